@@ -0,0 +1,42 @@
+# Generates a C++ source holding every file of the web interface as a byte array.
+# Invoked at build time by the EMBED_WEB_ASSETS option:
+#   cmake -DWEB_DIR=<web directory> -DOUTPUT=<generated .cpp> -P EmbedWebAssets.cmake
+
+file(GLOB_RECURSE WEB_FILES RELATIVE ${WEB_DIR} ${WEB_DIR}/*)
+list(SORT WEB_FILES)
+
+set(ARRAYS "")
+set(TABLE "")
+set(INDEX 0)
+
+foreach(WEB_FILE ${WEB_FILES})
+    file(READ ${WEB_DIR}/${WEB_FILE} HEX_CONTENT HEX)
+    string(LENGTH "${HEX_CONTENT}" HEX_LENGTH)
+    math(EXPR FILE_SIZE "${HEX_LENGTH} / 2")
+
+    if(FILE_SIZE EQUAL 0)
+        set(HEX_CONTENT "00")
+    endif()
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BYTES "${HEX_CONTENT}")
+
+    string(APPEND ARRAYS "const unsigned char asset${INDEX}[] = {${BYTES}};\n")
+    string(APPEND TABLE "    {\"/${WEB_FILE}\", asset${INDEX}, ${FILE_SIZE}},\n")
+    math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+if(INDEX EQUAL 0)
+    message(FATAL_ERROR "No web assets found in ${WEB_DIR}")
+endif()
+
+file(WRITE ${OUTPUT}
+"// Generated by cmake/EmbedWebAssets.cmake from ${WEB_DIR}, do not edit
+#include \"network/StaticAssetCache.hpp\"
+
+namespace {
+${ARRAYS}}
+
+extern const EmbeddedAsset g_embeddedWebAssets[] = {
+${TABLE}};
+
+extern const size_t g_embeddedWebAssetCount = ${INDEX};
+")
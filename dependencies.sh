@@ -44,6 +44,8 @@ sudo apt install -y \
     libssl-dev \
     libi2c-dev \
     libfreetype6-dev \
+    zlib1g-dev \
+    libbrotli-dev \
     wget \
     curl \
     unzip
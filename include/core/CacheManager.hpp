@@ -88,6 +88,9 @@ public:
 
     // Batch operations
     std::vector<std::string> getDirtyFiles() const;
+    // Copies every dirty entry back to the drive, up to maxParallel at a time.
+    // Returns the number written; entries that fail stay dirty.
+    size_t writeBackDirty(size_t maxParallel = 4);
     std::vector<std::string> getEvictionCandidates(size_t maxCount) const;
     void clearCache();
 
@@ -3,11 +3,13 @@
 #include <string>
 #include <queue>
 #include <mutex>
+#include <thread>
 #include <condition_variable>
 #include <memory>
 #include <vector>
 #include <functional>
 #include <chrono>
+#include "utils/LatencyHistogram.hpp"
 
 namespace usb_bridge {
 
@@ -86,14 +88,32 @@ public:
     // Buffer management
     uint64_t getAvailableBufferSpace() const;
     uint64_t getUsedBufferSpace() const;
+    const std::string& getLocalBufferPath() const { return m_localBufferPath; }
     bool hasBufferSpace(uint64_t requiredSize) const;
     void cleanupCompletedOperations(std::chrono::seconds olderThan);
     
+    // Reserve a buffer file for data arriving from a client (e.g. a streamed upload).
+    // Returns an empty path when the buffer can't hold requiredSize right now.
+    std::string allocateLocalBuffer(const std::string& clientId, uint64_t size);
+    void releaseLocalBuffer(const std::string& bufferPath);
+    void releaseLocalBuffer(const std::string& bufferPath, uint64_t reservedSize);
+    // Grow or shrink a reservation whose final size wasn't known up front (chunked uploads).
+    // Growing fails without changing anything when the buffer can't hold the difference.
+    bool resizeLocalBuffer(const std::string& bufferPath, uint64_t reservedSize, uint64_t newSize);
+    // Space taken under the buffer path by files the queue didn't allocate (the SMB staging
+    // layer), counted against the limit like reservations. Replaces the previous figure.
+    void setExternalBufferUsage(uint64_t bytes);
+    
     // Processing control
     void start();
     void stop();
     void pause();
     void resume();
+    // Runs queued operations until the queue is empty or timeout passes, then pauses.
+    // Operations queued meanwhile are held back until resume(), so the drain finishes what
+    // was queued when it started; what's left at the deadline stays queued. Returns false
+    // if an operation was still executing at the deadline.
+    bool drain(std::chrono::milliseconds timeout);
     bool isRunning() const;
     
     // Statistics
@@ -107,6 +127,13 @@ public:
         double averageOperationTime;
     };
     Statistics getStatistics() const;
+    LatencyHistogram::Snapshot getOperationDurations() const { return m_operationDurations.snapshot(); }
+
+    // Progress of the running operation, reported from the processing thread when it
+    // starts, at most every PROGRESS_INTERVAL while copying, and when it ends.
+    // Set before start().
+    using ProgressCallback = std::function<void(const FileOperation&)>;
+    void setProgressCallback(ProgressCallback callback) { m_progressCallback = std::move(callback); }
 
 private:
     void processQueue();
@@ -117,15 +144,17 @@ private:
     bool executeMkdir(std::shared_ptr<FileOperation> op);
     bool executeMove(std::shared_ptr<FileOperation> op);
     
-    std::string allocateLocalBuffer(const std::string& clientId, uint64_t size);
-    void releaseLocalBuffer(const std::string& bufferPath);
+    bool hasBufferSpaceLocked(uint64_t requiredSize) const;
     uint64_t calculateBufferUsage() const;
     
     uint64_t nextOperationId();
+    void enqueueLocked(const std::shared_ptr<FileOperation>& op);
+    void reportProgress(const FileOperation& op, bool force);
     
     std::string m_localBufferPath;
     uint64_t m_maxLocalBufferSize;
     uint64_t m_currentBufferUsage;
+    uint64_t m_externalBufferUsage;
     
     std::queue<std::shared_ptr<FileOperation>> m_queue;
     std::unordered_map<uint64_t, std::shared_ptr<FileOperation>> m_operations;
@@ -135,10 +164,20 @@ private:
     
     bool m_running;
     bool m_paused;
+    bool m_executing;            // An operation is between dequeue and completion callback
+    bool m_draining;
+    std::vector<std::shared_ptr<FileOperation>> m_held;   // Queued while draining
     std::thread m_processingThread;
     
     uint64_t m_nextId;
+    uint64_t m_nextBufferId;     // Keeps buffer names unique when many are allocated at once
     Statistics m_stats;
+    LatencyHistogram m_operationDurations;   // Execution time, queue wait excluded
+    
+    ProgressCallback m_progressCallback;
+    std::chrono::steady_clock::time_point m_lastProgressReport;
+    
+    static const std::chrono::milliseconds PROGRESS_INTERVAL;
 };
 
 } // namespace usb_bridge
\ No newline at end of file
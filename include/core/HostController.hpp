@@ -2,6 +2,9 @@
 
 #include <string>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
 #include <thread>
 #include <functional>
 
@@ -26,19 +29,91 @@ public:
     // Callback for status changes
     void setStatusCallback(std::function<void(int, ConnectionStatus)> callback);
     
-    // Access control
+    // Access control. With read-only access the LUN is exported with ro=1, so the host
+    // can share the drive with other readers.
     void enableAccess();
+    void enableReadOnlyAccess();
     void disableAccess();
     bool hasAccess() const { return m_accessEnabled; }
+    bool isReadOnly() const { return !m_accessEnabled || m_readOnly; }
+    bool updateAccessMode(bool readOnly);
+    
+    bool changeBackingFile(const std::string& newBackingFile);
+    std::string getConnectionInfo() const;
+
+    // Block-device passthrough: the LUN exports the drive's device node instead of the image
+    // file on its filesystem, so host I/O skips the board's filesystems. The caller keeps the
+    // drive unmounted (or mounted read-only, for a read-only LUN) while it is attached. The
+    // medium is swapped without rebinding; the host sees a media change.
+    bool attachBlockDevice(const std::string& devicePath, bool readOnly);
+    // Ejects the device or image file, forcibly if the host has locked the medium. The image
+    // keeps the drive busy and the device must not be written twice, so this comes before
+    // the drive is unmounted or remounted.
+    bool ejectMedium();
+    // Reinserts the image file once the drive is mounted on the board again
+    bool restoreBackingFile();
+    std::string getBlockDevice() const;
+    
+    // Image file exported when no block device is attached, created when the gadget first binds.
+    // Sparse images take space as the host writes; preallocated ones reserve it up front with
+    // fallocate. Format is fat32 (laid out in-process), exfat (mkfs.exfat) or none; anything
+    // else falls back to fat32.
+    void setBackingImageSize(uint64_t size) { m_imageSize = size; }
+    void setPreallocateBackingImage(bool preallocate) { m_preallocateImage = preallocate; }
+    void setBackingImageFormat(const std::string& format);
+    
+    // Writes boot sector, FSInfo, FAT heads and root directory of an empty FAT32 volume covering
+    // size bytes of fd, which must read as zeros. Fails below the 65525 clusters FAT32 needs.
+    static bool writeFat32Layout(int fd, uint64_t size, const std::string& label);
+    
+    // I/O of the block device behind the LUN, which is what the host does through the gadget.
+    // completed counts finished reads and writes; inFlight those still with the device.
+    bool getBackingIoCounters(uint64_t& completed, uint64_t& inFlight) const;
+    // Same counters for the block device holding path (a file on it, or the device node)
+    static bool readBlockIoCounters(const std::string& path, uint64_t& completed, uint64_t& inFlight);
 
 private:
+    // Binds the gadget, then sleeps until the UDC's state changes (sysfs poll), a UDC comes or
+    // goes (uevent) or disconnect() wakes it. Status follows the host: CONNECTED once it has
+    // configured the gadget, CONNECTING while it enumerates, DISCONNECTED when unplugged.
     void connectionLoop();
     void notifyStatusChange();
+    void setStatus(ConnectionStatus status);
+    bool bindGadget();
+    void updateHostState();
+    void closeStateWatch();
+    int openUeventSocket();
+    void waitForEvent(int ueventFd, std::chrono::milliseconds timeout);
+    
+    // USB gadget configuration through configfs
+    bool configureUsbGadget();
+    bool configureMassStorageBacking(const std::string& functionPath);
+    std::string prepareBackingFile();
+    void createBackingFile(const std::string& filePath);
+    bool insertMedium(const std::string& path, bool readOnly);
+    std::string findAvailableUDC();
+    bool isGadgetActive();
+    void cleanupUsbGadget();
+    bool writeGadgetFile(const std::string& filePath, const std::string& content);
     
     int m_hostId;
     std::atomic<ConnectionStatus> m_status;
     std::atomic<bool> m_accessEnabled;
+    std::atomic<bool> m_readOnly;
     std::atomic<bool> m_shouldRun;
     std::thread m_connectionThread;
     std::function<void(int, ConnectionStatus)> m_statusCallback;
+    
+    int m_wakeFd;               // eventfd, wakes the connection thread for disconnect()
+    int m_stateFd;              // /sys/class/udc/<udc>/state while the gadget is bound
+    std::string m_udcName;
+    
+    mutable std::mutex m_backingMutex;   // Serializes medium changes
+    std::string m_blockDevice;           // Attached device node, empty for the image file
+    uint64_t m_imageSize;
+    bool m_preallocateImage;
+    std::string m_imageFormat;
+    
+    static const std::chrono::milliseconds RETRY_INTERVAL;
+    static const std::chrono::milliseconds STATE_RECHECK_INTERVAL;
 };
\ No newline at end of file
@@ -1,9 +1,13 @@
 #pragma once
 
 #include <mutex>
+#include <condition_variable>
 #include <string>
 #include <chrono>
 #include <memory>
+#include <list>
+#include <vector>
+#include <functional>
 #include <unordered_map>
 
 namespace usb_bridge {
@@ -23,14 +27,24 @@ enum class ClientType {
     SYSTEM
 };
 
+// Order in which waiting direct access requests are served
+enum class QueuePolicy {
+    FIFO,              // Strictly in order of arrival
+    PRIORITY           // By client type priority, in order of arrival within a priority
+};
+
 struct AccessGrant {
     std::string clientId;
     ClientType clientType;
     AccessMode mode;
     std::chrono::system_clock::time_point grantedTime;
-    std::chrono::system_clock::time_point expiryTime;
+    std::chrono::system_clock::time_point expiryTime;       // Lease end, moved on by renewals
+    std::chrono::system_clock::time_point lastActivityTime;
+    std::chrono::system_clock::time_point deadline;         // Renewals never extend past this
+    std::chrono::system_clock::time_point sliceEnd;         // Preempted after this if others wait
     uint64_t operationId;  // Associated operation ID if any
     bool isActive;
+    bool readOnly;         // Shared with other read-only holders
 };
 
 class MutexLocker {
@@ -43,13 +57,23 @@ public:
     bool isBoardManaged() const;
     
     // Request direct access for large file operations
-    // Returns true if direct access granted, false if needs to wait or denied
+    // Waits in the queue for up to timeout. Access is handed to the next waiter on release,
+    // so a request arriving later can't overtake one that is already waiting.
+    // Returns true if direct access granted, false on timeout or when access is blocked
     bool requestDirectAccess(const std::string& clientId, 
                             ClientType clientType,
                             uint64_t operationId,
                             std::chrono::seconds timeout = std::chrono::seconds(30));
     
-    // Release direct access and return to board-managed mode
+    // Request read-only direct access, held together with any other read-only clients.
+    // Waits in the same queue: readers behind a waiting writer don't overtake it, and a
+    // writer is granted once the last reader has released.
+    bool requestSharedAccess(const std::string& clientId,
+                            ClientType clientType,
+                            uint64_t operationId,
+                            std::chrono::seconds timeout = std::chrono::seconds(30));
+    
+    // Release direct access (exclusive or shared); the board regains the drive when no one holds it
     void releaseDirectAccess(const std::string& clientId);
     
     // Check if a specific client has direct access
@@ -58,9 +82,37 @@ public:
     // Get current access mode
     AccessMode getCurrentAccessMode() const;
     
-    // Get current access holder (if any)
+    // Get current access holder (if any); read-only holders are listed comma separated
     std::string getCurrentAccessHolder() const;
     
+    // Wait queue. Positions are 1-based, 0 when the client isn't waiting.
+    void setQueuePolicy(QueuePolicy policy);
+    void setClientPriority(ClientType clientType, int priority);   // Higher is served first
+    size_t getQueuePosition(const std::string& clientId) const;
+    std::vector<std::string> getWaitingClients() const;            // In the order they'll be served
+    
+    // Grants are leases: they run out idleTimeout after the last renewal, and after maxDuration
+    // no matter what. Holders renew on activity; releaseExpiredGrants() takes back the rest.
+    void setLeaseLimits(std::chrono::seconds idleTimeout, std::chrono::seconds maxDuration);
+    // expectedRemaining extends the lease to when a transfer in progress should finish
+    bool renewAccess(const std::string& clientId,
+                     std::chrono::seconds expectedRemaining = std::chrono::seconds(0));
+    // Returns the clients whose grants were released
+    std::vector<std::string> releaseExpiredGrants();
+    
+    // Time slicing. While others wait, a holder keeps the drive for timeSlice times the weight
+    // of its client type and is then preempted. Between two holders the board gets boardWindow
+    // to work off its queue, if boardHasWork says there is something to do. A timeSlice of
+    // zero disables preemption. Slices end and windows close in releaseExpiredGrants().
+    void setTimeSlicing(std::chrono::seconds timeSlice, std::chrono::seconds boardWindow);
+    void setSliceWeight(ClientType clientType, unsigned weight);
+    void setBoardWorkCheck(std::function<bool()> boardHasWork);
+    
+    // Time source for leases, slices and board windows, replaceable to simulate time.
+    // Waiting in requestDirectAccess() is always real time.
+    using Clock = std::function<std::chrono::system_clock::time_point()>;
+    void setClock(Clock clock);
+    
     // Force release of all access (emergency use)
     void forceReleaseAll();
     
@@ -80,7 +132,10 @@ public:
         uint64_t deniedDirectAccess;
         uint64_t timeoutDirectAccess;
         std::chrono::milliseconds averageDirectAccessDuration;
-        uint64_t currentQueuedRequests;
+        uint64_t currentQueuedRequests;   // Waiting in the queue right now
+        uint64_t expiredGrants;           // Taken back when the lease ran out
+        uint64_t preemptedGrants;         // Taken back at the end of a time slice
+        uint64_t boardWindows;            // Windows given to the board between holders
     };
     Statistics getStatistics() const;
     
@@ -88,17 +143,63 @@ public:
     std::vector<AccessGrant> getActiveGrants() const;
 
 private:
+    // One per waiting request; the releasing thread grants access and wakes only this waiter
+    struct Waiter {
+        uint64_t ticket;
+        std::string clientId;
+        ClientType clientType;
+        uint64_t operationId;
+        int priority;
+        bool readOnly;
+        std::condition_variable condition;
+        bool granted = false;
+        bool cancelled = false;   // Access was blocked while waiting
+    };
+    
+    bool requestAccess(const std::string& clientId,
+                       ClientType clientType,
+                       uint64_t operationId,
+                       std::chrono::seconds timeout,
+                       bool readOnly);
     bool grantDirectAccess(const std::string& clientId, 
                           ClientType clientType, 
-                          uint64_t operationId);
+                          uint64_t operationId,
+                          bool readOnly);
+    bool canGrant(bool readOnly) const;
+    void updateAccessMode();
+    // Removes a holder's grant and accounts for it; the caller updates the mode and the queue
+    std::shared_ptr<AccessGrant> takeGrant(const std::string& clientId);
+    void endGrant(const std::shared_ptr<AccessGrant>& grant);
+    // After the last holder left, with clients still waiting
+    void openBoardWindow();
     
-    void cleanupExpiredGrants();
+    // Hands access to the head of the queue while it can be granted: a writer once the drive
+    // is free, or every reader up to the next writer. Called with m_mutex held.
+    void grantWaiters();
+    void enqueueWaiter(std::shared_ptr<Waiter> waiter);
+    void cancelWaiters();
+    int getClientPriority(ClientType clientType) const;
     
     mutable std::mutex m_mutex;
-    std::condition_variable m_condition;
     
     AccessMode m_currentMode;
-    std::shared_ptr<AccessGrant> m_currentGrant;
+    std::shared_ptr<AccessGrant> m_currentGrant;    // Exclusive holder
+    std::unordered_map<std::string, std::shared_ptr<AccessGrant>> m_sharedGrants;   // Read-only holders
+    
+    std::chrono::seconds m_idleTimeout;
+    std::chrono::seconds m_maxGrantDuration;
+    
+    Clock m_clock;
+    std::chrono::seconds m_timeSlice;
+    std::chrono::seconds m_boardWindow;
+    std::unordered_map<int, unsigned> m_sliceWeights;   // ClientType -> weight
+    std::function<bool()> m_boardHasWork;
+    std::chrono::system_clock::time_point m_boardWindowEnd;   // No grants before this
+    
+    std::list<std::shared_ptr<Waiter>> m_waitQueue;
+    uint64_t m_nextTicket;
+    QueuePolicy m_queuePolicy;
+    std::unordered_map<int, int> m_clientPriorities;   // ClientType -> priority
     
     std::unordered_map<std::string, std::shared_ptr<AccessGrant>> m_accessHistory;
     
@@ -115,12 +216,14 @@ public:
                      const std::string& clientId,
                      ClientType clientType,
                      uint64_t operationId,
-                     std::chrono::seconds timeout = std::chrono::seconds(30))
+                     std::chrono::seconds timeout = std::chrono::seconds(30),
+                     bool readOnly = false)
         : m_locker(locker)
         , m_clientId(clientId)
         , m_acquired(false)
     {
-        m_acquired = m_locker.requestDirectAccess(clientId, clientType, operationId, timeout);
+        m_acquired = readOnly ? m_locker.requestSharedAccess(clientId, clientType, operationId, timeout)
+                              : m_locker.requestDirectAccess(clientId, clientType, operationId, timeout);
     }
     
     ~DirectAccessGuard() {
@@ -36,6 +36,8 @@ public:
     // Drive management
     bool mountDrive(const std::string& devicePath);
     bool unmountDrive();
+    // Switches the mounted drive between read-only and read-write in place
+    bool remountDrive(bool readOnly);
     bool isDriveConnected() const { return m_driveConnected; }
     DriveInfo getDriveInfo() const;
     
@@ -6,6 +6,8 @@
 #include "FileChangeLogger.hpp"
 #include "ConfigManager.hpp"
 #include "FileOperationQueue.hpp"
+#include "WriteQueueManager.hpp"
+#include "CacheManager.hpp"
 #include "network/NetworkManager.hpp"
 #include "network/SmbServer.hpp"
 #include "network/HttpServer.hpp"
@@ -18,20 +20,21 @@
 namespace usb_bridge {
 
 struct SystemStatus {
-    bool driveConnected;
-    bool usbHost1Connected;
-    bool usbHost2Connected;
-    bool networkActive;
-    bool smbServerRunning;
-    bool httpServerRunning;
-    AccessMode currentAccessMode;
+    bool driveConnected = false;
+    bool usbHost1Connected = false;
+    bool usbHost2Connected = false;
+    bool networkActive = false;
+    bool smbServerRunning = false;
+    bool httpServerRunning = false;
+    AccessMode currentAccessMode = AccessMode::NONE;
     std::string accessHolder;
-    uint64_t queuedOperations;
-    uint64_t availableBufferSpace;
-    uint64_t usedBufferSpace;
-    uint64_t driveCapacity;
-    uint64_t driveUsed;
-    uint64_t driveFree;
+    std::vector<std::string> accessQueue;   // Clients waiting for direct access, next first
+    uint64_t queuedOperations = 0;
+    uint64_t availableBufferSpace = 0;
+    uint64_t usedBufferSpace = 0;
+    uint64_t driveCapacity = 0;
+    uint64_t driveUsed = 0;
+    uint64_t driveFree = 0;
     std::string driveMountPoint;
     std::string driveFilesystem;
 };
@@ -61,6 +64,8 @@ public:
     MutexLocker& getMutexLocker();
     FileChangeLogger& getFileLogger();
     FileOperationQueue& getOperationQueue();
+    WriteQueueManager& getWriteQueueManager();
+    CacheManager& getCacheManager();
     NetworkManager& getNetworkManager();
     SmbServer& getSmbServer();
     HttpServer& getHttpServer();
@@ -81,6 +86,12 @@ public:
                             uint64_t fileSize,
                             std::function<void(const FileOperation&)> callback = nullptr);
     
+    // Many buffered files and directories written as one ordered batch (see WriteQueueManager)
+    std::vector<uint64_t> clientWriteBatch(const std::string& clientId,
+                                           ClientType clientType,
+                                           std::vector<WriteBatchItem> items,
+                                           std::function<void(const FileOperation&)> callback = nullptr);
+    
     uint64_t clientDeleteFile(const std::string& clientId,
                              ClientType clientType,
                              const std::string& drivePath,
@@ -109,8 +120,17 @@ public:
                             ClientType clientType,
                             uint64_t operationId,
                             std::chrono::seconds timeout = std::chrono::seconds(30));
+    // Shared with other read-only clients; USB hosts see the drive write-protected
+    bool requestReadOnlyAccess(const std::string& clientId,
+                              ClientType clientType,
+                              uint64_t operationId,
+                              std::chrono::seconds timeout = std::chrono::seconds(30));
     
     void releaseDirectAccess(const std::string& clientId);
+    // Heartbeat for a holder's transfer; expectedRemaining is how long it should still take.
+    // Network clients are renewed as http_, webdav_ or smb_ followed by their address.
+    bool renewDirectAccess(const std::string& clientId,
+                           std::chrono::seconds expectedRemaining = std::chrono::seconds(0));
     
     // System maintenance
     void cleanupOldOperations();
@@ -129,10 +149,31 @@ private:
     void monitoringThread();
     void maintenanceThread();
     void handleFileSystemEvents();
-    void switchToDirectAccessMode(const std::string& clientId, ClientType type);
+    // False when the board couldn't hand the drive over; the caller then releases the grant
+    bool switchToDirectAccessMode(const std::string& clientId, ClientType type, bool readOnly);
     void switchToBoardManagedMode();
+    // Pauses write intake, flushes queued operations (bounded by m_drainTimeout), writes back
+    // dirty cache entries and syncs the drive; done once per handover from the board. Fails,
+    // with both queues running again, when an operation is still executing at the deadline.
+    bool drainForHandover();
+    void returnDriveToBoard();
+    // Block-device passthrough (access.blockPassthrough): USB holders get the drive's device
+    // instead of the image file on it. A writer has it unmounted from the board, which needs
+    // Samba stopped beforehand (switchToDirectAccessMode does so ahead of the drain); readers
+    // share it mounted read-only. Callers hold m_handoverMutex.
+    bool passDriveThrough(bool readOnly);
+    bool takeDriveFromGadget();
+    void checkDirectAccessLeases();
     bool isLargeFile(uint64_t fileSize) const;
     
+    // Live updates for the web interface (/api/events)
+    nlohmann::json buildStatusJson(const SystemStatus& status) const;
+    void publishOperationProgress(const FileOperation& operation);
+    void publishFileEvent(const FileOperation& operation);
+    
+    // Prometheus text served on /api/metrics
+    std::string buildMetrics() const;
+    
     // Core components
     std::unique_ptr<ConfigManager> m_config;
     std::unique_ptr<StorageManager> m_storage;
@@ -140,6 +181,8 @@ private:
     std::unique_ptr<MutexLocker> m_mutexLocker;
     std::unique_ptr<FileChangeLogger> m_fileLogger;
     std::unique_ptr<FileOperationQueue> m_operationQueue;
+    std::unique_ptr<WriteQueueManager> m_writeQueue;
+    std::unique_ptr<CacheManager> m_cacheManager;
     
     // Network components
     std::unique_ptr<NetworkManager> m_network;
@@ -157,6 +200,7 @@ private:
     // System state
     mutable std::mutex m_statusMutex;
     SystemStatus m_status;
+    mutable std::atomic<size_t> m_metricsSizeHint;   // Last /api/metrics size, reserved up front
     
     // Configuration parameters (loaded from config)
     std::string m_localBufferPath;
@@ -164,6 +208,18 @@ private:
     uint64_t m_largeFileThreshold;
     std::chrono::seconds m_operationCleanupAge;
     std::chrono::seconds m_maintenanceInterval;
+    
+    // Handover to direct access
+    std::chrono::seconds m_drainTimeout;
+    std::mutex m_handoverMutex;
+    bool m_boardDrained;                  // Queue paused and drive synced for the current holders
+    bool m_blockPassthrough;
+    std::string m_passthroughDevice;      // Exported to the USB hosts, empty while the board has it
+    bool m_passthroughReadOnly;
+    bool m_smbSuspended;                  // Samba stopped to unmount the drive for a writer
+    LatencyHistogram m_drainDurations;
+    uint64_t m_lastGadgetIo;              // Gadget I/O at the last lease check
+    std::chrono::system_clock::time_point m_startTime;
 };
 
 } // namespace usb_bridge
\ No newline at end of file
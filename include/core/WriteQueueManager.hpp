@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core/FileOperationQueue.hpp"
+#include "core/MutexLocker.hpp"
 #include <string>
 #include <vector>
 #include <queue>
@@ -31,6 +32,7 @@ struct WriteRequest {
     std::chrono::system_clock::time_point scheduledTime;
     uint64_t operationId;  // FileOperationQueue operation ID once queued
     bool queued;
+    bool isDirectory;      // Create drivePath instead of copying localPath
     std::function<void(const FileOperation&)> callback;
 };
 
@@ -43,10 +45,22 @@ struct WriteRequestComparator {
             return static_cast<int>(a->priority) < static_cast<int>(b->priority);
         }
         // Same priority: earlier submission time comes first
-        return a->submittedTime > b->submittedTime;
+        if (a->submittedTime != b->submittedTime) {
+            return a->submittedTime > b->submittedTime;
+        }
+        // Submitted together (a batch): keep submission order
+        return a->id > b->id;
     }
 };
 
+// One file or directory of a batch passed to submitBatch()
+struct WriteBatchItem {
+    std::string localPath;      // Buffered contents; unused for directories
+    std::string drivePath;
+    uint64_t fileSize = 0;
+    bool isDirectory = false;
+};
+
 /**
  * WriteQueueManager - Manages write operations with priority and batching
  * 
@@ -70,6 +84,15 @@ public:
                         WritePriority priority = WritePriority::NORMAL,
                         std::function<void(const FileOperation&)> callback = nullptr);
 
+    // Submit many writes at once (e.g. an unpacked archive). Directories are created first,
+    // parents before children, then files follow grouped by directory, so the drive sees
+    // one sequential pass. Returns the request IDs in execution order.
+    std::vector<uint64_t> submitBatch(const std::string& clientId,
+                                      ClientType clientType,
+                                      std::vector<WriteBatchItem> items,
+                                      WritePriority priority = WritePriority::NORMAL,
+                                      std::function<void(const FileOperation&)> callback = nullptr);
+
     // Priority management
     bool updatePriority(uint64_t requestId, WritePriority newPriority);
     WritePriority getPriority(uint64_t requestId) const;
@@ -16,9 +16,11 @@ private:
     void createWifiSection();
     void createEthernetSection();
     void createServiceStatus();
+    void createActivitySection();
     void scanWifiNetworks();
     void updateWifiList();
     void updateConnectionStatus();
+    void updateActivity();
     void onWifiConnect(const std::string& ssid);
     void onWifiDisconnect();
     void showPasswordDialog(const std::string& ssid);
@@ -31,6 +33,8 @@ private:
     lv_obj_t* m_smbSwitch;
     lv_obj_t* m_httpSwitch;
     lv_obj_t* m_passwordDialog;
+    lv_obj_t* m_smbActivity;
+    lv_obj_t* m_trafficStatus;
     
     std::vector<WifiNetwork> m_wifiNetworks;
     std::string m_selectedSsid;
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ctime>
+#include "network/HttpServer.hpp"
+
+struct stat;
+
+/**
+ * ArchiveStreamer - Writes a directory tree as a tar or zip archive on the fly
+ *
+ * Nothing is staged on disk and memory stays bounded by the output buffer:
+ *  - tar sends file data with sendfile; only files smaller than SMALL_FILE_SIZE are
+ *    read into the buffer, so runs of small files leave in a few large writes.
+ *  - zip is store-only. The CRC has to be computed from the data, so file contents
+ *    pass through the buffer once and the CRC follows each entry in a data descriptor.
+ *    The central directory (about 50 bytes plus the name per entry) is the only part
+ *    that grows with the number of entries. Zip64 records are used where needed.
+ * Symbolic links and special files are skipped, so the archive never leaves the tree.
+ */
+class ArchiveStreamer {
+public:
+    enum class Format {
+        TAR,
+        ZIP
+    };
+    
+    ArchiveStreamer(Format format, const HttpBodyWriter& output);
+    
+    // Archives the tree under directory with every entry name starting with prefix
+    // (e.g. "photos/"). Returns false if the client went away or a file couldn't be read.
+    bool write(const std::string& directory, const std::string& prefix);
+
+private:
+    struct ZipEntry {
+        std::string name;
+        uint32_t crc;
+        uint64_t size;
+        uint64_t offset;
+        uint16_t dosTime;
+        uint16_t dosDate;
+        uint32_t mode;
+        bool zip64;
+    };
+    
+    bool addDirectory(int dirFd, const std::string& name, const struct stat& st, int depth);
+    bool addFile(const HttpFileBody& file, const std::string& name, const struct stat& st);
+    
+    bool writeTarHeader(const std::string& name, const struct stat& st, uint64_t size, char type);
+    bool writeZipLocalHeader(ZipEntry& entry);
+    bool writeZipDataDescriptor(const ZipEntry& entry);
+    bool writeZipCentralDirectory();
+    
+    bool copyFileData(int fd, uint64_t length, uint32_t* crc);
+    bool emit(const void* data, size_t length);
+    bool pad(size_t length);
+    bool flush();
+    
+    static void formatTarHeader(char* block, const std::string& name, uint32_t mode, uint64_t size,
+                                int64_t mtime, char type);
+    static std::string paxRecord(const std::string& key, const std::string& value);
+    static void setDosTime(ZipEntry& entry, time_t mtime);
+    
+    Format m_format;
+    const HttpBodyWriter& m_output;
+    std::vector<char> m_buffer;
+    size_t m_used = 0;
+    uint64_t m_offset = 0;      // Bytes of archive produced so far
+    std::vector<ZipEntry> m_zipEntries;
+    
+    static const size_t BUFFER_SIZE;
+    static const uint64_t SMALL_FILE_SIZE;
+    static const int MAX_DEPTH;
+};
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * DavLockManager - WebDAV write locks (RFC 4918 class 2)
+ *
+ * Locks are advisory state kept in memory: they protect a resource from other
+ * WebDAV clients, not from USB hosts or SMB, and they don't survive a restart,
+ * which clients handle by locking again. Paths are drive paths; a depth-infinity
+ * lock covers everything below its root. Expired locks are dropped lazily.
+ */
+class DavLockManager {
+public:
+    struct Lock {
+        std::string token;        // "opaquelocktoken:<uuid>"
+        std::string path;         // Lock root
+        bool exclusive = true;
+        bool infinite = false;    // Depth infinity
+        std::string owner;        // Text of the client's DAV:owner
+        uint32_t timeoutSeconds = 0;
+        std::chrono::steady_clock::time_point expires;
+    };
+    
+    // Returns false when an existing lock conflicts
+    bool lock(Lock& lock);
+    bool refresh(const std::string& token, uint32_t timeoutSeconds, Lock& refreshed);
+    bool unlock(const std::string& path, const std::string& token);
+    
+    // Locks on path or an ancestor's infinite locks, and with includeDescendants locks below path
+    std::vector<Lock> getLocks(const std::string& path, bool includeDescendants);
+    
+    // True if every lock affecting path was submitted in the request's If header
+    bool isAllowed(const std::string& path, std::string_view ifHeader, bool includeDescendants);
+    
+    // Locks on a deleted or moved-away tree go with it
+    void removeTree(const std::string& path);
+    
+    static const uint32_t DEFAULT_TIMEOUT_SECONDS;
+    static const uint32_t MAX_TIMEOUT_SECONDS;
+
+private:
+    void purgeExpired();
+    static bool isWithin(const std::string& path, const std::string& root);
+    static std::string generateToken();
+    
+    std::mutex m_mutex;
+    std::map<std::string, Lock> m_locks;   // By token
+};
\ No newline at end of file
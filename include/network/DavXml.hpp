@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <string_view>
+
+/**
+ * DavXml - The little XML that WebDAV request and response bodies need
+ *
+ * Request bodies (lockinfo, propertyupdate, propfind) are small and flat, so they
+ * are searched for elements by local name instead of being parsed into a tree.
+ * Namespace prefixes are resolved against every xmlns declaration in the document,
+ * which is exact for the bodies real clients send.
+ */
+class DavXml {
+public:
+    struct Name {
+        std::string namespaceUri;
+        std::string localName;
+    };
+    
+    static std::string escape(std::string_view text);
+    
+    // Percent-encodes everything but unreserved characters and '/' for use in an href
+    static std::string encodeHref(std::string_view path);
+    
+    // Contents of the first element with this local name in any namespace; found tells
+    // apart a missing element from an empty one
+    static std::string_view findElement(std::string_view xml, std::string_view localName, bool& found);
+    static bool hasElement(std::string_view xml, std::string_view localName);
+    
+    // Names of the properties inside every <prop> element (PROPPATCH set/remove, PROPFIND prop)
+    static std::vector<Name> propertyNames(std::string_view xml);
+
+private:
+    static std::string_view localPart(std::string_view qualifiedName);
+    static std::string resolveNamespace(std::string_view xml, std::string_view qualifiedName);
+};
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <map>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+
+struct stat;
+
+/**
+ * DirectoryListingCache - Scanned directories kept for paginated listing
+ *
+ * Reading a large directory (readdir plus a stat per entry) is far more expensive
+ * than serving a page of it, so each scan is kept and reused while the directory's
+ * own mtime is unchanged. Entries are only stat'ed during the scan, so cached sizes
+ * and times of files changed in place can be up to MAX_AGE old.
+ * Listings are immutable once published; pages are served without holding the cache lock.
+ */
+class DirectoryListingCache {
+public:
+    enum class SortKey {
+        NAME,
+        SIZE,
+        MODIFIED
+    };
+    
+    struct Entry {
+        std::string name;
+        uint64_t size;
+        int64_t modified;   // Seconds since the epoch
+        uint32_t modifiedNsec;
+        uint64_t inode;
+        bool isDirectory;
+    };
+    
+    class Listing {
+    public:
+        const std::vector<Entry>& getEntries() const { return m_entries; }
+        
+        // Entry indices in the requested order, directories always first; built on first use
+        std::shared_ptr<const std::vector<uint32_t>> getOrder(SortKey key, bool descending) const;
+    
+    private:
+        friend class DirectoryListingCache;
+        
+        std::vector<Entry> m_entries;
+        struct timespec m_directoryMtime = {};
+        uint64_t m_inode = 0;
+        std::chrono::steady_clock::time_point m_loadedAt;
+        mutable std::mutex m_orderMutex;
+        mutable std::shared_ptr<const std::vector<uint32_t>> m_orders[6];
+    };
+    
+    // Returns null if the path is not a readable directory
+    std::shared_ptr<const Listing> get(const std::string& path);
+    
+    void invalidate(const std::string& path);
+    void clear();
+
+private:
+    static std::shared_ptr<Listing> scan(const std::string& path, const struct stat& st);
+    
+    struct CachedListing {
+        std::shared_ptr<const Listing> listing;
+        uint64_t lastUsed;
+    };
+    
+    std::mutex m_mutex;
+    std::map<std::string, CachedListing> m_listings;
+    uint64_t m_useCounter = 0;
+    
+    static const size_t MAX_CACHED_LISTINGS;
+    static const std::chrono::seconds MAX_AGE;
+};
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <condition_variable>
+#include <nlohmann/json.hpp>
+
+/**
+ * EventHub - Fan-out of live updates to Server-Sent Events clients
+ *
+ * Publishers never block on subscribers and every subscriber's backlog is bounded:
+ *  - States (e.g. "status") are diffed per subscriber, so a slow client gets one
+ *    delta covering everything it missed instead of every intermediate state.
+ *  - Updates (e.g. operation progress) are keyed; only the latest per key is kept.
+ *  - Events (e.g. file changes) are queued up to a limit; on overflow the queue is
+ *    dropped and the client is told to resync.
+ */
+class EventHub {
+public:
+    struct Subscriber;
+    
+    EventHub();
+    
+    // Null when maxSubscribers are subscribed already
+    std::shared_ptr<Subscriber> subscribe(size_t maxSubscribers);
+    void unsubscribe(const std::shared_ptr<Subscriber>& subscriber);
+    size_t getSubscriberCount() const;
+    
+    void publishState(const std::string& topic, const nlohmann::json& state);
+    void publishUpdate(const std::string& event, const std::string& key, const nlohmann::json& data);
+    void publishEvent(const std::string& event, const nlohmann::json& data);
+    
+    // Blocks until something is pending for the subscriber, the timeout passes or the
+    // hub shuts down. Returns the pending items formatted as SSE, empty if there are none.
+    std::string waitForEvents(const std::shared_ptr<Subscriber>& subscriber, std::chrono::milliseconds timeout);
+    
+    // Wakes all waiting subscribers so their streams can close; start() lets them wait again
+    void shutdown();
+    void start();
+
+private:
+    static nlohmann::json diffState(const nlohmann::json& from, const nlohmann::json& to);
+    static void appendEvent(std::string& out, const std::string& event, const std::string& data);
+    static bool hasPending(const Subscriber& subscriber);
+    
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::set<std::shared_ptr<Subscriber>> m_subscribers;
+    std::map<std::string, nlohmann::json> m_states;
+    bool m_shutdown;
+    
+    static const size_t MAX_PENDING_UPDATES;
+    static const size_t MAX_PENDING_EVENTS;
+};
\ No newline at end of file
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <string_view>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * HttpRequestParser - Incremental parser for HTTP/1.x request heads
+ *
+ * Works directly on the connection's receive buffer: call parse() with everything
+ * received so far for the current request, as often as needed, until it reports
+ * COMPLETE. Already scanned bytes are not scanned again. All results are views into
+ * that buffer, so nothing is allocated and the buffer must stay untouched while the
+ * request is being handled.
+ */
+class HttpRequestParser {
+public:
+    enum class Status {
+        INCOMPLETE,     // Need more data
+        COMPLETE,       // Head parsed, headLength() bytes belong to it
+        ERROR           // Malformed or over a limit, see errorStatus()
+    };
+    
+    struct Header {
+        std::string_view name;
+        std::string_view value;
+    };
+    
+    static const size_t MAX_HEADERS = 64;
+    static const size_t MAX_REQUEST_LINE = 8 * 1024;
+    
+    explicit HttpRequestParser(size_t maxHeadSize = 16 * 1024);
+    
+    void reset();
+    Status parse(std::string_view data);
+    
+    // HTTP status to answer with after ERROR (400, 414, 431, 501)
+    int errorStatus() const { return m_errorStatus; }
+    size_t headLength() const { return m_headLength; }
+    
+    std::string_view method() const { return m_method; }
+    std::string_view target() const { return m_target; }
+    std::string_view path() const { return m_path; }      // Raw (still percent-encoded)
+    std::string_view query() const { return m_query; }
+    std::string_view version() const { return m_version; }
+    
+    // Case-insensitive lookup, empty when absent
+    std::string_view header(std::string_view name) const;
+    size_t headerCount() const { return m_headerCount; }
+    const Header& headerAt(size_t index) const { return m_headers[index]; }
+    
+    // Body framing
+    bool isChunked() const { return m_chunked; }
+    bool hasContentLength() const { return m_hasContentLength; }
+    uint64_t contentLength() const { return m_contentLength; }
+
+private:
+    Status fail(int status);
+    bool parseRequestLine(std::string_view line);
+    bool parseHeaderLine(std::string_view line);
+    bool applyFramingHeader(const Header& header);
+    
+    size_t m_maxHeadSize;
+    size_t m_scanned;        // Bytes already searched for the end of the head
+    size_t m_leadingBytes;   // Empty lines tolerated before the request line
+    size_t m_headLength;
+    int m_errorStatus;
+    
+    std::string_view m_method;
+    std::string_view m_target;
+    std::string_view m_path;
+    std::string_view m_query;
+    std::string_view m_version;
+    
+    Header m_headers[MAX_HEADERS];
+    size_t m_headerCount;
+    
+    bool m_chunked;
+    bool m_hasContentLength;
+    uint64_t m_contentLength;
+};
+
+/**
+ * ChunkedDecoder - Incremental decoder for "Transfer-Encoding: chunked" bodies
+ *
+ * Input may be split anywhere, including inside chunk-size lines. decode() consumes
+ * framing bytes and returns at most one span of payload per call as a view into the
+ * input, so payload is never copied.
+ */
+class ChunkedDecoder {
+public:
+    static const size_t MAX_EXTENSION_LENGTH = 1024;
+    static const size_t MAX_TRAILER_SIZE = 8 * 1024;
+    
+    ChunkedDecoder();
+    
+    void reset();
+    
+    // Returns the number of input bytes consumed; payload is set to the data found (may be empty)
+    size_t decode(std::string_view input, std::string_view& payload);
+    
+    bool done() const { return m_state == State::DONE; }
+    bool failed() const { return m_state == State::ERROR; }
+
+private:
+    enum class State {
+        SIZE,
+        EXTENSION,
+        SIZE_LF,
+        DATA,
+        DATA_CR,
+        DATA_LF,
+        TRAILER_START,
+        TRAILER_LINE,
+        TRAILER_LF,
+        FINAL_LF,
+        DONE,
+        ERROR
+    };
+    
+    State m_state;
+    uint64_t m_remaining;
+    size_t m_sizeDigits;
+    size_t m_extensionLength;
+    size_t m_trailerSize;
+};
+
+/**
+ * HttpInputBuffer - Fixed-size receive buffer owned by one connection
+ *
+ * Allocated once per connection. Data never moves on its own: only compact() and
+ * truncate() invalidate views into the buffer, so the owner decides when a parsed
+ * request head may be overwritten.
+ */
+class HttpInputBuffer {
+public:
+    explicit HttpInputBuffer(size_t capacity);
+    
+    std::string_view view() const { return std::string_view(m_data.get() + m_start, m_end - m_start); }
+    size_t size() const { return m_end - m_start; }
+    bool empty() const { return m_start == m_end; }
+    
+    // recv() into the free space at the end; returns the recv() result, 0 when full
+    long fill(int socket);
+    void consume(size_t length);
+    
+    // Move unconsumed bytes to the front of the buffer
+    void compact();
+    // Drop everything after the first length unconsumed bytes
+    void truncate(size_t length);
+
+private:
+    std::unique_ptr<char[]> m_data;
+    size_t m_capacity;
+    size_t m_start;
+    size_t m_end;
+};
\ No newline at end of file
@@ -1,13 +1,111 @@
 #pragma once
 
 #include <map>
+#include <set>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <atomic>
 #include <thread>
+#include <memory>
+#include <ctime>
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <string_view>
+#include <condition_variable>
+#include "network/HttpRequestParser.hpp"
+#include "network/StaticAssetCache.hpp"
+#include "network/EventHub.hpp"
+#include "network/DirectoryListingCache.hpp"
+#include "network/UploadSessionStore.hpp"
+#include "network/DavLockManager.hpp"
+#include "utils/LatencyHistogram.hpp"
+
+// One per connection, cleared between its requests so the strings keep their capacity
+struct HttpRequest {
+    // The request line and headers are views into the connection buffer, valid until the
+    // response is sent
+    std::string_view method;
+    std::string_view query;     // Raw query string (after '?')
+    std::string_view version;   // "HTTP/1.0" or "HTTP/1.1"
+    uint64_t contentLength = 0;
+    bool chunked = false;       // Body sent with Transfer-Encoding: chunked
+    std::string body;
+    std::string remoteAddress;
+    std::chrono::steady_clock::time_point start;   // Head parsed; request latency counts from here
+    const HttpRequestParser* parser = nullptr;
+    
+    std::string_view header(std::string_view name) const;
+    
+    // Path without the query string, percent-decoded the first time it is asked for
+    const std::string& path() const;
+    
+    // Forgets the request but not the connection's remote address
+    void clear();
+
+private:
+    mutable std::string m_path;
+    mutable bool m_pathDecoded = false;
+};
+
+struct stat;
+
+namespace usb_bridge {
+class UsbBridge;
+struct FileOperation;
+struct WriteBatchItem;
+}
+
+// Open file sent as the response body by the kernel (sendfile/splice), never copied into memory
+struct HttpFileBody {
+    static const uint64_t UNTIL_EOF;  // Length of sources without a known size
+    
+    // One part of a multipart/byteranges body
+    struct Part {
+        std::string header;
+        uint64_t offset;
+        uint64_t length;
+    };
+    
+    int fd = -1;
+    uint64_t offset = 0;
+    uint64_t length = 0;   // Total body length, including part headers and trailer
+    bool regular = true;   // Pipes the server sets up itself are spliced instead of sendfile'd
+    std::string leaseClientId;   // Renews this client's direct-access grant, if it holds one, while sending
+    std::vector<Part> parts;
+    std::string trailer;
+    
+    HttpFileBody() = default;
+    ~HttpFileBody();
+    HttpFileBody(const HttpFileBody&) = delete;
+    HttpFileBody& operator=(const HttpFileBody&) = delete;
+};
+
+// Output of a generated response body; both calls return false once the client is gone
+struct HttpBodyWriter {
+    std::function<bool(const char* data, size_t length)> write;
+    std::function<bool(const HttpFileBody& file, uint64_t offset, uint64_t length)> writeFile;  // Zero-copy
+};
+
+struct HttpResponse {
+    int statusCode = 200;
+    std::string contentType;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    std::shared_ptr<const std::string> sharedBody;  // Sent instead of body when set, owned by a cache
+    std::shared_ptr<HttpFileBody> file;  // Sent after body when set
+    
+    // Body generated while it is sent, chunked on HTTP/1.1
+    std::function<bool(const HttpBodyWriter&)> stream;
+    
+    bool headOnly = false;  // HEAD: the head is sent as for GET, the body is dropped
+};
 
 class HttpServer {
 public:
+    using ApiHandler = std::function<HttpResponse(const HttpRequest&)>;
+    
     HttpServer();
     ~HttpServer();
 
@@ -19,8 +117,23 @@ public:
     void setDocumentRoot(const std::string& path) { m_documentRoot = path; }
     void setPort(int port) { m_port = port; }
     
+    // Bridge used to hand uploaded files to the write pipeline
+    void setBridge(usb_bridge::UsbBridge* bridge) { m_bridge = bridge; }
+    
+    // Persistent connections (HTTP/1.1 keep-alive with pipelining)
+    void setKeepAliveTimeout(int seconds) { m_keepAliveTimeout = seconds; }
+    void setMaxRequestsPerConnection(int maxRequests) { m_maxRequestsPerConnection = maxRequests; }
+    // Each connection has a thread and an input buffer; beyond this many new ones get 503
+    void setMaxConnections(int maxConnections) { m_maxConnections = maxConnections; }
+    
+    // How long a WebDAV change waits for the write queue before it is answered with 202
+    void setDavOperationTimeout(int seconds) { m_davOperationTimeout = seconds; }
+    
     // REST API endpoints
-    void addApiEndpoint(const std::string& path, std::function<std::string(const std::string&)> handler);
+    void addApiEndpoint(const std::string& path, ApiHandler handler);
+    
+    // Live updates pushed to /api/events subscribers
+    EventHub& getEventHub() { return m_eventHub; }
     
     // File serving
     void enableDirectoryListing(bool enable) { m_directoryListing = enable; }
@@ -29,13 +142,124 @@ public:
     // Statistics
     int getActiveConnections() const;
     uint64_t getRequestCount() const;
+    uint64_t getResponseCount(int statusClass) const;   // 1 to 5 for 1xx to 5xx
+    LatencyHistogram::Snapshot getRequestLatency() const { return m_requestLatency.snapshot(); }
 
 private:
     void serverLoop();
-    std::string handleRequest(const std::string& request);
-    std::string serveFile(const std::string& path);
-    std::string listDirectory(const std::string& path);
-    std::string generateApiResponse(const std::string& endpoint, const std::string& data, int);
+    void handleConnection(int clientSocket);
+    bool readRequestHead(int clientSocket, HttpInputBuffer& input, HttpRequestParser& parser, bool firstRequest);
+    bool readRequestBody(int clientSocket, HttpInputBuffer& input, HttpRequest& request, size_t& requestLength);
+    bool readBody(int clientSocket, HttpInputBuffer& input, const HttpRequest& request, size_t& requestLength,
+                  const std::function<bool(std::string_view)>& sink);
+    void populateRequest(const HttpRequestParser& parser, HttpRequest& request);
+    bool waitForData(int clientSocket, int timeoutSeconds);
+    bool sendResponse(int clientSocket, const HttpResponse& response, bool keepAlive, bool chunked = true);
+    bool sendStreamBody(int clientSocket, const HttpResponse& response, bool chunked);
+    bool sendChunk(int clientSocket, const char* data, size_t length);
+    bool sendAll(int clientSocket, const char* data, size_t length, int flags = 0);
+    bool sendFileBody(int clientSocket, const HttpFileBody& file);
+    bool sendFileSpan(int clientSocket, const HttpFileBody& file, uint64_t start, uint64_t length);
+    bool spliceFileBody(int clientSocket, int sourceFd, uint64_t length);
+    bool wantsKeepAlive(const HttpRequest& request) const;
+    void recordRequest(int statusCode, std::chrono::steady_clock::time_point start);
+    
+    // Server-Sent Events
+    bool isEventStreamRequest(const HttpRequest& request) const;
+    void streamEvents(int clientSocket, const HttpRequest& request);
+    
+    // Streaming uploads
+    bool isUploadRequest(const HttpRequest& request) const;
+    HttpResponse handleUpload(int clientSocket, HttpInputBuffer& input, const HttpRequest& request,
+                              size_t& requestLength, bool& bodyConsumed);
+    HttpResponse handleArchiveUpload(int clientSocket, HttpInputBuffer& input, const HttpRequest& request,
+                                     size_t& requestLength, bool& bodyConsumed);
+    int bufferRequestBody(int clientSocket, HttpInputBuffer& input, const HttpRequest& request, size_t& requestLength,
+                          const std::string& clientId, std::string& bufferPath, uint64_t& size);
+    std::string waitForBufferSpace(const std::string& clientId, uint64_t size);
+    bool waitForBufferResize(const std::string& bufferPath, uint64_t reservedSize, uint64_t newSize);
+    static bool writeAll(int fd, const char* data, size_t length);
+    std::string resolveDrivePath(const std::string& relativePath) const;
+    
+    // Resumable uploads (tus)
+    bool isResumableUploadRequest(const HttpRequest& request) const;
+    HttpResponse handleResumableUpload(int clientSocket, HttpInputBuffer& input, const HttpRequest& request,
+                                       size_t& requestLength, bool& bodyConsumed);
+    HttpResponse createResumableUpload(const HttpRequest& request);
+    HttpResponse appendResumableUpload(int clientSocket, HttpInputBuffer& input, const HttpRequest& request,
+                                       size_t& requestLength, bool& bodyConsumed, const std::string& id);
+    uint64_t commitResumableUpload(const UploadSessionStore::Session& session);
+    
+    // WebDAV (class 1 and 2) under /dav
+    enum class DavResult {
+        COMPLETED,
+        FAILED,
+        PENDING    // Still queued when the wait timed out
+    };
+    using OperationCallback = std::function<void(const usb_bridge::FileOperation&)>;
+    
+    bool isWebDavRequest(const HttpRequest& request) const;
+    static bool isDavPath(const std::string& path);
+    HttpResponse handleWebDav(const HttpRequest& request);
+    HttpResponse handleWebDavPut(int clientSocket, HttpInputBuffer& input, const HttpRequest& request,
+                                 size_t& requestLength, bool& bodyConsumed);
+    HttpResponse davOptions();
+    HttpResponse davGet(const HttpRequest& request, const std::string& drivePath);
+    HttpResponse davPropfind(const HttpRequest& request, const std::string& drivePath);
+    HttpResponse davProppatch(const HttpRequest& request, const std::string& drivePath);
+    HttpResponse davMkcol(const HttpRequest& request, const std::string& drivePath);
+    HttpResponse davDelete(const HttpRequest& request, const std::string& drivePath);
+    HttpResponse davCopyMove(const HttpRequest& request, const std::string& drivePath, bool move);
+    HttpResponse davLock(const HttpRequest& request, const std::string& drivePath);
+    HttpResponse davUnlock(const HttpRequest& request, const std::string& drivePath);
+    bool bufferDavCopy(const std::string& clientId, const std::string& source, const std::string& dest, bool recursive,
+                       std::vector<usb_bridge::WriteBatchItem>& items);
+    void releaseDavCopy(const std::vector<usb_bridge::WriteBatchItem>& items);
+    void submitDavTransfer(const std::string& clientId, const std::string& source, const std::string& dest, bool move,
+                           const std::shared_ptr<std::vector<usb_bridge::WriteBatchItem>>& copyItems,
+                           const OperationCallback& done);
+    DavResult waitForOperations(size_t count, const std::function<void(const OperationCallback&)>& submit);
+    void queueDavWrite(const std::string& clientId, const std::string& bufferPath, const std::string& drivePath,
+                       uint64_t size);
+    bool findDavPending(const std::string& drivePath, struct stat& st);
+    bool isDavWriteAllowed(const HttpRequest& request, const std::string& drivePath,
+                           bool includeDescendants, bool changesMembership);
+    std::string resolveDavPath(const std::string& path) const;
+    std::string davHref(const std::string& drivePath, bool isCollection) const;
+    static void appendDavResponse(std::string& xml, const std::string& href,
+                                  const DirectoryListingCache::Entry& entry, const std::string& lockDiscovery);
+    static HttpResponse davError(int statusCode, const std::string& condition);
+    static std::string davLockDiscovery(const std::vector<DavLockManager::Lock>& locks, const std::string& root);
+    static int davResultStatus(DavResult result, int successStatus);
+    
+    HttpResponse handleRequest(const HttpRequest& request);
+    HttpResponse serveFile(const std::string& path, const HttpRequest& request);
+    HttpResponse serveLocalFile(const std::string& fullPath, const std::string& typePath, const HttpRequest& request);
+    HttpResponse serveAsset(const StaticAssetCache::Asset& asset, const HttpRequest& request);
+    HttpResponse listDirectory(const std::string& path);
+    HttpResponse handleFileListing(const HttpRequest& request);
+    HttpResponse handleArchive(const HttpRequest& request);
+    HttpResponse generateApiResponse(const std::string& endpoint, const std::string& data, int);
+    HttpResponse generateErrorResponse(int statusCode);
+    static std::string getStatusText(int statusCode);
+    static std::string getQueryParameter(std::string_view query, const std::string& name);
+    static std::string urlDecode(std::string_view text, bool plusAsSpace = true);
+    static std::string jsonEscape(const std::string& text);
+    
+    // Conditional requests and content negotiation
+    static bool matchesETag(std::string_view ifNoneMatch, const std::string& etag);
+    static bool acceptsEncoding(std::string_view acceptEncoding, std::string_view coding);
+    static std::string fileETag(const struct stat& st);
+    static std::string formatETag(uint64_t inode, int64_t mtime, long mtimeNsec, uint64_t size);
+    static bool isNotModified(const HttpRequest& request, const struct stat& st);
+    static std::string formatHttpDate(time_t time);
+    static bool parseHttpDate(const std::string& text, time_t& time);
+    
+    // Byte ranges (RFC 7233)
+    static bool parseRangeHeader(const std::string& header, uint64_t fileSize,
+                                 std::vector<std::pair<uint64_t, uint64_t>>& ranges);
+    static bool isIfRangeSatisfied(const HttpRequest& request, const struct stat& st);
+    static std::string generateBoundary();
     
     std::atomic<bool> m_running;
     std::thread m_serverThread;
@@ -44,5 +268,66 @@ private:
     std::atomic<bool> m_directoryListing;
     std::atomic<bool> m_fileDownload;
     
-    std::map<std::string, std::function<std::string(const std::string&)>> m_apiHandlers;
+    // Connection management
+    std::atomic<int> m_keepAliveTimeout;          // Idle seconds before a persistent connection is closed
+    std::atomic<int> m_maxRequestsPerConnection;  // Requests served before the connection is closed
+    std::atomic<int> m_activeConnections;
+    std::atomic<int> m_maxConnections;
+    
+    // Sockets of running connection threads; stop() shuts them down and waits for the set to empty
+    std::mutex m_connectionMutex;
+    std::condition_variable m_connectionsClosed;
+    std::set<int> m_connectionSockets;
+    
+    // Request statistics, updated without locks from the connection threads
+    std::atomic<uint64_t> m_requestCount;
+    std::atomic<uint64_t> m_responseCounts[5];
+    LatencyHistogram m_requestLatency;   // Head received to response sent, event streams excluded
+    
+    usb_bridge::UsbBridge* m_bridge = nullptr;
+    
+    std::map<std::string, ApiHandler> m_apiHandlers;
+    
+    EventHub m_eventHub;
+    
+    // Web interface, loaded in initialize() and read-only afterwards
+    StaticAssetCache m_assetCache;
+    
+    // Drive directories scanned for /api/files
+    DirectoryListingCache m_listingCache;
+    
+    // Resumable uploads, persisted next to their buffer files
+    UploadSessionStore m_uploads;
+    
+    // WebDAV locks, and PUT bodies still in the local buffer keyed by drive path; clients
+    // see those as already written so a PROPFIND or GET right after the PUT finds them
+    struct DavPendingWrite {
+        std::string bufferPath;
+        uint64_t size;
+        time_t modified;
+    };
+    DavLockManager m_davLocks;
+    std::mutex m_davMutex;
+    std::map<std::string, DavPendingWrite> m_davPending;
+    std::atomic<int> m_davOperationTimeout;
+    
+    static const char* const WEB_ROOT;
+    static const size_t MAX_HEADER_SIZE;
+    static const size_t INPUT_BUFFER_SIZE;
+    static const size_t MAX_API_BODY_SIZE;
+    static const int REQUEST_TIMEOUT_SECONDS;
+    static const size_t SENDFILE_CHUNK_SIZE;
+    static const size_t SPLICE_PIPE_SIZE;
+    static const size_t MAX_RANGES_PER_REQUEST;
+    static const size_t UPLOAD_CHUNK_SIZE;
+    static const int UPLOAD_BUFFER_WAIT_SECONDS;
+    static const uint64_t UPLOAD_RESERVATION_STEP;
+    static const int EVENT_PING_SECONDS;
+    static const size_t MAX_EVENT_SUBSCRIBERS;
+    static const size_t DEFAULT_LISTING_LIMIT;
+    static const size_t MAX_LISTING_LIMIT;
+    static const char* const DAV_PREFIX;
+    static const char* const DAV_METHODS;
+    static const int DAV_OPERATION_TIMEOUT_SECONDS;
+    static const size_t DAV_RESPONSE_CHUNK_SIZE;
 };
\ No newline at end of file
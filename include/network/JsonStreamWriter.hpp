@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+/**
+ * JsonStreamWriter - Serialises JSON incrementally into a bounded buffer
+ *
+ * Output is handed to the sink whenever the buffer fills, so a document of any
+ * size is written with constant memory. Commas between members and elements are
+ * inserted automatically; the caller only has to keep begin/end calls balanced.
+ * After the sink fails once, all further output is dropped and ok() returns false.
+ */
+class JsonStreamWriter {
+public:
+    using Sink = std::function<bool(const char* data, size_t length)>;
+    
+    explicit JsonStreamWriter(Sink sink, size_t bufferSize = 16 * 1024);
+    
+    JsonStreamWriter& beginObject();
+    JsonStreamWriter& endObject();
+    JsonStreamWriter& beginArray();
+    JsonStreamWriter& endArray();
+    
+    JsonStreamWriter& key(std::string_view name);
+    JsonStreamWriter& value(std::string_view text);
+    JsonStreamWriter& value(const char* text) { return value(std::string_view(text)); }
+    JsonStreamWriter& value(uint64_t number);
+    JsonStreamWriter& value(int64_t number);
+    JsonStreamWriter& value(bool flag);
+    JsonStreamWriter& null();
+    
+    // Hands everything buffered to the sink; returns ok()
+    bool flush();
+    bool ok() const { return m_ok; }
+
+private:
+    void separate();
+    void appendString(std::string_view text);
+    void append(std::string_view text);
+    
+    Sink m_sink;
+    std::string m_buffer;
+    size_t m_bufferSize;
+    std::vector<bool> m_first;   // Per open container: no member written yet
+    bool m_afterKey = false;
+    bool m_ok = true;
+};
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <string_view>
+#include "utils/LatencyHistogram.hpp"
+
+/**
+ * MetricsWriter - Prometheus text exposition format (version 0.0.4)
+ *
+ * Appends to a caller-owned string, formatting numbers in place with to_chars, so
+ * a scrape costs one growing buffer and nothing per sample. Label sets are passed
+ * preformatted (name="value",...); constants are written out, appendLabel() builds
+ * them from values that come from outside (client names, interfaces).
+ */
+class MetricsWriter {
+public:
+    static const char* const CONTENT_TYPE;
+    
+    explicit MetricsWriter(std::string& output) : m_output(output) {}
+    
+    // # HELP and # TYPE lines, written once before a metric's samples
+    MetricsWriter& family(std::string_view name, std::string_view type, std::string_view help);
+    
+    MetricsWriter& sample(std::string_view name, uint64_t value) { return sample(name, {}, value); }
+    MetricsWriter& sample(std::string_view name, double value) { return sample(name, {}, value); }
+    MetricsWriter& sample(std::string_view name, std::string_view labels, uint64_t value);
+    MetricsWriter& sample(std::string_view name, std::string_view labels, double value);
+    
+    // Single-sample families
+    MetricsWriter& counter(std::string_view name, std::string_view help, uint64_t value);
+    MetricsWriter& gauge(std::string_view name, std::string_view help, uint64_t value);
+    MetricsWriter& gauge(std::string_view name, std::string_view help, double value);
+    
+    MetricsWriter& histogram(std::string_view name, std::string_view help, const LatencyHistogram::Snapshot& snapshot);
+
+    // Adds name="value" to a label set, escaping the value
+    static void appendLabel(std::string& labels, std::string_view name, std::string_view value);
+
+private:
+    void appendName(std::string_view name, std::string_view suffix, std::string_view labels);
+    void appendNumber(uint64_t value);
+    void appendNumber(double value);
+    
+    std::string& m_output;
+};
\ No newline at end of file
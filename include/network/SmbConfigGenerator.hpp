@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <sys/types.h>
+
+/**
+ * SmbConfigGenerator - smb.conf tuned to the shared drive and the board
+ *
+ * Samba's defaults suit a server with a local disk and memory to spare. Sharing a USB
+ * drive from a small board, the limits are the drive's queue depth, the copies between
+ * socket, page cache and user space, and the memory each in-flight request holds. The
+ * profile is picked from the drive type and RAM size; the output is plain text so it
+ * can be checked with testparm before it replaces the running configuration.
+ */
+class SmbConfigGenerator {
+public:
+    enum class DriveType {
+        ROTATIONAL,    // Hard disks: one head, seeks dominate
+        SOLID_STATE,   // SSDs behind a USB bridge
+        FLASH          // Sticks and SD cards: slow writes, shallow queues
+    };
+    
+    struct ShareSettings {
+        std::string path;
+        std::string name = "USBShare";
+        std::string workgroup = "WORKGROUP";
+        std::string description = "USB Bridge Shared Storage";
+        bool readOnly = false;
+        bool guestAccess = true;
+    };
+    
+    struct Environment {
+        DriveType driveType = DriveType::FLASH;
+        uint64_t memoryBytes = 0;
+        bool fatFilesystem = false;   // vfat/exFAT: no extended attributes, 2 s timestamps
+        int sambaMajor = 0;           // 0 when smbd couldn't be asked
+        int sambaMinor = 0;
+    };
+    
+    struct Profile {
+        std::string name;               // e.g. "hdd-1g", written to the header comment
+        uint64_t aioReadSize;           // Requests at least this large go to the thread pool
+        uint64_t aioWriteSize;
+        unsigned aioMaxThreads;
+        bool useSendfile;
+        std::string socketOptions;
+        bool oplocks;
+        bool leases;
+        bool strictSync;
+        bool strictAllocate;
+        uint64_t minReceivefileSize;    // Writes at least this large are spliced from the socket
+        uint64_t maxIoSize;             // smb2 max read/write/trans
+        uint64_t writeCacheSize;        // Only rendered for Samba before 4.12, which removed it
+    };
+    
+    // Looks at the block device behind sharePath, the filesystem, RAM and the installed smbd
+    static Environment detectEnvironment(const std::string& sharePath);
+    static Profile selectProfile(const Environment& environment);
+    static std::string render(const ShareSettings& share, const Environment& environment, const Profile& profile);
+    
+    // Runs testparm on a written config. True when it loads cleanly or testparm isn't
+    // installed; otherwise its complaints are returned in errors.
+    static bool validate(const std::string& configPath, std::string& errors);
+    
+    // "hdd", "ssd" and "flash", as used for the network.smb.profile setting
+    static bool parseDriveType(const std::string& name, DriveType& type);
+    static const char* getDriveTypeName(DriveType type);
+
+private:
+    static DriveType detectDriveType(dev_t device);
+    static void detectSambaVersion(Environment& environment);
+    
+    static const uint64_t WRITE_CACHE_REMOVED_VERSION;   // major * 100 + minor
+};
\ No newline at end of file
@@ -1,8 +1,17 @@
 #pragma once
 
+#include "network/SmbStatsCollector.hpp"
 #include <string>
 #include <atomic>
 #include <thread>
+#include <memory>
+#include <cstdint>
+
+namespace usb_bridge {
+class UsbBridge;
+}
+
+class SmbWriteStager;
 
 class SmbServer {
 public:
@@ -11,6 +20,8 @@ public:
 
     bool initialize(const std::string& sharePath, const std::string& shareName = "USBShare");
     bool start();
+    // False if smbd didn't stop or staged writes didn't all reach the drive (it can wait up
+    // to SmbWriteStager's FLUSH_TIMEOUT for the queue)
     bool stop();
     bool isRunning() const { return m_running; }
     
@@ -19,17 +30,28 @@ public:
     void setWorkgroup(const std::string& workgroup) { m_workgroup = workgroup; }
     void setReadOnly(bool readOnly) { m_readOnly = readOnly; }
     
+    // Performance profile: "auto" picks it from the drive, "hdd", "ssd" or "flash" override it
+    void setPerformanceProfile(const std::string& profile) { m_profile = profile; }
+    const std::string& getProfileName() const { return m_profileName; }   // Set once started
+    
+    // Stage client writes in the bridge's buffer and commit them through its write queue
+    // (see SmbWriteStager). Without it, or when staging can't start, Samba writes to the drive.
+    void setBridge(usb_bridge::UsbBridge* bridge) { m_bridge = bridge; }
+    void setBufferOperations(bool enabled) { m_bufferOperations = enabled; }
+    bool isBufferingWrites() const { return m_stager != nullptr; }
+    
     // Access control
     void setGuestAccess(bool enabled) { m_guestAccess = enabled; }
     bool addUser(const std::string& username, const std::string& password);
     void removeUser(const std::string& username);
     
-    // Statistics
+    // Statistics, as of the collector's last pass (see SmbStatsCollector)
     int getConnectedClients() const;
-    uint64_t getBytesTransferred() const;
+    uint64_t getBytesTransferred() const;   // Drive I/O of all sessions since start
+    SmbStatsCollector::Snapshot getSessionStatistics() const { return m_statsCollector.getSnapshot(); }
 
 private:
-    void generateSmbConfig();
+    bool generateSmbConfig();
     bool startSambaServices();
     bool stopSambaServices();
     
@@ -39,6 +61,13 @@ private:
     std::atomic<bool> m_running;
     std::atomic<bool> m_readOnly;
     std::atomic<bool> m_guestAccess;
+    std::string m_profile;
+    std::string m_profileName;
+    
+    usb_bridge::UsbBridge* m_bridge = nullptr;
+    bool m_bufferOperations = false;
+    std::unique_ptr<SmbWriteStager> m_stager;
+    SmbStatsCollector m_statsCollector;
     
     static const std::string SMB_CONFIG_PATH;
 };
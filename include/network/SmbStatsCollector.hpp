@@ -0,0 +1,96 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+
+/**
+ * SmbStatsCollector - Who is connected over SMB and how hard they use the drive
+ *
+ * Samba keeps no per-client byte counts, but it runs one smbd process per client
+ * connection. Every COLLECT_INTERVAL the sessions, open files and byte-range locks
+ * are read from `smbstatus --json` (or its text output before Samba 4.16), and each
+ * session's storage I/O from /proc/<pid>/io of its smbd. Whether a session is active
+ * goes by all of its smbd's reads and writes instead, since reads served from the page
+ * cache never reach storage. Interface counters come from
+ * /sys/class/net. Readers get a copy of the last pass and never wait for smbstatus.
+ */
+class SmbStatsCollector {
+public:
+    struct Session {
+        std::string pid;            // smbd serving the client, stable for the connection
+        std::string username;
+        std::string machine;        // Client address
+        std::string protocol;       // Negotiated dialect, e.g. SMB3_11
+        uint64_t bytesRead = 0;     // Storage I/O of the session so far
+        uint64_t bytesWritten = 0;
+        double readRate = 0;        // Bytes per second over the last interval
+        double writeRate = 0;
+        uint32_t openFiles = 0;
+        uint32_t locks = 0;         // Byte-range locks held
+        bool active = false;        // Moved more than keepalives over the last interval
+    };
+    
+    struct Interface {
+        std::string name;
+        uint64_t bytesReceived = 0;
+        uint64_t bytesSent = 0;
+        double receiveRate = 0;
+        double sendRate = 0;
+    };
+    
+    struct Snapshot {
+        std::vector<Session> sessions;
+        std::vector<Interface> interfaces;
+        uint64_t totalBytesRead = 0;      // All sessions since start, ended ones included
+        uint64_t totalBytesWritten = 0;
+    };
+    
+    SmbStatsCollector();
+    ~SmbStatsCollector();
+    
+    void start();
+    void stop();
+    
+    Snapshot getSnapshot() const;
+    
+    // Sessions with open file and lock counts from smbstatus output; no I/O figures
+    static bool parseStatusJson(const std::string& text, std::vector<Session>& sessions);
+    static void parseStatusText(const std::string& processes, const std::string& openFiles,
+                                std::vector<Session>& sessions);
+
+private:
+    void collectLoop();
+    void collect();
+    bool readSessions(std::vector<Session>& sessions);
+    void readInterfaces(std::vector<Interface>& interfaces);
+    
+    // bytesTransferred is rchar + wchar: sockets and page-cache hits included
+    static bool readProcessIo(const std::string& pid, uint64_t& bytesRead, uint64_t& bytesWritten,
+                              uint64_t& bytesTransferred);
+    static bool runCommand(const std::string& command, std::string& output);
+    
+    std::atomic<bool> m_running;
+    std::thread m_collectThread;
+    std::mutex m_waitMutex;
+    std::condition_variable m_wakeup;
+    
+    // Previous pass, for rates and totals; touched by the collect thread only
+    std::chrono::steady_clock::time_point m_lastCollect;
+    std::map<std::string, std::pair<uint64_t, uint64_t>> m_lastSessionIo;       // pid -> read, written
+    std::map<std::string, uint64_t> m_lastSessionTransfer;                      // pid -> transferred
+    std::map<std::string, std::pair<uint64_t, uint64_t>> m_lastInterfaceBytes;  // name -> received, sent
+    bool m_jsonSupported;
+    
+    mutable std::mutex m_mutex;
+    Snapshot m_snapshot;
+    
+    static const std::chrono::seconds COLLECT_INTERVAL;
+    static const uint64_t ACTIVE_TRANSFER;   // Bytes per interval above SMB echoes and keepalives
+};
\ No newline at end of file
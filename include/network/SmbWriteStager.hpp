@@ -0,0 +1,118 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <thread>
+#include <cstdint>
+#include <unordered_map>
+
+namespace usb_bridge {
+class UsbBridge;
+}
+
+/**
+ * SmbWriteStager - Puts SMB writes through the bridge's buffer and write queue
+ *
+ * Samba exports an overlay of the drive whose upper layer lives in the local buffer, so
+ * client writes land on the board's storage and are acknowledged from there. What the
+ * kernel does when either layer of a mounted overlay changes is undefined, so nothing is
+ * committed while it is mounted; inotify on the upper layer only notes that something
+ * changed. Once the share has been idle for RECLAIM_IDLE and the overlay unmounts (it
+ * doesn't while a client is connected), the layer is committed from its state: files
+ * become queued writes of a linked, reflinked or copied snapshot, whiteouts deletes and new
+ * directories mkdirs. The overlay is mounted again, emptied, when the queue has written
+ * it all. A file saved many times in a row is written to the drive once; a layer left
+ * behind by a crash is committed on start.
+ *
+ * Until then other clients don't see SMB changes, and changes they make to the drive
+ * meanwhile may not show through the overlay, hence network.smb.bufferOperations is off
+ * by default. Kernel FAT and exFAT can't be an overlay's lower layer, start() fails for them.
+ */
+class SmbWriteStager {
+public:
+    SmbWriteStager(usb_bridge::UsbBridge* bridge, const std::string& drivePath, const std::string& stagingPath);
+    ~SmbWriteStager();
+    
+    // Mounts the overlay; Samba should then export getSharePath() instead of the drive
+    bool start();
+    // Commits what is pending and unmounts; call after smbd has stopped. False when some of
+    // it didn't reach the drive within FLUSH_TIMEOUT; the layer keeps it for the next start.
+    bool stop();
+    bool isRunning() const { return m_running; }
+    const std::string& getSharePath() const { return m_mergedPath; }
+    
+    struct Statistics {
+        uint64_t filesCommitted = 0;
+        uint64_t bytesCommitted = 0;
+        uint64_t deletesCommitted = 0;
+        uint64_t directoriesCommitted = 0;
+        uint64_t pendingPaths = 0;       // Changed, waiting to settle
+        uint64_t outstandingWrites = 0;  // Queued, not yet on the drive
+        uint64_t failedWrites = 0;
+    };
+    Statistics getStatistics() const;
+
+private:
+    // Outlives the stager: queue callbacks may complete after it is gone
+    struct CommitTracker {
+        std::mutex mutex;
+        std::condition_variable settled;   // Notified when outstanding drops to zero
+        uint64_t outstanding = 0;
+        uint64_t failed = 0;
+    };
+    
+    void watchLoop();
+    void handleEvents(const char* buffer, size_t length);
+    void watchTree(const std::string& relativePath);
+    void unwatchTree(const std::string& relativePath);
+    void markDirty(const std::string& relativePath);
+    void commit();
+    size_t commitLayer();   // Returns the number of paths looked at
+    bool waitForCommits(std::chrono::milliseconds timeout);
+    uint64_t takeFailures();
+    bool reclaim();
+    bool remount();
+    bool recover();
+    
+    bool mountOverlay();
+    bool unmountOverlay();
+    void clearUpperLayer();
+    void updateLayerUsage();   // Reports the layer's size to the queue's buffer accounting
+    bool resetWatches();
+    
+    std::string upperPath(const std::string& relativePath) const;
+    std::string drivePath(const std::string& relativePath) const;
+    
+    usb_bridge::UsbBridge* m_bridge;
+    std::string m_drivePath;
+    std::string m_upperPath;
+    std::string m_workPath;
+    std::string m_mergedPath;
+    
+    std::atomic<bool> m_running;
+    bool m_mounted;
+    std::thread m_watchThread;
+    int m_inotifyFd;
+    
+    // Touched by the watch thread only
+    std::unordered_map<int, std::string> m_watches;   // Watch descriptor -> directory
+    std::set<std::string> m_committed;                // Committed since the layer was last emptied
+    std::chrono::steady_clock::time_point m_lastActivity;
+    std::chrono::steady_clock::time_point m_lastUsageUpdate;
+    
+    mutable std::mutex m_mutex;
+    std::map<std::string, std::chrono::steady_clock::time_point> m_dirty;   // Path -> last change
+    Statistics m_stats;
+    std::shared_ptr<CommitTracker> m_tracker;
+    
+    static const std::string CLIENT_ID;
+    static const std::chrono::seconds RECLAIM_IDLE;
+    static const std::chrono::seconds FLUSH_TIMEOUT;    // Waited for the queue in start() and stop()
+    static const std::chrono::seconds USAGE_INTERVAL;   // Between layer size updates while it changes
+};
\ No newline at end of file
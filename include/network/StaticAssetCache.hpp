@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// File compiled into the executable (see cmake/EmbedWebAssets.cmake)
+struct EmbeddedAsset {
+    const char* path;
+    const unsigned char* data;
+    size_t size;
+};
+
+/**
+ * StaticAssetCache - Web interface files held in memory
+ *
+ * Every file is read once together with its precompressed variants and a strong
+ * ETag, so serving the dashboard never touches the disk or compresses per request.
+ * The cache is filled before the server starts and is read-only afterwards.
+ */
+class StaticAssetCache {
+public:
+    struct Asset {
+        std::string contentType;
+        std::string etag;          // Content hash; each encoding adds its own suffix
+        std::string cacheControl;
+        std::shared_ptr<const std::string> identity;
+        std::shared_ptr<const std::string> gzip;     // Null when compression doesn't pay off
+        std::shared_ptr<const std::string> brotli;   // Null without Brotli support
+    };
+    
+    // Both return the number of assets loaded
+    size_t loadDirectory(const std::string& root);
+    size_t loadEmbedded();
+    
+    const Asset* find(const std::string& path) const;
+    size_t getAssetCount() const { return m_assets.size(); }
+    uint64_t getMemoryUsage() const;
+
+private:
+    void addAsset(const std::string& path, std::string content);
+    
+    static std::string computeETag(const std::string& content);
+    static std::string gzipCompress(const std::string& content);
+    static std::string brotliCompress(const std::string& content);
+    static std::string getCacheControl(const std::string& path);
+    
+    std::map<std::string, Asset> m_assets;
+    
+    static const size_t MIN_COMPRESS_SIZE;
+};
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+/**
+ * TarStreamReader - Incremental tar parser for archives arriving over the network
+ *
+ * Data is pushed in pieces of any size and file contents are passed through to the
+ * handler as they arrive, so nothing but the current header is ever held in memory.
+ * Understands ustar, pax (path and size records) and GNU long names. Links, devices
+ * and other special entries are skipped. Entry paths are made relative and any path
+ * that would climb out of the extraction directory is rejected as an error.
+ */
+class TarStreamReader {
+public:
+    struct Entry {
+        std::string path;     // Relative, no "." or ".." components, no trailing slash
+        uint64_t size;
+        bool isDirectory;
+    };
+    
+    using EntryHandler = std::function<bool(const Entry& entry)>;
+    using DataHandler = std::function<bool(std::string_view data)>;   // Contents of the last entry
+    using EndHandler = std::function<bool()>;                         // Last entry complete
+    
+    TarStreamReader(EntryHandler onEntry, DataHandler onData, EndHandler onEnd);
+    
+    // Returns false on a malformed archive or when a handler fails; the reader then stays failed
+    bool feed(std::string_view data);
+    
+    // True once the end-of-archive marker was seen, or the input stopped between entries
+    bool isComplete() const;
+    const std::string& getError() const { return m_error; }
+
+private:
+    enum class State {
+        HEADER,
+        DATA,        // Contents of a file, passed to the handler
+        METADATA,    // Contents of a pax or GNU long-name entry, collected
+        SKIP,        // Contents of an entry we don't extract
+        PADDING,
+        END
+    };
+    
+    bool processHeader();
+    bool finishEntryData();
+    bool fail(const std::string& error);
+    void parsePaxRecords(const std::string& records);
+    
+    static bool parseNumber(const char* field, size_t length, uint64_t& value);
+    static bool verifyChecksum(const char* header);
+    static bool normalizePath(const std::string& path, std::string& normalized);
+    
+    EntryHandler m_onEntry;
+    DataHandler m_onData;
+    EndHandler m_onEnd;
+    
+    State m_state = State::HEADER;
+    char m_header[512];
+    size_t m_headerFill = 0;
+    uint64_t m_remaining = 0;    // Bytes left in the current state
+    uint64_t m_padding = 0;      // Padding after the current entry's data
+    char m_metadataType = 0;
+    std::string m_metadata;
+    
+    // Overrides for the next entry from pax or GNU long-name headers
+    std::string m_nextPath;
+    bool m_hasNextSize = false;
+    uint64_t m_nextSize = 0;
+    
+    std::string m_error;
+    
+    static const size_t MAX_METADATA_SIZE;
+};
\ No newline at end of file
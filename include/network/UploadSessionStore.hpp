@@ -0,0 +1,69 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * UploadSessionStore - Resumable uploads in progress
+ *
+ * Each upload's data lives in its local buffer file, whose size is the offset the
+ * client resumes from. A small session file next to it records where the upload is
+ * going, so interrupted uploads survive a dropped connection and a restart alike.
+ * Sessions are handed out as copies; a claimed session belongs to one request until
+ * it is released, which keeps two connections from writing the same upload.
+ */
+class UploadSessionStore {
+public:
+    struct Session {
+        std::string id;
+        std::string clientId;
+        std::string bufferPath;
+        std::string destPath;
+        uint64_t length = 0;
+        uint64_t offset = 0;      // Bytes received, the size of the buffer file
+        uint64_t reserved = 0;    // Buffer space accounted to the upload
+    };
+    
+    enum class Claim {
+        CLAIMED,
+        NOT_FOUND,
+        BUSY
+    };
+    
+    // Picks up the sessions a previous run left in the buffer directory; returns how many
+    size_t load(const std::string& directory);
+    
+    // Assigns the session an ID and persists it; false if it couldn't be written
+    bool create(Session& session);
+    bool get(const std::string& id, Session& session);
+    
+    Claim claim(const std::string& id, Session& session);
+    void release(const Session& session);
+    
+    // Forgets a claimed session, the buffer file is left to the caller
+    void remove(const std::string& id);
+    
+    // Removes sessions idle for longer than EXPIRY and returns them so their buffers can be released
+    std::vector<Session> takeExpired();
+
+private:
+    struct Entry {
+        Session session;
+        bool busy = false;
+        std::chrono::steady_clock::time_point lastActivity;
+    };
+    
+    std::string sessionFilePath(const std::string& id) const;
+    bool writeSessionFile(const Session& session) const;
+    static std::string generateId();
+    
+    std::mutex m_mutex;
+    std::string m_directory;
+    std::map<std::string, Entry> m_sessions;
+    
+    static const std::chrono::hours EXPIRY;
+};
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <initializer_list>
+
+/**
+ * LatencyHistogram - Fixed-bucket duration histogram for metrics export
+ *
+ * observe() is a couple of relaxed atomic increments, so it can be called on hot
+ * paths from any thread without a lock. A snapshot taken while observations are
+ * running may be off by the few in flight, which is fine for scraping.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t MAX_BUCKETS = 16;
+    
+    struct Snapshot {
+        size_t bucketCount = 0;
+        double bounds[MAX_BUCKETS] = {};
+        uint64_t cumulative[MAX_BUCKETS] = {};   // Observations <= bounds[i]
+        uint64_t count = 0;
+        double sum = 0.0;                        // Seconds
+    };
+    
+    // Upper bucket bounds in seconds, ascending; the +Inf bucket is implied
+    LatencyHistogram(std::initializer_list<double> bounds) {
+        for (double bound : bounds) {
+            if (m_bucketCount == MAX_BUCKETS) break;
+            m_bounds[m_bucketCount++] = bound;
+        }
+    }
+    
+    void observe(std::chrono::steady_clock::duration duration) {
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        if (micros < 0) micros = 0;
+        
+        double seconds = micros / 1e6;
+        size_t bucket = 0;
+        while (bucket < m_bucketCount && seconds > m_bounds[bucket]) {
+            bucket++;
+        }
+        m_counts[bucket].fetch_add(1, std::memory_order_relaxed);
+        m_sumMicros.fetch_add(static_cast<uint64_t>(micros), std::memory_order_relaxed);
+    }
+    
+    Snapshot snapshot() const {
+        Snapshot snapshot;
+        snapshot.bucketCount = m_bucketCount;
+        
+        uint64_t running = 0;
+        for (size_t i = 0; i < m_bucketCount; ++i) {
+            running += m_counts[i].load(std::memory_order_relaxed);
+            snapshot.bounds[i] = m_bounds[i];
+            snapshot.cumulative[i] = running;
+        }
+        snapshot.count = running + m_counts[m_bucketCount].load(std::memory_order_relaxed);
+        snapshot.sum = m_sumMicros.load(std::memory_order_relaxed) / 1e6;
+        return snapshot;
+    }
+
+private:
+    size_t m_bucketCount = 0;
+    double m_bounds[MAX_BUCKETS] = {};
+    std::atomic<uint64_t> m_counts[MAX_BUCKETS + 1] = {};   // Last one is +Inf
+    std::atomic<uint64_t> m_sumMicros{0};
+};
@@ -2,6 +2,8 @@
 #include "utils/Logger.hpp"
 #include <filesystem>
 #include <algorithm>
+#include <atomic>
+#include <thread>
 
 namespace fs = std::filesystem;
 
@@ -375,6 +377,59 @@ std::vector<std::string> CacheManager::getDirtyFiles() const {
     return dirtyFiles;
 }
 
+size_t CacheManager::writeBackDirty(size_t maxParallel) {
+    std::vector<std::shared_ptr<CacheEntry>> dirty;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& pair : m_entries) {
+            if (pair.second->state == CacheEntryState::DIRTY) {
+                pair.second->state = CacheEntryState::WRITING_BACK;
+                dirty.push_back(pair.second);
+            }
+        }
+    }
+    if (dirty.empty()) {
+        return 0;
+    }
+    
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> written(0);
+    auto writeBack = [&] {
+        for (size_t i = next++; i < dirty.size(); i = next++) {
+            const auto& entry = dirty[i];
+            std::error_code ec;
+            fs::copy_file(entry->cachePath, entry->drivePath, fs::copy_options::overwrite_existing, ec);
+            
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (ec) {
+                Logger::error("Failed to write back " + entry->drivePath + ": " + ec.message());
+                entry->state = CacheEntryState::DIRTY;
+                continue;
+            }
+            // Modified again while being copied: stays dirty for the next pass
+            if (entry->state == CacheEntryState::WRITING_BACK) {
+                entry->state = CacheEntryState::READY;
+            }
+            m_stats.totalWritebacks++;
+            written++;
+        }
+    };
+    
+    std::vector<std::thread> workers;
+    size_t workerCount = std::min(std::max<size_t>(maxParallel, 1), dirty.size());
+    for (size_t i = 1; i < workerCount; ++i) {
+        workers.emplace_back(writeBack);
+    }
+    writeBack();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    
+    Logger::info("Wrote back " + std::to_string(written.load()) + " of " + std::to_string(dirty.size()) +
+                 " dirty cache entries");
+    return written;
+}
+
 std::vector<std::string> CacheManager::getEvictionCandidates(size_t maxCount) const {
     std::lock_guard<std::mutex> lock(m_mutex);
     
@@ -9,14 +9,21 @@ namespace fs = std::filesystem;
 
 namespace usb_bridge {
 
+const std::chrono::milliseconds FileOperationQueue::PROGRESS_INTERVAL(500);
+
 FileOperationQueue::FileOperationQueue(const std::string& localBufferPath, uint64_t maxLocalBufferSize)
     : m_localBufferPath(localBufferPath)
     , m_maxLocalBufferSize(maxLocalBufferSize)
     , m_currentBufferUsage(0)
+    , m_externalBufferUsage(0)
     , m_running(false)
     , m_paused(false)
+    , m_executing(false)
+    , m_draining(false)
     , m_nextId(1)
+    , m_nextBufferId(1)
     , m_stats({0, 0, 0, 0, 0, 0, 0.0})
+    , m_operationDurations{0.01, 0.05, 0.1, 0.5, 1, 5, 10, 30, 60, 300, 900, 3600}
 {
     // Create local buffer directory if it doesn't exist
     fs::create_directories(m_localBufferPath);
@@ -75,6 +82,51 @@ void FileOperationQueue::resume() {
     Logger::info("FileOperationQueue resumed");
 }
 
+bool FileOperationQueue::drain(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    
+    // Work off the backlog, even if the queue was paused while it built up; what clients
+    // queue meanwhile is held back, or the backlog could keep growing until the deadline
+    m_draining = true;
+    m_paused = false;
+    m_condition.notify_all();
+    bool drained = m_condition.wait_until(lock, deadline, [this] {
+        return !m_running || (m_queue.empty() && !m_executing);
+    });
+    
+    // What's left stays queued. The operation already touching the drive gets until the
+    // deadline too; one still running then means the drive can't be handed over.
+    m_paused = true;
+    bool idle = m_condition.wait_until(lock, deadline, [this] { return !m_executing; });
+    
+    // Held operations run after the backlog once the queue is resumed
+    size_t held = m_held.size();
+    for (auto& op : m_held) {
+        m_queue.push(std::move(op));
+    }
+    m_held.clear();
+    m_draining = false;
+    
+    Logger::info("FileOperationQueue drained" + std::string(drained ? "" : ", " +
+                 std::to_string(m_queue.size() - held) + " operations left queued") +
+                 (held ? ", " + std::to_string(held) + " queued meanwhile held back" : ""));
+    if (!idle) {
+        Logger::warn("FileOperationQueue drain deadline reached with an operation still running");
+    }
+    return idle;
+}
+
+void FileOperationQueue::enqueueLocked(const std::shared_ptr<FileOperation>& op) {
+    m_operations[op->id] = op;
+    if (m_draining) {
+        m_held.push_back(op);
+    } else {
+        m_queue.push(op);
+    }
+    m_stats.totalOperations++;
+}
+
 bool FileOperationQueue::isRunning() const {
     std::lock_guard<std::mutex> lock(m_mutex);
     return m_running;
@@ -97,16 +149,14 @@ uint64_t FileOperationQueue::queueRead(const std::string& clientId,
     // Get file size
     try {
         op->fileSize = fs::file_size(drivePath);
-        op->requiresDirectAccess = !hasBufferSpace(op->fileSize);
+        op->requiresDirectAccess = !hasBufferSpaceLocked(op->fileSize);
     } catch (const std::exception& e) {
         op->fileSize = 0;
         op->requiresDirectAccess = false;
         Logger::error("Failed to get file size for read: " + std::string(e.what()));
     }
     
-    m_operations[op->id] = op;
-    m_queue.push(op);
-    m_stats.totalOperations++;
+    enqueueLocked(op);
     
     Logger::info("Queued READ operation #" + std::to_string(op->id) + 
                  " for client " + clientId + ": " + drivePath);
@@ -133,17 +183,16 @@ uint64_t FileOperationQueue::queueWrite(const std::string& clientId,
     op->queuedTime = std::chrono::system_clock::now();
     op->completionCallback = callback;
     
-    // Check if we need direct access
-    op->requiresDirectAccess = !hasBufferSpace(fileSize);
+    // Check if we need direct access - data already staged in the buffer never does
+    bool alreadyBuffered = localFilePath.compare(0, m_localBufferPath.length(), m_localBufferPath) == 0;
+    op->requiresDirectAccess = !alreadyBuffered && !hasBufferSpaceLocked(fileSize);
     
     if (op->requiresDirectAccess) {
         Logger::warn("Write operation #" + std::to_string(op->id) + 
                     " requires direct access (size: " + std::to_string(fileSize / (1024*1024)) + " MB)");
     }
     
-    m_operations[op->id] = op;
-    m_queue.push(op);
-    m_stats.totalOperations++;
+    enqueueLocked(op);
     
     Logger::info("Queued WRITE operation #" + std::to_string(op->id) + 
                  " for client " + clientId + ": " + driveDestPath);
@@ -168,9 +217,7 @@ uint64_t FileOperationQueue::queueDelete(const std::string& clientId,
     op->queuedTime = std::chrono::system_clock::now();
     op->completionCallback = callback;
     
-    m_operations[op->id] = op;
-    m_queue.push(op);
-    m_stats.totalOperations++;
+    enqueueLocked(op);
     
     Logger::info("Queued DELETE operation #" + std::to_string(op->id) + 
                  " for client " + clientId + ": " + drivePath);
@@ -195,9 +242,7 @@ uint64_t FileOperationQueue::queueMkdir(const std::string& clientId,
     op->queuedTime = std::chrono::system_clock::now();
     op->completionCallback = callback;
     
-    m_operations[op->id] = op;
-    m_queue.push(op);
-    m_stats.totalOperations++;
+    enqueueLocked(op);
     
     Logger::info("Queued MKDIR operation #" + std::to_string(op->id) + 
                  " for client " + clientId + ": " + drivePath);
@@ -224,9 +269,7 @@ uint64_t FileOperationQueue::queueMove(const std::string& clientId,
     op->queuedTime = std::chrono::system_clock::now();
     op->completionCallback = callback;
     
-    m_operations[op->id] = op;
-    m_queue.push(op);
-    m_stats.totalOperations++;
+    enqueueLocked(op);
     
     Logger::info("Queued MOVE operation #" + std::to_string(op->id) + 
                  " for client " + clientId + ": " + driveSourcePath + " -> " + driveDestPath);
@@ -252,12 +295,17 @@ void FileOperationQueue::processQueue() {
             
             op = m_queue.front();
             m_queue.pop();
+            m_executing = true;
             op->status = OperationStatus::IN_PROGRESS;
             op->startTime = std::chrono::system_clock::now();
         }
         
+        reportProgress(*op, true);
+        
         // Execute operation outside of lock
+        auto started = std::chrono::steady_clock::now();
         bool success = executeOperation(op);
+        m_operationDurations.observe(std::chrono::steady_clock::now() - started);
         
         {
             std::lock_guard<std::mutex> lock(m_mutex);
@@ -284,6 +332,8 @@ void FileOperationQueue::processQueue() {
                 m_stats.completedOperations;
         }
         
+        reportProgress(*op, true);
+        
         // Call completion callback
         if (op->completionCallback) {
             try {
@@ -292,6 +342,12 @@ void FileOperationQueue::processQueue() {
                 Logger::error("Exception in completion callback: " + std::string(e.what()));
             }
         }
+        
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_executing = false;
+        }
+        m_condition.notify_all();
     }
     
     Logger::info("FileOperationQueue processing thread stopped");
@@ -349,6 +405,7 @@ bool FileOperationQueue::executeRead(std::shared_ptr<FileOperation> op) {
     while (src.read(buffer.data(), bufferSize) || src.gcount() > 0) {
         dst.write(buffer.data(), src.gcount());
         op->bytesProcessed += src.gcount();
+        reportProgress(*op, false);
     }
     
     op->localBufferPath = bufferPath;
@@ -378,6 +435,7 @@ bool FileOperationQueue::executeWrite(std::shared_ptr<FileOperation> op) {
     while (src.read(buffer.data(), bufferSize) || src.gcount() > 0) {
         dst.write(buffer.data(), src.gcount());
         op->bytesProcessed += src.gcount();
+        reportProgress(*op, false);
     }
     
     // Clean up local buffer after successful write
@@ -401,6 +459,24 @@ bool FileOperationQueue::executeMkdir(std::shared_ptr<FileOperation> op) {
     return true;
 }
 
+void FileOperationQueue::reportProgress(const FileOperation& op, bool force) {
+    if (!m_progressCallback) {
+        return;
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    if (!force && now - m_lastProgressReport < PROGRESS_INTERVAL) {
+        return;
+    }
+    m_lastProgressReport = now;
+    
+    try {
+        m_progressCallback(op);
+    } catch (const std::exception& e) {
+        Logger::error("Exception in progress callback: " + std::string(e.what()));
+    }
+}
+
 bool FileOperationQueue::executeMove(std::shared_ptr<FileOperation> op) {
     fs::rename(op->sourcePath, op->destPath);
     Logger::info("Move operation #" + std::to_string(op->id) + " completed successfully");
@@ -410,14 +486,15 @@ bool FileOperationQueue::executeMove(std::shared_ptr<FileOperation> op) {
 std::string FileOperationQueue::allocateLocalBuffer(const std::string& clientId, uint64_t size) {
     std::lock_guard<std::mutex> lock(m_mutex);
     
-    if (!hasBufferSpace(size)) {
+    if (!hasBufferSpaceLocked(size)) {
         Logger::warn("Insufficient buffer space for allocation: " + std::to_string(size / (1024*1024)) + " MB");
         return "";
     }
     
     // Generate unique buffer filename
     auto timestamp = std::chrono::system_clock::now().time_since_epoch().count();
-    std::string filename = "buffer_" + clientId + "_" + std::to_string(timestamp) + ".tmp";
+    std::string filename = "buffer_" + clientId + "_" + std::to_string(timestamp) + "_" +
+                           std::to_string(m_nextBufferId++) + ".tmp";
     std::string fullPath = m_localBufferPath + "/" + filename;
     
     m_currentBufferUsage += size;
@@ -440,6 +517,39 @@ void FileOperationQueue::releaseLocalBuffer(const std::string& bufferPath) {
     }
 }
 
+void FileOperationQueue::releaseLocalBuffer(const std::string& bufferPath, uint64_t reservedSize) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    // Used for buffers abandoned before they were filled (e.g. an aborted upload),
+    // where the file size does not match what allocateLocalBuffer reserved
+    std::error_code ec;
+    fs::remove(bufferPath, ec);
+    m_currentBufferUsage -= std::min(reservedSize, m_currentBufferUsage);
+    
+    Logger::debug("Released unused buffer: " + bufferPath + " (" + std::to_string(reservedSize / (1024*1024)) + " MB)");
+}
+
+bool FileOperationQueue::resizeLocalBuffer(const std::string& bufferPath, uint64_t reservedSize, uint64_t newSize) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    if (newSize > reservedSize) {
+        if (!hasBufferSpaceLocked(newSize - reservedSize)) {
+            return false;
+        }
+        m_currentBufferUsage += newSize - reservedSize;
+    } else {
+        m_currentBufferUsage -= std::min(reservedSize - newSize, m_currentBufferUsage);
+    }
+    
+    Logger::debug("Resized buffer: " + bufferPath + " (" + std::to_string(newSize / (1024*1024)) + " MB)");
+    return true;
+}
+
+void FileOperationQueue::setExternalBufferUsage(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_externalBufferUsage = bytes;
+}
+
 uint64_t FileOperationQueue::calculateBufferUsage() const {
     uint64_t totalSize = 0;
     
@@ -458,19 +568,25 @@ uint64_t FileOperationQueue::calculateBufferUsage() const {
 
 uint64_t FileOperationQueue::getAvailableBufferSpace() const {
     std::lock_guard<std::mutex> lock(m_mutex);
-    return m_maxLocalBufferSize > m_currentBufferUsage ? 
-           m_maxLocalBufferSize - m_currentBufferUsage : 0;
+    uint64_t used = m_currentBufferUsage + m_externalBufferUsage;
+    return m_maxLocalBufferSize > used ? m_maxLocalBufferSize - used : 0;
 }
 
 uint64_t FileOperationQueue::getUsedBufferSpace() const {
     std::lock_guard<std::mutex> lock(m_mutex);
-    return m_currentBufferUsage;
+    return m_currentBufferUsage + m_externalBufferUsage;
 }
 
 bool FileOperationQueue::hasBufferSpace(uint64_t requiredSize) const {
     return getAvailableBufferSpace() >= requiredSize;
 }
 
+bool FileOperationQueue::hasBufferSpaceLocked(uint64_t requiredSize) const {
+    // Caller holds m_mutex
+    uint64_t used = m_currentBufferUsage + m_externalBufferUsage;
+    return m_maxLocalBufferSize > used && m_maxLocalBufferSize - used >= requiredSize;
+}
+
 bool FileOperationQueue::cancelOperation(uint64_t operationId) {
     std::lock_guard<std::mutex> lock(m_mutex);
     
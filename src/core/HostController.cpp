@@ -2,24 +2,75 @@
 #include "core/HostController.hpp"
 #include "utils/Logger.hpp"
 #include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <cstring>
+#include <ctime>
 #include <fstream>
 #include <filesystem>
 
+// Without a UDC to bind to, look again this often even if no uevent says one appeared
+const std::chrono::milliseconds HostController::RETRY_INTERVAL(5000);
+// Safety net for UDC drivers that don't notify state changes
+const std::chrono::milliseconds HostController::STATE_RECHECK_INTERVAL(30000);
+
+namespace {
+
+void put16(uint8_t* field, uint16_t value) {
+    field[0] = static_cast<uint8_t>(value);
+    field[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void put32(uint8_t* field, uint32_t value) {
+    put16(field, static_cast<uint16_t>(value));
+    put16(field + 2, static_cast<uint16_t>(value >> 16));
+}
+
+// A kernel uevent is "action@devpath" followed by NUL-separated KEY=VALUE pairs
+bool isUdcEvent(const char* message, size_t length) {
+    static const char SUBSYSTEM_UDC[] = "SUBSYSTEM=udc";
+    
+    const char* end = message + length;
+    for (const char* field = message; field < end; field += strnlen(field, end - field) + 1) {
+        size_t fieldLength = strnlen(field, end - field);
+        if (fieldLength == sizeof(SUBSYSTEM_UDC) - 1 && memcmp(field, SUBSYSTEM_UDC, fieldLength) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
 HostController::HostController(int hostId)
     : m_hostId(hostId)
     , m_status(ConnectionStatus::DISCONNECTED)
     , m_accessEnabled(true)
+    , m_readOnly(false)
     , m_shouldRun(false)
+    , m_wakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+    , m_stateFd(-1)
+    , m_imageSize(1024ULL * 1024 * 1024)   // 1GB
+    , m_preallocateImage(false)
+    , m_imageFormat("fat32")
 {
 }
 
 HostController::~HostController() {
     disconnect();
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+    }
 }
 
 bool HostController::connect() {
-    if (m_status == ConnectionStatus::CONNECTED || m_status == ConnectionStatus::CONNECTING) {
+    if (m_shouldRun) {
         return true;
     }
     
@@ -35,13 +86,18 @@ bool HostController::connect() {
 }
 
 bool HostController::disconnect() {
-    if (m_status == ConnectionStatus::DISCONNECTED) {
+    // The thread also runs while no host is plugged in
+    if (!m_shouldRun && !m_connectionThread.joinable()) {
         return true;
     }
     
     LOG_INFO("Disconnecting USB host " + std::to_string(m_hostId), "HOST");
     
     m_shouldRun = false;
+    uint64_t wake = 1;
+    if (write(m_wakeFd, &wake, sizeof(wake)) < 0) {
+        LOG_WARNING("Failed to wake host controller thread: " + std::string(strerror(errno)), "HOST");
+    }
     
     if (m_connectionThread.joinable()) {
         m_connectionThread.join();
@@ -56,67 +112,211 @@ bool HostController::disconnect() {
     return true;
 }
 
+void HostController::setBackingImageFormat(const std::string& format) {
+    // An image nothing formats would reach the host as a blank disk
+    if (format != "fat32" && format != "exfat" && format != "none") {
+        LOG_WARNING("Unknown backing image format '" + format + "', using fat32", "HOST");
+        m_imageFormat = "fat32";
+        return;
+    }
+    m_imageFormat = format;
+}
+
 void HostController::setStatusCallback(std::function<void(int, ConnectionStatus)> callback) {
     m_statusCallback = callback;
 }
 
 void HostController::enableAccess() {
     m_accessEnabled = true;
+    m_readOnly = false;
+    updateAccessMode(false);
     LOG_INFO("Access enabled for USB host " + std::to_string(m_hostId), "HOST");
 }
 
+void HostController::enableReadOnlyAccess() {
+    m_accessEnabled = true;
+    m_readOnly = true;
+    updateAccessMode(true);
+    LOG_INFO("Read-only access enabled for USB host " + std::to_string(m_hostId), "HOST");
+}
+
 void HostController::disableAccess() {
     m_accessEnabled = false;
+    // A passed-through drive is ejected by the caller and the image comes back read-only
+    if (getBlockDevice().empty()) {
+        updateAccessMode(true);
+    }
     LOG_INFO("Access disabled for USB host " + std::to_string(m_hostId), "HOST");
 }
 
 void HostController::connectionLoop() {
+    int ueventFd = openUeventSocket();
+    
     while (m_shouldRun) {
         try {
-            // Check if USB gadget module is available
-            std::string gadgetPath = "/sys/kernel/config/usb_gadget/usb" + std::to_string(m_hostId);
-            
-            if (std::filesystem::exists("/sys/kernel/config/usb_gadget")) {
-                if (m_status != ConnectionStatus::CONNECTED) {
-                    // Configure USB gadget for mass storage
-                    if (configureUsbGadget()) {
-                        m_status = ConnectionStatus::CONNECTED;
-                        LOG_INFO("USB host " + std::to_string(m_hostId) + " connected", "HOST");
-                        notifyStatusChange();
-                    } else {
-                        m_status = ConnectionStatus::ERROR;
-                        LOG_ERROR("Failed to configure USB gadget for host " + std::to_string(m_hostId), "HOST");
-                        notifyStatusChange();
-                    }
-                }
-                
-                // Monitor connection health
-                if (m_status == ConnectionStatus::CONNECTED) {
-                    if (!isGadgetActive()) {
-                        LOG_WARNING("USB gadget became inactive for host " + std::to_string(m_hostId), "HOST");
-                        m_status = ConnectionStatus::DISCONNECTED;
-                        notifyStatusChange();
-                    }
-                }
-                
+            if (m_stateFd < 0) {
+                bindGadget();
             } else {
-                if (m_status == ConnectionStatus::CONNECTED) {
-                    m_status = ConnectionStatus::DISCONNECTED;
-                    LOG_INFO("USB gadget subsystem unavailable for host " + std::to_string(m_hostId), "HOST");
-                    notifyStatusChange();
-                }
+                updateHostState();
             }
-            
-            // Check connection status periodically
-            std::this_thread::sleep_for(std::chrono::seconds(2));
-            
         } catch (const std::exception& e) {
             LOG_ERROR("Exception in host controller loop: " + std::string(e.what()), "HOST");
-            m_status = ConnectionStatus::ERROR;
-            notifyStatusChange();
-            std::this_thread::sleep_for(std::chrono::seconds(5));
+            closeStateWatch();
+            setStatus(ConnectionStatus::ERROR);
+        }
+        
+        waitForEvent(ueventFd, m_stateFd >= 0 ? STATE_RECHECK_INTERVAL : RETRY_INTERVAL);
+    }
+    
+    closeStateWatch();
+    if (ueventFd >= 0) {
+        close(ueventFd);
+    }
+}
+
+bool HostController::bindGadget() {
+    if (!std::filesystem::exists("/sys/kernel/config/usb_gadget")) {
+        if (m_status == ConnectionStatus::CONNECTED) {
+            LOG_INFO("USB gadget subsystem unavailable for host " + std::to_string(m_hostId), "HOST");
         }
+        setStatus(ConnectionStatus::DISCONNECTED);
+        return false;
+    }
+    
+    if (!configureUsbGadget()) {
+        LOG_ERROR("Failed to configure USB gadget for host " + std::to_string(m_hostId), "HOST");
+        setStatus(ConnectionStatus::ERROR);
+        return false;
     }
+    
+    // The UDC core calls sysfs_notify() on state for every transition, so it can be polled
+    std::string statePath = "/sys/class/udc/" + m_udcName + "/state";
+    m_stateFd = open(statePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_stateFd < 0) {
+        LOG_WARNING("Cannot watch " + statePath + ": " + std::string(strerror(errno)), "HOST");
+        setStatus(ConnectionStatus::ERROR);
+        return false;
+    }
+    
+    updateHostState();
+    return true;
+}
+
+void HostController::updateHostState() {
+    // sysfs attributes are re-read from offset 0, which also re-arms the poll notification
+    char buffer[64];
+    ssize_t length = pread(m_stateFd, buffer, sizeof(buffer) - 1, 0);
+    if (length < 0) {
+        LOG_WARNING("UDC " + m_udcName + " went away for host " + std::to_string(m_hostId), "HOST");
+        closeStateWatch();
+        setStatus(ConnectionStatus::DISCONNECTED);
+        return;
+    }
+    
+    std::string state(buffer, static_cast<size_t>(length));
+    while (!state.empty() && (state.back() == '\n' || state.back() == ' ')) {
+        state.pop_back();
+    }
+    
+    if (state == "configured" || state == "suspended") {
+        setStatus(ConnectionStatus::CONNECTED);
+    } else if (state == "not attached") {
+        setStatus(ConnectionStatus::DISCONNECTED);
+    } else {
+        // powered, default, addressed: the host is enumerating the gadget
+        setStatus(ConnectionStatus::CONNECTING);
+    }
+}
+
+void HostController::closeStateWatch() {
+    if (m_stateFd >= 0) {
+        close(m_stateFd);
+        m_stateFd = -1;
+    }
+}
+
+int HostController::openUeventSocket() {
+    // UDCs appearing or disappearing (driver loaded, controller reset) arrive as kernel uevents
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) {
+        LOG_WARNING("No uevent socket, UDC changes are picked up by polling: " + std::string(strerror(errno)), "HOST");
+        return -1;
+    }
+    
+    sockaddr_nl address = {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = 1;   // Kernel uevents
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        LOG_WARNING("Failed to bind uevent socket: " + std::string(strerror(errno)), "HOST");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void HostController::waitForEvent(int ueventFd, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    
+    while (true) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0) {
+            return;
+        }
+        
+        pollfd fds[3] = {
+            {m_wakeFd, POLLIN, 0},
+            {ueventFd, POLLIN, 0},
+            {m_stateFd, POLLPRI | POLLERR, 0}
+        };
+        // A negative descriptor is ignored by poll()
+        int ready = poll(fds, 3, static_cast<int>(remaining.count()));
+        if (ready == 0 || (ready < 0 && errno != EINTR)) {
+            return;
+        }
+        if (ready < 0) {
+            continue;
+        }
+        
+        bool wake = (fds[2].revents & (POLLPRI | POLLERR)) != 0;
+        if (fds[0].revents & POLLIN) {
+            uint64_t value;
+            while (read(m_wakeFd, &value, sizeof(value)) > 0) {}
+            wake = true;
+        }
+        if (fds[1].revents & POLLIN) {
+            // Every device on the system reports here; rebinding the gadget for each of them
+            // would rebuild it over and over, so only the udc class ends the wait
+            char buffer[8192];
+            ssize_t length;
+            while ((length = recv(ueventFd, buffer, sizeof(buffer), 0)) > 0) {
+                if (isUdcEvent(buffer, static_cast<size_t>(length))) {
+                    wake = true;
+                }
+            }
+        }
+        if (wake) {
+            return;
+        }
+    }
+}
+
+void HostController::setStatus(ConnectionStatus status) {
+    if (m_status == status) {
+        return;
+    }
+    m_status = status;
+    
+    switch (status) {
+        case ConnectionStatus::CONNECTED:
+            LOG_INFO("USB host " + std::to_string(m_hostId) + " connected", "HOST");
+            break;
+        case ConnectionStatus::DISCONNECTED:
+            LOG_INFO("USB host " + std::to_string(m_hostId) + " disconnected", "HOST");
+            break;
+        default:
+            break;
+    }
+    notifyStatusChange();
 }
 
 bool HostController::configureUsbGadget() {
@@ -204,10 +404,11 @@ bool HostController::configureUsbGadget() {
             return false;
         }
         
-        writeGadgetFile(gadgetPath + "/UDC", udcName);
-        
-        // Wait a moment for the gadget to initialize
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        // Binding is synchronous; the host's enumeration shows up in the UDC state
+        if (!writeGadgetFile(gadgetPath + "/UDC", udcName)) {
+            return false;
+        }
+        m_udcName = udcName;
         
         LOG_INFO("USB gadget configured successfully for host " + std::to_string(m_hostId) + " on UDC " + udcName, "HOST");
         return true;
@@ -221,20 +422,9 @@ bool HostController::configureUsbGadget() {
 
 bool HostController::configureMassStorageBacking(const std::string& functionPath) {
     try {
-        // Check if we have a mounted USB drive to share
-        std::string usbMountPoint = "/mnt/usb_bridge";
-        std::string backingFile = usbMountPoint + "/bridge_storage_" + std::to_string(m_hostId) + ".img";
-        
-        // If no USB drive is mounted, create a temporary backing file
-        if (!std::filesystem::exists(usbMountPoint) || !std::filesystem::is_directory(usbMountPoint)) {
-            backingFile = "/tmp/usb_bridge_" + std::to_string(m_hostId) + ".img";
-            LOG_WARNING("No USB storage mounted, using temporary backing file: " + backingFile, "HOST");
-        }
-        
-        // Create backing file if it doesn't exist
-        if (!std::filesystem::exists(backingFile)) {
-            createBackingFile(backingFile);
-        }
+        // A device attached while the gadget was down is exported as soon as it binds
+        std::lock_guard<std::mutex> lock(m_backingMutex);
+        std::string backingFile = m_blockDevice.empty() ? prepareBackingFile() : m_blockDevice;
         
         // Configure the LUN (Logical Unit Number)
         std::string lunPath = functionPath + "/lun.0";
@@ -242,7 +432,7 @@ bool HostController::configureMassStorageBacking(const std::string& functionPath
         writeGadgetFile(lunPath + "/file", backingFile);
         writeGadgetFile(lunPath + "/removable", "1");
         writeGadgetFile(lunPath + "/cdrom", "0");
-        writeGadgetFile(lunPath + "/ro", m_accessEnabled ? "0" : "1"); // Read-only if access disabled
+        writeGadgetFile(lunPath + "/ro", isReadOnly() ? "1" : "0"); // Read-only if access disabled or shared
         writeGadgetFile(lunPath + "/nofua", "1"); // Disable FUA for better performance
         
         LOG_INFO("Mass storage backing configured: " + backingFile, "HOST");
@@ -254,33 +444,157 @@ bool HostController::configureMassStorageBacking(const std::string& functionPath
     }
 }
 
-void HostController::createBackingFile(const std::string& filePath) {
-    LOG_INFO("Creating backing file: " + filePath, "HOST");
+std::string HostController::prepareBackingFile() {
+    // Check if we have a mounted USB drive to share
+    std::string usbMountPoint = "/mnt/usb_bridge";
+    std::string backingFile = usbMountPoint + "/bridge_storage_" + std::to_string(m_hostId) + ".img";
     
-    // Create a 1GB backing file
-    const size_t fileSize = 1024 * 1024 * 1024; // 1GB
+    // If no USB drive is mounted, create a temporary backing file
+    if (!std::filesystem::exists(usbMountPoint) || !std::filesystem::is_directory(usbMountPoint)) {
+        backingFile = "/tmp/usb_bridge_" + std::to_string(m_hostId) + ".img";
+        LOG_WARNING("No USB storage mounted, using temporary backing file: " + backingFile, "HOST");
+    }
+    
+    // Create backing file if it doesn't exist
+    if (!std::filesystem::exists(backingFile)) {
+        createBackingFile(backingFile);
+    }
+    return backingFile;
+}
+
+void HostController::createBackingFile(const std::string& filePath) {
+    LOG_INFO("Creating " + std::to_string(m_imageSize / (1024 * 1024)) + " MB backing file: " + filePath, "HOST");
+    auto started = std::chrono::steady_clock::now();
     
-    std::ofstream file(filePath, std::ios::binary);
-    if (!file.is_open()) {
+    int fd = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
         throw std::runtime_error("Failed to create backing file: " + filePath);
     }
     
-    // Write sparse file (seek to end and write one byte)
-    file.seekp(fileSize - 1);
-    file.write("\0", 1);
-    file.close();
+    // Only metadata is written: holes and unwritten extents read as zeros. Filesystems
+    // without either (kernel FAT) zero-fill on extend whatever is asked for.
+    bool sized = false;
+    if (m_preallocateImage) {
+        sized = fallocate(fd, 0, 0, static_cast<off_t>(m_imageSize)) == 0;
+        if (!sized) {
+            LOG_WARNING("Cannot preallocate backing file (" + std::string(strerror(errno)) + "), creating it sparse", "HOST");
+        }
+    }
+    if (!sized && ftruncate(fd, static_cast<off_t>(m_imageSize)) != 0) {
+        std::string error = strerror(errno);
+        close(fd);
+        std::filesystem::remove(filePath);
+        throw std::runtime_error("Failed to size backing file " + filePath + ": " + error);
+    }
     
-    // Format the file as FAT32
-    std::string formatCmd = "mkfs.vfat -F 32 -n \"USBBRIDGE\" \"" + filePath + "\" >/dev/null 2>&1";
-    int result = system(formatCmd.c_str());
+    bool formatted = true;
+    if (m_imageFormat == "fat32") {
+        formatted = writeFat32Layout(fd, m_imageSize, "USBBRIDGE");
+    }
+    close(fd);
     
-    if (result != 0) {
-        LOG_WARNING("Failed to format backing file as FAT32", "HOST");
+    // exFAT needs an upcase table, allocation bitmap and checksummed boot region; left to mkfs
+    if (m_imageFormat == "exfat") {
+        std::string formatCmd = "mkfs.exfat -n \"USBBRIDGE\" \"" + filePath + "\" >/dev/null 2>&1";
+        formatted = system(formatCmd.c_str()) == 0;
+    }
+    
+    if (!formatted) {
+        LOG_WARNING("Failed to format backing file as " + m_imageFormat, "HOST");
     } else {
-        LOG_INFO("Backing file formatted as FAT32", "HOST");
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+        LOG_INFO("Backing file ready (" + m_imageFormat + ") in " + std::to_string(elapsed.count()) + " ms", "HOST");
     }
 }
 
+bool HostController::writeFat32Layout(int fd, uint64_t size, const std::string& label) {
+    // Microsoft's FAT specification (fatgen103); a superfloppy, as mkfs.vfat makes on a file
+    const uint32_t sectorSize = 512;
+    const uint32_t reservedSectors = 32;
+    const uint32_t fatCount = 2;
+    const uint32_t backupBootSector = 6;
+    
+    uint64_t sectors = size / sectorSize;
+    if (sectors > 0xFFFFFFFFULL || sectors < reservedSectors + 2 * fatCount) {
+        return false;
+    }
+    uint32_t totalSectors = static_cast<uint32_t>(sectors);
+    
+    // Cluster sizes as Windows picks them, halved while the volume has too few clusters
+    uint32_t sectorsPerCluster = size <= (8ULL << 30) ? 8 : size <= (16ULL << 30) ? 16 :
+                                 size <= (32ULL << 30) ? 32 : 64;
+    uint32_t fatSectors;
+    uint32_t clusters;
+    for (;;) {
+        uint32_t divisor = (256 * sectorsPerCluster + fatCount) / 2;
+        fatSectors = (totalSectors - reservedSectors + divisor - 1) / divisor;
+        clusters = (totalSectors - reservedSectors - fatCount * fatSectors) / sectorsPerCluster;
+        if (clusters >= 65525 || sectorsPerCluster == 1) {
+            break;
+        }
+        sectorsPerCluster /= 2;
+    }
+    if (clusters < 65525) {
+        LOG_WARNING("Backing file too small for FAT32", "HOST");
+        return false;
+    }
+    
+    char volumeLabel[11];
+    std::memset(volumeLabel, ' ', sizeof(volumeLabel));
+    std::memcpy(volumeLabel, label.data(), std::min(label.size(), sizeof(volumeLabel)));
+    
+    uint8_t boot[sectorSize] = {};
+    boot[0] = 0xEB;                                  // jmp short past the BPB, nop
+    boot[1] = 0x58;
+    boot[2] = 0x90;
+    std::memcpy(boot + 3, "MSWIN4.1", 8);
+    put16(boot + 11, sectorSize);
+    boot[13] = static_cast<uint8_t>(sectorsPerCluster);
+    put16(boot + 14, reservedSectors);
+    boot[16] = fatCount;
+    boot[21] = 0xF8;                                 // Fixed media
+    put16(boot + 24, 32);                            // Sectors per track, heads: nominal
+    put16(boot + 26, 64);
+    put32(boot + 32, totalSectors);
+    put32(boot + 36, fatSectors);
+    put32(boot + 44, 2);                             // Root directory cluster
+    put16(boot + 48, 1);                             // FSInfo sector
+    put16(boot + 50, backupBootSector);
+    boot[64] = 0x80;
+    boot[66] = 0x29;                                 // Volume ID, label and type follow
+    put32(boot + 67, static_cast<uint32_t>(time(nullptr)));
+    std::memcpy(boot + 71, volumeLabel, 11);
+    std::memcpy(boot + 82, "FAT32   ", 8);
+    boot[510] = 0x55;
+    boot[511] = 0xAA;
+    
+    uint8_t info[sectorSize] = {};
+    put32(info, 0x41615252);
+    put32(info + 484, 0x61417272);
+    put32(info + 488, clusters - 1);                 // Free clusters; the root directory has one
+    put32(info + 492, 3);                            // Next free cluster hint
+    put32(info + 508, 0xAA550000);
+    
+    uint8_t fat[sectorSize] = {};
+    put32(fat, 0x0FFFFFF8);                          // Media byte
+    put32(fat + 4, 0x0FFFFFFF);
+    put32(fat + 8, 0x0FFFFFFF);                      // Root directory, one cluster
+    
+    uint8_t root[sectorSize] = {};
+    std::memcpy(root, volumeLabel, 11);
+    root[11] = 0x08;                                 // Volume label entry
+    
+    // Everything else is zero in a fresh file, so a few sectors make the volume
+    auto writeSector = [fd](uint64_t sector, const uint8_t* data) {
+        return pwrite(fd, data, sectorSize, static_cast<off_t>(sector * sectorSize)) == sectorSize;
+    };
+    uint32_t dataStart = reservedSectors + fatCount * fatSectors;
+    return writeSector(0, boot) && writeSector(1, info) &&
+           writeSector(backupBootSector, boot) && writeSector(backupBootSector + 1, info) &&
+           writeSector(reservedSectors, fat) && writeSector(reservedSectors + fatSectors, fat) &&
+           writeSector(dataStart, root);
+}
+
 std::string HostController::findAvailableUDC() {
     std::string udcDir = "/sys/class/udc";
     
@@ -369,8 +683,8 @@ void HostController::cleanupUsbGadget() {
         // Disable gadget first
         std::string udcPath = gadgetPath + "/UDC";
         if (std::filesystem::exists(udcPath)) {
+            // Unbinding returns once the function is torn down
             writeGadgetFile(udcPath, "");
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
         
         // Remove configuration links
@@ -452,11 +766,26 @@ bool HostController::updateAccessMode(bool readOnly) {
     }
     
     try {
-        std::string gadgetName = "usb" + std::to_string(m_hostId);
-        std::string gadgetPath = "/sys/kernel/config/usb_gadget/" + gadgetName;
-        std::string lunPath = gadgetPath + "/functions/mass_storage.usb" + std::to_string(m_hostId) + "/lun.0/ro";
+        std::string lunPath = "/sys/kernel/config/usb_gadget/usb" + std::to_string(m_hostId) +
+                              "/functions/mass_storage.usb" + std::to_string(m_hostId) + "/lun.0";
+        
+        std::lock_guard<std::mutex> lock(m_backingMutex);
+        std::ifstream currentFile(lunPath + "/file");
+        std::string backingFile;
+        std::getline(currentFile, backingFile);
+        
+        // Re-inserting is a media change the host has to recover from; only a flip needs one
+        std::ifstream currentMode(lunPath + "/ro");
+        std::string mode;
+        std::getline(currentMode, mode);
+        if (mode == (readOnly ? "1" : "0")) {
+            return true;
+        }
         
-        return writeGadgetFile(lunPath, readOnly ? "1" : "0");
+        bool success = insertMedium(backingFile, readOnly);
+        
+        LOG_INFO("USB host " + std::to_string(m_hostId) + " LUN now " + (readOnly ? "read-only" : "read-write"), "HOST");
+        return success;
         
     } catch (const std::exception& e) {
         LOG_ERROR("Failed to update access mode: " + std::string(e.what()), "HOST");
@@ -476,15 +805,14 @@ bool HostController::changeBackingFile(const std::string& newBackingFile) {
         
         // Disconnect first
         writeGadgetFile(gadgetPath + "/UDC", "");
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
         
         // Change backing file
         bool success = writeGadgetFile(filePath, newBackingFile);
         
         // Reconnect
         std::string udcName = findAvailableUDC();
-        if (!udcName.empty()) {
-            writeGadgetFile(gadgetPath + "/UDC", udcName);
+        if (!udcName.empty() && writeGadgetFile(gadgetPath + "/UDC", udcName)) {
+            m_udcName = udcName;
         }
         
         if (success) {
@@ -499,6 +827,111 @@ bool HostController::changeBackingFile(const std::string& newBackingFile) {
     }
 }
 
+bool HostController::attachBlockDevice(const std::string& devicePath, bool readOnly) {
+    std::lock_guard<std::mutex> lock(m_backingMutex);
+    m_accessEnabled = true;
+    m_readOnly = readOnly;
+    if (!insertMedium(devicePath, readOnly)) {
+        LOG_ERROR("Failed to attach " + devicePath + " to USB host " + std::to_string(m_hostId), "HOST");
+        return false;
+    }
+    m_blockDevice = devicePath;
+    LOG_INFO("USB host " + std::to_string(m_hostId) + " now exports " + devicePath +
+             (readOnly ? " read-only" : ""), "HOST");
+    return true;
+}
+
+bool HostController::ejectMedium() {
+    std::lock_guard<std::mutex> lock(m_backingMutex);
+    if (!insertMedium("", isReadOnly())) {
+        LOG_ERROR("USB host " + std::to_string(m_hostId) + " won't release its medium", "HOST");
+        return false;
+    }
+    if (!m_blockDevice.empty()) {
+        LOG_INFO("Detached " + m_blockDevice + " from USB host " + std::to_string(m_hostId), "HOST");
+        m_blockDevice.clear();
+    }
+    return true;
+}
+
+bool HostController::restoreBackingFile() {
+    std::lock_guard<std::mutex> lock(m_backingMutex);
+    if (!m_blockDevice.empty()) {
+        return false;
+    }
+    try {
+        return insertMedium(prepareBackingFile(), isReadOnly());
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to restore backing file: " + std::string(e.what()), "HOST");
+        return false;
+    }
+}
+
+std::string HostController::getBlockDevice() const {
+    std::lock_guard<std::mutex> lock(m_backingMutex);
+    return m_blockDevice;
+}
+
+bool HostController::insertMedium(const std::string& path, bool readOnly) {
+    std::string lunPath = "/sys/kernel/config/usb_gadget/usb" + std::to_string(m_hostId) +
+                          "/functions/mass_storage.usb" + std::to_string(m_hostId) + "/lun.0";
+    // Not configured yet: configureMassStorageBacking inserts the medium when the gadget binds
+    if (!std::filesystem::exists(lunPath)) {
+        return true;
+    }
+    
+    std::ifstream currentFile(lunPath + "/file");
+    std::string current;
+    std::getline(currentFile, current);
+    
+    // The kernel refuses to change ro while the medium is open: eject, switch, reinsert.
+    // The LUN is removable, so the host sees a media change and rereads the drive.
+    if (!current.empty() && !writeGadgetFile(lunPath + "/file", "")) {
+        // The host has locked the medium (PREVENT MEDIUM REMOVAL); newer kernels can override it
+        if (!std::filesystem::exists(lunPath + "/forced_eject") ||
+            !writeGadgetFile(lunPath + "/forced_eject", "1")) {
+            return false;
+        }
+    }
+    bool success = writeGadgetFile(lunPath + "/ro", readOnly ? "1" : "0");
+    if (!path.empty() && !writeGadgetFile(lunPath + "/file", path)) {
+        return false;
+    }
+    return success;
+}
+
+bool HostController::getBackingIoCounters(uint64_t& completed, uint64_t& inFlight) const {
+    std::string lunFile = "/sys/kernel/config/usb_gadget/usb" + std::to_string(m_hostId) +
+                          "/functions/mass_storage.usb" + std::to_string(m_hostId) + "/lun.0/file";
+    std::ifstream file(lunFile);
+    std::string backingFile;
+    if (!std::getline(file, backingFile) || backingFile.empty()) {
+        return false;
+    }
+    return readBlockIoCounters(backingFile, completed, inFlight);
+}
+
+bool HostController::readBlockIoCounters(const std::string& path, uint64_t& completed, uint64_t& inFlight) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+    dev_t device = S_ISBLK(info.st_mode) ? info.st_rdev : info.st_dev;
+    
+    // Documentation/block/stat.rst: reads, merged, sectors, ticks, writes, merged, sectors, ticks, in_flight
+    std::ifstream counters("/sys/dev/block/" + std::to_string(major(device)) + ":" +
+                       std::to_string(minor(device)) + "/stat");
+    uint64_t fields[9];
+    for (auto& field : fields) {
+        if (!(counters >> field)) {
+            return false;
+        }
+    }
+    completed = fields[0] + fields[4];
+    inFlight = fields[8];
+    return true;
+}
+
 std::string HostController::getConnectionInfo() const {
     std::string info = "Host " + std::to_string(m_hostId) + ": ";
     
@@ -511,7 +944,7 @@ std::string HostController::getConnectionInfo() const {
             break;
         case ConnectionStatus::CONNECTED:
             info += "Connected";
-            if (!m_accessEnabled) {
+            if (isReadOnly()) {
                 info += " (Read-Only)";
             }
             break;
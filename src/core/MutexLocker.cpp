@@ -1,14 +1,36 @@
 #include "core/MutexLocker.hpp"
 #include "utils/Logger.hpp"
+#include <algorithm>
 
 namespace usb_bridge {
 
 MutexLocker::MutexLocker()
     : m_currentMode(AccessMode::BOARD_MANAGED)
     , m_currentGrant(nullptr)
+    , m_idleTimeout(std::chrono::seconds(30))
+    , m_maxGrantDuration(std::chrono::minutes(30))
+    , m_clock([] { return std::chrono::system_clock::now(); })
+    , m_timeSlice(std::chrono::seconds(0))
+    , m_boardWindow(std::chrono::seconds(0))
+    , m_nextTicket(1)
+    , m_queuePolicy(QueuePolicy::FIFO)
     , m_blocked(false)
-    , m_stats({0, 0, 0, 0, std::chrono::milliseconds(0), 0})
+    , m_stats({0, 0, 0, 0, std::chrono::milliseconds(0), 0, 0, 0, 0})
 {
+    // Used with QueuePolicy::PRIORITY: a host waiting on its USB port goes before network clients
+    m_clientPriorities[static_cast<int>(ClientType::SYSTEM)] = 3;
+    m_clientPriorities[static_cast<int>(ClientType::USB_HOST_1)] = 2;
+    m_clientPriorities[static_cast<int>(ClientType::USB_HOST_2)] = 2;
+    m_clientPriorities[static_cast<int>(ClientType::NETWORK_SMB)] = 1;
+    m_clientPriorities[static_cast<int>(ClientType::NETWORK_HTTP)] = 1;
+    
+    // Time slice weights: a host holds the drive twice as long as a network client
+    m_sliceWeights[static_cast<int>(ClientType::SYSTEM)] = 1;
+    m_sliceWeights[static_cast<int>(ClientType::USB_HOST_1)] = 2;
+    m_sliceWeights[static_cast<int>(ClientType::USB_HOST_2)] = 2;
+    m_sliceWeights[static_cast<int>(ClientType::NETWORK_SMB)] = 1;
+    m_sliceWeights[static_cast<int>(ClientType::NETWORK_HTTP)] = 1;
+    
     Logger::info("MutexLocker initialized in BOARD_MANAGED mode");
 }
 
@@ -25,62 +47,194 @@ bool MutexLocker::requestDirectAccess(const std::string& clientId,
                                       ClientType clientType,
                                       uint64_t operationId,
                                       std::chrono::seconds timeout) {
+    return requestAccess(clientId, clientType, operationId, timeout, false);
+}
+
+bool MutexLocker::requestSharedAccess(const std::string& clientId,
+                                      ClientType clientType,
+                                      uint64_t operationId,
+                                      std::chrono::seconds timeout) {
+    return requestAccess(clientId, clientType, operationId, timeout, true);
+}
+
+bool MutexLocker::requestAccess(const std::string& clientId,
+                                ClientType clientType,
+                                uint64_t operationId,
+                                std::chrono::seconds timeout,
+                                bool readOnly) {
     std::unique_lock<std::mutex> lock(m_mutex);
     
     m_stats.totalDirectAccessRequests++;
-    m_stats.currentQueuedRequests++;
     
-    Logger::info("Client " + clientId + " requesting direct access for operation #" + 
-                 std::to_string(operationId));
+    Logger::info("Client " + clientId + " requesting " + (readOnly ? "read-only " : "") +
+                 "direct access for operation #" + std::to_string(operationId));
     
     // Check if access is blocked
     if (m_blocked) {
         Logger::warn("Direct access denied - system is blocked: " + m_blockReason);
         m_stats.deniedDirectAccess++;
-        m_stats.currentQueuedRequests--;
         return false;
     }
     
-    // Wait until we can grant access or timeout
-    auto deadline = std::chrono::system_clock::now() + timeout;
+    // Free and nobody waiting ahead: granted without queueing
+    if (m_waitQueue.empty() && canGrant(readOnly)) {
+        grantDirectAccess(clientId, clientType, operationId, readOnly);
+        m_stats.grantedDirectAccess++;
+        Logger::info("Direct access granted to client " + clientId);
+        return true;
+    }
+    
+    auto waiter = std::make_shared<Waiter>();
+    waiter->ticket = m_nextTicket++;
+    waiter->clientId = clientId;
+    waiter->clientType = clientType;
+    waiter->operationId = operationId;
+    waiter->priority = getClientPriority(clientType);
+    waiter->readOnly = readOnly;
+    enqueueWaiter(waiter);
+    
+    auto position = std::distance(m_waitQueue.begin(), std::find(m_waitQueue.begin(), m_waitQueue.end(), waiter)) + 1;
+    Logger::info("Client " + clientId + " queued for direct access at position " +
+                 std::to_string(position) + " (ticket " + std::to_string(waiter->ticket) + ")");
     
-    bool waitResult = m_condition.wait_until(lock, deadline, [this] {
-        return m_currentMode == AccessMode::BOARD_MANAGED || m_blocked;
+    // Woken only for this request: granted by the releasing thread, or cancelled by a block
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    waiter->condition.wait_until(lock, deadline, [&waiter] {
+        return waiter->granted || waiter->cancelled;
     });
     
-    if (m_blocked) {
+    if (waiter->granted) {
+        m_stats.grantedDirectAccess++;
+        Logger::info("Direct access granted to client " + clientId);
+        return true;
+    }
+    
+    if (waiter->cancelled) {
         Logger::warn("Direct access denied - system became blocked during wait");
         m_stats.deniedDirectAccess++;
-        m_stats.currentQueuedRequests--;
         return false;
     }
     
-    if (!waitResult) {
-        Logger::warn("Direct access request timed out for client " + clientId);
-        m_stats.timeoutDirectAccess++;
-        m_stats.currentQueuedRequests--;
-        return false;
+    m_waitQueue.remove(waiter);
+    m_stats.currentQueuedRequests = m_waitQueue.size();
+    Logger::warn("Direct access request timed out for client " + clientId);
+    m_stats.timeoutDirectAccess++;
+    return false;
+}
+
+void MutexLocker::enqueueWaiter(std::shared_ptr<Waiter> waiter) {
+    auto position = m_waitQueue.end();
+    if (m_queuePolicy == QueuePolicy::PRIORITY) {
+        // Behind everyone of the same or a higher priority
+        position = std::find_if(m_waitQueue.begin(), m_waitQueue.end(), [&waiter](const std::shared_ptr<Waiter>& other) {
+            return other->priority < waiter->priority;
+        });
     }
+    m_waitQueue.insert(position, std::move(waiter));
+    m_stats.currentQueuedRequests = m_waitQueue.size();
+}
+
+void MutexLocker::grantWaiters() {
+    while (!m_blocked && !m_waitQueue.empty() && canGrant(m_waitQueue.front()->readOnly)) {
+        auto waiter = m_waitQueue.front();
+        m_waitQueue.pop_front();
+        
+        waiter->granted = grantDirectAccess(waiter->clientId, waiter->clientType,
+                                            waiter->operationId, waiter->readOnly);
+        waiter->condition.notify_one();
+    }
+    m_stats.currentQueuedRequests = m_waitQueue.size();
+}
+
+void MutexLocker::cancelWaiters() {
+    for (auto& waiter : m_waitQueue) {
+        waiter->cancelled = true;
+        waiter->condition.notify_one();
+    }
+    m_waitQueue.clear();
+    m_stats.currentQueuedRequests = 0;
+}
     
-    // Grant access
-    bool granted = grantDirectAccess(clientId, clientType, operationId);
-    if (granted) {
-        m_stats.grantedDirectAccess++;
-        Logger::info("Direct access granted to client " + clientId);
-    } else {
-        m_stats.deniedDirectAccess++;
-        Logger::warn("Failed to grant direct access to client " + clientId);
+int MutexLocker::getClientPriority(ClientType clientType) const {
+    auto priority = m_clientPriorities.find(static_cast<int>(clientType));
+    return priority != m_clientPriorities.end() ? priority->second : 0;
+}
+
+void MutexLocker::setQueuePolicy(QueuePolicy policy) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queuePolicy = policy;
+    
+    // Requests already waiting are reordered under the new policy
+    m_waitQueue.sort([policy](const std::shared_ptr<Waiter>& a, const std::shared_ptr<Waiter>& b) {
+        if (policy == QueuePolicy::PRIORITY && a->priority != b->priority) {
+            return a->priority > b->priority;
+        }
+        return a->ticket < b->ticket;
+    });
+}
+
+void MutexLocker::setClientPriority(ClientType clientType, int priority) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_clientPriorities[static_cast<int>(clientType)] = priority;
+}
+
+size_t MutexLocker::getQueuePosition(const std::string& clientId) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    size_t position = 1;
+    for (const auto& waiter : m_waitQueue) {
+        if (waiter->clientId == clientId) {
+            return position;
+        }
+        position++;
+    }
+    return 0;
+}
+
+std::vector<std::string> MutexLocker::getWaitingClients() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    std::vector<std::string> clients;
+    clients.reserve(m_waitQueue.size());
+    for (const auto& waiter : m_waitQueue) {
+        clients.push_back(waiter->clientId);
+    }
+    return clients;
+}
+
+bool MutexLocker::canGrant(bool readOnly) const {
+    // Readers only exclude writers; a writer excludes everyone
+    if (m_currentGrant) {
+        return false;
+    }
+    if (m_clock() < m_boardWindowEnd) {
+        return false;
+    }
+    return readOnly || m_sharedGrants.empty();
+}
+
+void MutexLocker::updateAccessMode() {
+    if (m_currentGrant) {
+        m_currentMode = m_currentGrant->mode;
+        return;
     }
     
-    m_stats.currentQueuedRequests--;
-    return granted;
+    m_currentMode = AccessMode::BOARD_MANAGED;
+    for (const auto& [clientId, grant] : m_sharedGrants) {
+        // Any USB host among the readers keeps the gadget exported
+        if (grant->mode == AccessMode::DIRECT_USB) {
+            m_currentMode = AccessMode::DIRECT_USB;
+            break;
+        }
+        m_currentMode = AccessMode::DIRECT_NETWORK;
+    }
 }
 
 bool MutexLocker::grantDirectAccess(const std::string& clientId, 
                                     ClientType clientType, 
-                                    uint64_t operationId) {
-    // Should only be called when m_currentMode is BOARD_MANAGED
-    if (m_currentMode != AccessMode::BOARD_MANAGED) {
+                                    uint64_t operationId,
+                                    bool readOnly) {
+    if (!canGrant(readOnly)) {
         return false;
     }
     
@@ -88,21 +242,31 @@ bool MutexLocker::grantDirectAccess(const std::string& clientId,
     grant->clientId = clientId;
     grant->clientType = clientType;
     grant->operationId = operationId;
-    grant->grantedTime = std::chrono::system_clock::now();
-    grant->expiryTime = grant->grantedTime + std::chrono::minutes(5); // 5 minute timeout
+    grant->grantedTime = m_clock();
+    grant->lastActivityTime = grant->grantedTime;
+    grant->deadline = grant->grantedTime + m_maxGrantDuration;
+    grant->expiryTime = std::min(grant->grantedTime + m_idleTimeout, grant->deadline);
+    
+    auto weight = m_sliceWeights.find(static_cast<int>(clientType));
+    grant->sliceEnd = m_timeSlice.count() == 0 ? grant->deadline :
+                      grant->grantedTime + m_timeSlice * (weight != m_sliceWeights.end() ? weight->second : 1);
     grant->isActive = true;
+    grant->readOnly = readOnly;
     
     // Determine access mode based on client type
     if (clientType == ClientType::USB_HOST_1 || clientType == ClientType::USB_HOST_2) {
         grant->mode = AccessMode::DIRECT_USB;
-        m_currentMode = AccessMode::DIRECT_USB;
     } else {
         grant->mode = AccessMode::DIRECT_NETWORK;
-        m_currentMode = AccessMode::DIRECT_NETWORK;
     }
     
-    m_currentGrant = grant;
+    if (readOnly) {
+        m_sharedGrants[clientId] = grant;
+    } else {
+        m_currentGrant = grant;
+    }
     m_accessHistory[clientId] = grant;
+    updateAccessMode();
     
     return true;
 }
@@ -110,14 +274,37 @@ bool MutexLocker::grantDirectAccess(const std::string& clientId,
 void MutexLocker::releaseDirectAccess(const std::string& clientId) {
     std::lock_guard<std::mutex> lock(m_mutex);
     
-    if (!m_currentGrant || m_currentGrant->clientId != clientId) {
+    auto grant = takeGrant(clientId);
+    if (!grant) {
         Logger::warn("Attempted to release direct access by non-holder: " + clientId);
         return;
     }
+    endGrant(grant);
+    
+    // Back to board-managed mode unless other readers still hold the drive
+    updateAccessMode();
+    openBoardWindow();
+    
+    // Hand over to the next waiting client, if any
+    grantWaiters();
+}
+
+std::shared_ptr<AccessGrant> MutexLocker::takeGrant(const std::string& clientId) {
+    std::shared_ptr<AccessGrant> grant;
+    auto shared = m_sharedGrants.find(clientId);
+    if (m_currentGrant && m_currentGrant->clientId == clientId) {
+        grant = m_currentGrant;
+        m_currentGrant = nullptr;
+    } else if (shared != m_sharedGrants.end()) {
+        grant = shared->second;
+        m_sharedGrants.erase(shared);
+    }
+    return grant;
+}
     
-    m_currentGrant->isActive = false;
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now() - m_currentGrant->grantedTime);
+void MutexLocker::endGrant(const std::shared_ptr<AccessGrant>& grant) {
+    grant->isActive = false;
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(m_clock() - grant->grantedTime);
     
     // Update statistics
     auto totalDuration = m_stats.averageDirectAccessDuration.count() * (m_stats.grantedDirectAccess - 1);
@@ -125,19 +312,115 @@ void MutexLocker::releaseDirectAccess(const std::string& clientId) {
     m_stats.averageDirectAccessDuration = std::chrono::milliseconds(
         totalDuration / m_stats.grantedDirectAccess);
     
-    Logger::info("Client " + clientId + " released direct access (duration: " + 
+    Logger::info("Client " + grant->clientId + " released direct access (duration: " + 
                  std::to_string(duration.count()) + "ms)");
+}
     
-    // Return to board-managed mode
-    m_currentMode = AccessMode::BOARD_MANAGED;
-    m_currentGrant = nullptr;
+void MutexLocker::setLeaseLimits(std::chrono::seconds idleTimeout, std::chrono::seconds maxDuration) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_idleTimeout = idleTimeout;
+    m_maxGrantDuration = maxDuration;
+}
+
+bool MutexLocker::renewAccess(const std::string& clientId, std::chrono::seconds expectedRemaining) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    std::shared_ptr<AccessGrant> grant;
+    auto shared = m_sharedGrants.find(clientId);
+    if (m_currentGrant && m_currentGrant->clientId == clientId) {
+        grant = m_currentGrant;
+    } else if (shared != m_sharedGrants.end()) {
+        grant = shared->second;
+    } else {
+        return false;
+    }
     
-    // Notify waiting clients
-    m_condition.notify_all();
+    auto now = m_clock();
+    grant->lastActivityTime = now;
+    grant->expiryTime = std::min(now + std::max<std::chrono::seconds>(m_idleTimeout, expectedRemaining),
+                                 grant->deadline);
+    return true;
+}
+
+std::vector<std::string> MutexLocker::releaseExpiredGrants() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    auto now = m_clock();
+    std::vector<std::shared_ptr<AccessGrant>> holders;
+    if (m_currentGrant) {
+        holders.push_back(m_currentGrant);
+    }
+    for (const auto& [clientId, grant] : m_sharedGrants) {
+        holders.push_back(grant);
+    }
+    
+    std::vector<std::string> released;
+    for (const auto& grant : holders) {
+        if (now >= grant->expiryTime) {
+            Logger::warn("Direct access lease of " + grant->clientId + (now >= grant->deadline ?
+                         " reached its maximum duration" : " expired after inactivity"));
+            m_stats.expiredGrants++;
+        } else if (now >= grant->sliceEnd && !m_waitQueue.empty()) {
+            Logger::info("Time slice of " + grant->clientId + " ended, " +
+                         std::to_string(m_waitQueue.size()) + " clients waiting");
+            m_stats.preemptedGrants++;
+        } else {
+            continue;
+        }
+        takeGrant(grant->clientId);
+        endGrant(grant);
+        released.push_back(grant->clientId);
+    }
+    
+    if (!released.empty()) {
+        updateAccessMode();
+        openBoardWindow();
+    }
+    // Also lets the next client in once a board window has closed
+    grantWaiters();
+    return released;
+}
+
+void MutexLocker::openBoardWindow() {
+    if (m_boardWindow.count() == 0 || m_waitQueue.empty() || m_currentMode != AccessMode::BOARD_MANAGED) {
+        return;
+    }
+    if (m_boardHasWork && !m_boardHasWork()) {
+        return;
+    }
+    
+    m_boardWindowEnd = m_clock() + m_boardWindow;
+    m_stats.boardWindows++;
+    Logger::info("Board gets the drive for " + std::to_string(m_boardWindow.count()) +
+                 "s before the next direct access grant");
+}
+
+void MutexLocker::setTimeSlicing(std::chrono::seconds timeSlice, std::chrono::seconds boardWindow) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timeSlice = timeSlice;
+    m_boardWindow = boardWindow;
+}
+
+void MutexLocker::setSliceWeight(ClientType clientType, unsigned weight) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sliceWeights[static_cast<int>(clientType)] = std::max(weight, 1u);
+}
+
+void MutexLocker::setBoardWorkCheck(std::function<bool()> boardHasWork) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_boardHasWork = std::move(boardHasWork);
+}
+
+void MutexLocker::setClock(Clock clock) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_clock = std::move(clock);
 }
 
 bool MutexLocker::hasDirectAccess(const std::string& clientId) const {
     std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_sharedGrants.count(clientId)) {
+        return true;
+    }
     return m_currentGrant && m_currentGrant->clientId == clientId && m_currentGrant->isActive;
 }
 
@@ -151,6 +434,13 @@ std::string MutexLocker::getCurrentAccessHolder() const {
     if (m_currentGrant && m_currentGrant->isActive) {
         return m_currentGrant->clientId;
     }
+    if (!m_sharedGrants.empty()) {
+        std::string holders;
+        for (const auto& [clientId, grant] : m_sharedGrants) {
+            holders += (holders.empty() ? "" : ", ") + clientId;
+        }
+        return holders;
+    }
     return "BOARD";
 }
 
@@ -161,11 +451,16 @@ void MutexLocker::forceReleaseAll() {
         Logger::warn("Force releasing direct access from " + m_currentGrant->clientId);
         m_currentGrant->isActive = false;
     }
+    for (auto& [clientId, grant] : m_sharedGrants) {
+        Logger::warn("Force releasing read-only access from " + clientId);
+        grant->isActive = false;
+    }
     
     m_currentMode = AccessMode::BOARD_MANAGED;
     m_currentGrant = nullptr;
+    m_sharedGrants.clear();
     
-    m_condition.notify_all();
+    grantWaiters();
 }
 
 bool MutexLocker::isDriveAccessible() const {
@@ -180,7 +475,7 @@ void MutexLocker::blockAccess(const std::string& reason) {
     m_blockReason = reason;
     
     Logger::warn("Drive access blocked: " + reason);
-    m_condition.notify_all();
+    cancelWaiters();
 }
 
 void MutexLocker::unblockAccess() {
@@ -190,7 +485,7 @@ void MutexLocker::unblockAccess() {
         Logger::info("Drive access unblocked (was: " + m_blockReason + ")");
         m_blocked = false;
         m_blockReason.clear();
-        m_condition.notify_all();
+        grantWaiters();
     }
 }
 
@@ -204,16 +499,6 @@ std::string MutexLocker::getBlockReason() const {
     return m_blockReason;
 }
 
-void MutexLocker::cleanupExpiredGrants() {
-    auto now = std::chrono::system_clock::now();
-    
-    if (m_currentGrant && m_currentGrant->isActive && 
-        now > m_currentGrant->expiryTime) {
-        Logger::warn("Direct access grant expired for " + m_currentGrant->clientId);
-        releaseDirectAccess(m_currentGrant->clientId);
-    }
-}
-
 MutexLocker::Statistics MutexLocker::getStatistics() const {
     std::lock_guard<std::mutex> lock(m_mutex);
     return m_stats;
@@ -227,6 +512,9 @@ std::vector<AccessGrant> MutexLocker::getActiveGrants() const {
     if (m_currentGrant && m_currentGrant->isActive) {
         grants.push_back(*m_currentGrant);
     }
+    for (const auto& [clientId, grant] : m_sharedGrants) {
+        grants.push_back(*grant);
+    }
     
     return grants;
 }
@@ -98,6 +98,23 @@ bool StorageManager::unmountDrive() {
     }
 }
 
+bool StorageManager::remountDrive(bool readOnly) {
+    if (!m_driveConnected) {
+        return false;
+    }
+    
+    std::string remountCmd = std::string("mount -o remount,") + (readOnly ? "ro " : "rw ") + m_mountPoint;
+    int result = system(remountCmd.c_str());
+    
+    if (result == 0) {
+        LOG_INFO(std::string("Drive remounted ") + (readOnly ? "read-only" : "read-write"), "STORAGE");
+        return true;
+    } else {
+        LOG_ERROR("Failed to remount drive", "STORAGE");
+        return false;
+    }
+}
+
 std::vector<FileInfo> StorageManager::listDirectory(const std::string& path) {
     std::vector<FileInfo> files;
     
@@ -1,8 +1,14 @@
 #include <chrono>
 #include <thread>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 #include "core/UsbBridge.hpp"
 #include "core/ConfigManager.hpp"
 #include "utils/Logger.hpp"
+#include "network/MetricsWriter.hpp"
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -11,11 +17,19 @@ namespace usb_bridge {
 
 UsbBridge::UsbBridge()
     : m_running(false)
+    , m_metricsSizeHint(0)
     , m_localBufferPath("/data/buffer")
     , m_maxLocalBufferSize(10ULL * 1024 * 1024 * 1024) // 10GB default
     , m_largeFileThreshold(5ULL * 1024 * 1024 * 1024)  // 5GB default
     , m_operationCleanupAge(std::chrono::hours(24))
     , m_maintenanceInterval(std::chrono::minutes(5))
+    , m_drainTimeout(std::chrono::seconds(10))
+    , m_boardDrained(false)
+    , m_blockPassthrough(false)
+    , m_passthroughReadOnly(false)
+    , m_smbSuspended(false)
+    , m_drainDurations{0.01, 0.05, 0.1, 0.5, 1, 2, 5, 10, 30, 60}
+    , m_lastGadgetIo(0)
 {
     Logger::info("UsbBridge constructor");
 }
@@ -52,15 +66,102 @@ bool UsbBridge::initialize() {
         
         // Initialize core components
         m_mutexLocker = std::make_unique<MutexLocker>();
+        if (m_config->hasKey("access.drainTimeout")) {
+            m_drainTimeout = std::chrono::seconds(m_config->getUInt64("access.drainTimeout"));
+        }
+        m_blockPassthrough = m_config->getBool("access.blockPassthrough", false);
+        m_mutexLocker->setLeaseLimits(std::chrono::seconds(m_config->hasKey("access.idleTimeout") ?
+                                                           m_config->getUInt64("access.idleTimeout") : 15),
+                                      std::chrono::seconds(m_config->hasKey("access.maxDirectAccessDuration") ?
+                                                           m_config->getUInt64("access.maxDirectAccessDuration") : 1800));
+        m_mutexLocker->setTimeSlicing(std::chrono::seconds(m_config->hasKey("access.timeSlice") ?
+                                                           m_config->getUInt64("access.timeSlice") : 60),
+                                      std::chrono::seconds(m_config->hasKey("access.boardWindow") ?
+                                                           m_config->getUInt64("access.boardWindow") : 5));
+        if (m_config->hasKey("access.usbSliceWeight")) {
+            m_mutexLocker->setSliceWeight(ClientType::USB_HOST_1, m_config->getUInt64("access.usbSliceWeight"));
+            m_mutexLocker->setSliceWeight(ClientType::USB_HOST_2, m_config->getUInt64("access.usbSliceWeight"));
+        }
+        if (m_config->hasKey("access.networkSliceWeight")) {
+            m_mutexLocker->setSliceWeight(ClientType::NETWORK_SMB, m_config->getUInt64("access.networkSliceWeight"));
+            m_mutexLocker->setSliceWeight(ClientType::NETWORK_HTTP, m_config->getUInt64("access.networkSliceWeight"));
+        }
+        std::string queuePolicy = m_config->hasKey("access.queuePolicy") ?
+                                  m_config->getString("access.queuePolicy") : "fifo";
+        m_mutexLocker->setQueuePolicy(queuePolicy == "priority" ? QueuePolicy::PRIORITY : QueuePolicy::FIFO);
         m_fileLogger = std::make_unique<FileChangeLogger>("/data/logs");
         m_operationQueue = std::make_unique<FileOperationQueue>(m_localBufferPath, m_maxLocalBufferSize);
+        m_writeQueue = std::make_unique<WriteQueueManager>(*m_operationQueue);
+        m_cacheManager = std::make_unique<CacheManager>(m_localBufferPath + "/cache",
+                                                        m_config->hasKey("cache.maxSize") ?
+                                                        m_config->getUInt64("cache.maxSize") : 1024ULL * 1024 * 1024);
+        m_cacheManager->initialize();
         m_storage = std::make_unique<StorageManager>("/mnt/usbdrive");
         m_hostController = std::make_unique<HostController>();
+        if (m_config->hasKey("hosts.usb.imageSize")) {
+            m_hostController->setBackingImageSize(m_config->getUInt64("hosts.usb.imageSize"));
+        }
+        m_hostController->setPreallocateBackingImage(m_config->getBool("hosts.usb.preallocateImage", false));
+        if (m_config->hasKey("hosts.usb.imageFormat")) {
+            m_hostController->setBackingImageFormat(m_config->getString("hosts.usb.imageFormat"));
+        }
         
         // Initialize network components
         m_network = std::make_unique<NetworkManager>();
         m_smbServer = std::make_unique<SmbServer>();
-        m_httpServer = std::make_unique<HttpServer>(8080);
+        m_smbServer->initialize(m_config->hasKey("storage.mountPoint") ?
+                                m_config->getString("storage.mountPoint") : "/mnt/usbdrive",
+                                m_config->hasKey("network.smb.shareName") ?
+                                m_config->getString("network.smb.shareName") : "USB_SHARE");
+        if (m_config->hasKey("network.smb.workgroup")) {
+            m_smbServer->setWorkgroup(m_config->getString("network.smb.workgroup"));
+        }
+        if (m_config->hasKey("network.smb.profile")) {
+            m_smbServer->setPerformanceProfile(m_config->getString("network.smb.profile"));
+        }
+        m_smbServer->setGuestAccess(m_config->getBool("network.smb.guestAccess", true));
+        m_smbServer->setReadOnly(m_config->getBool("network.smb.readOnly", false));
+        m_smbServer->setBufferOperations(m_config->getBool("network.smb.bufferOperations", false));
+        m_smbServer->setBridge(this);
+        m_httpServer = std::make_unique<HttpServer>();
+        m_httpServer->initialize(m_config->hasKey("network.http.port") ?
+                                 m_config->getUInt64("network.http.port") : 8080);
+        if (m_config->hasKey("network.http.keepAliveTimeout")) {
+            m_httpServer->setKeepAliveTimeout(m_config->getUInt64("network.http.keepAliveTimeout"));
+        }
+        if (m_config->hasKey("network.http.maxRequestsPerConnection")) {
+            m_httpServer->setMaxRequestsPerConnection(m_config->getUInt64("network.http.maxRequestsPerConnection"));
+        }
+        if (m_config->hasKey("network.http.maxConnections")) {
+            m_httpServer->setMaxConnections(m_config->getUInt64("network.http.maxConnections"));
+        }
+        m_httpServer->setDocumentRoot(m_config->hasKey("storage.mountPoint") ?
+                                      m_config->getString("storage.mountPoint") : "/mnt/usbdrive");
+        m_httpServer->setBridge(this);
+        
+        // The same status document is served on request and pushed to event stream subscribers
+        m_httpServer->addApiEndpoint("/status", [this](const HttpRequest&) {
+            HttpResponse response;
+            response.contentType = "application/json";
+            response.headers.emplace_back("Access-Control-Allow-Origin", "*");
+            response.body = buildStatusJson(getStatus()).dump();
+            return response;
+        });
+        m_httpServer->addApiEndpoint("/metrics", [this](const HttpRequest&) {
+            HttpResponse response;
+            response.contentType = MetricsWriter::CONTENT_TYPE;
+            response.headers.emplace_back("Cache-Control", "no-store");
+            response.body = buildMetrics();
+            return response;
+        });
+        m_operationQueue->setProgressCallback([this](const FileOperation& operation) {
+            publishOperationProgress(operation);
+        });
+        
+        // A board window between direct access holders is only worth it with work queued
+        m_mutexLocker->setBoardWorkCheck([this] {
+            return !m_operationQueue->getQueuedOperations().empty() || !m_writeQueue->getPendingWrites().empty();
+        });
         
         // Initialize GUI
         m_gui = std::make_unique<GuiManager>();
@@ -83,9 +184,11 @@ void UsbBridge::start() {
     Logger::info("Starting USB Bridge system...");
     
     m_running = true;
+    m_startTime = std::chrono::system_clock::now();
     
     // Start file operation queue
     m_operationQueue->start();
+    m_writeQueue->start();
     
     // Start monitoring thread
     m_monitoringThread = std::thread(&UsbBridge::monitoringThread, this);
@@ -117,7 +220,19 @@ void UsbBridge::stop() {
     
     m_running = false;
     
+    // Stop network services first, so the writes they still have buffered reach the queue
+    if (m_smbServer) {
+        m_smbServer->stop();
+    }
+    
+    if (m_httpServer) {
+        m_httpServer->stop();
+    }
+    
     // Stop operation queue
+    if (m_writeQueue) {
+        m_writeQueue->stop();
+    }
     if (m_operationQueue) {
         m_operationQueue->stop();
     }
@@ -131,15 +246,6 @@ void UsbBridge::stop() {
         m_maintenanceThread.join();
     }
     
-    // Stop network services
-    if (m_smbServer) {
-        m_smbServer->stop();
-    }
-    
-    if (m_httpServer) {
-        m_httpServer->stop();
-    }
-    
     // Stop GUI
     if (m_gui) {
         m_gui->stop();
@@ -178,9 +284,10 @@ void UsbBridge::monitoringThread() {
                 m_hostController->checkHostConnections();
             }
             
-            // Check for expired access grants
-            if (m_mutexLocker && !m_mutexLocker->isBoardManaged()) {
-                // Could check for timeouts here
+            // Renew direct access leases while holders are busy, take the drive back from idle
+            // ones and from those whose time slice is up
+            if (m_mutexLocker) {
+                checkDirectAccessLeases();
             }
             
         } catch (const std::exception& e) {
@@ -253,6 +360,19 @@ uint64_t UsbBridge::clientWriteFile(const std::string& clientId,
         });
 }
 
+std::vector<uint64_t> UsbBridge::clientWriteBatch(const std::string& clientId,
+                                                  ClientType clientType,
+                                                  std::vector<WriteBatchItem> items,
+                                                  std::function<void(const FileOperation&)> callback) {
+    Logger::info("Client " + clientId + " requesting batch write of " + std::to_string(items.size()) + " entries");
+    
+    return m_writeQueue->submitBatch(clientId, clientType, std::move(items), WritePriority::NORMAL,
+        [this, callback](const FileOperation& op) {
+            this->onOperationCompleted(op);
+            if (callback) callback(op);
+        });
+}
+
 uint64_t UsbBridge::clientDeleteFile(const std::string& clientId,
                                      ClientType clientType,
                                      const std::string& drivePath,
@@ -322,16 +442,31 @@ bool UsbBridge::requestDirectAccess(const std::string& clientId,
     Logger::info("Client " + clientId + " requesting direct access for operation #" + 
                  std::to_string(operationId));
     
-    // Pause the operation queue while direct access is active
-    m_operationQueue->pause();
-    
+    // The queue keeps running while the request waits; it is drained once access is granted
     bool granted = m_mutexLocker->requestDirectAccess(clientId, clientType, operationId, timeout);
     
-    if (granted) {
-        switchToDirectAccessMode(clientId, clientType);
-    } else {
-        // Resume queue if access wasn't granted
-        m_operationQueue->resume();
+    // The board couldn't finish with the drive in time; the grant goes to whoever is next
+    if (granted && !switchToDirectAccessMode(clientId, clientType, false)) {
+        releaseDirectAccess(clientId);
+        granted = false;
+    }
+    
+    return granted;
+}
+
+bool UsbBridge::requestReadOnlyAccess(const std::string& clientId,
+                                      ClientType clientType,
+                                      uint64_t operationId,
+                                      std::chrono::seconds timeout) {
+    Logger::info("Client " + clientId + " requesting read-only access for operation #" +
+                 std::to_string(operationId));
+    
+    // Readers share the drive with each other, not with the board's writes
+    bool granted = m_mutexLocker->requestSharedAccess(clientId, clientType, operationId, timeout);
+    
+    if (granted && !switchToDirectAccessMode(clientId, clientType, true)) {
+        releaseDirectAccess(clientId);
+        granted = false;
     }
     
     return granted;
@@ -341,24 +476,254 @@ void UsbBridge::releaseDirectAccess(const std::string& clientId) {
     Logger::info("Client " + clientId + " releasing direct access");
     
     m_mutexLocker->releaseDirectAccess(clientId);
+    returnDriveToBoard();
+}
+    
+bool UsbBridge::renewDirectAccess(const std::string& clientId, std::chrono::seconds expectedRemaining) {
+    return m_mutexLocker->renewAccess(clientId, expectedRemaining);
+}
+
+void UsbBridge::checkDirectAccessLeases() {
+    // Ticks even in board-managed mode, so waiting clients get in when a board window closes
+    if (m_mutexLocker->isBoardManaged()) {
+        m_mutexLocker->releaseExpiredGrants();
+        // A host that held on to the device when access ended is asked again
+        bool stillAttached;
+        {
+            std::lock_guard<std::mutex> lock(m_handoverMutex);
+            stillAttached = m_boardDrained && !m_passthroughDevice.empty();
+        }
+        if (stillAttached) {
+            returnDriveToBoard();
+        }
+        return;
+    }
+    
+    // Each holder is renewed by its own I/O only. A host's shows up in the gadget's counters;
+    // HTTP transfers renew their client as they send, SMB clients are seen from their smbd.
+    uint64_t gadgetIo = 0;
+    uint64_t gadgetInFlight = 0;
+    m_hostController->getBackingIoCounters(gadgetIo, gadgetInFlight);
+    if (gadgetIo != m_lastGadgetIo || gadgetInFlight > 0) {
+        for (const auto& grant : m_mutexLocker->getActiveGrants()) {
+            if (grant.clientType == ClientType::USB_HOST_1 || grant.clientType == ClientType::USB_HOST_2) {
+                m_mutexLocker->renewAccess(grant.clientId);
+            }
+        }
+    }
+    m_lastGadgetIo = gadgetIo;
+    
+    if (m_smbServer && m_smbServer->isRunning()) {
+        for (const auto& session : m_smbServer->getSessionStatistics().sessions) {
+            if (session.active) {
+                renewDirectAccess("smb_" + session.machine);
+            }
+        }
+    }
+    
+    auto expired = m_mutexLocker->releaseExpiredGrants();
+    if (!expired.empty()) {
+        returnDriveToBoard();
+    }
+}
+
+void UsbBridge::returnDriveToBoard() {
+    // Checked under the handover lock: a client granted from here on drains the queue again
+    // before it is told, so resuming can't overlap its access
+    std::lock_guard<std::mutex> lock(m_handoverMutex);
+    
+    // With the last USB grant gone the host's LUN is read-only again
+    AccessMode mode = m_mutexLocker->getCurrentAccessMode();
+    if (mode != AccessMode::DIRECT_USB && m_hostController->hasAccess()) {
+        m_hostController->disableAccess();
+    }
+    
+    // A queued client may have been handed access on release; the board stays out then
+    if (mode != AccessMode::BOARD_MANAGED) {
+        return;
+    }
+    // The queue stays paused until the drive is mounted again
+    if (!takeDriveFromGadget()) {
+        return;
+    }
     switchToBoardManagedMode();
+    m_boardDrained = false;
     
-    // Resume the operation queue
+    // Resume the operation queue and let buffered client writes into it again
     m_operationQueue->resume();
+    m_writeQueue->resume();
+}
+
+bool UsbBridge::drainForHandover() {
+    std::lock_guard<std::mutex> lock(m_handoverMutex);
+    
+    // Another reader already has the drive, so the board has nothing in flight
+    if (m_boardDrained) {
+        return true;
+    }
+    
+    auto started = std::chrono::steady_clock::now();
+    
+    // New client writes stay in the buffer until the board has the drive back
+    m_writeQueue->pause();
+    if (!m_operationQueue->drain(m_drainTimeout)) {
+        Logger::warn("Board still writing to the drive after the drain deadline, handover aborted");
+        m_operationQueue->resume();
+        m_writeQueue->resume();
+        return false;
+    }
+    size_t writtenBack = m_cacheManager->writeBackDirty();
+    
+    // Only the drive's filesystem needs to reach the medium, not every dirty page on the board
+    std::string mountPoint = m_config->hasKey("storage.mountPoint") ?
+                             m_config->getString("storage.mountPoint") : "/mnt/usbdrive";
+    int fd = open(mountPoint.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0 || syncfs(fd) != 0) {
+        Logger::warn("syncfs on " + mountPoint + " failed (" + std::string(strerror(errno)) + "), syncing everything");
+        sync();
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    
+    auto elapsed = std::chrono::steady_clock::now() - started;
+    m_drainDurations.observe(elapsed);
+    m_boardDrained = true;
+    
+    Logger::info("Drive drained for direct access in " +
+                 std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()) + " ms, " +
+                 std::to_string(writtenBack) + " cache entries written back");
+    return true;
 }
 
-void UsbBridge::switchToDirectAccessMode(const std::string& clientId, ClientType type) {
-    Logger::info("Switching to direct access mode for client " + clientId);
+bool UsbBridge::switchToDirectAccessMode(const std::string& clientId, ClientType type, bool readOnly) {
+    Logger::info("Switching to " + std::string(readOnly ? "read-only " : "") +
+                 "direct access mode for client " + clientId);
+    
+    bool usbHost = type == ClientType::USB_HOST_1 || type == ClientType::USB_HOST_2;
+    
+    // A writer given the block device needs Samba and its overlay off the drive. Stopping it
+    // commits staged SMB writes through the queue, so that happens before the drain, and
+    // without the handover lock since it can wait SmbWriteStager's FLUSH_TIMEOUT.
+    bool passThrough = usbHost && m_blockPassthrough;
+    if (passThrough && !readOnly && m_smbServer->isRunning()) {
+        if (m_smbServer->stop()) {
+            std::lock_guard<std::mutex> lock(m_handoverMutex);
+            m_smbSuspended = true;
+        } else {
+            // Unmounting now would strand what SMB clients wrote in the staging layer
+            Logger::warn("SMB writes not flushed, exporting the image file instead of the drive");
+            m_smbServer->start();
+            passThrough = false;
+        }
+    }
+    
+    // Queued writes, dirty cache entries and the page cache reach the drive before the client gets it
+    if (!drainForHandover()) {
+        std::lock_guard<std::mutex> lock(m_handoverMutex);
+        if (m_smbSuspended) {
+            m_smbServer->start();
+            m_smbSuspended = false;
+        }
+        return false;
+    }
     
     // Depending on client type, configure USB gadget or network share for direct access
-    if (type == ClientType::USB_HOST_1 || type == ClientType::USB_HOST_2) {
+    if (usbHost) {
         // Enable USB mass storage gadget mode
         // This would involve running the USB gadget setup script
         Logger::info("Enabling USB mass storage gadget for direct access");
+        std::lock_guard<std::mutex> lock(m_handoverMutex);
+        if (passThrough && passDriveThrough(readOnly)) {
+            return true;
+        }
+        if (readOnly) {
+            m_hostController->enableReadOnlyAccess();
+        } else {
+            m_hostController->enableAccess();
+        }
     } else {
-        // Network clients can access directly via SMB/HTTP without mode change
+        // Network clients can access directly via SMB/HTTP without mode change, once the
+        // drive is mounted on the board for what they do
         Logger::info("Network client has direct access via existing shares");
+        std::lock_guard<std::mutex> lock(m_handoverMutex);
+        if (!m_passthroughDevice.empty() && !(readOnly && m_passthroughReadOnly)) {
+            takeDriveFromGadget();
+        }
+    }
+    return true;
+}
+
+bool UsbBridge::passDriveThrough(bool readOnly) {
+    // Readers joining a reader find the device attached already
+    if (!m_passthroughDevice.empty()) {
+        if (m_passthroughReadOnly == readOnly) {
+            return true;
+        }
+        if (!takeDriveFromGadget()) {
+            return false;
+        }
+    }
+    
+    std::string device = m_storage->getDriveInfo().devicePath;
+    if (device.empty() || !m_hostController->ejectMedium()) {
+        return false;
+    }
+    
+    // A writer needs the drive to itself; Samba was stopped before the drain
+    bool released;
+    if (readOnly) {
+        released = m_storage->remountDrive(true);
+    } else {
+        released = !m_smbServer->isRunning() && m_storage->unmountDrive();
+    }
+    if (released && m_hostController->attachBlockDevice(device, readOnly)) {
+        m_passthroughDevice = device;
+        m_passthroughReadOnly = readOnly;
+        return true;
+    }
+    
+    // Something on the board still has files open on the drive: the host gets the image file
+    Logger::warn("Drive busy on the board, exporting the image file instead of " + device);
+    if (released) {
+        if (readOnly) {
+            m_storage->remountDrive(false);
+        } else {
+            m_storage->mountDrive(device);
+        }
+    }
+    if (m_smbSuspended) {
+        m_smbServer->start();
+        m_smbSuspended = false;
+    }
+    m_hostController->restoreBackingFile();
+    return false;
+}
+
+bool UsbBridge::takeDriveFromGadget() {
+    if (m_passthroughDevice.empty()) {
+        return true;
+    }
+    
+    // Mounting while a host can still write to the device would corrupt the filesystem
+    if (!m_hostController->ejectMedium()) {
+        Logger::error("USB host still holds " + m_passthroughDevice + ", drive stays unmounted on the board");
+        return false;
+    }
+    
+    bool mounted = m_passthroughReadOnly ? m_storage->remountDrive(false) :
+                                           m_storage->mountDrive(m_passthroughDevice);
+    if (!mounted) {
+        Logger::error("Failed to mount " + m_passthroughDevice + " after passthrough");
+        return false;
     }
+    m_passthroughDevice.clear();
+    m_hostController->restoreBackingFile();
+    if (m_smbSuspended) {
+        m_smbServer->start();
+        m_smbSuspended = false;
+    }
+    return true;
 }
 
 void UsbBridge::switchToBoardManagedMode() {
@@ -381,10 +746,11 @@ void UsbBridge::checkDriveHealth() {
 }
 
 void UsbBridge::updateSystemStatus() {
-    std::lock_guard<std::mutex> lock(m_statusMutex);
+    std::unique_lock<std::mutex> lock(m_statusMutex);
     
     m_status.currentAccessMode = m_mutexLocker->getCurrentAccessMode();
     m_status.accessHolder = m_mutexLocker->getCurrentAccessHolder();
+    m_status.accessQueue = m_mutexLocker->getWaitingClients();
     
     auto queuedOps = m_operationQueue->getQueuedOperations();
     m_status.queuedOperations = queuedOps.size();
@@ -415,6 +781,251 @@ void UsbBridge::updateSystemStatus() {
     
     m_status.smbServerRunning = m_smbServer && m_smbServer->isRunning();
     m_status.httpServerRunning = m_httpServer && m_httpServer->isRunning();
+    
+    SystemStatus snapshot = m_status;
+    lock.unlock();
+    
+    // Called every main loop iteration; the hub only wakes subscribers when something changed
+    if (m_httpServer) {
+        m_httpServer->getEventHub().publishState("status", buildStatusJson(snapshot));
+    }
+}
+
+nlohmann::json UsbBridge::buildStatusJson(const SystemStatus& status) const {
+    static const char* const accessModes[] = {"none", "board_managed", "direct_usb", "direct_network"};
+    
+    // Uptime is derived by the client from startTime so the document doesn't change every second
+    json document = {
+        {"usb", {
+            {"connected", status.usbHost1Connected || status.usbHost2Connected},
+            {"hostCount", (status.usbHost1Connected ? 1 : 0) + (status.usbHost2Connected ? 1 : 0)}
+        }},
+        {"network", {
+            {"connected", status.networkActive},
+            {"smb", status.smbServerRunning},
+            {"http", status.httpServerRunning}
+        }},
+        {"storage", {
+            {"mounted", status.driveConnected},
+            {"capacity", status.driveCapacity},
+            {"usedSpace", status.driveUsed},
+            {"freeSpace", status.driveFree},
+            {"filesystem", status.driveFilesystem}
+        }},
+        {"access", {
+            {"mode", accessModes[static_cast<int>(status.currentAccessMode)]},
+            {"holder", status.accessHolder},
+            {"waiting", status.accessQueue}
+        }},
+        {"queue", {
+            {"queued", status.queuedOperations},
+            {"bufferUsed", status.usedBufferSpace},
+            {"bufferAvailable", status.availableBufferSpace}
+        }},
+        {"system", {
+            {"startTime", std::chrono::duration_cast<std::chrono::seconds>(
+                m_startTime.time_since_epoch()).count()}
+        }}
+    };
+    return document;
+}
+
+std::string UsbBridge::buildMetrics() const {
+    // Each component hands over a copy of its counters under its own lock, held only for
+    // the copy; HTTP counters and histograms are read from atomics. The status snapshot
+    // is the one the monitoring thread keeps current.
+    SystemStatus status = getStatus();
+    auto queueStats = m_operationQueue->getStatistics();
+    auto writeStats = m_writeQueue->getStatistics();
+    auto cacheStats = m_cacheManager->getStatistics();
+    auto accessStats = m_mutexLocker->getStatistics();
+    
+    std::string output;
+    output.reserve(m_metricsSizeHint.load(std::memory_order_relaxed) + 256);
+    MetricsWriter metrics(output);
+    
+    metrics.gauge("usbbridge_start_time_seconds", "Unix time the bridge was started",
+                  static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                      m_startTime.time_since_epoch()).count()));
+    metrics.gauge("usbbridge_drive_connected", "Whether the USB drive is mounted", uint64_t(status.driveConnected));
+    metrics.gauge("usbbridge_drive_capacity_bytes", "Size of the mounted drive", status.driveCapacity);
+    metrics.gauge("usbbridge_drive_used_bytes", "Space used on the mounted drive", status.driveUsed);
+    metrics.family("usbbridge_access_mode", "gauge", "Current drive access mode, 1 for the active one");
+    static const char* const accessModes[] = {
+        "mode=\"none\"", "mode=\"board_managed\"", "mode=\"direct_usb\"", "mode=\"direct_network\""
+    };
+    for (int mode = 0; mode < 4; ++mode) {
+        metrics.sample("usbbridge_access_mode", accessModes[mode],
+                       uint64_t(static_cast<int>(status.currentAccessMode) == mode));
+    }
+    
+    // File operation queue
+    metrics.counter("usbbridge_file_operations_total", "File operations submitted", queueStats.totalOperations);
+    metrics.counter("usbbridge_file_operations_completed_total", "File operations completed",
+                    queueStats.completedOperations);
+    metrics.counter("usbbridge_file_operations_failed_total", "File operations failed", queueStats.failedOperations);
+    metrics.counter("usbbridge_file_operations_direct_access_total", "File operations that needed direct access",
+                    queueStats.directAccessOperations);
+    metrics.family("usbbridge_file_operation_bytes_total", "counter", "Bytes moved by file operations");
+    metrics.sample("usbbridge_file_operation_bytes_total", "direction=\"read\"", queueStats.bytesRead);
+    metrics.sample("usbbridge_file_operation_bytes_total", "direction=\"written\"", queueStats.bytesWritten);
+    metrics.histogram("usbbridge_file_operation_duration_seconds", "Time spent executing file operations",
+                      m_operationQueue->getOperationDurations());
+    metrics.gauge("usbbridge_file_operations_queued", "File operations waiting in the queue", status.queuedOperations);
+    metrics.gauge("usbbridge_buffer_used_bytes", "Local buffer space in use", status.usedBufferSpace);
+    metrics.gauge("usbbridge_buffer_available_bytes", "Local buffer space free", status.availableBufferSpace);
+    
+    // Write queue
+    metrics.counter("usbbridge_writes_submitted_total", "Write requests submitted", writeStats.totalSubmitted);
+    metrics.counter("usbbridge_writes_completed_total", "Write requests completed", writeStats.totalCompleted);
+    metrics.counter("usbbridge_writes_failed_total", "Write requests failed", writeStats.totalFailed);
+    metrics.counter("usbbridge_write_batches_total", "Write batches created", writeStats.batchesCreated);
+    metrics.gauge("usbbridge_writes_pending", "Write requests not yet completed", writeStats.currentPending);
+    metrics.gauge("usbbridge_write_queue_wait_seconds", "Average time write requests waited before being queued",
+                  writeStats.averageQueueTime.count() / 1000.0);
+    
+    // Cache
+    metrics.counter("usbbridge_cache_hits_total", "Cache hits", cacheStats.totalCacheHits);
+    metrics.counter("usbbridge_cache_misses_total", "Cache misses", cacheStats.totalCacheMisses);
+    metrics.counter("usbbridge_cache_evictions_total", "Cache entries evicted", cacheStats.totalEvictions);
+    metrics.counter("usbbridge_cache_writebacks_total", "Cache entries written back", cacheStats.totalWritebacks);
+    metrics.gauge("usbbridge_cache_entries", "Files in the cache", cacheStats.currentEntries);
+    metrics.gauge("usbbridge_cache_size_bytes", "Cache space in use", cacheStats.currentSize);
+    metrics.gauge("usbbridge_cache_max_bytes", "Cache size limit", cacheStats.maxSize);
+    
+    // Direct access arbitration
+    metrics.counter("usbbridge_direct_access_requests_total", "Direct access requests",
+                    accessStats.totalDirectAccessRequests);
+    metrics.counter("usbbridge_direct_access_granted_total", "Direct access requests granted",
+                    accessStats.grantedDirectAccess);
+    metrics.counter("usbbridge_direct_access_denied_total", "Direct access requests denied",
+                    accessStats.deniedDirectAccess);
+    metrics.counter("usbbridge_direct_access_timeouts_total", "Direct access requests that timed out",
+                    accessStats.timeoutDirectAccess);
+    metrics.gauge("usbbridge_direct_access_waiting", "Direct access requests waiting", accessStats.currentQueuedRequests);
+    metrics.gauge("usbbridge_direct_access_average_seconds", "Average time direct access was held",
+                  accessStats.averageDirectAccessDuration.count() / 1000.0);
+    metrics.counter("usbbridge_direct_access_expired_total", "Direct access grants taken back when their lease ran out",
+                    accessStats.expiredGrants);
+    metrics.counter("usbbridge_direct_access_preempted_total", "Direct access grants taken back at the end of a time slice",
+                    accessStats.preemptedGrants);
+    metrics.counter("usbbridge_direct_access_board_windows_total", "Windows given to the board's queue between direct access holders",
+                    accessStats.boardWindows);
+    metrics.histogram("usbbridge_direct_access_drain_seconds", "Time taken to drain the board before a direct access handover",
+                      m_drainDurations.snapshot());
+    
+    // HTTP
+    metrics.counter("usbbridge_http_requests_total", "HTTP requests served", m_httpServer->getRequestCount());
+    metrics.family("usbbridge_http_responses_total", "counter", "HTTP responses by status class");
+    static const char* const statusClasses[] = {
+        "class=\"1xx\"", "class=\"2xx\"", "class=\"3xx\"", "class=\"4xx\"", "class=\"5xx\""
+    };
+    for (int statusClass = 1; statusClass <= 5; ++statusClass) {
+        metrics.sample("usbbridge_http_responses_total", statusClasses[statusClass - 1],
+                       m_httpServer->getResponseCount(statusClass));
+    }
+    metrics.histogram("usbbridge_http_request_duration_seconds", "Time from request received to response sent",
+                      m_httpServer->getRequestLatency());
+    metrics.gauge("usbbridge_http_connections", "Open HTTP connections",
+                  static_cast<uint64_t>(std::max(0, m_httpServer->getActiveConnections())));
+    
+    // SMB, from the collector's last pass. Sessions are labelled by their smbd's PID,
+    // which stays the same for as long as the client is connected.
+    auto smbStats = m_smbServer->getSessionStatistics();
+    metrics.gauge("usbbridge_smb_sessions", "Connected SMB clients", uint64_t(smbStats.sessions.size()));
+    metrics.family("usbbridge_smb_bytes_total", "counter", "Drive bytes moved by SMB clients, ended sessions included");
+    metrics.sample("usbbridge_smb_bytes_total", "direction=\"read\"", smbStats.totalBytesRead);
+    metrics.sample("usbbridge_smb_bytes_total", "direction=\"written\"", smbStats.totalBytesWritten);
+    
+    std::vector<std::string> sessionLabels;
+    for (const auto& session : smbStats.sessions) {
+        std::string labels;
+        MetricsWriter::appendLabel(labels, "pid", session.pid);
+        MetricsWriter::appendLabel(labels, "machine", session.machine);
+        MetricsWriter::appendLabel(labels, "user", session.username);
+        sessionLabels.push_back(std::move(labels));
+    }
+    metrics.family("usbbridge_smb_session_bytes_total", "counter", "Drive bytes moved by an SMB session");
+    for (size_t i = 0; i < smbStats.sessions.size(); ++i) {
+        metrics.sample("usbbridge_smb_session_bytes_total", sessionLabels[i] + ",direction=\"read\"",
+                       smbStats.sessions[i].bytesRead);
+        metrics.sample("usbbridge_smb_session_bytes_total", sessionLabels[i] + ",direction=\"written\"",
+                       smbStats.sessions[i].bytesWritten);
+    }
+    metrics.family("usbbridge_smb_session_throughput_bytes_per_second", "gauge",
+                   "Drive throughput of an SMB session over the last collection interval");
+    for (size_t i = 0; i < smbStats.sessions.size(); ++i) {
+        metrics.sample("usbbridge_smb_session_throughput_bytes_per_second", sessionLabels[i] + ",direction=\"read\"",
+                       smbStats.sessions[i].readRate);
+        metrics.sample("usbbridge_smb_session_throughput_bytes_per_second", sessionLabels[i] + ",direction=\"written\"",
+                       smbStats.sessions[i].writeRate);
+    }
+    metrics.family("usbbridge_smb_session_open_files", "gauge", "Files an SMB session has open");
+    for (size_t i = 0; i < smbStats.sessions.size(); ++i) {
+        metrics.sample("usbbridge_smb_session_open_files", sessionLabels[i], uint64_t(smbStats.sessions[i].openFiles));
+    }
+    metrics.family("usbbridge_smb_session_locks", "gauge", "Byte-range locks an SMB session holds");
+    for (size_t i = 0; i < smbStats.sessions.size(); ++i) {
+        metrics.sample("usbbridge_smb_session_locks", sessionLabels[i], uint64_t(smbStats.sessions[i].locks));
+    }
+    
+    metrics.family("usbbridge_network_bytes_total", "counter", "Bytes through a network interface");
+    for (const auto& interface : smbStats.interfaces) {
+        std::string labels;
+        MetricsWriter::appendLabel(labels, "interface", interface.name);
+        metrics.sample("usbbridge_network_bytes_total", labels + ",direction=\"received\"", interface.bytesReceived);
+        metrics.sample("usbbridge_network_bytes_total", labels + ",direction=\"sent\"", interface.bytesSent);
+    }
+    
+    m_metricsSizeHint.store(output.size(), std::memory_order_relaxed);
+    return output;
+}
+
+void UsbBridge::publishOperationProgress(const FileOperation& operation) {
+    if (!m_httpServer) {
+        return;
+    }
+    
+    static const char* const statuses[] = {"queued", "in_progress", "completed", "failed", "direct_access_required"};
+    static const char* const types[] = {"read", "write", "delete", "mkdir", "move"};
+    
+    json progress = {
+        {"id", operation.id},
+        {"type", types[static_cast<int>(operation.type)]},
+        {"status", statuses[static_cast<int>(operation.status)]},
+        {"path", operation.type == OperationType::WRITE || operation.type == OperationType::MKDIR ?
+                 operation.destPath : operation.sourcePath},
+        {"bytesProcessed", operation.bytesProcessed},
+        {"fileSize", operation.fileSize}
+    };
+    
+    // Keyed by operation, so a slow client only sees the latest progress of each
+    m_httpServer->getEventHub().publishUpdate("progress", std::to_string(operation.id), progress);
+}
+
+void UsbBridge::publishFileEvent(const FileOperation& operation) {
+    if (!m_httpServer || operation.status != OperationStatus::COMPLETED) {
+        return;
+    }
+    
+    // Same shape as the entries of /api/activity
+    std::string type;
+    std::string path = operation.sourcePath;
+    switch (operation.type) {
+        case OperationType::WRITE: type = "modified"; path = operation.destPath; break;
+        case OperationType::DELETE: type = "deleted"; break;
+        case OperationType::MKDIR: type = "created"; path = operation.destPath; break;
+        case OperationType::MOVE: type = "moved"; path = operation.destPath; break;
+        case OperationType::READ: return;
+    }
+    
+    json event = {
+        {"type", type},
+        {"path", path},
+        {"timestamp", std::chrono::duration_cast<std::chrono::seconds>(
+            operation.endTime.time_since_epoch()).count()}
+    };
+    m_httpServer->getEventHub().publishEvent("file", event);
 }
 
 SystemStatus UsbBridge::getStatus() const {
@@ -500,6 +1111,7 @@ void UsbBridge::onOperationCompleted(const FileOperation& operation) {
         m_fileLogger->logEvent(opType, operation.sourcePath, operation.destPath);
     }
     
+    publishFileEvent(operation);
     updateSystemStatus();
 }
 
@@ -523,6 +1135,8 @@ HostController& UsbBridge::getHostController() { return *m_hostController; }
 MutexLocker& UsbBridge::getMutexLocker() { return *m_mutexLocker; }
 FileChangeLogger& UsbBridge::getFileLogger() { return *m_fileLogger; }
 FileOperationQueue& UsbBridge::getOperationQueue() { return *m_operationQueue; }
+WriteQueueManager& UsbBridge::getWriteQueueManager() { return *m_writeQueue; }
+CacheManager& UsbBridge::getCacheManager() { return *m_cacheManager; }
 NetworkManager& UsbBridge::getNetworkManager() { return *m_network; }
 SmbServer& UsbBridge::getSmbServer() { return *m_smbServer; }
 HttpServer& UsbBridge::getHttpServer() { return *m_httpServer; }
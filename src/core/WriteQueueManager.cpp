@@ -91,6 +91,7 @@ uint64_t WriteQueueManager::submitWrite(const std::string& clientId,
     request->priority = priority;
     request->submittedTime = std::chrono::system_clock::now();
     request->queued = false;
+    request->isDirectory = false;
     request->operationId = 0;
     request->callback = callback;
     
@@ -107,6 +108,68 @@ uint64_t WriteQueueManager::submitWrite(const std::string& clientId,
     return request->id;
 }
 
+std::vector<uint64_t> WriteQueueManager::submitBatch(const std::string& clientId,
+                                                     ClientType clientType,
+                                                     std::vector<WriteBatchItem> items,
+                                                     WritePriority priority,
+                                                     std::function<void(const FileOperation&)> callback) {
+    // Order by (directory, name) with directories first. A parent's path is a prefix of its
+    // children's directory, so parents always sort ahead of what they contain.
+    std::stable_sort(items.begin(), items.end(), [](const WriteBatchItem& a, const WriteBatchItem& b) {
+        if (a.isDirectory != b.isDirectory) {
+            return a.isDirectory;
+        }
+        size_t slashA = a.drivePath.rfind('/');
+        size_t slashB = b.drivePath.rfind('/');
+        slashA = slashA == std::string::npos ? 0 : slashA;
+        slashB = slashB == std::string::npos ? 0 : slashB;
+        
+        int parent = a.drivePath.compare(0, slashA, b.drivePath, 0, slashB);
+        if (parent != 0) {
+            return parent < 0;
+        }
+        return a.drivePath.compare(slashA, std::string::npos, b.drivePath, slashB, std::string::npos) < 0;
+    });
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    // One timestamp for the whole batch; the comparator then falls back to the request ID
+    auto now = std::chrono::system_clock::now();
+    std::vector<uint64_t> requestIds;
+    requestIds.reserve(items.size());
+    uint64_t totalSize = 0;
+    
+    for (auto& item : items) {
+        auto request = std::make_shared<WriteRequest>();
+        request->id = nextRequestId();
+        request->clientId = clientId;
+        request->clientType = clientType;
+        request->localPath = std::move(item.localPath);
+        request->drivePath = std::move(item.drivePath);
+        request->fileSize = item.fileSize;
+        request->priority = priority;
+        request->submittedTime = now;
+        request->queued = false;
+        request->isDirectory = item.isDirectory;
+        request->operationId = 0;
+        request->callback = callback;
+        
+        m_requests[request->id] = request;
+        m_priorityQueue.push(request);
+        requestIds.push_back(request->id);
+        totalSize += item.fileSize;
+    }
+    
+    m_stats.totalSubmitted += requestIds.size();
+    m_stats.currentPending += requestIds.size();
+    
+    Logger::info("Write batch of " + std::to_string(requestIds.size()) + " entries (" +
+                 std::to_string(totalSize / 1024) + " KB) submitted for client " + clientId);
+    
+    m_condition.notify_one();
+    return requestIds;
+}
+
 bool WriteQueueManager::updatePriority(uint64_t requestId, WritePriority newPriority) {
     std::lock_guard<std::mutex> lock(m_mutex);
     
@@ -372,13 +435,15 @@ void WriteQueueManager::queueWriteRequest(std::shared_ptr<WriteRequest> request)
     };
     
     // Queue in FileOperationQueue
-    uint64_t opId = m_operationQueue.queueWrite(
-        request->clientId,
-        request->localPath,
-        request->drivePath,
-        request->fileSize,
-        callback
-    );
+    uint64_t opId = request->isDirectory ?
+        m_operationQueue.queueMkdir(request->clientId, request->drivePath, callback) :
+        m_operationQueue.queueWrite(
+            request->clientId,
+            request->localPath,
+            request->drivePath,
+            request->fileSize,
+            callback
+        );
     
     request->operationId = opId;
     request->queued = true;
@@ -1,10 +1,13 @@
 #include "gui/screens/ScreenNetwork.hpp"
 #include "core/UsbBridge.hpp"
 #include "utils/Logger.hpp"
+#include "utils/FileUtils.hpp"
 
 ScreenNetwork::ScreenNetwork(const std::string& name, UsbBridge* bridge)
     : Screen(name, bridge)
     , m_passwordDialog(nullptr)
+    , m_smbActivity(nullptr)
+    , m_trafficStatus(nullptr)
 {
 }
 
@@ -35,6 +38,7 @@ bool ScreenNetwork::create() {
     createWifiSection();
     createEthernetSection();
     createServiceStatus();
+    createActivitySection();
     
     return true;
 }
@@ -122,9 +126,28 @@ void ScreenNetwork::createServiceStatus() {
     }, LV_EVENT_VALUE_CHANGED, this);
 }
 
+void ScreenNetwork::createActivitySection() {
+    // One line per SMB client: who it is and what it does to the drive
+    m_smbActivity = lv_label_create(m_container);
+    lv_label_set_text(m_smbActivity, "No SMB clients");
+    lv_label_set_long_mode(m_smbActivity, LV_LABEL_LONG_CLIP);
+    lv_obj_set_size(m_smbActivity, 220, 80);
+    lv_obj_set_pos(m_smbActivity, 250, 205);
+    lv_obj_set_style_text_font(m_smbActivity, &lv_font_montserrat_12, 0);
+    
+    // Interface throughput
+    m_trafficStatus = lv_label_create(m_container);
+    lv_label_set_text(m_trafficStatus, "");
+    lv_label_set_long_mode(m_trafficStatus, LV_LABEL_LONG_CLIP);
+    lv_obj_set_size(m_trafficStatus, 230, 45);
+    lv_obj_set_pos(m_trafficStatus, 10, 235);
+    lv_obj_set_style_text_font(m_trafficStatus, &lv_font_montserrat_12, 0);
+}
+
 void ScreenNetwork::show() {
     Screen::show();
     updateConnectionStatus();
+    updateActivity();
     scanWifiNetworks();
 }
 
@@ -134,6 +157,7 @@ void ScreenNetwork::update() {
     uint32_t now = lv_tick_get();
     if (now - lastUpdate > 5000) { // Update every 5 seconds
         updateConnectionStatus();
+        updateActivity();
         lastUpdate = now;
     }
 }
@@ -270,6 +294,37 @@ void ScreenNetwork::updateConnectionStatus() {
     }
 }
 
+void ScreenNetwork::updateActivity() {
+    if (!m_bridge || !m_smbActivity) {
+        return;
+    }
+    
+    // The bridge's server is the one exporting the drive; the network manager's never starts
+    auto stats = m_bridge->getSmbServer().getSessionStatistics();
+    
+    std::string smbText;
+    for (const auto& session : stats.sessions) {
+        if (!smbText.empty()) {
+            smbText += "\n";
+        }
+        smbText += session.machine + " R " + FileUtils::formatFileSize(static_cast<uint64_t>(session.readRate)) +
+                   "/s W " + FileUtils::formatFileSize(static_cast<uint64_t>(session.writeRate)) + "/s, " +
+                   std::to_string(session.openFiles) + " open";
+    }
+    lv_label_set_text(m_smbActivity, smbText.empty() ? "No SMB clients" : smbText.c_str());
+    
+    std::string trafficText;
+    for (const auto& interface : stats.interfaces) {
+        if (!trafficText.empty()) {
+            trafficText += "\n";
+        }
+        trafficText += interface.name + ": " LV_SYMBOL_DOWNLOAD " " +
+                       FileUtils::formatFileSize(static_cast<uint64_t>(interface.receiveRate)) + "/s " LV_SYMBOL_UPLOAD " " +
+                       FileUtils::formatFileSize(static_cast<uint64_t>(interface.sendRate)) + "/s";
+    }
+    lv_label_set_text(m_trafficStatus, trafficText.c_str());
+}
+
 void ScreenNetwork::onWifiConnect(const std::string& ssid) {
     m_selectedSsid = ssid;
     
@@ -315,21 +370,18 @@ void ScreenNetwork::onServiceToggle(const std::string& service, bool enabled) {
         return;
     }
     
-    auto networkManager = m_bridge->getNetworkManager();
-    if (!networkManager) {
-        return;
-    }
-    
     if (service == "smb") {
-        auto smbServer = networkManager->getSmbServer();
-        if (smbServer) {
-            if (enabled) {
-                smbServer->start();
-            } else {
-                smbServer->stop();
-            }
+        auto& smbServer = m_bridge->getSmbServer();
+        if (enabled) {
+            smbServer.start();
+        } else {
+            smbServer.stop();
         }
     } else if (service == "http") {
+        auto networkManager = m_bridge->getNetworkManager();
+        if (!networkManager) {
+            return;
+        }
         auto httpServer = networkManager->getHttpServer();
         if (httpServer) {
             if (enabled) {
@@ -0,0 +1,451 @@
+#include "network/ArchiveStreamer.hpp"
+#include "utils/Logger.hpp"
+#include <zlib.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+const size_t ArchiveStreamer::BUFFER_SIZE = 256 * 1024;
+// Below this a sendfile call costs more than copying the data along with the headers
+const uint64_t ArchiveStreamer::SMALL_FILE_SIZE = 32 * 1024;
+const int ArchiveStreamer::MAX_DEPTH = 64;
+
+namespace {
+
+const uint64_t TAR_MAX_OCTAL_SIZE = 077777777777ULL;   // 11 octal digits, just under 8 GiB
+const uint64_t ZIP32_LIMIT = 0xFFFFFFFFULL;
+const uint16_t ZIP_FLAGS = 0x0808;                      // Data descriptor follows, names are UTF-8
+const uint16_t ZIP_VERSION = 20;
+const uint16_t ZIP64_VERSION = 45;
+const uint16_t ZIP_MADE_BY_UNIX = 3 << 8;
+
+void put16(std::string& out, uint16_t value) {
+    out += static_cast<char>(value & 0xFF);
+    out += static_cast<char>(value >> 8);
+}
+
+void put32(std::string& out, uint32_t value) {
+    put16(out, static_cast<uint16_t>(value & 0xFFFF));
+    put16(out, static_cast<uint16_t>(value >> 16));
+}
+
+void put64(std::string& out, uint64_t value) {
+    put32(out, static_cast<uint32_t>(value & 0xFFFFFFFF));
+    put32(out, static_cast<uint32_t>(value >> 32));
+}
+
+void putOctal(char* field, size_t width, uint64_t value) {
+    snprintf(field, width, "%0*llo", static_cast<int>(width - 1), static_cast<unsigned long long>(value));
+}
+
+} // namespace
+
+ArchiveStreamer::ArchiveStreamer(Format format, const HttpBodyWriter& output)
+    : m_format(format)
+    , m_output(output)
+    , m_buffer(BUFFER_SIZE)
+{
+}
+
+bool ArchiveStreamer::write(const std::string& directory, const std::string& prefix) {
+    int dirFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) {
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(dirFd, &st) != 0) {
+        close(dirFd);
+        return false;
+    }
+    
+    if (!addDirectory(dirFd, prefix, st, 0)) {
+        return false;
+    }
+    
+    if (m_format == Format::TAR) {
+        // Two zero blocks end a tar archive
+        if (!pad(1024)) {
+            return false;
+        }
+    } else if (!writeZipCentralDirectory()) {
+        return false;
+    }
+    
+    return flush();
+}
+
+bool ArchiveStreamer::addDirectory(int dirFd, const std::string& name, const struct stat& st, int depth) {
+    DIR* dir = fdopendir(dirFd);
+    if (!dir) {
+        close(dirFd);
+        return false;
+    }
+    
+    bool success = true;
+    if (!name.empty()) {
+        if (m_format == Format::TAR) {
+            success = writeTarHeader(name, st, 0, '5');
+        } else {
+            ZipEntry entry = {name, 0, 0, 0, 0, 0, static_cast<uint32_t>(st.st_mode), false};
+            setDosTime(entry, st.st_mtime);
+            success = writeZipLocalHeader(entry) && writeZipDataDescriptor(entry);
+            m_zipEntries.push_back(std::move(entry));
+        }
+    }
+    
+    // Sorted, so the same tree always produces the same archive
+    std::vector<std::string> children;
+    struct dirent* dirEntry;
+    while (success && (dirEntry = readdir(dir)) != nullptr) {
+        const char* childName = dirEntry->d_name;
+        if (strcmp(childName, ".") != 0 && strcmp(childName, "..") != 0) {
+            children.emplace_back(childName);
+        }
+    }
+    std::sort(children.begin(), children.end());
+    
+    for (const auto& child : children) {
+        if (!success) {
+            break;
+        }
+        
+        // Links are not followed, so nothing outside the tree can be reached
+        struct stat childSt;
+        if (fstatat(dirFd, child.c_str(), &childSt, AT_SYMLINK_NOFOLLOW) != 0) {
+            continue;  // Removed since readdir
+        }
+        
+        if (S_ISDIR(childSt.st_mode)) {
+            if (depth + 1 >= MAX_DEPTH) {
+                LOG_WARNING("Archive skips deeply nested directory: " + name + child, "HTTP");
+                continue;
+            }
+            int childFd = openat(dirFd, child.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (childFd >= 0) {
+                success = addDirectory(childFd, name + child + "/", childSt, depth + 1);
+            }
+        } else if (S_ISREG(childSt.st_mode)) {
+            HttpFileBody file;
+            file.fd = openat(dirFd, child.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+            
+            // Sizes come from the open file, so a replaced file is archived consistently
+            if (file.fd >= 0 && fstat(file.fd, &childSt) == 0) {
+                success = addFile(file, name + child, childSt);
+            }
+        }
+    }
+    
+    closedir(dir);
+    return success;
+}
+
+bool ArchiveStreamer::addFile(const HttpFileBody& file, const std::string& name, const struct stat& st) {
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    
+    if (m_format == Format::TAR) {
+        if (!writeTarHeader(name, st, size, '0')) {
+            return false;
+        }
+        
+        if (size < SMALL_FILE_SIZE) {
+            if (!copyFileData(file.fd, size, nullptr)) {
+                return false;
+            }
+        } else {
+            if (!flush() || !m_output.writeFile(file, 0, size)) {
+                return false;
+            }
+            m_offset += size;
+        }
+        return pad((512 - size % 512) % 512);
+    }
+    
+    ZipEntry entry = {name, 0, size, 0, 0, 0, static_cast<uint32_t>(st.st_mode), size >= ZIP32_LIMIT};
+    setDosTime(entry, st.st_mtime);
+    
+    uint32_t crc = crc32(0, Z_NULL, 0);
+    if (!writeZipLocalHeader(entry) || !copyFileData(file.fd, size, &crc)) {
+        return false;
+    }
+    entry.crc = crc;
+    
+    if (!writeZipDataDescriptor(entry)) {
+        return false;
+    }
+    m_zipEntries.push_back(std::move(entry));
+    return true;
+}
+
+bool ArchiveStreamer::writeTarHeader(const std::string& name, const struct stat& st, uint64_t size, char type) {
+    char block[512];
+    
+    // ustar holds 100-byte names and sizes below 8 GiB; a pax header carries anything larger
+    bool longName = name.length() > 100;
+    bool largeSize = size > TAR_MAX_OCTAL_SIZE;
+    if (longName || largeSize) {
+        std::string records;
+        if (longName) {
+            records += paxRecord("path", name);
+        }
+        if (largeSize) {
+            records += paxRecord("size", std::to_string(size));
+        }
+        
+        formatTarHeader(block, "././@PaxHeader", 0644, records.length(), st.st_mtime, 'x');
+        if (!emit(block, sizeof(block)) || !emit(records.data(), records.length()) ||
+            !pad((512 - records.length() % 512) % 512)) {
+            return false;
+        }
+    }
+    
+    formatTarHeader(block, name.substr(0, 100), st.st_mode & 07777, largeSize ? 0 : size, st.st_mtime, type);
+    return emit(block, sizeof(block));
+}
+
+bool ArchiveStreamer::writeZipLocalHeader(ZipEntry& entry) {
+    entry.offset = m_offset;
+    
+    // Sizes and CRC follow in the data descriptor; zip64 entries say so with an extra field
+    std::string header;
+    put32(header, 0x04034b50);
+    put16(header, entry.zip64 ? ZIP64_VERSION : ZIP_VERSION);
+    put16(header, ZIP_FLAGS);
+    put16(header, 0);   // Stored
+    put16(header, entry.dosTime);
+    put16(header, entry.dosDate);
+    put32(header, 0);
+    put32(header, entry.zip64 ? 0xFFFFFFFF : 0);
+    put32(header, entry.zip64 ? 0xFFFFFFFF : 0);
+    put16(header, static_cast<uint16_t>(entry.name.length()));
+    put16(header, entry.zip64 ? 20 : 0);
+    header += entry.name;
+    if (entry.zip64) {
+        put16(header, 0x0001);
+        put16(header, 16);
+        put64(header, 0);
+        put64(header, 0);
+    }
+    
+    return emit(header.data(), header.length());
+}
+
+bool ArchiveStreamer::writeZipDataDescriptor(const ZipEntry& entry) {
+    std::string descriptor;
+    put32(descriptor, 0x08074b50);
+    put32(descriptor, entry.crc);
+    if (entry.zip64) {
+        put64(descriptor, entry.size);
+        put64(descriptor, entry.size);
+    } else {
+        put32(descriptor, static_cast<uint32_t>(entry.size));
+        put32(descriptor, static_cast<uint32_t>(entry.size));
+    }
+    return emit(descriptor.data(), descriptor.length());
+}
+
+bool ArchiveStreamer::writeZipCentralDirectory() {
+    uint64_t start = m_offset;
+    
+    for (const auto& entry : m_zipEntries) {
+        bool largeSize = entry.size >= ZIP32_LIMIT;
+        bool largeOffset = entry.offset >= ZIP32_LIMIT;
+        
+        // Only the fields that overflowed appear in the zip64 extra field, in this order
+        std::string extra;
+        if (largeSize) {
+            put64(extra, entry.size);
+            put64(extra, entry.size);
+        }
+        if (largeOffset) {
+            put64(extra, entry.offset);
+        }
+        
+        std::string header;
+        put32(header, 0x02014b50);
+        put16(header, ZIP_MADE_BY_UNIX | ZIP64_VERSION);
+        put16(header, entry.zip64 || largeOffset ? ZIP64_VERSION : ZIP_VERSION);
+        put16(header, ZIP_FLAGS);
+        put16(header, 0);
+        put16(header, entry.dosTime);
+        put16(header, entry.dosDate);
+        put32(header, entry.crc);
+        put32(header, largeSize ? 0xFFFFFFFF : static_cast<uint32_t>(entry.size));
+        put32(header, largeSize ? 0xFFFFFFFF : static_cast<uint32_t>(entry.size));
+        put16(header, static_cast<uint16_t>(entry.name.length()));
+        put16(header, static_cast<uint16_t>(extra.empty() ? 0 : extra.length() + 4));
+        put16(header, 0);   // Comment
+        put16(header, 0);   // Disk
+        put16(header, 0);   // Internal attributes
+        put32(header, (entry.mode << 16) | (S_ISDIR(entry.mode) ? 0x10 : 0));
+        put32(header, largeOffset ? 0xFFFFFFFF : static_cast<uint32_t>(entry.offset));
+        header += entry.name;
+        if (!extra.empty()) {
+            put16(header, 0x0001);
+            put16(header, static_cast<uint16_t>(extra.length()));
+            header += extra;
+        }
+        
+        if (!emit(header.data(), header.length())) {
+            return false;
+        }
+    }
+    
+    uint64_t size = m_offset - start;
+    uint64_t count = m_zipEntries.size();
+    std::string end;
+    
+    if (count >= 0xFFFF || size >= ZIP32_LIMIT || start >= ZIP32_LIMIT) {
+        uint64_t zip64End = m_offset;
+        
+        put32(end, 0x06064b50);
+        put64(end, 44);
+        put16(end, ZIP_MADE_BY_UNIX | ZIP64_VERSION);
+        put16(end, ZIP64_VERSION);
+        put32(end, 0);
+        put32(end, 0);
+        put64(end, count);
+        put64(end, count);
+        put64(end, size);
+        put64(end, start);
+        
+        put32(end, 0x07064b50);
+        put32(end, 0);
+        put64(end, zip64End);
+        put32(end, 1);
+    }
+    
+    put32(end, 0x06054b50);
+    put16(end, 0);
+    put16(end, 0);
+    put16(end, static_cast<uint16_t>(std::min<uint64_t>(count, 0xFFFF)));
+    put16(end, static_cast<uint16_t>(std::min<uint64_t>(count, 0xFFFF)));
+    put32(end, static_cast<uint32_t>(std::min(size, ZIP32_LIMIT)));
+    put32(end, static_cast<uint32_t>(std::min(start, ZIP32_LIMIT)));
+    put16(end, 0);
+    
+    return emit(end.data(), end.length());
+}
+
+bool ArchiveStreamer::copyFileData(int fd, uint64_t length, uint32_t* crc) {
+    // Read straight into the output buffer, so the data is copied only once on its way out
+    while (length > 0) {
+        if (m_used == m_buffer.size() && !flush()) {
+            return false;
+        }
+        
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(length, m_buffer.size() - m_used));
+        ssize_t bytesRead = read(fd, m_buffer.data() + m_used, chunk);
+        if (bytesRead < 0) {
+            if (errno == EINTR) continue;
+            LOG_WARNING("Failed to read file for archive: " + std::string(strerror(errno)), "HTTP");
+            return false;
+        }
+        if (bytesRead == 0) {
+            LOG_WARNING("File truncated while being archived", "HTTP");
+            return false;
+        }
+        
+        if (crc) {
+            *crc = crc32(*crc, reinterpret_cast<const Bytef*>(m_buffer.data() + m_used),
+                         static_cast<uInt>(bytesRead));
+        }
+        m_used += bytesRead;
+        m_offset += bytesRead;
+        length -= bytesRead;
+    }
+    return true;
+}
+
+bool ArchiveStreamer::emit(const void* data, size_t length) {
+    const char* bytes = static_cast<const char*>(data);
+    m_offset += length;
+    
+    while (length > 0) {
+        if (m_used == m_buffer.size() && !flush()) {
+            return false;
+        }
+        
+        size_t chunk = std::min(length, m_buffer.size() - m_used);
+        memcpy(m_buffer.data() + m_used, bytes, chunk);
+        m_used += chunk;
+        bytes += chunk;
+        length -= chunk;
+    }
+    return true;
+}
+
+bool ArchiveStreamer::pad(size_t length) {
+    static const char zeros[512] = {};
+    
+    while (length > 0) {
+        size_t chunk = std::min(length, sizeof(zeros));
+        if (!emit(zeros, chunk)) {
+            return false;
+        }
+        length -= chunk;
+    }
+    return true;
+}
+
+bool ArchiveStreamer::flush() {
+    if (m_used == 0) {
+        return true;
+    }
+    
+    bool success = m_output.write(m_buffer.data(), m_used);
+    m_used = 0;
+    return success;
+}
+
+void ArchiveStreamer::formatTarHeader(char* block, const std::string& name, uint32_t mode, uint64_t size,
+                                      int64_t mtime, char type) {
+    memset(block, 0, 512);
+    
+    memcpy(block, name.data(), std::min<size_t>(name.length(), 100));
+    putOctal(block + 100, 8, mode);
+    putOctal(block + 108, 8, 0);                                      // uid
+    putOctal(block + 116, 8, 0);                                      // gid
+    putOctal(block + 124, 12, size);
+    putOctal(block + 136, 12, static_cast<uint64_t>(std::max<int64_t>(mtime, 0)));
+    block[156] = type;
+    memcpy(block + 257, "ustar", 6);
+    memcpy(block + 263, "00", 2);
+    
+    // The checksum is computed with its own field filled with spaces
+    memset(block + 148, ' ', 8);
+    unsigned int checksum = 0;
+    for (int i = 0; i < 512; ++i) {
+        checksum += static_cast<unsigned char>(block[i]);
+    }
+    snprintf(block + 148, 7, "%06o", checksum);
+    block[155] = ' ';
+}
+
+std::string ArchiveStreamer::paxRecord(const std::string& key, const std::string& value) {
+    // "<length> <key>=<value>\n", where the length counts its own digits too
+    size_t length = key.length() + value.length() + 3;
+    size_t total = length + std::to_string(length).length();
+    if (std::to_string(total).length() != std::to_string(length).length()) {
+        total++;
+    }
+    return std::to_string(total) + " " + key + "=" + value + "\n";
+}
+
+void ArchiveStreamer::setDosTime(ZipEntry& entry, time_t mtime) {
+    struct tm local;
+    if (!localtime_r(&mtime, &local) || local.tm_year < 80) {
+        // DOS dates start in 1980
+        entry.dosTime = 0;
+        entry.dosDate = (1 << 5) | 1;
+        return;
+    }
+    
+    entry.dosTime = static_cast<uint16_t>((local.tm_hour << 11) | (local.tm_min << 5) | (local.tm_sec / 2));
+    entry.dosDate = static_cast<uint16_t>(((local.tm_year - 80) << 9) | ((local.tm_mon + 1) << 5) | local.tm_mday);
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "network/DavLockManager.hpp"
+#include <random>
+#include <cstdio>
+
+const uint32_t DavLockManager::DEFAULT_TIMEOUT_SECONDS = 600;
+const uint32_t DavLockManager::MAX_TIMEOUT_SECONDS = 3600;
+
+bool DavLockManager::lock(Lock& lock) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    purgeExpired();
+    
+    for (const auto& [token, existing] : m_locks) {
+        bool overlaps = existing.path == lock.path ||
+                        (existing.infinite && isWithin(lock.path, existing.path)) ||
+                        (lock.infinite && isWithin(existing.path, lock.path));
+        if (overlaps && (existing.exclusive || lock.exclusive)) {
+            return false;
+        }
+    }
+    
+    lock.token = generateToken();
+    lock.expires = std::chrono::steady_clock::now() + std::chrono::seconds(lock.timeoutSeconds);
+    m_locks[lock.token] = lock;
+    return true;
+}
+
+bool DavLockManager::refresh(const std::string& token, uint32_t timeoutSeconds, Lock& refreshed) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    purgeExpired();
+    
+    auto it = m_locks.find(token);
+    if (it == m_locks.end()) {
+        return false;
+    }
+    
+    it->second.timeoutSeconds = timeoutSeconds;
+    it->second.expires = std::chrono::steady_clock::now() + std::chrono::seconds(timeoutSeconds);
+    refreshed = it->second;
+    return true;
+}
+
+bool DavLockManager::unlock(const std::string& path, const std::string& token) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    purgeExpired();
+    
+    // The token has to belong to a lock that covers the request URI
+    auto it = m_locks.find(token);
+    if (it == m_locks.end() ||
+        !(it->second.path == path || (it->second.infinite && isWithin(path, it->second.path)))) {
+        return false;
+    }
+    m_locks.erase(it);
+    return true;
+}
+
+std::vector<DavLockManager::Lock> DavLockManager::getLocks(const std::string& path, bool includeDescendants) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    purgeExpired();
+    
+    std::vector<Lock> locks;
+    for (const auto& [token, lock] : m_locks) {
+        if (lock.path == path || (lock.infinite && isWithin(path, lock.path)) ||
+            (includeDescendants && isWithin(lock.path, path))) {
+            locks.push_back(lock);
+        }
+    }
+    return locks;
+}
+
+bool DavLockManager::isAllowed(const std::string& path, std::string_view ifHeader, bool includeDescendants) {
+    // Tokens are unique random strings, so finding one anywhere in the If header is as
+    // good as evaluating its lists; ETag conditions in it aren't checked
+    for (const auto& lock : getLocks(path, includeDescendants)) {
+        if (ifHeader.find(lock.token) == std::string_view::npos) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void DavLockManager::removeTree(const std::string& path) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    
+    for (auto it = m_locks.begin(); it != m_locks.end();) {
+        if (it->second.path == path || isWithin(it->second.path, path)) {
+            it = m_locks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void DavLockManager::purgeExpired() {
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = m_locks.begin(); it != m_locks.end();) {
+        if (it->second.expires <= now) {
+            it = m_locks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool DavLockManager::isWithin(const std::string& path, const std::string& root) {
+    return path.length() > root.length() && path.compare(0, root.length(), root) == 0 &&
+           (path[root.length()] == '/' || root.back() == '/');
+}
+
+std::string DavLockManager::generateToken() {
+    thread_local std::mt19937_64 generator(std::random_device{}());
+    uint64_t high = generator();
+    uint64_t low = generator();
+    
+    // Random (version 4) UUID
+    high = (high & ~0xF000ULL) | 0x4000ULL;
+    low = (low & ~(0xC000ULL << 48)) | (0x8000ULL << 48);
+    
+    char token[64];
+    snprintf(token, sizeof(token), "opaquelocktoken:%08llx-%04llx-%04llx-%04llx-%012llx",
+             static_cast<unsigned long long>(high >> 32),
+             static_cast<unsigned long long>((high >> 16) & 0xFFFF),
+             static_cast<unsigned long long>(high & 0xFFFF),
+             static_cast<unsigned long long>(low >> 48),
+             static_cast<unsigned long long>(low & 0xFFFFFFFFFFFFULL));
+    return token;
+}
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "network/DavXml.hpp"
+#include <cctype>
+
+std::string DavXml::escape(std::string_view text) {
+    std::string escaped;
+    escaped.reserve(text.length());
+    
+    for (char c : text) {
+        switch (c) {
+            case '&':  escaped += "&amp;"; break;
+            case '<':  escaped += "&lt;"; break;
+            case '>':  escaped += "&gt;"; break;
+            case '"':  escaped += "&quot;"; break;
+            default:   escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string DavXml::encodeHref(std::string_view path) {
+    static const char hex[] = "0123456789ABCDEF";
+    
+    std::string encoded;
+    encoded.reserve(path.length());
+    for (char c : path) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (std::isalnum(byte) || c == '/' || c == '-' || c == '_' || c == '.' || c == '~') {
+            encoded += c;
+        } else {
+            encoded += '%';
+            encoded += hex[byte >> 4];
+            encoded += hex[byte & 0xF];
+        }
+    }
+    return encoded;
+}
+
+std::string_view DavXml::findElement(std::string_view xml, std::string_view localName, bool& found) {
+    found = false;
+    
+    size_t pos = 0;
+    while ((pos = xml.find('<', pos)) != std::string_view::npos) {
+        size_t nameStart = pos + 1;
+        size_t nameEnd = nameStart;
+        while (nameEnd < xml.length() && !std::isspace(static_cast<unsigned char>(xml[nameEnd])) &&
+               xml[nameEnd] != '>' && xml[nameEnd] != '/') {
+            nameEnd++;
+        }
+        
+        std::string_view name = xml.substr(nameStart, nameEnd - nameStart);
+        size_t tagEnd = xml.find('>', nameEnd);
+        if (tagEnd == std::string_view::npos) {
+            return {};
+        }
+        
+        if (name.empty() || name[0] == '/' || name[0] == '?' || name[0] == '!' || localPart(name) != localName) {
+            pos = tagEnd + 1;
+            continue;
+        }
+        
+        found = true;
+        if (xml[tagEnd - 1] == '/') {
+            return xml.substr(tagEnd + 1, 0);
+        }
+        
+        // Elements of the same name don't nest in DAV bodies, the next end tag closes this one
+        std::string endTag = "</" + std::string(name);
+        size_t close = xml.find(endTag, tagEnd + 1);
+        if (close == std::string_view::npos) {
+            return xml.substr(tagEnd + 1);
+        }
+        return xml.substr(tagEnd + 1, close - tagEnd - 1);
+    }
+    return {};
+}
+
+bool DavXml::hasElement(std::string_view xml, std::string_view localName) {
+    bool found;
+    findElement(xml, localName, found);
+    return found;
+}
+
+std::vector<DavXml::Name> DavXml::propertyNames(std::string_view xml) {
+    std::vector<Name> names;
+    
+    bool found;
+    std::string_view rest = xml;
+    while (true) {
+        std::string_view prop = findElement(rest, "prop", found);
+        if (!found) {
+            break;
+        }
+        
+        // Top-level children of <prop> are the property names
+        size_t pos = 0;
+        int depth = 0;
+        while ((pos = prop.find('<', pos)) != std::string_view::npos) {
+            size_t tagEnd = prop.find('>', pos);
+            if (tagEnd == std::string_view::npos) {
+                break;
+            }
+            std::string_view tag = prop.substr(pos + 1, tagEnd - pos - 1);
+            pos = tagEnd + 1;
+            
+            if (tag.empty() || tag[0] == '?' || tag[0] == '!') {
+                continue;
+            }
+            if (tag[0] == '/') {
+                depth--;
+                continue;
+            }
+            
+            bool selfClosing = tag.back() == '/';
+            if (depth == 0) {
+                size_t nameEnd = 0;
+                while (nameEnd < tag.length() && !std::isspace(static_cast<unsigned char>(tag[nameEnd])) &&
+                       tag[nameEnd] != '/') {
+                    nameEnd++;
+                }
+                std::string_view qualifiedName = tag.substr(0, nameEnd);
+                
+                // A declaration on the property element itself wins over the document's
+                std::string namespaceUri = resolveNamespace(tag, qualifiedName);
+                if (namespaceUri.empty()) {
+                    namespaceUri = resolveNamespace(xml, qualifiedName);
+                }
+                names.push_back({namespaceUri, std::string(localPart(qualifiedName))});
+            }
+            if (!selfClosing) {
+                depth++;
+            }
+        }
+        
+        // Continue behind this <prop> element
+        size_t consumed = static_cast<size_t>(prop.data() - rest.data()) + prop.length();
+        if (consumed >= rest.length()) {
+            break;
+        }
+        rest = rest.substr(consumed);
+    }
+    return names;
+}
+
+std::string_view DavXml::localPart(std::string_view qualifiedName) {
+    size_t colon = qualifiedName.find(':');
+    return colon == std::string_view::npos ? qualifiedName : qualifiedName.substr(colon + 1);
+}
+
+std::string DavXml::resolveNamespace(std::string_view xml, std::string_view qualifiedName) {
+    size_t colon = qualifiedName.find(':');
+    std::string attribute = colon == std::string_view::npos
+        ? "xmlns="
+        : "xmlns:" + std::string(qualifiedName.substr(0, colon)) + "=";
+    
+    size_t pos = xml.find(attribute);
+    if (pos == std::string_view::npos || pos + attribute.length() >= xml.length()) {
+        return "";
+    }
+    
+    char quote = xml[pos + attribute.length()];
+    size_t start = pos + attribute.length() + 1;
+    size_t end = xml.find(quote, start);
+    if (end == std::string_view::npos) {
+        return "";
+    }
+    return std::string(xml.substr(start, end - start));
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "network/DirectoryListingCache.hpp"
+#include <dirent.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+const size_t DirectoryListingCache::MAX_CACHED_LISTINGS = 16;
+const std::chrono::seconds DirectoryListingCache::MAX_AGE(10);
+
+std::shared_ptr<const DirectoryListingCache::Listing> DirectoryListingCache::get(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return nullptr;
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_listings.find(path);
+        if (it != m_listings.end()) {
+            const Listing& cached = *it->second.listing;
+            if (cached.m_inode == st.st_ino &&
+                cached.m_directoryMtime.tv_sec == st.st_mtim.tv_sec &&
+                cached.m_directoryMtime.tv_nsec == st.st_mtim.tv_nsec &&
+                now - cached.m_loadedAt < MAX_AGE) {
+                it->second.lastUsed = ++m_useCounter;
+                return it->second.listing;
+            }
+        }
+    }
+    
+    // Scan without the lock; two clients missing at once both scan and the later one is kept
+    std::shared_ptr<Listing> listing = scan(path, st);
+    if (!listing) {
+        return nullptr;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    if (m_listings.size() >= MAX_CACHED_LISTINGS && m_listings.find(path) == m_listings.end()) {
+        auto oldest = std::min_element(m_listings.begin(), m_listings.end(),
+                                       [](const auto& a, const auto& b) {
+                                           return a.second.lastUsed < b.second.lastUsed;
+                                       });
+        m_listings.erase(oldest);
+    }
+    m_listings[path] = CachedListing{listing, ++m_useCounter};
+    
+    return listing;
+}
+
+void DirectoryListingCache::invalidate(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_listings.erase(path);
+}
+
+void DirectoryListingCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_listings.clear();
+}
+
+std::shared_ptr<DirectoryListingCache::Listing> DirectoryListingCache::scan(const std::string& path,
+                                                                            const struct stat& st) {
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return nullptr;
+    }
+    
+    auto listing = std::make_shared<Listing>();
+    listing->m_directoryMtime = st.st_mtim;
+    listing->m_inode = st.st_ino;
+    listing->m_loadedAt = std::chrono::steady_clock::now();
+    
+    // fstatat relative to the open directory avoids resolving the full path for every entry
+    int dirFd = dirfd(dir);
+    struct dirent* dirEntry;
+    while ((dirEntry = readdir(dir)) != nullptr) {
+        const char* name = dirEntry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+        
+        struct stat entrySt;
+        if (fstatat(dirFd, name, &entrySt, 0) != 0) {
+            continue;  // Removed since readdir, or a dangling symlink
+        }
+        
+        Entry entry;
+        entry.name = name;
+        entry.isDirectory = S_ISDIR(entrySt.st_mode);
+        entry.size = entry.isDirectory ? 0 : static_cast<uint64_t>(entrySt.st_size);
+        entry.modified = entrySt.st_mtime;
+        entry.modifiedNsec = static_cast<uint32_t>(entrySt.st_mtim.tv_nsec);
+        entry.inode = entrySt.st_ino;
+        listing->m_entries.push_back(std::move(entry));
+    }
+    
+    closedir(dir);
+    return listing;
+}
+
+std::shared_ptr<const std::vector<uint32_t>> DirectoryListingCache::Listing::getOrder(SortKey key,
+                                                                                      bool descending) const {
+    std::lock_guard<std::mutex> lock(m_orderMutex);
+    
+    auto& order = m_orders[static_cast<int>(key) * 2 + (descending ? 1 : 0)];
+    if (order) {
+        return order;
+    }
+    
+    auto indices = std::make_shared<std::vector<uint32_t>>(m_entries.size());
+    for (uint32_t i = 0; i < indices->size(); ++i) {
+        (*indices)[i] = i;
+    }
+    
+    const std::vector<Entry>& entries = m_entries;
+    auto compareNames = [](const Entry& a, const Entry& b) {
+        int result = strcasecmp(a.name.c_str(), b.name.c_str());
+        return result != 0 ? result < 0 : a.name < b.name;
+    };
+    
+    // Directories stay first in either direction; names break ties so pages are stable
+    std::sort(indices->begin(), indices->end(), [&](uint32_t left, uint32_t right) {
+        const Entry& a = entries[left];
+        const Entry& b = entries[right];
+        if (a.isDirectory != b.isDirectory) {
+            return a.isDirectory;
+        }
+        
+        const Entry& first = descending ? b : a;
+        const Entry& second = descending ? a : b;
+        switch (key) {
+            case SortKey::SIZE:
+                if (first.size != second.size) {
+                    return first.size < second.size;
+                }
+                break;
+            case SortKey::MODIFIED:
+                if (first.modified != second.modified) {
+                    return first.modified < second.modified;
+                }
+                break;
+            case SortKey::NAME:
+                break;
+        }
+        return compareNames(first, second);
+    });
+    
+    order = indices;
+    return order;
+}
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "network/EventHub.hpp"
+
+const size_t EventHub::MAX_PENDING_UPDATES = 64;
+const size_t EventHub::MAX_PENDING_EVENTS = 256;
+
+struct EventHub::Subscriber {
+    std::map<std::string, nlohmann::json> sentStates;   // Last state delivered per topic
+    std::set<std::string> dirtyTopics;
+    std::map<std::string, std::pair<std::string, std::string>> updates;  // key -> (event, data)
+    std::deque<std::pair<std::string, std::string>> events;
+    bool overflowed = false;
+};
+
+EventHub::EventHub()
+    : m_shutdown(false)
+{
+}
+
+std::shared_ptr<EventHub::Subscriber> EventHub::subscribe(size_t maxSubscribers) {
+    auto subscriber = std::make_shared<Subscriber>();
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_subscribers.size() >= maxSubscribers) {
+        return nullptr;
+    }
+    
+    // A new client starts with the complete current state
+    for (const auto& state : m_states) {
+        subscriber->dirtyTopics.insert(state.first);
+    }
+    m_subscribers.insert(subscriber);
+    return subscriber;
+}
+
+void EventHub::unsubscribe(const std::shared_ptr<Subscriber>& subscriber) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_subscribers.erase(subscriber);
+}
+
+size_t EventHub::getSubscriberCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_subscribers.size();
+}
+
+void EventHub::publishState(const std::string& topic, const nlohmann::json& state) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        
+        auto it = m_states.find(topic);
+        if (it != m_states.end() && it->second == state) {
+            return;  // Unchanged, nobody needs waking
+        }
+        m_states[topic] = state;
+        
+        for (const auto& subscriber : m_subscribers) {
+            subscriber->dirtyTopics.insert(topic);
+        }
+    }
+    m_condition.notify_all();
+}
+
+void EventHub::publishUpdate(const std::string& event, const std::string& key, const nlohmann::json& data) {
+    std::string payload = data.dump();
+    std::string slot = event + "/" + key;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_subscribers.empty()) {
+            return;
+        }
+        
+        for (const auto& subscriber : m_subscribers) {
+            auto it = subscriber->updates.find(slot);
+            if (it != subscriber->updates.end()) {
+                it->second.second = payload;
+            } else if (subscriber->updates.size() < MAX_PENDING_UPDATES) {
+                subscriber->updates.emplace(slot, std::make_pair(event, payload));
+            } else {
+                subscriber->overflowed = true;
+            }
+        }
+    }
+    m_condition.notify_all();
+}
+
+void EventHub::publishEvent(const std::string& event, const nlohmann::json& data) {
+    std::string payload = data.dump();
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_subscribers.empty()) {
+            return;
+        }
+        
+        for (const auto& subscriber : m_subscribers) {
+            if (subscriber->overflowed) {
+                continue;  // Client refetches everything anyway
+            }
+            if (subscriber->events.size() >= MAX_PENDING_EVENTS) {
+                subscriber->events.clear();
+                subscriber->overflowed = true;
+                continue;
+            }
+            subscriber->events.emplace_back(event, payload);
+        }
+    }
+    m_condition.notify_all();
+}
+
+std::string EventHub::waitForEvents(const std::shared_ptr<Subscriber>& subscriber,
+                                    std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    m_condition.wait_for(lock, timeout, [&] {
+        return m_shutdown || hasPending(*subscriber);
+    });
+    
+    std::string out;
+    
+    if (subscriber->overflowed) {
+        // Fell too far behind; pending updates and events are replaced by a single resync
+        appendEvent(out, "resync", "{}");
+        subscriber->overflowed = false;
+        subscriber->updates.clear();
+        subscriber->events.clear();
+    }
+    
+    for (const auto& topic : subscriber->dirtyTopics) {
+        const nlohmann::json& current = m_states[topic];
+        nlohmann::json& sent = subscriber->sentStates[topic];
+        
+        nlohmann::json delta = diffState(sent, current);
+        if (!delta.empty()) {
+            appendEvent(out, topic, delta.dump());
+        }
+        sent = current;
+    }
+    subscriber->dirtyTopics.clear();
+    
+    for (const auto& update : subscriber->updates) {
+        appendEvent(out, update.second.first, update.second.second);
+    }
+    subscriber->updates.clear();
+    
+    for (const auto& event : subscriber->events) {
+        appendEvent(out, event.first, event.second);
+    }
+    subscriber->events.clear();
+    
+    return out;
+}
+
+void EventHub::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_condition.notify_all();
+}
+
+void EventHub::start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_shutdown = false;
+}
+
+nlohmann::json EventHub::diffState(const nlohmann::json& from, const nlohmann::json& to) {
+    // JSON merge patch (RFC 7386) turning from into to; removed fields become null
+    if (!from.is_object() || !to.is_object()) {
+        return from == to ? nlohmann::json::object() : to;
+    }
+    
+    nlohmann::json delta = nlohmann::json::object();
+    
+    for (auto it = to.begin(); it != to.end(); ++it) {
+        auto previous = from.find(it.key());
+        if (previous == from.end()) {
+            delta[it.key()] = it.value();
+        } else if (*previous != it.value()) {
+            delta[it.key()] = previous->is_object() && it.value().is_object() ?
+                              diffState(*previous, it.value()) : it.value();
+        }
+    }
+    
+    for (auto it = from.begin(); it != from.end(); ++it) {
+        if (!to.contains(it.key())) {
+            delta[it.key()] = nullptr;
+        }
+    }
+    
+    return delta;
+}
+
+void EventHub::appendEvent(std::string& out, const std::string& event, const std::string& data) {
+    // Payloads are single-line JSON, so one data field is enough
+    out += "event: ";
+    out += event;
+    out += "\ndata: ";
+    out += data;
+    out += "\n\n";
+}
+
+bool EventHub::hasPending(const Subscriber& subscriber) {
+    return subscriber.overflowed || !subscriber.dirtyTopics.empty() ||
+           !subscriber.updates.empty() || !subscriber.events.empty();
+}
\ No newline at end of file
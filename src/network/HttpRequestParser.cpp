@@ -0,0 +1,424 @@
+#include "network/HttpRequestParser.hpp"
+#include <sys/socket.h>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+bool isTokenChar(char c) {
+    // RFC 7230 tchar
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+        return true;
+    }
+    return std::strchr("!#$%&'*+-.^_`|~", c) != nullptr && c != '\0';
+}
+
+char toLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.length() != b.length()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.length(); ++i) {
+        if (toLower(a[i]) != toLower(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view trimWhitespace(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+} // namespace
+
+// ===== HttpRequestParser =====
+
+HttpRequestParser::HttpRequestParser(size_t maxHeadSize)
+    : m_maxHeadSize(maxHeadSize)
+{
+    reset();
+}
+
+void HttpRequestParser::reset() {
+    m_scanned = 0;
+    m_leadingBytes = 0;
+    m_headLength = 0;
+    m_errorStatus = 0;
+    m_method = m_target = m_path = m_query = m_version = std::string_view();
+    m_headerCount = 0;
+    m_chunked = false;
+    m_hasContentLength = false;
+    m_contentLength = 0;
+}
+
+HttpRequestParser::Status HttpRequestParser::fail(int status) {
+    m_errorStatus = status;
+    return Status::ERROR;
+}
+
+HttpRequestParser::Status HttpRequestParser::parse(std::string_view data) {
+    if (m_errorStatus != 0) {
+        return Status::ERROR;
+    }
+    if (m_headLength != 0) {
+        return Status::COMPLETE;
+    }
+    
+    // Robustness: ignore empty lines ahead of the request line (RFC 7230 3.5)
+    while (m_leadingBytes + 1 < data.length() &&
+           data[m_leadingBytes] == '\r' && data[m_leadingBytes + 1] == '\n') {
+        m_leadingBytes += 2;
+    }
+    
+    // Resume the search where the previous call stopped, allowing for a split terminator
+    size_t searchFrom = std::max(m_scanned, m_leadingBytes + 3) - 3;
+    size_t end = data.find("\r\n\r\n", searchFrom);
+    
+    if (end == std::string_view::npos) {
+        m_scanned = data.length();
+        
+        size_t lineEnd = data.find("\r\n", m_leadingBytes);
+        if (lineEnd == std::string_view::npos && data.length() - m_leadingBytes > MAX_REQUEST_LINE) {
+            return fail(414);
+        }
+        if (data.length() > m_maxHeadSize) {
+            return fail(431);
+        }
+        return Status::INCOMPLETE;
+    }
+    
+    if (end + 4 > m_maxHeadSize) {
+        return fail(431);
+    }
+    
+    std::string_view head = data.substr(m_leadingBytes, end - m_leadingBytes);
+    
+    size_t lineEnd = head.find("\r\n");
+    std::string_view requestLine = head.substr(0, lineEnd);
+    if (requestLine.length() > MAX_REQUEST_LINE) {
+        return fail(414);
+    }
+    if (!parseRequestLine(requestLine)) {
+        return fail(400);
+    }
+    
+    while (lineEnd != std::string_view::npos) {
+        size_t lineStart = lineEnd + 2;
+        lineEnd = head.find("\r\n", lineStart);
+        
+        std::string_view line = head.substr(lineStart, lineEnd == std::string_view::npos ?
+                                            std::string_view::npos : lineEnd - lineStart);
+        if (!parseHeaderLine(line)) {
+            return m_errorStatus != 0 ? Status::ERROR : fail(400);
+        }
+    }
+    
+    // A message with both framings is a smuggling vector (RFC 7230 3.3.3)
+    if (m_chunked && m_hasContentLength) {
+        return fail(400);
+    }
+    
+    m_headLength = end + 4;
+    return Status::COMPLETE;
+}
+
+bool HttpRequestParser::parseRequestLine(std::string_view line) {
+    size_t methodEnd = line.find(' ');
+    if (methodEnd == 0 || methodEnd == std::string_view::npos) {
+        return false;
+    }
+    m_method = line.substr(0, methodEnd);
+    for (char c : m_method) {
+        if (!isTokenChar(c)) {
+            return false;
+        }
+    }
+    
+    size_t targetEnd = line.find(' ', methodEnd + 1);
+    if (targetEnd == std::string_view::npos || targetEnd == methodEnd + 1) {
+        return false;
+    }
+    m_target = line.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    for (char c : m_target) {
+        if (static_cast<unsigned char>(c) <= 0x20 || c == 0x7f) {
+            return false;
+        }
+    }
+    
+    m_version = line.substr(targetEnd + 1);
+    if (m_version != "HTTP/1.1" && m_version != "HTTP/1.0") {
+        return false;
+    }
+    
+    size_t queryStart = m_target.find('?');
+    m_path = m_target.substr(0, queryStart);
+    m_query = queryStart == std::string_view::npos ? std::string_view() : m_target.substr(queryStart + 1);
+    
+    return !m_path.empty();
+}
+
+bool HttpRequestParser::parseHeaderLine(std::string_view line) {
+    // Obsolete line folding is rejected rather than unfolded (RFC 7230 3.2.4)
+    if (line.empty() || line.front() == ' ' || line.front() == '\t') {
+        return false;
+    }
+    
+    size_t colon = line.find(':');
+    if (colon == 0 || colon == std::string_view::npos) {
+        return false;
+    }
+    
+    Header header;
+    header.name = line.substr(0, colon);
+    for (char c : header.name) {
+        if (!isTokenChar(c)) {
+            return false;
+        }
+    }
+    
+    header.value = trimWhitespace(line.substr(colon + 1));
+    for (char c : header.value) {
+        if ((static_cast<unsigned char>(c) < 0x20 && c != '\t') || c == 0x7f) {
+            return false;
+        }
+    }
+    
+    if (m_headerCount == MAX_HEADERS) {
+        fail(431);
+        return false;
+    }
+    m_headers[m_headerCount++] = header;
+    
+    return applyFramingHeader(header);
+}
+
+bool HttpRequestParser::applyFramingHeader(const Header& header) {
+    if (equalsIgnoreCase(header.name, "content-length")) {
+        if (header.value.empty() || header.value.length() > 19) {
+            return false;
+        }
+        
+        uint64_t length = 0;
+        for (char c : header.value) {
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            length = length * 10 + (c - '0');
+        }
+        
+        // Repeated Content-Length headers must agree
+        if (m_hasContentLength && length != m_contentLength) {
+            return false;
+        }
+        m_hasContentLength = true;
+        m_contentLength = length;
+    } else if (equalsIgnoreCase(header.name, "transfer-encoding")) {
+        // Only "chunked" as the final coding is understood
+        std::string_view value = header.value;
+        size_t comma = value.rfind(',');
+        std::string_view lastCoding = trimWhitespace(comma == std::string_view::npos ? value : value.substr(comma + 1));
+        
+        if (!equalsIgnoreCase(lastCoding, "chunked") || comma != std::string_view::npos) {
+            fail(501);
+            return false;
+        }
+        m_chunked = true;
+    }
+    
+    return true;
+}
+
+std::string_view HttpRequestParser::header(std::string_view name) const {
+    for (size_t i = 0; i < m_headerCount; ++i) {
+        if (equalsIgnoreCase(m_headers[i].name, name)) {
+            return m_headers[i].value;
+        }
+    }
+    return std::string_view();
+}
+
+// ===== ChunkedDecoder =====
+
+ChunkedDecoder::ChunkedDecoder() {
+    reset();
+}
+
+void ChunkedDecoder::reset() {
+    m_state = State::SIZE;
+    m_remaining = 0;
+    m_sizeDigits = 0;
+    m_extensionLength = 0;
+    m_trailerSize = 0;
+}
+
+size_t ChunkedDecoder::decode(std::string_view input, std::string_view& payload) {
+    payload = std::string_view();
+    size_t pos = 0;
+    
+    while (pos < input.length() && m_state != State::DONE && m_state != State::ERROR) {
+        char c = input[pos];
+        
+        switch (m_state) {
+            case State::SIZE: {
+                int digit = hexValue(c);
+                if (digit >= 0) {
+                    if (++m_sizeDigits > 15) {
+                        m_state = State::ERROR;  // Chunk size overflow
+                        break;
+                    }
+                    m_remaining = (m_remaining << 4) | static_cast<uint64_t>(digit);
+                } else if (m_sizeDigits > 0 && (c == ';' || c == ' ' || c == '\t')) {
+                    m_state = State::EXTENSION;
+                } else if (m_sizeDigits > 0 && c == '\r') {
+                    m_state = State::SIZE_LF;
+                } else {
+                    m_state = State::ERROR;
+                }
+                pos++;
+                break;
+            }
+            
+            case State::EXTENSION:
+                // Chunk extensions are skipped
+                if (c == '\r') {
+                    m_state = State::SIZE_LF;
+                } else if (++m_extensionLength > MAX_EXTENSION_LENGTH) {
+                    m_state = State::ERROR;
+                }
+                pos++;
+                break;
+            
+            case State::SIZE_LF:
+                if (c != '\n') {
+                    m_state = State::ERROR;
+                } else {
+                    m_state = m_remaining == 0 ? State::TRAILER_START : State::DATA;
+                }
+                pos++;
+                break;
+            
+            case State::DATA: {
+                size_t available = input.length() - pos;
+                size_t take = m_remaining < available ? static_cast<size_t>(m_remaining) : available;
+                
+                payload = input.substr(pos, take);
+                m_remaining -= take;
+                pos += take;
+                
+                if (m_remaining == 0) {
+                    m_state = State::DATA_CR;
+                }
+                // Hand the payload to the caller before decoding further
+                return pos;
+            }
+            
+            case State::DATA_CR:
+                m_state = c == '\r' ? State::DATA_LF : State::ERROR;
+                pos++;
+                break;
+            
+            case State::DATA_LF:
+                if (c == '\n') {
+                    m_state = State::SIZE;
+                    m_sizeDigits = 0;
+                    m_extensionLength = 0;
+                } else {
+                    m_state = State::ERROR;
+                }
+                pos++;
+                break;
+            
+            case State::TRAILER_START:
+                m_state = c == '\r' ? State::FINAL_LF : State::TRAILER_LINE;
+                if (m_state == State::TRAILER_LINE) {
+                    continue;  // Count this byte as part of the trailer line
+                }
+                pos++;
+                break;
+            
+            case State::TRAILER_LINE:
+                // Trailer fields are skipped
+                if (++m_trailerSize > MAX_TRAILER_SIZE) {
+                    m_state = State::ERROR;
+                } else if (c == '\r') {
+                    m_state = State::TRAILER_LF;
+                }
+                pos++;
+                break;
+            
+            case State::TRAILER_LF:
+                m_state = c == '\n' ? State::TRAILER_START : State::ERROR;
+                pos++;
+                break;
+            
+            case State::FINAL_LF:
+                m_state = c == '\n' ? State::DONE : State::ERROR;
+                pos++;
+                break;
+            
+            case State::DONE:
+            case State::ERROR:
+                break;
+        }
+    }
+    
+    return pos;
+}
+
+// ===== HttpInputBuffer =====
+
+HttpInputBuffer::HttpInputBuffer(size_t capacity)
+    : m_data(new char[capacity])
+    , m_capacity(capacity)
+    , m_start(0)
+    , m_end(0)
+{
+}
+
+long HttpInputBuffer::fill(int socket) {
+    if (m_end == m_capacity) {
+        return 0;
+    }
+    
+    ssize_t received = recv(socket, m_data.get() + m_end, m_capacity - m_end, 0);
+    if (received > 0) {
+        m_end += received;
+    }
+    return received;
+}
+
+void HttpInputBuffer::consume(size_t length) {
+    m_start += std::min(length, size());
+    if (m_start == m_end) {
+        m_start = m_end = 0;
+    }
+}
+
+void HttpInputBuffer::compact() {
+    if (m_start > 0) {
+        std::memmove(m_data.get(), m_data.get() + m_start, m_end - m_start);
+        m_end -= m_start;
+        m_start = 0;
+    }
+}
+
+void HttpInputBuffer::truncate(size_t length) {
+    m_end = m_start + std::min(length, size());
+}
\ No newline at end of file
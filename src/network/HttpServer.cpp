@@ -1,20 +1,123 @@
 #include "network/HttpServer.hpp"
 #include "utils/Logger.hpp"
 #include "utils/FileUtils.hpp"
+#include "core/UsbBridge.hpp"
+#include "network/JsonStreamWriter.hpp"
+#include "network/ArchiveStreamer.hpp"
+#include "network/TarStreamReader.hpp"
+#include "network/DavXml.hpp"
 #include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <random>
+#include <set>
 #include <sstream>
-#include <fstream>
 #include <filesystem>
+#include <condition_variable>
+
+const char* const HttpServer::WEB_ROOT = "/web";
+const size_t HttpServer::MAX_HEADER_SIZE = 16 * 1024;
+const size_t HttpServer::MAX_API_BODY_SIZE = 1024 * 1024;
+const int HttpServer::REQUEST_TIMEOUT_SECONDS = 30;
+const size_t HttpServer::SENDFILE_CHUNK_SIZE = 4 * 1024 * 1024;
+const size_t HttpServer::SPLICE_PIPE_SIZE = 256 * 1024;
+const size_t HttpServer::MAX_RANGES_PER_REQUEST = 16;
+const size_t HttpServer::UPLOAD_CHUNK_SIZE = 256 * 1024;
+// Room for a full head plus one read of body data behind it
+const size_t HttpServer::INPUT_BUFFER_SIZE = HttpServer::MAX_HEADER_SIZE + HttpServer::UPLOAD_CHUNK_SIZE;
+const int HttpServer::UPLOAD_BUFFER_WAIT_SECONDS = 60;
+const uint64_t HttpServer::UPLOAD_RESERVATION_STEP = 64 * 1024 * 1024;
+const int HttpServer::EVENT_PING_SECONDS = 30;
+const size_t HttpServer::MAX_EVENT_SUBSCRIBERS = 16;
+const size_t HttpServer::DEFAULT_LISTING_LIMIT = 200;
+const size_t HttpServer::MAX_LISTING_LIMIT = 1000;
+const char* const HttpServer::DAV_PREFIX = "/dav";
+const char* const HttpServer::DAV_METHODS =
+    "OPTIONS, GET, HEAD, PUT, DELETE, PROPFIND, PROPPATCH, MKCOL, COPY, MOVE, LOCK, UNLOCK";
+const int HttpServer::DAV_OPERATION_TIMEOUT_SECONDS = 60;
+const size_t HttpServer::DAV_RESPONSE_CHUNK_SIZE = 64 * 1024;
+
+const uint64_t HttpFileBody::UNTIL_EOF = UINT64_MAX;
+
+namespace {
+
+// Appends rather than returns, so a string kept across requests reuses its capacity
+void appendUrlDecoded(std::string_view text, bool plusAsSpace, std::string& decoded) {
+    for (size_t i = 0; i < text.length(); ++i) {
+        if (text[i] == '%' && i + 2 < text.length() &&
+            std::isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            char hex[3] = {text[i + 1], text[i + 2], '\0'};
+            decoded += static_cast<char>(std::strtol(hex, nullptr, 16));
+            i += 2;
+        } else if (text[i] == '+' && plusAsSpace) {
+            decoded += ' ';
+        } else {
+            decoded += text[i];
+        }
+    }
+}
+
+} // namespace
+
+HttpFileBody::~HttpFileBody() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+std::string_view HttpRequest::header(std::string_view name) const {
+    return parser ? parser->header(name) : std::string_view();
+}
+
+const std::string& HttpRequest::path() const {
+    if (!m_pathDecoded && parser) {
+        m_path.clear();
+        appendUrlDecoded(parser->path(), false, m_path);
+        m_pathDecoded = true;
+    }
+    return m_path;
+}
+
+void HttpRequest::clear() {
+    method = std::string_view();
+    query = std::string_view();
+    version = std::string_view();
+    contentLength = 0;
+    chunked = false;
+    body.clear();
+    parser = nullptr;
+    m_path.clear();
+    m_pathDecoded = false;
+}
 
 HttpServer::HttpServer()
     : m_running(false)
     , m_port(8080)
     , m_directoryListing(true)
     , m_fileDownload(true)
+    , m_keepAliveTimeout(15)
+    , m_maxRequestsPerConnection(100)
+    , m_activeConnections(0)
+    , m_maxConnections(32)
+    , m_requestCount(0)
+    , m_responseCounts{}
+    , m_requestLatency{0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30}
+    , m_davOperationTimeout(DAV_OPERATION_TIMEOUT_SECONDS)
 {
 }
 
@@ -26,16 +129,26 @@ bool HttpServer::initialize(int port) {
     m_port = port;
     
     // Add default API endpoints
-    addApiEndpoint("/status", [this](const std::string& data) {
-        return generateApiResponse("/status", R"({"status": "online", "server": "USB Bridge HTTP"})", 500);
+    addApiEndpoint("/status", [this](const HttpRequest& request) {
+        return generateApiResponse("/status", R"({"status": "online", "server": "USB Bridge HTTP"})", 200);
+    });
+    
+    addApiEndpoint("/files", [this](const HttpRequest& request) {
+        return handleFileListing(request);
     });
     
-    addApiEndpoint("/files", [this](const std::string& data) {
-        // Extract path from headers (simplified)
-        std::string path = "/";
-        return listDirectory(m_documentRoot + path);
+    addApiEndpoint("/archive", [this](const HttpRequest& request) {
+        return handleArchive(request);
     });
     
+    // Web interface is served from memory; a build with embedded assets doesn't need /web at all
+    size_t assetCount = m_assetCache.loadEmbedded();
+    if (assetCount == 0) {
+        assetCount = m_assetCache.loadDirectory(WEB_ROOT);
+    }
+    LOG_INFO("Cached " + std::to_string(assetCount) + " web assets (" +
+             std::to_string(m_assetCache.getMemoryUsage() / 1024) + " KB)", "HTTP");
+    
     LOG_INFO("HTTP server initialized on port " + std::to_string(m_port), "HTTP");
     return true;
 }
@@ -47,7 +160,15 @@ bool HttpServer::start() {
     
     LOG_INFO("Starting HTTP server", "HTTP");
     
+    if (m_bridge) {
+        size_t restored = m_uploads.load(m_bridge->getOperationQueue().getLocalBufferPath());
+        if (restored > 0) {
+            LOG_INFO("Restored " + std::to_string(restored) + " interrupted uploads", "HTTP");
+        }
+    }
+    
     m_running = true;
+    m_eventHub.start();
     m_serverThread = std::thread(&HttpServer::serverLoop, this);
     
     LOG_INFO("HTTP server started on port " + std::to_string(m_port), "HTTP");
@@ -62,27 +183,55 @@ bool HttpServer::stop() {
     LOG_INFO("Stopping HTTP server", "HTTP");
     
     m_running = false;
+    m_eventHub.shutdown();
     
     if (m_serverThread.joinable()) {
         m_serverThread.join();
     }
     
+    // Connection threads use this object until they return: wake the ones waiting on their
+    // client, then wait for all of them, including those finishing a drive operation
+    std::unique_lock<std::mutex> lock(m_connectionMutex);
+    for (int socket : m_connectionSockets) {
+        shutdown(socket, SHUT_RDWR);
+    }
+    while (!m_connectionsClosed.wait_for(lock, std::chrono::seconds(5),
+                                         [this] { return m_connectionSockets.empty(); })) {
+        LOG_WARNING("Waiting for " + std::to_string(m_connectionSockets.size()) + " HTTP connections to finish", "HTTP");
+    }
+    lock.unlock();
+    
     LOG_INFO("HTTP server stopped", "HTTP");
     return true;
 }
 
-void HttpServer::addApiEndpoint(const std::string& path, std::function<std::string(const std::string&)> handler) {
+void HttpServer::addApiEndpoint(const std::string& path, ApiHandler handler) {
     m_apiHandlers[path] = handler;
 }
 
 int HttpServer::getActiveConnections() const {
-    // For simplicity, return 0. In a real implementation, this would track active connections
-    return 0;
+    return m_activeConnections;
 }
 
 uint64_t HttpServer::getRequestCount() const {
-    // For simplicity, return 0. In a real implementation, this would track requests
-    return 0;
+    return m_requestCount.load(std::memory_order_relaxed);
+}
+
+uint64_t HttpServer::getResponseCount(int statusClass) const {
+    if (statusClass < 1 || statusClass > 5) {
+        return 0;
+    }
+    return m_responseCounts[statusClass - 1].load(std::memory_order_relaxed);
+}
+
+void HttpServer::recordRequest(int statusCode, std::chrono::steady_clock::time_point start) {
+    m_requestCount.fetch_add(1, std::memory_order_relaxed);
+    
+    int statusClass = statusCode / 100;
+    if (statusClass >= 1 && statusClass <= 5) {
+        m_responseCounts[statusClass - 1].fetch_add(1, std::memory_order_relaxed);
+    }
+    m_requestLatency.observe(std::chrono::steady_clock::now() - start);
 }
 
 void HttpServer::serverLoop() {
@@ -126,179 +275,2718 @@ void HttpServer::serverLoop() {
             continue;
         }
         
-        // Handle request in a separate thread for simplicity
-        std::thread([this, clientSocket]() {
-            char buffer[4096];
-            int bytesRead = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
-            
-            if (bytesRead > 0) {
-                buffer[bytesRead] = '\0';
-                std::string request(buffer);
-                std::string response = handleRequest(request);
-                
-                send(clientSocket, response.c_str(), response.length(), 0);
+        // Responses go out in a single sendmsg, so Nagle would only add latency
+        setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        
+        bool accepted;
+        {
+            std::lock_guard<std::mutex> lock(m_connectionMutex);
+            accepted = m_connectionSockets.size() < static_cast<size_t>(m_maxConnections);
+            if (accepted) {
+                m_connectionSockets.insert(clientSocket);
             }
-            
+        }
+        if (!accepted) {
+            // A short response fits the socket buffer, so this doesn't hold up accepting
+            HttpResponse response = generateErrorResponse(503);
+            response.headers.emplace_back("Retry-After", "5");
+            sendResponse(clientSocket, response, false);
             close(clientSocket);
-        }).detach();
+            continue;
+        }
+            
+        // Each connection gets its own thread and may carry many requests
+        std::thread(&HttpServer::handleConnection, this, clientSocket).detach();
     }
     
     close(serverSocket);
 }
 
-std::string HttpServer::handleRequest(const std::string& request) {
-    std::istringstream iss(request);
-    std::string method, path, protocol;
-    iss >> method >> path >> protocol;
+void HttpServer::handleConnection(int clientSocket) {
+    m_activeConnections++;
+    
+    std::string remoteAddress;
+    struct sockaddr_in peerAddr;
+    socklen_t peerLen = sizeof(peerAddr);
+    if (getpeername(clientSocket, (struct sockaddr*)&peerAddr, &peerLen) == 0) {
+        char addressText[INET_ADDRSTRLEN];
+        if (inet_ntop(AF_INET, &peerAddr.sin_addr, addressText, sizeof(addressText))) {
+            remoteAddress = addressText;
+        }
+    }
     
-    LOG_DEBUG("HTTP request: " + method + " " + path, "HTTP");
+    // Bytes received but not yet consumed; pipelined requests queue up here and are
+    // parsed in place. The buffer, parser and request are set up once for the life of the
+    // connection, so a request that needs no body or decoding allocates nothing.
+    HttpInputBuffer input(INPUT_BUFFER_SIZE);
+    HttpRequestParser parser(MAX_HEADER_SIZE);
+    HttpRequest request;
+    request.remoteAddress = remoteAddress;
+    int requestsServed = 0;
+    bool keepAlive = true;
     
-    // Handle API requests
-    if (path.find("/api/") == 0) {
-        auto it = m_apiHandlers.find(path);
-        if (it != m_apiHandlers.end()) {
-            return it->second("");
+    while (m_running && keepAlive) {
+        parser.reset();
+        if (!readRequestHead(clientSocket, input, parser, requestsServed == 0)) {
+            break;
+        }
+        
+        auto requestStart = std::chrono::steady_clock::now();
+        
+        if (parser.errorStatus() != 0) {
+            // Unparseable request, the stream position can't be trusted any more
+            LOG_WARNING("Rejected malformed request from " + remoteAddress + " (" +
+                        std::to_string(parser.errorStatus()) + ")", "HTTP");
+            sendResponse(clientSocket, generateErrorResponse(parser.errorStatus()), false);
+            recordRequest(parser.errorStatus(), requestStart);
+            break;
+        }
+        
+        request.clear();
+        request.start = requestStart;
+        populateRequest(parser, request);
+        
+        requestsServed++;
+        keepAlive = wantsKeepAlive(request) && requestsServed < m_maxRequestsPerConnection;
+        
+        // Head plus body bytes, released from the buffer once the response is out
+        size_t requestLength = parser.headLength();
+        
+        if (isEventStreamRequest(request)) {
+            // The event stream keeps the connection until the client goes away
+            streamEvents(clientSocket, request);
+            break;
+        }
+        
+        HttpResponse response;
+        if (isUploadRequest(request)) {
+            // Upload bodies are streamed to the local buffer instead of being read into memory
+            bool bodyConsumed = false;
+            response = handleUpload(clientSocket, input, request, requestLength, bodyConsumed);
+            if (!bodyConsumed) {
+                keepAlive = false;
+            }
+        } else if (isResumableUploadRequest(request)) {
+            bool bodyConsumed = false;
+            response = handleResumableUpload(clientSocket, input, request, requestLength, bodyConsumed);
+            if (!bodyConsumed) {
+                keepAlive = false;
+            }
+        } else if (isWebDavRequest(request) && request.method == "PUT") {
+            bool bodyConsumed = false;
+            response = handleWebDavPut(clientSocket, input, request, requestLength, bodyConsumed);
+            if (!bodyConsumed) {
+                keepAlive = false;
+            }
+        } else if (isWebDavRequest(request)) {
+            if (!readRequestBody(clientSocket, input, request, requestLength)) {
+                break;
+            }
+            response = handleWebDav(request);
         } else {
-            return generateApiResponse("", R"({"error": "API endpoint not found"})", 404);
+            if (!readRequestBody(clientSocket, input, request, requestLength)) {
+                break;
+            }
+            response = handleRequest(request);
+        }
+        
+        response.headOnly = request.method == "HEAD";
+        
+        if (response.file && response.file->length == HttpFileBody::UNTIL_EOF && !response.headOnly) {
+            // Body of unknown length is delimited by closing the connection
+            keepAlive = false;
+        }
+        
+        // HTTP/1.0 has no chunked encoding, so a generated body can only end with the connection
+        bool chunked = request.version == "HTTP/1.1";
+        if (response.stream && !chunked && !response.headOnly) {
+            keepAlive = false;
+        }
+        
+        bool sent = sendResponse(clientSocket, response, keepAlive, chunked);
+        recordRequest(response.statusCode, requestStart);
+        if (!sent) {
+            break;
         }
+        
+        // Whatever follows is the start of the next pipelined request
+        input.consume(requestLength);
     }
     
-    // Handle file requests
-    if (method == "GET") {
-        if (path == "/") {
-            path = "/index.html";
+    m_activeConnections--;
+    
+    // Closed under the lock, so stop() never shuts down a descriptor number already reused.
+    // Nothing of this object is touched once the lock is released.
+    std::lock_guard<std::mutex> lock(m_connectionMutex);
+    m_connectionSockets.erase(clientSocket);
+    close(clientSocket);
+    m_connectionsClosed.notify_all();
+}
+
+bool HttpServer::readRequestHead(int clientSocket, HttpInputBuffer& input, HttpRequestParser& parser,
+                                 bool firstRequest) {
+    // A fresh connection gets the full request timeout, an idle persistent one the keep-alive timeout
+    int timeout = firstRequest ? REQUEST_TIMEOUT_SECONDS : static_cast<int>(m_keepAliveTimeout);
+    
+    // Nothing references the buffer between requests, so leftover pipelined bytes can move
+    // to the front; the head and its body then always have the rest of the buffer to grow into
+    input.compact();
+    
+    // The parser remembers how far it scanned, so each read only looks at the new bytes.
+    // Errors are returned through parser.errorStatus() so the caller can answer them.
+    while (parser.parse(input.view()) == HttpRequestParser::Status::INCOMPLETE) {
+        if (!waitForData(clientSocket, input.empty() ? timeout : REQUEST_TIMEOUT_SECONDS)) {
+            return false;
         }
         
-        return serveFile(path);
+        if (input.fill(clientSocket) <= 0) {
+            return false;
+        }
     }
     
-    // Method not allowed
-    std::string response = "HTTP/1.1 405 Method Not Allowed\r\n";
-    response += "Content-Length: 0\r\n";
-    response += "Connection: close\r\n\r\n";
+    return true;
+}
+
+void HttpServer::populateRequest(const HttpRequestParser& parser, HttpRequest& request) {
+    request.method = parser.method();
+    request.query = parser.query();
+    request.version = parser.version();
+    request.contentLength = parser.contentLength();
+    request.chunked = parser.isChunked();
+    request.parser = &parser;
+}
     
-    return response;
+bool HttpServer::readRequestBody(int clientSocket, HttpInputBuffer& input, HttpRequest& request,
+                                 size_t& requestLength) {
+    if (request.contentLength > MAX_API_BODY_SIZE) {
+        sendResponse(clientSocket, generateErrorResponse(413), false);
+        recordRequest(413, request.start);
+        return false;
+    }
+    
+    if (request.contentLength == 0 && !request.chunked) {
+        return true;
+    }
+    
+    // The length of a chunked body is only known once it has arrived
+    bool tooLarge = false;
+    bool success = readBody(clientSocket, input, request, requestLength, [&](std::string_view data) {
+        if (request.body.length() + data.length() > MAX_API_BODY_SIZE) {
+            tooLarge = true;
+            return false;
+        }
+        request.body.append(data.data(), data.length());
+        return true;
+    });
+        
+    if (tooLarge) {
+        sendResponse(clientSocket, generateErrorResponse(413), false);
+        recordRequest(413, request.start);
+    }
+    return success;
 }
 
-std::string HttpServer::serveFile(const std::string& path) {
-    std::string fullPath;
+bool HttpServer::readBody(int clientSocket, HttpInputBuffer& input, const HttpRequest& request,
+                          size_t& requestLength, const std::function<bool(std::string_view)>& sink) {
+    // Body bytes are received into the buffer behind the head, which has to stay where it
+    // is because the request's header views point into it. Once everything behind the head
+    // has been handed to the sink that space is reused for the next read.
+    size_t headLength = requestLength;
+    size_t cursor = headLength;
+    uint64_t remaining = request.contentLength;
+    ChunkedDecoder decoder;
     
-    // Serve web interface files from /web directory
-    if (path.find("/css/") == 0 || path.find("/js/") == 0 || path == "/index.html") {
-        fullPath = "/web" + path;
+    while (request.chunked ? !decoder.done() : remaining > 0) {
+        if (cursor == input.size()) {
+            input.truncate(headLength);
+            cursor = headLength;
+            
+            if (!waitForData(clientSocket, REQUEST_TIMEOUT_SECONDS) || input.fill(clientSocket) <= 0) {
+                return false;
+            }
+        }
+        
+        std::string_view available = input.view().substr(cursor);
+        
+        if (request.chunked) {
+            std::string_view payload;
+            cursor += decoder.decode(available, payload);
+            
+            if (decoder.failed()) {
+                LOG_WARNING("Malformed chunked body from " + request.remoteAddress, "HTTP");
+                return false;
+            }
+            if (!payload.empty() && !sink(payload)) {
+                return false;
+            }
+        } else {
+            size_t take = static_cast<size_t>(std::min<uint64_t>(remaining, available.length()));
+            if (!sink(available.substr(0, take))) {
+                return false;
+            }
+            cursor += take;
+            remaining -= take;
+        }
+    }
+    
+    requestLength = cursor;
+    return true;
+}
+
+bool HttpServer::waitForData(int clientSocket, int timeoutSeconds) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeoutSeconds);
+    
+    // Wake up periodically so stop() doesn't wait out idle keep-alive connections
+    while (m_running) {
+        struct pollfd pfd = {clientSocket, POLLIN, 0};
+        int result = poll(&pfd, 1, 500);
+        
+        if (result > 0) {
+            return true;
+        }
+        if (result < 0 && errno != EINTR) {
+            return false;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+    }
+    
+    return false;
+}
+
+bool HttpServer::wantsKeepAlive(const HttpRequest& request) const {
+    std::string connection(request.header("connection"));
+    std::transform(connection.begin(), connection.end(), connection.begin(), ::tolower);
+    
+    if (request.version == "HTTP/1.0") {
+        return connection.find("keep-alive") != std::string::npos;
+    }
+    return connection.find("close") == std::string::npos;
+}
+
+bool HttpServer::sendResponse(int clientSocket, const HttpResponse& response, bool keepAlive, bool chunked) {
+    std::string head = "HTTP/1.1 " + std::to_string(response.statusCode) + " " +
+                       getStatusText(response.statusCode) + "\r\n";
+    
+    if (!response.contentType.empty()) {
+        head += "Content-Type: " + response.contentType + "\r\n";
+    }
+    for (const auto& header : response.headers) {
+        head += header.first + ": " + header.second + "\r\n";
+    }
+    
+    const std::string& body = response.sharedBody ? *response.sharedBody : response.body;
+    
+    if (response.statusCode == 304 || response.statusCode == 204) {
+        // No body and no Content-Length; for 304 it would describe the unsent representation
+    } else if (response.stream) {
+        if (chunked) {
+            head += "Transfer-Encoding: chunked\r\n";
+        }
+    } else if (!response.file) {
+        head += "Content-Length: " + std::to_string(body.length()) + "\r\n";
+    } else if (response.file->length != HttpFileBody::UNTIL_EOF) {
+        head += "Content-Length: " + std::to_string(response.file->length) + "\r\n";
+    }
+    
+    if (keepAlive) {
+        head += "Connection: keep-alive\r\n";
+        head += "Keep-Alive: timeout=" + std::to_string(m_keepAliveTimeout) +
+                ", max=" + std::to_string(m_maxRequestsPerConnection) + "\r\n";
     } else {
-        // Serve files from document root (USB storage)
-        fullPath = m_documentRoot + path;
+        head += "Connection: close\r\n";
     }
+    head += "\r\n";
     
-    // Security check - prevent directory traversal
-    std::string normalizedPath = std::filesystem::weakly_canonical(fullPath).string();
-    if (normalizedPath.find(m_documentRoot) != 0 && normalizedPath.find("/web") != 0) {
-        std::string response = "HTTP/1.1 403 Forbidden\r\n";
-        response += "Content-Length: 0\r\n";
-        response += "Connection: close\r\n\r\n";
-        return response;
+    if (response.headOnly) {
+        return sendAll(clientSocket, head.data(), head.length());
     }
     
-    if (!std::filesystem::exists(fullPath)) {
-        std::string response = "HTTP/1.1 404 Not Found\r\n";
-        response += "Content-Type: text/html\r\n";
-        response += "Connection: close\r\n\r\n";
-        response += "<html><body><h1>404 Not Found</h1></body></html>";
-        return response;
+    // Header and body leave in one segment where possible
+    struct iovec iov[2];
+    iov[0].iov_base = const_cast<char*>(head.data());
+    iov[0].iov_len = head.length();
+    iov[1].iov_base = const_cast<char*>(body.data());
+    iov[1].iov_len = body.length();
+    
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = body.empty() ? 1 : 2;
+    
+    // With a file body following, let the kernel merge the header into the first data segment
+    int flags = MSG_NOSIGNAL | (response.file || response.stream ? MSG_MORE : 0);
+    
+    ssize_t sent = sendmsg(clientSocket, &msg, flags);
+    if (sent < 0) {
+        return false;
     }
     
-    if (std::filesystem::is_directory(fullPath)) {
-        if (m_directoryListing) {
-            return listDirectory(fullPath);
+    size_t total = head.length() + body.length();
+    if (static_cast<size_t>(sent) < total) {
+        // Partial write, finish the remainder
+        if (static_cast<size_t>(sent) < head.length()) {
+            if (!sendAll(clientSocket, head.data() + sent, head.length() - sent) ||
+                !sendAll(clientSocket, body.data(), body.length())) {
+                return false;
+            }
         } else {
-            std::string response = "HTTP/1.1 403 Forbidden\r\n";
-            response += "Content-Length: 0\r\n";
-            response += "Connection: close\r\n\r\n";
-            return response;
+            size_t bodySent = sent - head.length();
+            if (!sendAll(clientSocket, body.data() + bodySent, body.length() - bodySent)) {
+                return false;
+            }
         }
     }
     
-    // Serve file
-    std::ifstream file(fullPath, std::ios::binary);
-    if (!file.is_open()) {
-        std::string response = "HTTP/1.1 500 Internal Server Error\r\n";
-        response += "Content-Length: 0\r\n";
-        response += "Connection: close\r\n\r\n";
-        return response;
+    if (response.file) {
+        return sendFileBody(clientSocket, *response.file);
+    }
+    if (response.stream) {
+        return sendStreamBody(clientSocket, response, chunked);
     }
     
-    std::ostringstream content;
-    content << file.rdbuf();
-    std::string fileContent = content.str();
+    return true;
+}
+
+bool HttpServer::sendStreamBody(int clientSocket, const HttpResponse& response, bool chunked) {
+    HttpBodyWriter body;
     
-    std::string mimeType = FileUtils::getMimeType(fullPath);
+    body.write = [&](const char* data, size_t length) {
+        if (length == 0) {
+            return true;  // An empty chunk would end the body
+        }
+        return chunked ? sendChunk(clientSocket, data, length) : sendAll(clientSocket, data, length);
+    };
     
-    std::string response = "HTTP/1.1 200 OK\r\n";
-    response += "Content-Type: " + mimeType + "\r\n";
-    response += "Content-Length: " + std::to_string(fileContent.length()) + "\r\n";
-    response += "Connection: close\r\n\r\n";
-    response += fileContent;
+    body.writeFile = [&](const HttpFileBody& file, uint64_t offset, uint64_t length) {
+        if (length == 0) {
+            return true;
+        }
+        if (!chunked) {
+            return sendFileSpan(clientSocket, file, offset, length);
+        }
+        
+        // The chunk frame is corked onto the file data so it doesn't go out as its own segment
+        char size[24];
+        int sizeLength = snprintf(size, sizeof(size), "%llx\r\n", static_cast<unsigned long long>(length));
+        return sendAll(clientSocket, size, sizeLength, MSG_MORE) &&
+               sendFileSpan(clientSocket, file, offset, length) &&
+               sendAll(clientSocket, "\r\n", 2, MSG_MORE);
+    };
     
-    return response;
+    if (!response.stream(body)) {
+        return false;
+    }
+    return !chunked || sendAll(clientSocket, "0\r\n\r\n", 5);
 }
 
-std::string HttpServer::listDirectory(const std::string& path) {
-    std::ostringstream html;
+bool HttpServer::sendChunk(int clientSocket, const char* data, size_t length) {
+    char size[24];
+    int sizeLength = snprintf(size, sizeof(size), "%zx\r\n", length);
     
-    html << "HTTP/1.1 200 OK\r\n";
-    html << "Content-Type: text/html\r\n";
-    html << "Connection: close\r\n\r\n";
+    // Size line, data and terminator leave in one call; the data is never copied
+    struct iovec iov[3];
+    iov[0].iov_base = size;
+    iov[0].iov_len = sizeLength;
+    iov[1].iov_base = const_cast<char*>(data);
+    iov[1].iov_len = length;
+    iov[2].iov_base = const_cast<char*>("\r\n");
+    iov[2].iov_len = 2;
     
-    html << "<!DOCTYPE html>\n";
-    html << "<html><head><title>Directory Listing</title>";
-    html << "<style>body{font-family:Arial,sans-serif;margin:20px;} ";
-    html << "table{border-collapse:collapse;width:100%;} ";
-    html << "th,td{border:1px solid #ddd;padding:8px;text-align:left;} ";
-    html << "th{background-color:#f2f2f2;}</style></head>\n";
-    html << "<body><h1>Directory Listing</h1>\n";
-    html << "<table><tr><th>Name</th><th>Size</th><th>Modified</th></tr>\n";
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 3;
     
-    try {
-        for (const auto& entry : std::filesystem::directory_iterator(path)) {
-            std::string name = entry.path().filename().string();
-            std::string size = entry.is_directory() ? "-" : FileUtils::formatFileSize(entry.file_size());
-            std::string modified = FileUtils::formatTime(FileUtils::getLastModifiedTime(entry.path().string()));
+    ssize_t sent;
+    do {
+        sent = sendmsg(clientSocket, &msg, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    if (sent < 0) {
+        return false;
+    }
+    
+    // Partial write, finish whatever is left of each piece
+    size_t skip = sent;
+    for (const auto& part : iov) {
+        if (skip >= part.iov_len) {
+            skip -= part.iov_len;
+            continue;
+        }
+        if (!sendAll(clientSocket, static_cast<const char*>(part.iov_base) + skip, part.iov_len - skip)) {
+            return false;
+        }
+        skip = 0;
+    }
+    return true;
+}
+
+bool HttpServer::sendFileBody(int clientSocket, const HttpFileBody& file) {
+    if (file.parts.empty()) {
+        return sendFileSpan(clientSocket, file, file.offset, file.length);
+    }
+    
+    // multipart/byteranges: each part header is followed by its slice of the file
+    for (const auto& part : file.parts) {
+        if (!sendAll(clientSocket, part.header.data(), part.header.length(), MSG_MORE) ||
+            !sendFileSpan(clientSocket, file, part.offset, part.length)) {
+            return false;
+        }
+    }
+    
+    return sendAll(clientSocket, file.trailer.data(), file.trailer.length());
+}
+
+bool HttpServer::sendFileSpan(int clientSocket, const HttpFileBody& file, uint64_t start, uint64_t length) {
+    uint64_t remaining = length;
+    
+    // Regular files go straight from the page cache to the socket
+    if (file.regular) {
+        off_t offset = static_cast<off_t>(start);
+        
+        while (remaining > 0) {
+            // A download from a drive handed over to this client counts as its activity
+            if (m_bridge && !file.leaseClientId.empty()) {
+                m_bridge->renewDirectAccess(file.leaseClientId);
+            }
             
-            html << "<tr>";
-            html << "<td>";
-            if (entry.is_directory()) {
-                html << "📁 ";
-            } else {
-                html << "📄 ";
+            size_t chunk = static_cast<size_t>(std::min<uint64_t>(remaining, SENDFILE_CHUNK_SIZE));
+            ssize_t sent = sendfile(clientSocket, file.fd, &offset, chunk);
+            
+            if (sent < 0) {
+                if (errno == EINTR || errno == EAGAIN) continue;
+                if ((errno == EINVAL || errno == ENOSYS) && remaining == length) {
+                    // Filesystem without sendfile support, splice from the same offset instead
+                    break;
+                }
+                LOG_WARNING("sendfile failed: " + std::string(strerror(errno)), "HTTP");
+                return false;
             }
-            html << "<a href=\"" << name;
-            if (entry.is_directory()) html << "/";
-            html << "\">" << name << "</a></td>";
-            html << "<td>" << size << "</td>";
-            html << "<td>" << modified << "</td>";
-            html << "</tr>\n";
+            if (sent == 0) {
+                LOG_WARNING("File truncated while being sent", "HTTP");
+                return false;
+            }
+            remaining -= sent;
+        }
+        
+        if (remaining == 0) {
+            return true;
+        }
+        
+        if (lseek(file.fd, static_cast<off_t>(start), SEEK_SET) < 0) {
+            return false;
         }
-    } catch (const std::exception& e) {
-        html << "<tr><td colspan=\"3\">Error reading directory: " << e.what() << "</td></tr>\n";
     }
     
-    html << "</table></body></html>";
+    return spliceFileBody(clientSocket, file.fd, remaining);
+}
+
+bool HttpServer::spliceFileBody(int clientSocket, int sourceFd, uint64_t length) {
+    // Pipes, devices and filesystems without sendfile move through a kernel pipe,
+    // which also bounds the memory used by this connection to the pipe capacity
+    int pipeFds[2];
+    if (pipe2(pipeFds, O_CLOEXEC) < 0) {
+        LOG_ERROR("Failed to create splice pipe: " + std::string(strerror(errno)), "HTTP");
+        return false;
+    }
+    fcntl(pipeFds[1], F_SETPIPE_SZ, static_cast<int>(SPLICE_PIPE_SIZE));
+    
+    bool success = true;
+    bool untilEof = length == HttpFileBody::UNTIL_EOF;
+    
+    while (untilEof || length > 0) {
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(length, SPLICE_PIPE_SIZE));
+        ssize_t filled = splice(sourceFd, nullptr, pipeFds[1], nullptr, chunk, SPLICE_F_MOVE | SPLICE_F_MORE);
+        
+        if (filled < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            LOG_WARNING("splice from source failed: " + std::string(strerror(errno)), "HTTP");
+            success = false;
+            break;
+        }
+        if (filled == 0) {
+            success = untilEof;
+            break;
+        }
+        
+        ssize_t pending = filled;
+        while (pending > 0) {
+            ssize_t drained = splice(pipeFds[0], nullptr, clientSocket, nullptr, pending, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (drained < 0) {
+                if (errno == EINTR || errno == EAGAIN) continue;
+                success = false;
+                break;
+            }
+            pending -= drained;
+        }
+        
+        if (!success) {
+            break;
+        }
+        if (!untilEof) {
+            length -= filled;
+        }
+    }
     
-    return html.str();
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+    return success;
+}
+
+bool HttpServer::sendAll(int clientSocket, const char* data, size_t length, int flags) {
+    while (length > 0) {
+        ssize_t sent = send(clientSocket, data, length, MSG_NOSIGNAL | flags);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        length -= sent;
+    }
+    return true;
+}
+
+bool HttpServer::isEventStreamRequest(const HttpRequest& request) const {
+    return request.method == "GET" && request.path() == "/api/events";
 }
 
-std::string HttpServer::generateApiResponse(const std::string& endpoint, const std::string& data, int statusCode) {
-    std::string statusText = "OK";
-    if (statusCode == 404) statusText = "Not Found";
-    else if (statusCode == 500) statusText = "Internal Server Error";
+void HttpServer::streamEvents(int clientSocket, const HttpRequest& request) {
+    // Counted and registered in one step, so concurrent requests can't overshoot the limit
+    auto subscriber = m_eventHub.subscribe(MAX_EVENT_SUBSCRIBERS);
+    if (!subscriber) {
+        sendResponse(clientSocket, generateApiResponse("/events", R"({"error": "Too many event streams"})", 503), false);
+        return;
+    }
+    
+    // The body has no length; it ends when either side closes the connection
+    std::string head = "HTTP/1.1 200 OK\r\n"
+                       "Content-Type: text/event-stream\r\n"
+                       "Cache-Control: no-cache\r\n"
+                       "Access-Control-Allow-Origin: *\r\n"
+                       "Connection: close\r\n"
+                       "\r\n"
+                       "retry: 5000\n\n";
+    if (!sendAll(clientSocket, head.data(), head.length())) {
+        m_eventHub.unsubscribe(subscriber);
+        return;
+    }
     
-    std::string response = "HTTP/1.1 " + std::to_string(statusCode) + " " + statusText + "\r\n";
-    response += "Content-Type: application/json\r\n";
-    response += "Access-Control-Allow-Origin: *\r\n";
-    response += "Content-Length: " + std::to_string(data.length()) + "\r\n";
-    response += "Connection: close\r\n\r\n";
-    response += data;
+    LOG_DEBUG("Event stream opened for " + request.remoteAddress, "HTTP");
     
-    return response;
+    // Nothing is sent while nothing changes apart from an occasional comment,
+    // which keeps idle NAT mappings alive and notices clients that have gone
+    while (m_running) {
+        std::string events = m_eventHub.waitForEvents(subscriber, std::chrono::seconds(EVENT_PING_SECONDS));
+        if (!m_running) {
+            break;
+        }
+        if (events.empty()) {
+            events = ": ping\n\n";
+        }
+        if (!sendAll(clientSocket, events.data(), events.length())) {
+            break;
+        }
+    }
+    
+    m_eventHub.unsubscribe(subscriber);
+    LOG_DEBUG("Event stream closed for " + request.remoteAddress, "HTTP");
+}
+
+bool HttpServer::isUploadRequest(const HttpRequest& request) const {
+    return (request.method == "PUT" || request.method == "POST") && request.path() == "/api/upload";
+}
+
+HttpResponse HttpServer::handleUpload(int clientSocket, HttpInputBuffer& input, const HttpRequest& request,
+                                      size_t& requestLength, bool& bodyConsumed) {
+    if (!m_bridge || m_documentRoot.empty()) {
+        return generateApiResponse("/upload", R"({"error": "Uploads are not available"})", 503);
+    }
+    
+    if (!request.chunked && request.header("content-length").empty()) {
+        return generateApiResponse("/upload", R"({"error": "Content-Length required"})", 411);
+    }
+    
+    std::string extract = getQueryParameter(request.query, "extract");
+    if (extract == "tar") {
+        return handleArchiveUpload(clientSocket, input, request, requestLength, bodyConsumed);
+    }
+    if (!extract.empty()) {
+        return generateApiResponse("/upload", R"({"error": "Unsupported archive format"})", 400);
+    }
+    
+    std::string destPath = resolveDrivePath(getQueryParameter(request.query, "path"));
+    if (destPath.empty() || destPath == m_documentRoot) {
+        return generateApiResponse("/upload", R"({"error": "Invalid upload path"})", 400);
+    }
+    
+    if (!std::filesystem::is_directory(std::filesystem::path(destPath).parent_path())) {
+        return generateApiResponse("/upload", R"({"error": "Parent directory does not exist"})", 409);
+    }
+    
+    std::string clientId = "http_" + request.remoteAddress;
+    std::string bufferPath;
+    uint64_t received = 0;
+    
+    int status = bufferRequestBody(clientSocket, input, request, requestLength, clientId, bufferPath, received);
+    if (status != 0) {
+        LOG_WARNING("Upload to " + destPath + " aborted", "HTTP");
+        if (status == 507) {
+            return generateApiResponse("/upload", R"({"error": "Insufficient buffer space"})", 507);
+        }
+        if (status == 400) {
+            return generateApiResponse("/upload", R"({"error": "Upload incomplete"})", 400);
+        }
+        return generateErrorResponse(status);
+    }
+    
+    bodyConsumed = true;
+    
+    uint64_t operationId = m_bridge->clientWriteFile(clientId, usb_bridge::ClientType::NETWORK_HTTP,
+                                                     bufferPath, destPath, received);
+    
+    LOG_INFO("Upload of " + std::to_string(received) + " bytes buffered for " + destPath +
+             " (operation #" + std::to_string(operationId) + ")", "HTTP");
+    
+    std::string relativePath = destPath.substr(m_documentRoot.length());
+    return generateApiResponse("/upload", "{\"operationId\": " + std::to_string(operationId) +
+                               ", \"path\": \"" + jsonEscape(relativePath) + "\"" +
+                               ", \"size\": " + std::to_string(received) + "}", 202);
+}
+
+HttpResponse HttpServer::handleArchiveUpload(int clientSocket, HttpInputBuffer& input, const HttpRequest& request,
+                                             size_t& requestLength, bool& bodyConsumed) {
+    std::string destRoot = resolveDrivePath(getQueryParameter(request.query, "path"));
+    if (destRoot.empty()) {
+        return generateApiResponse("/upload", R"({"error": "Invalid upload path"})", 400);
+    }
+    if (!std::filesystem::is_directory(destRoot)) {
+        return generateApiResponse("/upload", R"({"error": "Target directory does not exist"})", 404);
+    }
+    
+    std::string clientId = "http_" + request.remoteAddress;
+    auto& queue = m_bridge->getOperationQueue();
+    
+    // Every file gets its own buffer, sized from its tar header, and its contents are written
+    // there as they come off the socket. Nothing reaches the write queue until the whole
+    // archive has arrived intact, so a broken upload never leaves half a tree on the drive.
+    std::vector<usb_bridge::WriteBatchItem> files;
+    std::set<std::string> directories;
+    uint64_t totalSize = 0;
+    int fd = -1;
+    bool outOfSpace = false;
+    
+    auto addParents = [&](const std::string& path) {
+        for (size_t slash = path.find('/'); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+            directories.insert(path.substr(0, slash));
+        }
+    };
+    
+    TarStreamReader reader(
+        [&](const TarStreamReader::Entry& entry) {
+            addParents(entry.path);
+            if (entry.isDirectory) {
+                directories.insert(entry.path);
+                return true;
+            }
+            
+            std::string bufferPath = waitForBufferSpace(clientId, entry.size);
+            if (bufferPath.empty()) {
+                outOfSpace = true;
+                return false;
+            }
+            files.push_back({bufferPath, destRoot + "/" + entry.path, entry.size, false});
+            totalSize += entry.size;
+            
+            fd = open(bufferPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                return false;
+            }
+            if (entry.size > 0) {
+                posix_fallocate(fd, 0, entry.size);
+            }
+            return true;
+        },
+        [&](std::string_view data) {
+            if (!writeAll(fd, data.data(), data.length())) {
+                LOG_ERROR("Failed to write upload to buffer: " + std::string(strerror(errno)), "HTTP");
+                return false;
+            }
+            return true;
+        },
+        [&]() {
+            int result = close(fd);
+            fd = -1;
+            return result == 0;
+        });
+    
+    if (request.header("expect") == "100-continue") {
+        static const char continueResponse[] = "HTTP/1.1 100 Continue\r\n\r\n";
+        sendAll(clientSocket, continueResponse, sizeof(continueResponse) - 1);
+    }
+    
+    bool success = readBody(clientSocket, input, request, requestLength, [&](std::string_view data) {
+        return reader.feed(data);
+    });
+    
+    if (fd >= 0) {
+        close(fd);
+    }
+    
+    if (!success || !reader.isComplete()) {
+        LOG_WARNING("Archive upload to " + destRoot + " aborted" +
+                    (reader.getError().empty() ? "" : ": " + reader.getError()), "HTTP");
+        for (const auto& file : files) {
+            queue.releaseLocalBuffer(file.localPath, file.fileSize);
+        }
+        
+        if (outOfSpace) {
+            return generateApiResponse("/upload", R"({"error": "Insufficient buffer space"})", 507);
+        }
+        if (!reader.getError().empty()) {
+            return generateApiResponse("/upload", "{\"error\": \"" + jsonEscape(reader.getError()) + "\"}", 400);
+        }
+        return generateApiResponse("/upload", R"({"error": "Upload incomplete"})", 400);
+    }
+    
+    bodyConsumed = true;
+    
+    size_t fileCount = files.size();
+    std::vector<usb_bridge::WriteBatchItem> items = std::move(files);
+    for (const auto& directory : directories) {
+        items.push_back({"", destRoot + "/" + directory, 0, true});
+    }
+    
+    if (!items.empty()) {
+        m_bridge->clientWriteBatch(clientId, usb_bridge::ClientType::NETWORK_HTTP, std::move(items));
+    }
+    
+    LOG_INFO("Archive upload of " + std::to_string(fileCount) + " files (" + std::to_string(totalSize) +
+             " bytes) buffered for " + destRoot, "HTTP");
+    
+    std::string relativePath = destRoot.substr(m_documentRoot.length());
+    return generateApiResponse("/upload", "{\"files\": " + std::to_string(fileCount) +
+                               ", \"directories\": " + std::to_string(directories.size()) +
+                               ", \"size\": " + std::to_string(totalSize) +
+                               ", \"path\": \"" + jsonEscape(relativePath.empty() ? "/" : relativePath) + "\"}", 202);
+}
+
+bool HttpServer::isResumableUploadRequest(const HttpRequest& request) const {
+    return request.path() == "/api/uploads" || request.path().compare(0, 13, "/api/uploads/") == 0;
+}
+
+HttpResponse HttpServer::handleResumableUpload(int clientSocket, HttpInputBuffer& input, const HttpRequest& request,
+                                               size_t& requestLength, bool& bodyConsumed) {
+    // tus 1.0 core protocol with the creation and termination extensions. Only PATCH
+    // carries data; anything sent with the other methods is left unread.
+    bodyConsumed = request.contentLength == 0 && !request.chunked;
+    std::string id = request.path().length() > 13 ? request.path().substr(13) : "";
+    
+    HttpResponse response;
+    if (!m_bridge || m_documentRoot.empty()) {
+        response = generateApiResponse("/uploads", R"({"error": "Uploads are not available"})", 503);
+    } else if (id.empty() && request.method == "OPTIONS") {
+        response = generateErrorResponse(204);
+        response.headers.emplace_back("Tus-Version", "1.0.0");
+        response.headers.emplace_back("Tus-Extension", "creation,termination");
+    } else if (id.empty() && request.method == "POST") {
+        response = createResumableUpload(request);
+    } else if (id.empty() || id.find('/') != std::string::npos) {
+        response = generateErrorResponse(id.empty() ? 405 : 404);
+    } else if (request.method == "PATCH") {
+        response = appendResumableUpload(clientSocket, input, request, requestLength, bodyConsumed, id);
+    } else if (request.method == "HEAD") {
+        UploadSessionStore::Session session;
+        if (!m_uploads.get(id, session)) {
+            response = generateErrorResponse(404);
+        } else {
+            response = generateErrorResponse(200);
+            response.headers.emplace_back("Upload-Offset", std::to_string(session.offset));
+            response.headers.emplace_back("Upload-Length", std::to_string(session.length));
+            response.headers.emplace_back("Cache-Control", "no-store");
+        }
+    } else if (request.method == "DELETE") {
+        UploadSessionStore::Session session;
+        auto claim = m_uploads.claim(id, session);
+        if (claim == UploadSessionStore::Claim::CLAIMED) {
+            m_uploads.remove(id);
+            m_bridge->getOperationQueue().releaseLocalBuffer(session.bufferPath, session.reserved);
+            LOG_INFO("Upload " + id + " to " + session.destPath + " cancelled", "HTTP");
+            response = generateErrorResponse(204);
+        } else {
+            response = generateErrorResponse(claim == UploadSessionStore::Claim::BUSY ? 423 : 404);
+        }
+    } else {
+        response = generateErrorResponse(405);
+    }
+    
+    response.headers.emplace_back("Tus-Resumable", "1.0.0");
+    response.headers.emplace_back("Access-Control-Expose-Headers", "Location, Upload-Offset, Upload-Length, Tus-Resumable");
+    return response;
+}
+
+HttpResponse HttpServer::createResumableUpload(const HttpRequest& request) {
+    auto& queue = m_bridge->getOperationQueue();
+    
+    // Sessions the client never came back for give their buffer space back
+    for (const auto& expired : m_uploads.takeExpired()) {
+        LOG_INFO("Upload " + expired.id + " to " + expired.destPath + " expired", "HTTP");
+        queue.releaseLocalBuffer(expired.bufferPath, expired.reserved);
+    }
+    
+    std::string lengthHeader(request.header("upload-length"));
+    if (lengthHeader.empty() || lengthHeader.length() > 19 ||
+        lengthHeader.find_first_not_of("0123456789") != std::string::npos) {
+        return generateApiResponse("/uploads", R"({"error": "Upload-Length required"})", 400);
+    }
+    uint64_t length = std::stoull(lengthHeader);
+    
+    std::string destPath = resolveDrivePath(getQueryParameter(request.query, "path"));
+    if (destPath.empty() || destPath == m_documentRoot || destPath.find('\n') != std::string::npos) {
+        return generateApiResponse("/uploads", R"({"error": "Invalid upload path"})", 400);
+    }
+    if (!std::filesystem::is_directory(std::filesystem::path(destPath).parent_path())) {
+        return generateApiResponse("/uploads", R"({"error": "Parent directory does not exist"})", 409);
+    }
+    
+    // The whole upload is reserved now, so a client that got this far can't run out of
+    // buffer halfway through
+    std::string clientId = "http_" + request.remoteAddress;
+    std::string bufferPath = waitForBufferSpace(clientId, length);
+    if (bufferPath.empty()) {
+        LOG_WARNING("No buffer space for upload of " + std::to_string(length) + " bytes to " + destPath, "HTTP");
+        return generateApiResponse("/uploads", R"({"error": "Insufficient buffer space"})", 507);
+    }
+    
+    int fd = open(bufferPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        queue.releaseLocalBuffer(bufferPath, length);
+        return generateErrorResponse(500);
+    }
+    if (length > 0) {
+        // Claim the blocks without growing the file, whose size is the upload offset
+        fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, length);
+    }
+    close(fd);
+    
+    UploadSessionStore::Session session;
+    session.clientId = clientId;
+    session.bufferPath = bufferPath;
+    session.destPath = destPath;
+    session.length = length;
+    session.reserved = length;
+    
+    if (!m_uploads.create(session)) {
+        LOG_ERROR("Failed to persist upload session for " + destPath, "HTTP");
+        queue.releaseLocalBuffer(bufferPath, length);
+        return generateErrorResponse(500);
+    }
+    
+    LOG_INFO("Upload " + session.id + " of " + std::to_string(length) + " bytes to " + destPath + " created", "HTTP");
+    
+    std::string relativePath = destPath.substr(m_documentRoot.length());
+    HttpResponse response = generateApiResponse("/uploads", "{\"id\": \"" + session.id + "\"" +
+                                                ", \"path\": \"" + jsonEscape(relativePath) + "\"}", 201);
+    response.headers.emplace_back("Location", "/api/uploads/" + session.id);
+    response.headers.emplace_back("Upload-Offset", "0");
+    
+    if (length == 0) {
+        // Nothing to send, the upload is complete as it stands
+        m_uploads.claim(session.id, session);
+        commitResumableUpload(session);
+    }
+    return response;
+}
+
+HttpResponse HttpServer::appendResumableUpload(int clientSocket, HttpInputBuffer& input, const HttpRequest& request,
+                                               size_t& requestLength, bool& bodyConsumed, const std::string& id) {
+    if (request.header("content-type") != "application/offset+octet-stream") {
+        return generateErrorResponse(415);
+    }
+    
+    std::string offsetHeader(request.header("upload-offset"));
+    if (offsetHeader.empty() || offsetHeader.length() > 19 ||
+        offsetHeader.find_first_not_of("0123456789") != std::string::npos) {
+        return generateApiResponse("/uploads", R"({"error": "Upload-Offset required"})", 400);
+    }
+    
+    UploadSessionStore::Session session;
+    auto claim = m_uploads.claim(id, session);
+    if (claim != UploadSessionStore::Claim::CLAIMED) {
+        return generateErrorResponse(claim == UploadSessionStore::Claim::BUSY ? 423 : 404);
+    }
+    
+    auto conflict = [&](int statusCode) {
+        m_uploads.release(session);
+        HttpResponse response = generateErrorResponse(statusCode);
+        response.headers.emplace_back("Upload-Offset", std::to_string(session.offset));
+        return response;
+    };
+    
+    // The client resumes from what it last heard; it has to ask again if that is stale
+    if (std::stoull(offsetHeader) != session.offset) {
+        return conflict(409);
+    }
+    uint64_t remaining = session.length - session.offset;
+    if (!request.chunked && request.contentLength > remaining) {
+        return conflict(413);
+    }
+    
+    // Sessions restored after a restart only hold the space their data already takes
+    if (session.reserved < session.length) {
+        if (!waitForBufferResize(session.bufferPath, session.reserved, session.length)) {
+            m_uploads.release(session);
+            return generateApiResponse("/uploads", R"({"error": "Insufficient buffer space"})", 507);
+        }
+        session.reserved = session.length;
+    }
+    
+    int fd = open(session.bufferPath.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0 || lseek(fd, session.offset, SEEK_SET) < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        m_uploads.release(session);
+        return generateErrorResponse(500);
+    }
+    
+    if (request.header("expect") == "100-continue") {
+        static const char continueResponse[] = "HTTP/1.1 100 Continue\r\n\r\n";
+        sendAll(clientSocket, continueResponse, sizeof(continueResponse) - 1);
+    }
+    
+    uint64_t received = 0;
+    bool tooLarge = false;
+    
+    bool success = readBody(clientSocket, input, request, requestLength, [&](std::string_view data) {
+        if (received + data.length() > remaining) {
+            tooLarge = true;
+            return false;
+        }
+        if (!writeAll(fd, data.data(), data.length())) {
+            LOG_ERROR("Failed to write upload to buffer: " + std::string(strerror(errno)), "HTTP");
+            return false;
+        }
+        received += data.length();
+        return true;
+    });
+    
+    // Whatever arrived is kept, also when the connection dropped halfway. It is on disk
+    // before the new offset is reported, so the offset still holds after a power cut.
+    fdatasync(fd);
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+        session.offset = std::min<uint64_t>(st.st_size, session.length);
+    }
+    close(fd);
+    
+    bodyConsumed = success;
+    
+    if (session.offset == session.length) {
+        uint64_t operationId = commitResumableUpload(session);
+        LOG_INFO("Upload " + id + " complete, queued as operation #" + std::to_string(operationId), "HTTP");
+    } else {
+        m_uploads.release(session);
+    }
+    
+    HttpResponse response = generateErrorResponse(success ? 204 : (tooLarge ? 413 : 400));
+    response.headers.emplace_back("Upload-Offset", std::to_string(session.offset));
+    return response;
+}
+
+uint64_t HttpServer::commitResumableUpload(const UploadSessionStore::Session& session) {
+    m_uploads.remove(session.id);
+    
+    if (session.reserved > session.length) {
+        m_bridge->getOperationQueue().resizeLocalBuffer(session.bufferPath, session.reserved, session.length);
+    }
+    return m_bridge->clientWriteFile(session.clientId, usb_bridge::ClientType::NETWORK_HTTP,
+                                     session.bufferPath, session.destPath, session.length);
+}
+
+bool HttpServer::isWebDavRequest(const HttpRequest& request) const {
+    return isDavPath(request.path());
+}
+
+bool HttpServer::isDavPath(const std::string& path) {
+    size_t prefixLength = strlen(DAV_PREFIX);
+    return path.compare(0, prefixLength, DAV_PREFIX) == 0 &&
+           (path.length() == prefixLength || path[prefixLength] == '/');
+}
+
+HttpResponse HttpServer::handleWebDav(const HttpRequest& request) {
+    if (m_documentRoot.empty()) {
+        return generateErrorResponse(503);
+    }
+    if (request.method == "OPTIONS") {
+        return davOptions();
+    }
+    
+    std::string drivePath = resolveDavPath(request.path());
+    if (drivePath.empty()) {
+        return generateErrorResponse(403);
+    }
+    
+    if (request.method == "GET" || request.method == "HEAD") {
+        return davGet(request, drivePath);
+    }
+    if (request.method == "PROPFIND") {
+        return davPropfind(request, drivePath);
+    }
+    
+    // Everything else changes the drive and goes through the bridge's queue
+    if (!m_bridge) {
+        return generateErrorResponse(503);
+    }
+    if (request.method == "PROPPATCH") {
+        return davProppatch(request, drivePath);
+    }
+    if (request.method == "MKCOL") {
+        return davMkcol(request, drivePath);
+    }
+    if (request.method == "DELETE") {
+        return davDelete(request, drivePath);
+    }
+    if (request.method == "COPY" || request.method == "MOVE") {
+        return davCopyMove(request, drivePath, request.method == "MOVE");
+    }
+    if (request.method == "LOCK") {
+        return davLock(request, drivePath);
+    }
+    if (request.method == "UNLOCK") {
+        return davUnlock(request, drivePath);
+    }
+    
+    HttpResponse response = generateErrorResponse(405);
+    response.headers.emplace_back("Allow", DAV_METHODS);
+    return response;
+}
+
+HttpResponse HttpServer::handleWebDavPut(int clientSocket, HttpInputBuffer& input, const HttpRequest& request,
+                                         size_t& requestLength, bool& bodyConsumed) {
+    if (!m_bridge || m_documentRoot.empty()) {
+        return generateErrorResponse(503);
+    }
+    if (!request.chunked && request.header("content-length").empty()) {
+        return generateErrorResponse(411);
+    }
+    if (!request.header("content-range").empty()) {
+        // A partial PUT would be taken for the whole file; resumable uploads use /api/uploads
+        return generateErrorResponse(400);
+    }
+    
+    std::string drivePath = resolveDavPath(request.path());
+    if (drivePath.empty()) {
+        return generateErrorResponse(403);
+    }
+    
+    struct stat st;
+    bool exists = findDavPending(drivePath, st) || stat(drivePath.c_str(), &st) == 0;
+    if (exists && S_ISDIR(st.st_mode)) {
+        return generateErrorResponse(405);
+    }
+    if (!std::filesystem::is_directory(std::filesystem::path(drivePath).parent_path())) {
+        return generateErrorResponse(409);
+    }
+    if (!isDavWriteAllowed(request, drivePath, false, !exists)) {
+        return davError(423, "lock-token-submitted");
+    }
+    
+    // Same path into the buffer as /api/upload; the client gets its answer as soon as the
+    // body is stored, and the file shows up in PROPFIND and GET from the buffer until written
+    std::string clientId = "webdav_" + request.remoteAddress;
+    std::string bufferPath;
+    uint64_t size = 0;
+    
+    int status = bufferRequestBody(clientSocket, input, request, requestLength, clientId, bufferPath, size);
+    if (status != 0) {
+        LOG_WARNING("WebDAV upload to " + drivePath + " aborted", "HTTP");
+        return generateErrorResponse(status);
+    }
+    
+    bodyConsumed = true;
+    queueDavWrite(clientId, bufferPath, drivePath, size);
+    
+    LOG_INFO("WebDAV upload of " + std::to_string(size) + " bytes buffered for " + drivePath, "HTTP");
+    return generateErrorResponse(exists ? 204 : 201);
+}
+
+HttpResponse HttpServer::davOptions() {
+    HttpResponse response;
+    response.headers.emplace_back("DAV", "1, 2");
+    response.headers.emplace_back("Allow", DAV_METHODS);
+    // Windows' WebDAV redirector only writes to servers announcing this
+    response.headers.emplace_back("MS-Author-Via", "DAV");
+    return response;
+}
+
+HttpResponse HttpServer::davGet(const HttpRequest& request, const std::string& drivePath) {
+    if (!m_fileDownload) {
+        return generateErrorResponse(403);
+    }
+    
+    std::string bufferPath;
+    {
+        std::lock_guard<std::mutex> lock(m_davMutex);
+        auto it = m_davPending.find(drivePath);
+        if (it != m_davPending.end()) {
+            bufferPath = it->second.bufferPath;
+        }
+    }
+    
+    // A file that hasn't reached the drive yet is sent from its buffer, on the same zero-copy path
+    if (!bufferPath.empty()) {
+        HttpResponse response = serveLocalFile(bufferPath, drivePath, request);
+        if (response.statusCode < 400) {
+            return response;
+        }
+        // Written out and released in the meantime
+    }
+    return serveLocalFile(drivePath, drivePath, request);
+}
+
+HttpResponse HttpServer::davPropfind(const HttpRequest& request, const std::string& drivePath) {
+    std::string depth(request.header("depth"));
+    if (depth != "0" && depth != "1") {
+        // Depth infinity (also the default) would walk the whole drive for one response
+        return davError(403, "propfind-finite-depth");
+    }
+    
+    struct stat st;
+    if (!findDavPending(drivePath, st) && stat(drivePath.c_str(), &st) != 0) {
+        return generateErrorResponse(404);
+    }
+    bool isCollection = S_ISDIR(st.st_mode);
+    
+    // Members come from the listing cache, with buffered PUTs laid over them
+    std::shared_ptr<const DirectoryListingCache::Listing> listing;
+    std::map<std::string, DavPendingWrite> pending;
+    if (isCollection && depth == "1") {
+        listing = m_listingCache.get(drivePath);
+        if (!listing) {
+            return generateErrorResponse(403);
+        }
+        
+        std::string prefix = drivePath + "/";
+        std::lock_guard<std::mutex> lock(m_davMutex);
+        for (auto it = m_davPending.lower_bound(prefix);
+             it != m_davPending.end() && it->first.compare(0, prefix.length(), prefix) == 0; ++it) {
+            if (it->first.find('/', prefix.length()) == std::string::npos &&
+                access(it->second.bufferPath.c_str(), F_OK) == 0) {
+                pending.emplace(it->first.substr(prefix.length()), it->second);
+            }
+        }
+    }
+    
+    DirectoryListingCache::Entry self;
+    self.name = std::filesystem::path(drivePath).filename().string();
+    self.size = st.st_size;
+    self.modified = st.st_mtim.tv_sec;
+    self.modifiedNsec = st.st_mtim.tv_nsec;
+    self.inode = st.st_ino;
+    self.isDirectory = isCollection;
+    
+    std::string root = std::filesystem::weakly_canonical(m_documentRoot).string();
+    std::string href = davHref(drivePath, isCollection);
+    auto locks = m_davLocks.getLocks(drivePath, depth == "1");
+    
+    HttpResponse response;
+    response.statusCode = 207;
+    response.contentType = "application/xml; charset=utf-8";
+    
+    // Large folders are written out in pieces while the listing is walked
+    response.stream = [listing, pending, locks, self, href, drivePath, root](const HttpBodyWriter& body) mutable {
+        auto lockDiscovery = [&](const std::string& path) {
+            std::vector<DavLockManager::Lock> applying;
+            for (const auto& lock : locks) {
+                if (lock.path == path ||
+                    (lock.infinite && path.compare(0, lock.path.length() + 1, lock.path + "/") == 0)) {
+                    applying.push_back(lock);
+                }
+            }
+            return davLockDiscovery(applying, root);
+        };
+        
+        std::string xml = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<D:multistatus xmlns:D=\"DAV:\">";
+        appendDavResponse(xml, href, self, lockDiscovery(drivePath));
+        
+        if (listing) {
+            for (const auto& member : listing->getEntries()) {
+                DirectoryListingCache::Entry entry = member;
+                auto buffered = pending.find(entry.name);
+                if (buffered != pending.end()) {
+                    entry = {entry.name, buffered->second.size, buffered->second.modified, 0, 0, false};
+                    pending.erase(buffered);
+                }
+                
+                appendDavResponse(xml, href + DavXml::encodeHref(entry.name) + (entry.isDirectory ? "/" : ""),
+                                  entry, lockDiscovery(drivePath + "/" + entry.name));
+                
+                if (xml.length() >= DAV_RESPONSE_CHUNK_SIZE) {
+                    if (!body.write(xml.data(), xml.length())) {
+                        return false;
+                    }
+                    xml.clear();
+                }
+            }
+            
+            for (const auto& [name, write] : pending) {
+                DirectoryListingCache::Entry entry = {name, write.size, write.modified, 0, 0, false};
+                appendDavResponse(xml, href + DavXml::encodeHref(name), entry, lockDiscovery(drivePath + "/" + name));
+            }
+        }
+        
+        xml += "</D:multistatus>";
+        return body.write(xml.data(), xml.length());
+    };
+    
+    return response;
+}
+
+void HttpServer::appendDavResponse(std::string& xml, const std::string& href,
+                                   const DirectoryListingCache::Entry& entry, const std::string& lockDiscovery) {
+    xml += "<D:response><D:href>";
+    xml += href;
+    xml += "</D:href><D:propstat><D:prop>";
+    
+    if (entry.isDirectory) {
+        xml += "<D:resourcetype><D:collection/></D:resourcetype>";
+    } else {
+        xml += "<D:resourcetype/><D:getcontentlength>";
+        xml += std::to_string(entry.size);
+        xml += "</D:getcontentlength><D:getcontenttype>";
+        xml += DavXml::escape(FileUtils::getMimeType(entry.name));
+        xml += "</D:getcontenttype><D:getetag>";
+        xml += DavXml::escape(formatETag(entry.inode, entry.modified, entry.modifiedNsec, entry.size));
+        xml += "</D:getetag>";
+    }
+    
+    // FAT's creation time isn't exposed through stat, the modification time stands in for it
+    time_t modified = static_cast<time_t>(entry.modified);
+    struct tm tm;
+    gmtime_r(&modified, &tm);
+    char created[32];
+    strftime(created, sizeof(created), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    
+    xml += "<D:getlastmodified>";
+    xml += formatHttpDate(modified);
+    xml += "</D:getlastmodified><D:creationdate>";
+    xml += created;
+    xml += "</D:creationdate>";
+    xml += "<D:supportedlock>"
+           "<D:lockentry><D:lockscope><D:exclusive/></D:lockscope><D:locktype><D:write/></D:locktype></D:lockentry>"
+           "<D:lockentry><D:lockscope><D:shared/></D:lockscope><D:locktype><D:write/></D:locktype></D:lockentry>"
+           "</D:supportedlock>";
+    xml += lockDiscovery;
+    xml += "</D:prop><D:status>HTTP/1.1 200 OK</D:status></D:propstat></D:response>";
+}
+
+HttpResponse HttpServer::davProppatch(const HttpRequest& request, const std::string& drivePath) {
+    struct stat st;
+    if (!findDavPending(drivePath, st) && stat(drivePath.c_str(), &st) != 0) {
+        return generateErrorResponse(404);
+    }
+    if (!isDavWriteAllowed(request, drivePath, false, false)) {
+        return davError(423, "lock-token-submitted");
+    }
+    
+    // FAT has nowhere to keep dead properties. Clients set them to carry timestamps and
+    // attributes along (Windows' Win32LastModifiedTime and friends) and take a refusal for
+    // a failed copy, so they are acknowledged and dropped.
+    std::string xml = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<D:multistatus xmlns:D=\"DAV:\"><D:response><D:href>" +
+                      davHref(drivePath, S_ISDIR(st.st_mode)) + "</D:href><D:propstat><D:prop>";
+    
+    int index = 0;
+    for (const auto& name : DavXml::propertyNames(request.body)) {
+        if (name.namespaceUri.empty()) {
+            xml += "<" + name.localName + " xmlns=\"\"/>";
+        } else {
+            std::string prefix = "ns" + std::to_string(index++);
+            xml += "<" + prefix + ":" + name.localName + " xmlns:" + prefix + "=\"" +
+                   DavXml::escape(name.namespaceUri) + "\"/>";
+        }
+    }
+    xml += "</D:prop><D:status>HTTP/1.1 200 OK</D:status></D:propstat></D:response></D:multistatus>";
+    
+    HttpResponse response;
+    response.statusCode = 207;
+    response.contentType = "application/xml; charset=utf-8";
+    response.body = xml;
+    return response;
+}
+
+HttpResponse HttpServer::davMkcol(const HttpRequest& request, const std::string& drivePath) {
+    if (!request.body.empty()) {
+        return generateErrorResponse(415);
+    }
+    
+    struct stat st;
+    if (findDavPending(drivePath, st) || stat(drivePath.c_str(), &st) == 0) {
+        return generateErrorResponse(405);
+    }
+    
+    std::string parent = std::filesystem::path(drivePath).parent_path().string();
+    if (!std::filesystem::is_directory(parent)) {
+        return generateErrorResponse(409);
+    }
+    if (!isDavWriteAllowed(request, drivePath, false, true)) {
+        return davError(423, "lock-token-submitted");
+    }
+    
+    std::string clientId = "webdav_" + request.remoteAddress;
+    DavResult result = waitForOperations(1, [&](const OperationCallback& done) {
+        m_bridge->clientCreateDirectory(clientId, usb_bridge::ClientType::NETWORK_HTTP, drivePath, done);
+    });
+    
+    // FAT's two-second mtime can hide the change from the cache's revalidation
+    m_listingCache.invalidate(parent);
+    return generateErrorResponse(davResultStatus(result, 201));
+}
+
+HttpResponse HttpServer::davDelete(const HttpRequest& request, const std::string& drivePath) {
+    std::string root = std::filesystem::weakly_canonical(m_documentRoot).string();
+    if (drivePath == root) {
+        return generateErrorResponse(403);
+    }
+    
+    struct stat st;
+    if (!findDavPending(drivePath, st) && stat(drivePath.c_str(), &st) != 0) {
+        return generateErrorResponse(404);
+    }
+    if (!isDavWriteAllowed(request, drivePath, true, true)) {
+        return davError(423, "lock-token-submitted");
+    }
+    
+    // The queue runs in order, so a buffered PUT of the same file is written before this deletes it
+    std::string clientId = "webdav_" + request.remoteAddress;
+    DavResult result = waitForOperations(1, [&](const OperationCallback& done) {
+        m_bridge->clientDeleteFile(clientId, usb_bridge::ClientType::NETWORK_HTTP, drivePath, done);
+    });
+    
+    if (result == DavResult::COMPLETED) {
+        m_davLocks.removeTree(drivePath);
+    }
+    m_listingCache.invalidate(std::filesystem::path(drivePath).parent_path().string());
+    return generateErrorResponse(davResultStatus(result, 204));
+}
+
+HttpResponse HttpServer::davCopyMove(const HttpRequest& request, const std::string& drivePath, bool move) {
+    std::string destination(request.header("destination"));
+    if (destination.empty()) {
+        return generateErrorResponse(400);
+    }
+    
+    // An absolute URI, or just its path from clients that leave out the authority
+    size_t scheme = destination.find("://");
+    if (scheme != std::string::npos) {
+        size_t pathStart = destination.find('/', scheme + 3);
+        destination = pathStart == std::string::npos ? "/" : destination.substr(pathStart);
+    }
+    destination = urlDecode(destination.substr(0, destination.find_first_of("?#")), false);
+    
+    if (!isDavPath(destination)) {
+        // Somewhere this server doesn't serve
+        return generateErrorResponse(502);
+    }
+    
+    std::string destPath = resolveDavPath(destination);
+    std::string root = std::filesystem::weakly_canonical(m_documentRoot).string();
+    
+    struct stat st;
+    if (!findDavPending(drivePath, st) && stat(drivePath.c_str(), &st) != 0) {
+        return generateErrorResponse(404);
+    }
+    bool isCollection = S_ISDIR(st.st_mode);
+    
+    if (destPath.empty() || destPath == root || destPath == drivePath || (move && drivePath == root) ||
+        (isCollection && destPath.compare(0, drivePath.length() + 1, drivePath + "/") == 0)) {
+        return generateErrorResponse(403);
+    }
+    
+    std::string destParent = std::filesystem::path(destPath).parent_path().string();
+    if (!std::filesystem::is_directory(destParent)) {
+        return generateErrorResponse(409);
+    }
+    
+    struct stat destSt;
+    bool destExists = findDavPending(destPath, destSt) || stat(destPath.c_str(), &destSt) == 0;
+    if (destExists && request.header("overwrite") == "F") {
+        return generateErrorResponse(412);
+    }
+    
+    if ((move && !isDavWriteAllowed(request, drivePath, true, true)) ||
+        !isDavWriteAllowed(request, destPath, true, true)) {
+        return davError(423, "lock-token-submitted");
+    }
+    
+    std::string clientId = "webdav_" + request.remoteAddress;
+    
+    // A copy is read in completely before the destination goes, so failing to read it loses nothing
+    auto copyItems = std::make_shared<std::vector<usb_bridge::WriteBatchItem>>();
+    if (!move && !bufferDavCopy(clientId, drivePath, destPath, request.header("depth") != "0", *copyItems)) {
+        LOG_WARNING("WebDAV COPY " + drivePath + " could not be buffered", "HTTP");
+        return generateErrorResponse(davResultStatus(DavResult::FAILED, 201));
+    }
+    size_t transferCount = move ? 1 : copyItems->size();
+    
+    DavResult result;
+    if (!destExists) {
+        result = waitForOperations(transferCount, [&](const OperationCallback& done) {
+            submitDavTransfer(clientId, drivePath, destPath, move, copyItems, done);
+        });
+    } else {
+        // Overwrite replaces the destination instead of merging into it. The copy or move is
+        // submitted from the delete's completion, so it still follows the delete when that is
+        // only done after the client has been answered with 202.
+        result = waitForOperations(1 + transferCount, [&](const OperationCallback& done) {
+            m_bridge->clientDeleteFile(clientId, usb_bridge::ClientType::NETWORK_HTTP, destPath,
+                [this, clientId, drivePath, destPath, move, copyItems, transferCount, done](
+                    const usb_bridge::FileOperation& op) {
+                    done(op);
+                    if (op.status == usb_bridge::OperationStatus::COMPLETED) {
+                        m_davLocks.removeTree(destPath);
+                        submitDavTransfer(clientId, drivePath, destPath, move, copyItems, done);
+                        return;
+                    }
+    
+                    // The destination is still there, so the copy is dropped and counted as failed
+                    LOG_WARNING("WebDAV overwrite of " + destPath + " failed: " + op.errorMessage, "HTTP");
+                    releaseDavCopy(*copyItems);
+                    for (size_t i = 0; i < transferCount; i++) {
+                        done(op);
+                    }
+                });
+        });
+    }
+    
+    LOG_INFO("WebDAV " + std::string(request.method) + " " + drivePath + " -> " + destPath, "HTTP");
+    
+    m_listingCache.invalidate(destParent);
+    if (move) {
+        m_listingCache.invalidate(std::filesystem::path(drivePath).parent_path().string());
+    }
+    return generateErrorResponse(davResultStatus(result, destExists ? 204 : 201));
+}
+
+bool HttpServer::bufferDavCopy(const std::string& clientId, const std::string& source, const std::string& dest,
+                               bool recursive, std::vector<usb_bridge::WriteBatchItem>& items) {
+    auto& queue = m_bridge->getOperationQueue();
+    
+    // The copy is read into local buffers and written back through the queue like an upload
+    auto bufferFile = [&](const std::string& from, const std::string& to) {
+        std::error_code error;
+        uint64_t size = std::filesystem::file_size(from, error);
+        if (error) {
+            return false;
+        }
+        
+        std::string bufferPath = waitForBufferSpace(clientId, size);
+        if (bufferPath.empty()) {
+            return false;
+        }
+        if (!std::filesystem::copy_file(from, bufferPath, std::filesystem::copy_options::overwrite_existing, error)) {
+            queue.releaseLocalBuffer(bufferPath, size);
+            return false;
+        }
+        items.push_back({bufferPath, to, size, false});
+        return true;
+    };
+    
+    std::string pendingBuffer;
+    {
+        std::lock_guard<std::mutex> lock(m_davMutex);
+        auto it = m_davPending.find(source);
+        if (it != m_davPending.end()) {
+            pendingBuffer = it->second.bufferPath;
+        }
+    }
+    
+    bool success = true;
+    if (!std::filesystem::is_directory(source)) {
+        // A file still in the buffer is copied from there, unless it was written out meanwhile
+        success = (!pendingBuffer.empty() && bufferFile(pendingBuffer, dest)) || bufferFile(source, dest);
+    } else {
+        items.push_back({"", dest, 0, true});
+        
+        std::error_code error;
+        if (recursive) {
+            for (auto it = std::filesystem::recursive_directory_iterator(source, error);
+                 !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+                std::string to = dest + it->path().string().substr(source.length());
+                if (it->is_directory(error)) {
+                    items.push_back({"", to, 0, true});
+                } else if (it->is_regular_file(error) && !bufferFile(it->path().string(), to)) {
+                    success = false;
+                    break;
+                }
+            }
+        }
+        success = success && !error;
+    }
+    
+    if (!success) {
+        releaseDavCopy(items);
+        items.clear();
+    }
+    return success;
+}
+
+void HttpServer::releaseDavCopy(const std::vector<usb_bridge::WriteBatchItem>& items) {
+    auto& queue = m_bridge->getOperationQueue();
+    for (const auto& item : items) {
+        if (!item.isDirectory) {
+            queue.releaseLocalBuffer(item.localPath, item.fileSize);
+        }
+    }
+}
+
+void HttpServer::submitDavTransfer(const std::string& clientId, const std::string& source, const std::string& dest,
+                                   bool move, const std::shared_ptr<std::vector<usb_bridge::WriteBatchItem>>& copyItems,
+                                   const OperationCallback& done) {
+    if (!move) {
+        m_bridge->clientWriteBatch(clientId, usb_bridge::ClientType::NETWORK_HTTP, std::move(*copyItems), done);
+        return;
+    }
+    
+    m_bridge->clientMoveFile(clientId, usb_bridge::ClientType::NETWORK_HTTP, source, dest,
+        [this, source, done](const usb_bridge::FileOperation& op) {
+            // Locks stay with the URL they were taken on, which no longer exists
+            if (op.status == usb_bridge::OperationStatus::COMPLETED) {
+                m_davLocks.removeTree(source);
+            }
+            done(op);
+        });
+}
+
+HttpResponse HttpServer::davLock(const HttpRequest& request, const std::string& drivePath) {
+    // "Second-n" or "Infinite", possibly several to choose from; either way capped
+    uint32_t timeout = DavLockManager::DEFAULT_TIMEOUT_SECONDS;
+    std::string timeoutHeader(request.header("timeout"));
+    size_t seconds = timeoutHeader.find("Second-");
+    if (seconds != std::string::npos) {
+        unsigned long long requested = std::strtoull(timeoutHeader.c_str() + seconds + 7, nullptr, 10);
+        if (requested > 0) {
+            timeout = static_cast<uint32_t>(std::min<unsigned long long>(requested, DavLockManager::MAX_TIMEOUT_SECONDS));
+        }
+    } else if (timeoutHeader.find("Infinite") != std::string::npos) {
+        timeout = DavLockManager::MAX_TIMEOUT_SECONDS;
+    }
+    
+    std::string root = std::filesystem::weakly_canonical(m_documentRoot).string();
+    HttpResponse response;
+    response.contentType = "application/xml; charset=utf-8";
+    
+    if (request.body.empty()) {
+        // Refresh, the lock is named by the token in the If header
+        std::string_view ifHeader = request.header("if");
+        size_t start = ifHeader.find("<opaquelocktoken:");
+        size_t end = start == std::string_view::npos ? start : ifHeader.find('>', start);
+        if (end == std::string_view::npos) {
+            return generateErrorResponse(400);
+        }
+        
+        DavLockManager::Lock lock;
+        if (!m_davLocks.refresh(std::string(ifHeader.substr(start + 1, end - start - 1)), timeout, lock)) {
+            return davError(412, "lock-token-matches-request-uri");
+        }
+        response.body = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<D:prop xmlns:D=\"DAV:\">" +
+                        davLockDiscovery({lock}, root) + "</D:prop>";
+        return response;
+    }
+    
+    bool found;
+    std::string_view lockInfo = DavXml::findElement(request.body, "lockinfo", found);
+    if (!found || !DavXml::hasElement(lockInfo, "write")) {
+        return generateErrorResponse(400);
+    }
+    
+    DavLockManager::Lock lock;
+    lock.path = drivePath;
+    lock.exclusive = !DavXml::hasElement(lockInfo, "shared");
+    lock.infinite = request.header("depth") != "0";
+    lock.timeoutSeconds = timeout;
+    
+    // The owner is echoed back in lockdiscovery. Only a plain href or text is kept, any
+    // other markup would carry namespace prefixes declared in the client's document.
+    std::string_view owner = DavXml::findElement(lockInfo, "owner", found);
+    if (found) {
+        std::string_view href = DavXml::findElement(owner, "href", found);
+        if (found && href.find('<') == std::string_view::npos) {
+            lock.owner = "<D:href>" + std::string(href) + "</D:href>";
+        } else if (owner.find('<') == std::string_view::npos) {
+            lock.owner = std::string(owner);
+        }
+    }
+    
+    struct stat st;
+    bool exists = findDavPending(drivePath, st) || stat(drivePath.c_str(), &st) == 0;
+    if (!exists && !std::filesystem::is_directory(std::filesystem::path(drivePath).parent_path())) {
+        return generateErrorResponse(409);
+    }
+    
+    if (!m_davLocks.lock(lock)) {
+        return davError(423, "no-conflicting-lock");
+    }
+    
+    if (!exists) {
+        // Locking an unmapped URL creates an empty file (RFC 4918 7.3), written like a PUT
+        std::string clientId = "webdav_" + request.remoteAddress;
+        std::string bufferPath = waitForBufferSpace(clientId, 0);
+        int fd = bufferPath.empty() ? -1 : open(bufferPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            if (!bufferPath.empty()) {
+                m_bridge->getOperationQueue().releaseLocalBuffer(bufferPath, 0);
+            }
+            m_davLocks.unlock(drivePath, lock.token);
+            return generateErrorResponse(507);
+        }
+        close(fd);
+        
+        queueDavWrite(clientId, bufferPath, drivePath, 0);
+        response.statusCode = 201;
+    }
+    
+    LOG_INFO("WebDAV " + std::string(lock.exclusive ? "exclusive" : "shared") + " lock on " + drivePath +
+             " for " + request.remoteAddress, "HTTP");
+    
+    response.headers.emplace_back("Lock-Token", "<" + lock.token + ">");
+    response.body = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<D:prop xmlns:D=\"DAV:\">" +
+                    davLockDiscovery({lock}, root) + "</D:prop>";
+    return response;
+}
+
+HttpResponse HttpServer::davUnlock(const HttpRequest& request, const std::string& drivePath) {
+    std::string token(request.header("lock-token"));
+    if (token.length() > 2 && token.front() == '<' && token.back() == '>') {
+        token = token.substr(1, token.length() - 2);
+    }
+    if (token.empty()) {
+        return generateErrorResponse(400);
+    }
+    
+    if (!m_davLocks.unlock(drivePath, token)) {
+        return davError(409, "lock-token-matches-request-uri");
+    }
+    return generateErrorResponse(204);
+}
+
+HttpServer::DavResult HttpServer::waitForOperations(size_t count,
+                                                    const std::function<void(const OperationCallback&)>& submit) {
+    // WebDAV clients take a change as done once it is answered, so unlike uploads these
+    // wait for the queue. The state is shared with the callbacks, which can outlive a wait
+    // that timed out.
+    struct Completion {
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t remaining;
+        bool failed = false;
+    };
+    auto completion = std::make_shared<Completion>();
+    completion->remaining = count;
+    
+    submit([completion](const usb_bridge::FileOperation& op) {
+        std::lock_guard<std::mutex> lock(completion->mutex);
+        if (op.status != usb_bridge::OperationStatus::COMPLETED) {
+            completion->failed = true;
+        }
+        if (completion->remaining > 0 && --completion->remaining == 0) {
+            completion->done.notify_all();
+        }
+    });
+    
+    std::unique_lock<std::mutex> lock(completion->mutex);
+    if (!completion->done.wait_for(lock, std::chrono::seconds(m_davOperationTimeout.load()),
+                                   [&] { return completion->remaining == 0; })) {
+        return DavResult::PENDING;
+    }
+    return completion->failed ? DavResult::FAILED : DavResult::COMPLETED;
+}
+
+void HttpServer::queueDavWrite(const std::string& clientId, const std::string& bufferPath,
+                               const std::string& drivePath, uint64_t size) {
+    {
+        std::lock_guard<std::mutex> lock(m_davMutex);
+        m_davPending[drivePath] = {bufferPath, size, time(nullptr)};
+    }
+    
+    m_bridge->clientWriteFile(clientId, usb_bridge::ClientType::NETWORK_HTTP, bufferPath, drivePath, size,
+        [this, bufferPath, drivePath](const usb_bridge::FileOperation& op) {
+            if (op.status != usb_bridge::OperationStatus::COMPLETED) {
+                // The drive doesn't have it, so the buffer stays the only copy and keeps being
+                // served until the queue discards the failed operation
+                LOG_ERROR("WebDAV write of " + drivePath + " failed: " + op.errorMessage, "HTTP");
+                return;
+            }
+            
+            // The overlay entry goes once the drive has the file; a listing cached meanwhile
+            // may not, FAT's mtime being too coarse to tell
+            m_listingCache.invalidate(std::filesystem::path(drivePath).parent_path().string());
+            
+            // A later PUT of the same path has replaced the entry with its own buffer
+            std::lock_guard<std::mutex> lock(m_davMutex);
+            auto it = m_davPending.find(drivePath);
+            if (it != m_davPending.end() && it->second.bufferPath == bufferPath) {
+                m_davPending.erase(it);
+            }
+        });
+}
+
+bool HttpServer::findDavPending(const std::string& drivePath, struct stat& st) {
+    std::lock_guard<std::mutex> lock(m_davMutex);
+    auto it = m_davPending.find(drivePath);
+    if (it == m_davPending.end()) {
+        return false;
+    }
+    if (access(it->second.bufferPath.c_str(), F_OK) != 0) {
+        // A failed write whose buffer the queue has since discarded
+        m_davPending.erase(it);
+        return false;
+    }
+    
+    st = {};
+    st.st_mode = S_IFREG | 0644;
+    st.st_size = it->second.size;
+    st.st_mtim.tv_sec = it->second.modified;
+    return true;
+}
+
+bool HttpServer::isDavWriteAllowed(const HttpRequest& request, const std::string& drivePath,
+                                   bool includeDescendants, bool changesMembership) {
+    std::string_view ifHeader = request.header("if");
+    if (!m_davLocks.isAllowed(drivePath, ifHeader, includeDescendants)) {
+        return false;
+    }
+    
+    // Adding or removing a member also needs the token of a lock on the collection itself
+    return !changesMembership ||
+           m_davLocks.isAllowed(std::filesystem::path(drivePath).parent_path().string(), ifHeader, false);
+}
+
+std::string HttpServer::resolveDavPath(const std::string& path) const {
+    std::string relative = path.substr(std::min(path.length(), strlen(DAV_PREFIX)));
+    
+    // Collections are addressed with or without their trailing slash
+    while (relative.length() > 1 && relative.back() == '/') {
+        relative.pop_back();
+    }
+    return resolveDrivePath(relative.empty() ? "/" : relative);
+}
+
+std::string HttpServer::davHref(const std::string& drivePath, bool isCollection) const {
+    std::string root = std::filesystem::weakly_canonical(m_documentRoot).string();
+    std::string href = DAV_PREFIX + drivePath.substr(std::min(root.length(), drivePath.length()));
+    if (isCollection && href.back() != '/') {
+        href += '/';
+    }
+    return DavXml::encodeHref(href);
+}
+
+HttpResponse HttpServer::davError(int statusCode, const std::string& condition) {
+    // Precondition and postcondition codes (RFC 4918 section 16)
+    HttpResponse response;
+    response.statusCode = statusCode;
+    response.contentType = "application/xml; charset=utf-8";
+    response.body = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<D:error xmlns:D=\"DAV:\"><D:" + condition +
+                    "/></D:error>";
+    return response;
+}
+
+std::string HttpServer::davLockDiscovery(const std::vector<DavLockManager::Lock>& locks, const std::string& root) {
+    auto now = std::chrono::steady_clock::now();
+    
+    std::string xml = "<D:lockdiscovery>";
+    for (const auto& lock : locks) {
+        auto remaining = std::chrono::ceil<std::chrono::seconds>(lock.expires - now).count();
+        
+        xml += "<D:activelock><D:locktype><D:write/></D:locktype><D:lockscope>";
+        xml += lock.exclusive ? "<D:exclusive/>" : "<D:shared/>";
+        xml += "</D:lockscope><D:depth>";
+        xml += lock.infinite ? "infinity" : "0";
+        xml += "</D:depth>";
+        if (!lock.owner.empty()) {
+            xml += "<D:owner>" + lock.owner + "</D:owner>";
+        }
+        xml += "<D:timeout>Second-" + std::to_string(std::max<long long>(remaining, 0)) + "</D:timeout>";
+        xml += "<D:locktoken><D:href>" + lock.token + "</D:href></D:locktoken>";
+        xml += "<D:lockroot><D:href>" + DavXml::encodeHref(DAV_PREFIX + lock.path.substr(root.length())) +
+               "</D:href></D:lockroot>";
+        xml += "</D:activelock>";
+    }
+    xml += "</D:lockdiscovery>";
+    return xml;
+}
+
+int HttpServer::davResultStatus(DavResult result, int successStatus) {
+    switch (result) {
+        case DavResult::COMPLETED: return successStatus;
+        case DavResult::PENDING:   return 202;   // Still queued, it will happen
+        default:                   return 500;
+    }
+}
+
+int HttpServer::bufferRequestBody(int clientSocket, HttpInputBuffer& input, const HttpRequest& request,
+                                  size_t& requestLength, const std::string& clientId,
+                                  std::string& bufferPath, uint64_t& size) {
+    auto& queue = m_bridge->getOperationQueue();
+    
+    // Reserve the whole body in the local buffer, or the first step of a chunked body whose
+    // size isn't known. While the buffer is full we stop reading the socket, so the client
+    // is held back by TCP flow control rather than by our memory.
+    uint64_t reserved = request.chunked ? UPLOAD_RESERVATION_STEP : request.contentLength;
+    bufferPath = waitForBufferSpace(clientId, reserved);
+    
+    if (bufferPath.empty()) {
+        LOG_WARNING("No buffer space for upload of " + std::to_string(reserved) + " bytes", "HTTP");
+        return 507;
+    }
+    
+    int fd = open(bufferPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        queue.releaseLocalBuffer(bufferPath, reserved);
+        bufferPath.clear();
+        return 500;
+    }
+    
+    if (!request.chunked && reserved > 0) {
+        // Claim the blocks up front so the file doesn't fragment as it grows
+        posix_fallocate(fd, 0, reserved);
+    }
+    
+    if (request.header("expect") == "100-continue") {
+        static const char continueResponse[] = "HTTP/1.1 100 Continue\r\n\r\n";
+        sendAll(clientSocket, continueResponse, sizeof(continueResponse) - 1);
+    }
+    
+    uint64_t received = 0;
+    bool outOfSpace = false;
+    
+    bool success = readBody(clientSocket, input, request, requestLength, [&](std::string_view data) {
+        if (received + data.length() > reserved) {
+            // Chunked body outgrew its reservation, extend it a step at a time
+            uint64_t newSize = std::max(reserved + UPLOAD_RESERVATION_STEP, received + data.length());
+            if (!waitForBufferResize(bufferPath, reserved, newSize)) {
+                outOfSpace = true;
+                return false;
+            }
+            reserved = newSize;
+        }
+        
+        if (!writeAll(fd, data.data(), data.length())) {
+            LOG_ERROR("Failed to write upload to buffer: " + std::string(strerror(errno)), "HTTP");
+            return false;
+        }
+        received += data.length();
+        return true;
+    });
+    
+    if (close(fd) < 0) {
+        success = false;
+    }
+    
+    if (!success) {
+        queue.releaseLocalBuffer(bufferPath, reserved);
+        bufferPath.clear();
+        return outOfSpace ? 507 : 400;
+    }
+    
+    // Hand back what a chunked body didn't use of its last reservation step
+    if (reserved > received) {
+        queue.resizeLocalBuffer(bufferPath, reserved, received);
+    }
+    
+    size = received;
+    return 0;
+}
+
+std::string HttpServer::waitForBufferSpace(const std::string& clientId, uint64_t size) {
+    auto& queue = m_bridge->getOperationQueue();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(UPLOAD_BUFFER_WAIT_SECONDS);
+    
+    std::string bufferPath = queue.allocateLocalBuffer(clientId, size);
+    while (bufferPath.empty() && m_running && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        bufferPath = queue.allocateLocalBuffer(clientId, size);
+    }
+    return bufferPath;
+}
+    
+bool HttpServer::waitForBufferResize(const std::string& bufferPath, uint64_t reservedSize, uint64_t newSize) {
+    auto& queue = m_bridge->getOperationQueue();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(UPLOAD_BUFFER_WAIT_SECONDS);
+    
+    bool resized = queue.resizeLocalBuffer(bufferPath, reservedSize, newSize);
+    while (!resized && m_running && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        resized = queue.resizeLocalBuffer(bufferPath, reservedSize, newSize);
+    }
+    return resized;
+}
+
+bool HttpServer::writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+std::string HttpServer::resolveDrivePath(const std::string& relativePath) const {
+    if (relativePath.empty() || relativePath.find('\0') != std::string::npos) {
+        return "";
+    }
+    
+    std::string root = std::filesystem::weakly_canonical(m_documentRoot).string();
+    std::string resolved = std::filesystem::weakly_canonical(root + "/" + relativePath).string();
+    
+    // Reject anything that escapes the document root (including /mnt/usbdrive2 style siblings)
+    if (resolved != root && resolved.compare(0, root.length() + 1, root + "/") != 0) {
+        return "";
+    }
+    return resolved;
+}
+
+std::string HttpServer::getQueryParameter(std::string_view query, const std::string& name) {
+    size_t pos = 0;
+    while (pos <= query.length()) {
+        size_t end = query.find('&', pos);
+        if (end == std::string_view::npos) {
+            end = query.length();
+        }
+        
+        size_t equals = query.find('=', pos);
+        if (equals != std::string_view::npos && equals < end && query.compare(pos, equals - pos, name) == 0 &&
+            equals - pos == name.length()) {
+            return urlDecode(query.substr(equals + 1, end - equals - 1));
+        }
+        pos = end + 1;
+    }
+    return "";
+}
+
+std::string HttpServer::urlDecode(std::string_view text, bool plusAsSpace) {
+    std::string decoded;
+    decoded.reserve(text.length());
+    appendUrlDecoded(text, plusAsSpace, decoded);
+    return decoded;
+}
+
+std::string HttpServer::jsonEscape(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.length());
+    
+    for (char c : text) {
+        switch (c) {
+            case '"':  escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char hex[8];
+                    snprintf(hex, sizeof(hex), "\\u%04x", c);
+                    escaped += hex;
+                } else {
+                    escaped += c;
+                }
+        }
+    }
+    return escaped;
+}
+
+HttpResponse HttpServer::handleRequest(const HttpRequest& request) {
+    const std::string& path = request.path();
+    
+    LOG_DEBUG("HTTP request: " + std::string(request.method) + " " + path, "HTTP");
+    
+    // Handle API requests
+    if (path.find("/api/") == 0) {
+        auto it = m_apiHandlers.find(path.substr(4));
+        if (it != m_apiHandlers.end()) {
+            return it->second(request);
+        } else {
+            return generateApiResponse("", R"({"error": "API endpoint not found"})", 404);
+        }
+    }
+    
+    // Handle file requests
+    if (request.method == "GET" || request.method == "HEAD") {
+        if (path == "/") {
+            return serveFile("/index.html", request);
+        }
+        
+        return serveFile(path, request);
+    }
+    
+    // Method not allowed
+    return generateErrorResponse(405);
+}
+
+HttpResponse HttpServer::serveFile(const std::string& path, const HttpRequest& request) {
+    std::string fullPath;
+    
+    // Serve web interface files from memory, falling back to the /web directory
+    if (path.find("/css/") == 0 || path.find("/js/") == 0 || path == "/index.html") {
+        if (const StaticAssetCache::Asset* asset = m_assetCache.find(path)) {
+            return serveAsset(*asset, request);
+        }
+        std::string webRoot = std::string(WEB_ROOT) + "/";
+        fullPath = std::filesystem::weakly_canonical(WEB_ROOT + path).string();
+        if (fullPath.compare(0, webRoot.length(), webRoot) != 0) {
+            return generateErrorResponse(403);
+        }
+    } else {
+        // Serve files from document root (USB storage), never a sibling or anything above it
+        fullPath = resolveDrivePath(path);
+        if (fullPath.empty()) {
+            return generateErrorResponse(403);
+        }
+    }
+    
+    return serveLocalFile(fullPath, fullPath, request);
+}
+
+HttpResponse HttpServer::serveLocalFile(const std::string& fullPath, const std::string& typePath,
+                                        const HttpRequest& request) {
+    struct stat st;
+    if (stat(fullPath.c_str(), &st) != 0) {
+        HttpResponse response;
+        response.statusCode = 404;
+        response.contentType = "text/html";
+        response.body = "<html><body><h1>404 Not Found</h1></body></html>";
+        return response;
+    }
+    
+    if (S_ISDIR(st.st_mode)) {
+        if (m_directoryListing) {
+            return listDirectory(fullPath);
+        } else {
+            return generateErrorResponse(403);
+        }
+    }
+    
+    // The drive may be mounted without nodev: device nodes and FIFOs on it are never opened
+    if (!S_ISREG(st.st_mode)) {
+        return generateErrorResponse(403);
+    }
+    
+    // Revalidation is answered from the inode alone, the file itself is never opened
+    if (isNotModified(request, st)) {
+        HttpResponse response;
+        response.statusCode = 304;
+        response.headers.emplace_back("ETag", fileETag(st));
+        response.headers.emplace_back("Last-Modified", formatHttpDate(st.st_mtime));
+        response.headers.emplace_back("Cache-Control", "no-cache");
+        return response;
+    }
+    
+    // Serve file - the body is streamed from the descriptor after the headers.
+    // O_NONBLOCK keeps a FIFO swapped in after stat() from blocking the open.
+    int fd = open(fullPath.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+    if (fd < 0) {
+        return generateErrorResponse(500);
+    }
+    
+    auto file = std::make_shared<HttpFileBody>();
+    file->fd = fd;
+    file->leaseClientId = (isWebDavRequest(request) ? "webdav_" : "http_") + request.remoteAddress;
+    
+    // The validators describe what is actually sent, even if the file was replaced meanwhile
+    if (fstat(fd, &st) < 0) {
+        return generateErrorResponse(500);
+    }
+    
+    if (!S_ISREG(st.st_mode)) {
+        return generateErrorResponse(403);
+    }
+    
+    HttpResponse response;
+    response.contentType = FileUtils::getMimeType(typePath);
+    response.headers.emplace_back("Accept-Ranges", "bytes");
+    response.headers.emplace_back("ETag", fileETag(st));
+    response.headers.emplace_back("Last-Modified", formatHttpDate(st.st_mtime));
+    // Files on the drive change underneath us (USB hosts, SMB), so caches always revalidate
+    response.headers.emplace_back("Cache-Control", "no-cache");
+    response.file = file;
+    
+    uint64_t fileSize = st.st_size;
+    std::string rangeHeader(request.header("range"));
+    
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    bool rangeApplies = !rangeHeader.empty() && isIfRangeSatisfied(request, st) &&
+                        parseRangeHeader(rangeHeader, fileSize, ranges);
+    
+    if (!rangeApplies) {
+        file->length = fileSize;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        return response;
+    }
+    
+    if (ranges.empty()) {
+        HttpResponse unsatisfiable = generateErrorResponse(416);
+        unsatisfiable.headers.emplace_back("Content-Range", "bytes */" + std::to_string(fileSize));
+        return unsatisfiable;
+    }
+    
+    response.statusCode = 206;
+    
+    if (ranges.size() == 1) {
+        file->offset = ranges[0].first;
+        file->length = ranges[0].second - ranges[0].first + 1;
+        response.headers.emplace_back("Content-Range", "bytes " + std::to_string(ranges[0].first) + "-" +
+                                      std::to_string(ranges[0].second) + "/" + std::to_string(fileSize));
+        return response;
+    }
+    
+    // Several ranges are sent as multipart/byteranges, every part still read with sendfile
+    std::string boundary = generateBoundary();
+    file->length = 0;
+    
+    for (const auto& range : ranges) {
+        HttpFileBody::Part part;
+        part.offset = range.first;
+        part.length = range.second - range.first + 1;
+        part.header = "\r\n--" + boundary + "\r\n" +
+                      "Content-Type: " + response.contentType + "\r\n" +
+                      "Content-Range: bytes " + std::to_string(range.first) + "-" +
+                      std::to_string(range.second) + "/" + std::to_string(fileSize) + "\r\n\r\n";
+        
+        file->length += part.header.length() + part.length;
+        file->parts.push_back(std::move(part));
+    }
+    
+    file->trailer = "\r\n--" + boundary + "--\r\n";
+    file->length += file->trailer.length();
+    
+    response.contentType = "multipart/byteranges; boundary=" + boundary;
+    return response;
+}
+
+HttpResponse HttpServer::serveAsset(const StaticAssetCache::Asset& asset, const HttpRequest& request) {
+    HttpResponse response;
+    response.headers.emplace_back("Cache-Control", asset.cacheControl);
+    response.headers.emplace_back("Vary", "Accept-Encoding");
+    
+    // Pick the smallest variant the client accepts; every variant has its own strong ETag
+    std::string_view acceptEncoding = request.header("accept-encoding");
+    std::string etag;
+    
+    if (asset.brotli && acceptsEncoding(acceptEncoding, "br")) {
+        response.headers.emplace_back("Content-Encoding", "br");
+        response.sharedBody = asset.brotli;
+        etag = "\"" + asset.etag + "-br\"";
+    } else if (asset.gzip && acceptsEncoding(acceptEncoding, "gzip")) {
+        response.headers.emplace_back("Content-Encoding", "gzip");
+        response.sharedBody = asset.gzip;
+        etag = "\"" + asset.etag + "-gz\"";
+    } else {
+        response.sharedBody = asset.identity;
+        etag = "\"" + asset.etag + "\"";
+    }
+    response.headers.emplace_back("ETag", etag);
+    
+    std::string_view ifNoneMatch = request.header("if-none-match");
+    if (!ifNoneMatch.empty() && matchesETag(ifNoneMatch, asset.etag)) {
+        // Only the validators and caching headers go with a 304
+        response.statusCode = 304;
+        response.sharedBody.reset();
+        response.headers.erase(std::remove_if(response.headers.begin(), response.headers.end(),
+                                              [](const std::pair<std::string, std::string>& header) {
+                                                  return header.first == "Content-Encoding";
+                                              }),
+                               response.headers.end());
+        return response;
+    }
+    
+    response.contentType = asset.contentType;
+    return response;
+}
+
+bool HttpServer::matchesETag(std::string_view ifNoneMatch, const std::string& etag) {
+    // If-None-Match uses weak comparison, and a tag for any encoding of the same content matches
+    size_t pos = 0;
+    while (pos < ifNoneMatch.length()) {
+        size_t end = ifNoneMatch.find(',', pos);
+        if (end == std::string_view::npos) {
+            end = ifNoneMatch.length();
+        }
+        
+        std::string_view tag = ifNoneMatch.substr(pos, end - pos);
+        pos = end + 1;
+        
+        while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) tag.remove_prefix(1);
+        while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) tag.remove_suffix(1);
+        
+        if (tag == "*") {
+            return true;
+        }
+        if (tag.substr(0, 2) == "W/") {
+            tag.remove_prefix(2);
+        }
+        if (tag.length() < 2 || tag.front() != '"' || tag.back() != '"') {
+            continue;
+        }
+        tag = tag.substr(1, tag.length() - 2);
+        
+        if (tag.substr(0, etag.length()) == etag &&
+            (tag.length() == etag.length() || tag.substr(etag.length()) == "-gz" ||
+             tag.substr(etag.length()) == "-br")) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HttpServer::acceptsEncoding(std::string_view acceptEncoding, std::string_view coding) {
+    size_t pos = 0;
+    while (pos < acceptEncoding.length()) {
+        size_t end = acceptEncoding.find(',', pos);
+        if (end == std::string_view::npos) {
+            end = acceptEncoding.length();
+        }
+        
+        std::string_view item = acceptEncoding.substr(pos, end - pos);
+        pos = end + 1;
+        
+        size_t semicolon = item.find(';');
+        std::string_view name = item.substr(0, semicolon);
+        while (!name.empty() && name.front() == ' ') name.remove_prefix(1);
+        while (!name.empty() && name.back() == ' ') name.remove_suffix(1);
+        
+        if (name.length() != coding.length() ||
+            !std::equal(name.begin(), name.end(), coding.begin(),
+                        [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; })) {
+            continue;
+        }
+        
+        // "gzip;q=0" explicitly refuses the coding
+        if (semicolon != std::string_view::npos) {
+            std::string parameters(item.substr(semicolon + 1));
+            size_t q = parameters.find("q=");
+            if (q != std::string::npos && std::strtod(parameters.c_str() + q + 2, nullptr) <= 0.0) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+bool HttpServer::parseRangeHeader(const std::string& header, uint64_t fileSize,
+                                  std::vector<std::pair<uint64_t, uint64_t>>& ranges) {
+    // Returns false when the header should be ignored (not bytes, malformed, abusive),
+    // true with an empty list when it is valid but nothing is satisfiable
+    const std::string unit = "bytes=";
+    if (header.compare(0, unit.length(), unit) != 0) {
+        return false;
+    }
+    
+    std::vector<std::pair<uint64_t, uint64_t>> parsed;
+    size_t specCount = 0;
+    size_t pos = unit.length();
+    
+    while (pos <= header.length()) {
+        size_t end = header.find(',', pos);
+        if (end == std::string::npos) {
+            end = header.length();
+        }
+        
+        std::string spec = header.substr(pos, end - pos);
+        spec.erase(0, spec.find_first_not_of(" \t"));
+        spec.erase(spec.find_last_not_of(" \t") + 1);
+        pos = end + 1;
+        
+        if (spec.empty()) {
+            continue;
+        }
+        specCount++;
+        
+        size_t dash = spec.find('-');
+        if (dash == std::string::npos ||
+            spec.find_first_not_of("0123456789-") != std::string::npos ||
+            spec.find('-', dash + 1) != std::string::npos) {
+            return false;
+        }
+        
+        std::string firstText = spec.substr(0, dash);
+        std::string lastText = spec.substr(dash + 1);
+        uint64_t first;
+        uint64_t last;
+        
+        try {
+            if (firstText.empty()) {
+                // Suffix range: the final N bytes
+                if (lastText.empty()) {
+                    return false;
+                }
+                uint64_t suffix = std::stoull(lastText);
+                if (suffix == 0 || fileSize == 0) {
+                    continue;
+                }
+                first = suffix >= fileSize ? 0 : fileSize - suffix;
+                last = fileSize - 1;
+            } else {
+                first = std::stoull(firstText);
+                last = lastText.empty() ? UINT64_MAX : std::stoull(lastText);
+                if (last < first) {
+                    return false;
+                }
+                if (first >= fileSize) {
+                    continue;
+                }
+                last = std::min(last, fileSize - 1);
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+        
+        parsed.emplace_back(first, last);
+        if (parsed.size() > MAX_RANGES_PER_REQUEST) {
+            return false;
+        }
+    }
+    
+    if (specCount == 0) {
+        return false;
+    }
+    
+    // Merge overlapping and adjacent ranges so no byte is read from the drive twice
+    std::sort(parsed.begin(), parsed.end());
+    for (const auto& range : parsed) {
+        if (!ranges.empty() && range.first <= ranges.back().second + 1) {
+            ranges.back().second = std::max(ranges.back().second, range.second);
+        } else {
+            ranges.push_back(range);
+        }
+    }
+    
+    return true;
+}
+
+bool HttpServer::isIfRangeSatisfied(const HttpRequest& request, const struct stat& st) {
+    std::string ifRange(request.header("if-range"));
+    if (ifRange.empty()) {
+        return true;
+    }
+    
+    // If-Range needs a strong match of the validator, weak tags never match
+    if (ifRange.front() == '"') {
+        return ifRange == fileETag(st);
+    }
+    if (ifRange.compare(0, 2, "W/") == 0) {
+        return false;
+    }
+    
+    time_t date;
+    return parseHttpDate(ifRange, date) && date == st.st_mtime;
+}
+
+std::string HttpServer::fileETag(const struct stat& st) {
+    return formatETag(st.st_ino, st.st_mtim.tv_sec, st.st_mtim.tv_nsec, st.st_size);
+}
+
+std::string HttpServer::formatETag(uint64_t inode, int64_t mtime, long mtimeNsec, uint64_t size) {
+    // Strong tag from inode, mtime (with nanoseconds) and size: a rewrite in place or a
+    // replacement by rename changes it, and it is known without reading the file
+    char etag[80];
+    snprintf(etag, sizeof(etag), "\"%llx-%llx-%lx-%llx\"",
+             static_cast<unsigned long long>(inode),
+             static_cast<unsigned long long>(mtime),
+             mtimeNsec,
+             static_cast<unsigned long long>(size));
+    return etag;
+}
+
+bool HttpServer::isNotModified(const HttpRequest& request, const struct stat& st) {
+    // If-None-Match takes precedence; If-Modified-Since only counts without it (RFC 7232 6)
+    std::string_view ifNoneMatch = request.header("if-none-match");
+    if (!ifNoneMatch.empty()) {
+        std::string etag = fileETag(st);
+        return matchesETag(ifNoneMatch, etag.substr(1, etag.length() - 2));
+    }
+    
+    std::string ifModifiedSince(request.header("if-modified-since"));
+    time_t date;
+    if (ifModifiedSince.empty() || !parseHttpDate(ifModifiedSince, date)) {
+        return false;
+    }
+    return st.st_mtime <= date;
+}
+    
+std::string HttpServer::formatHttpDate(time_t time) {
+    struct tm tm;
+    gmtime_r(&time, &tm);
+    
+    char date[32];
+    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return date;
+}
+
+bool HttpServer::parseHttpDate(const std::string& text, time_t& time) {
+    struct tm tm = {};
+    if (!strptime(text.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm)) {
+        return false;
+    }
+    time = timegm(&tm);
+    return true;
+}
+
+std::string HttpServer::generateBoundary() {
+    static const char hex[] = "0123456789abcdef";
+    thread_local std::mt19937_64 generator(std::random_device{}());
+    
+    uint64_t value = generator();
+    std::string boundary = "usbbridge_";
+    for (int i = 0; i < 16; ++i) {
+        boundary += hex[value & 0xF];
+        value >>= 4;
+    }
+    return boundary;
+}
+
+HttpResponse HttpServer::listDirectory(const std::string& path) {
+    std::ostringstream html;
+    
+    html << "<!DOCTYPE html>\n";
+    html << "<html><head><title>Directory Listing</title>";
+    html << "<style>body{font-family:Arial,sans-serif;margin:20px;} ";
+    html << "table{border-collapse:collapse;width:100%;} ";
+    html << "th,td{border:1px solid #ddd;padding:8px;text-align:left;} ";
+    html << "th{background-color:#f2f2f2;}</style></head>\n";
+    html << "<body><h1>Directory Listing</h1>\n";
+    html << "<table><tr><th>Name</th><th>Size</th><th>Modified</th></tr>\n";
+    
+    try {
+        for (const auto& entry : std::filesystem::directory_iterator(path)) {
+            std::string name = entry.path().filename().string();
+            std::string size = entry.is_directory() ? "-" : FileUtils::formatFileSize(entry.file_size());
+            std::string modified = FileUtils::formatTime(FileUtils::getLastModifiedTime(entry.path().string()));
+            
+            html << "<tr>";
+            html << "<td>";
+            if (entry.is_directory()) {
+                html << "📁 ";
+            } else {
+                html << "📄 ";
+            }
+            html << "<a href=\"" << name;
+            if (entry.is_directory()) html << "/";
+            html << "\">" << name << "</a></td>";
+            html << "<td>" << size << "</td>";
+            html << "<td>" << modified << "</td>";
+            html << "</tr>\n";
+        }
+    } catch (const std::exception& e) {
+        html << "<tr><td colspan=\"3\">Error reading directory: " << e.what() << "</td></tr>\n";
+    }
+    
+    html << "</table></body></html>";
+    
+    HttpResponse response;
+    response.contentType = "text/html";
+    response.body = html.str();
+    return response;
+}
+
+HttpResponse HttpServer::handleFileListing(const HttpRequest& request) {
+    // The path may also come in X-Path, which older versions of the web interface send
+    std::string path = getQueryParameter(request.query, "path");
+    if (path.empty()) {
+        path = std::string(request.header("X-Path"));
+    }
+    if (path.empty()) {
+        path = "/";
+    }
+    
+    std::string resolved = resolveDrivePath(path);
+    if (resolved.empty()) {
+        return generateApiResponse("/files", R"({"error": "Invalid path"})", 400);
+    }
+    
+    // Cursors are opaque to clients; they are the offset of the next entry in the sorted listing
+    size_t offset = 0;
+    size_t limit = DEFAULT_LISTING_LIMIT;
+    std::string cursor = getQueryParameter(request.query, "cursor");
+    std::string limitText = getQueryParameter(request.query, "limit");
+    char* end = nullptr;
+    if (!cursor.empty()) {
+        offset = std::strtoull(cursor.c_str(), &end, 10);
+        if (*end != '\0' || !std::isdigit(static_cast<unsigned char>(cursor[0]))) {
+            return generateApiResponse("/files", R"({"error": "Invalid cursor"})", 400);
+        }
+    }
+    if (!limitText.empty()) {
+        limit = std::strtoull(limitText.c_str(), &end, 10);
+        if (*end != '\0' || !std::isdigit(static_cast<unsigned char>(limitText[0])) || limit == 0) {
+            return generateApiResponse("/files", R"({"error": "Invalid limit"})", 400);
+        }
+        limit = std::min(limit, MAX_LISTING_LIMIT);
+    }
+    
+    std::string sort = getQueryParameter(request.query, "sort");
+    std::string order = getQueryParameter(request.query, "order");
+    DirectoryListingCache::SortKey sortKey;
+    if (sort.empty() || sort == "name") {
+        sort = "name";
+        sortKey = DirectoryListingCache::SortKey::NAME;
+    } else if (sort == "size") {
+        sortKey = DirectoryListingCache::SortKey::SIZE;
+    } else if (sort == "modified") {
+        sortKey = DirectoryListingCache::SortKey::MODIFIED;
+    } else {
+        return generateApiResponse("/files", R"({"error": "Invalid sort"})", 400);
+    }
+    if (order.empty()) {
+        order = "asc";
+    } else if (order != "asc" && order != "desc") {
+        return generateApiResponse("/files", R"({"error": "Invalid order"})", 400);
+    }
+    
+    auto listing = m_listingCache.get(resolved);
+    if (!listing) {
+        return generateApiResponse("/files", R"({"error": "Directory not found"})", 404);
+    }
+    auto indices = listing->getOrder(sortKey, order == "desc");
+    
+    std::string root = std::filesystem::weakly_canonical(m_documentRoot).string();
+    std::string displayPath = resolved.length() > root.length() ? resolved.substr(root.length()) : "/";
+    
+    size_t total = indices->size();
+    size_t first = std::min(offset, total);
+    size_t last = std::min(total - first, limit) + first;
+    
+    HttpResponse response = generateApiResponse("/files", "", 200);
+    response.headers.emplace_back("Cache-Control", "no-cache");
+    
+    // The page is serialised straight into the socket; the listing stays alive through the captures
+    response.stream = [listing, indices, displayPath, sort, order, first, last, total](const HttpBodyWriter& body) {
+        JsonStreamWriter json(body.write);
+        
+        json.beginObject();
+        json.key("path").value(displayPath);
+        json.key("sort").value(sort);
+        json.key("order").value(order);
+        json.key("total").value(static_cast<uint64_t>(total));
+        json.key("next_cursor");
+        if (last < total) {
+            json.value(std::to_string(last));
+        } else {
+            json.null();
+        }
+        
+        json.key("files").beginArray();
+        const auto& entries = listing->getEntries();
+        for (size_t i = first; i < last && json.ok(); ++i) {
+            const auto& entry = entries[(*indices)[i]];
+            json.beginObject();
+            json.key("name").value(entry.name);
+            json.key("is_directory").value(entry.isDirectory);
+            json.key("size").value(entry.size);
+            json.key("modified").value(entry.modified);
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+        
+        return json.flush();
+    };
+    
+    return response;
+}
+
+HttpResponse HttpServer::handleArchive(const HttpRequest& request) {
+    if (!m_fileDownload) {
+        return generateApiResponse("/archive", R"({"error": "File download is disabled"})", 403);
+    }
+    
+    std::string path = getQueryParameter(request.query, "path");
+    std::string format = getQueryParameter(request.query, "format");
+    if (format.empty()) {
+        format = "tar";
+    }
+    if (format != "tar" && format != "zip") {
+        return generateApiResponse("/archive", R"({"error": "Invalid format"})", 400);
+    }
+    
+    std::string resolved = resolveDrivePath(path.empty() ? "/" : path);
+    if (resolved.empty()) {
+        return generateApiResponse("/archive", R"({"error": "Invalid path"})", 400);
+    }
+    if (!std::filesystem::is_directory(resolved)) {
+        return generateApiResponse("/archive", R"({"error": "Directory not found"})", 404);
+    }
+    
+    // Entries are stored under the folder's own name, as if it had been archived from its parent
+    std::string root = std::filesystem::weakly_canonical(m_documentRoot).string();
+    std::string folder = resolved == root ? "drive" : std::filesystem::path(resolved).filename().string();
+    std::string fileName = folder + "." + format;
+    std::replace_if(fileName.begin(), fileName.end(), [](char c) {
+        return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+    }, '_');
+    
+    HttpResponse response;
+    response.contentType = format == "zip" ? "application/zip" : "application/x-tar";
+    response.headers.emplace_back("Content-Disposition", "attachment; filename=\"" + fileName + "\"");
+    response.headers.emplace_back("Access-Control-Allow-Origin", "*");
+    
+    LOG_INFO("Archiving " + resolved + " as " + format + " for " + request.remoteAddress, "HTTP");
+    
+    ArchiveStreamer::Format archiveFormat = format == "zip" ? ArchiveStreamer::Format::ZIP : ArchiveStreamer::Format::TAR;
+    response.stream = [resolved, folder, archiveFormat](const HttpBodyWriter& body) {
+        ArchiveStreamer archive(archiveFormat, body);
+        return archive.write(resolved, folder + "/");
+    };
+    
+    return response;
+}
+
+HttpResponse HttpServer::generateApiResponse(const std::string& endpoint, const std::string& data, int statusCode) {
+    HttpResponse response;
+    response.statusCode = statusCode;
+    response.contentType = "application/json";
+    response.headers.emplace_back("Access-Control-Allow-Origin", "*");
+    response.body = data;
+    
+    return response;
+}
+
+HttpResponse HttpServer::generateErrorResponse(int statusCode) {
+    HttpResponse response;
+    response.statusCode = statusCode;
+    return response;
+}
+
+std::string HttpServer::getStatusText(int statusCode) {
+    switch (statusCode) {
+        case 100: return "Continue";
+        case 200: return "OK";
+        case 201: return "Created";
+        case 202: return "Accepted";
+        case 204: return "No Content";
+        case 206: return "Partial Content";
+        case 207: return "Multi-Status";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 409: return "Conflict";
+        case 411: return "Length Required";
+        case 412: return "Precondition Failed";
+        case 413: return "Payload Too Large";
+        case 414: return "URI Too Long";
+        case 415: return "Unsupported Media Type";
+        case 416: return "Range Not Satisfiable";
+        case 423: return "Locked";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        case 507: return "Insufficient Storage";
+        default:  return "Unknown";
+    }
 }
\ No newline at end of file
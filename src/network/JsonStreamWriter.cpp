@@ -0,0 +1,146 @@
+#include "network/JsonStreamWriter.hpp"
+#include <cstdio>
+
+JsonStreamWriter::JsonStreamWriter(Sink sink, size_t bufferSize)
+    : m_sink(std::move(sink))
+    , m_bufferSize(bufferSize)
+{
+    m_buffer.reserve(bufferSize);
+}
+
+JsonStreamWriter& JsonStreamWriter::beginObject() {
+    separate();
+    append("{");
+    m_first.push_back(true);
+    return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::endObject() {
+    m_first.pop_back();
+    append("}");
+    return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::beginArray() {
+    separate();
+    append("[");
+    m_first.push_back(true);
+    return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::endArray() {
+    m_first.pop_back();
+    append("]");
+    return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::key(std::string_view name) {
+    separate();
+    appendString(name);
+    append(":");
+    m_afterKey = true;
+    return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::value(std::string_view text) {
+    separate();
+    appendString(text);
+    return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::value(uint64_t number) {
+    separate();
+    char text[24];
+    int length = snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(number));
+    append(std::string_view(text, length));
+    return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::value(int64_t number) {
+    separate();
+    char text[24];
+    int length = snprintf(text, sizeof(text), "%lld", static_cast<long long>(number));
+    append(std::string_view(text, length));
+    return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::value(bool flag) {
+    separate();
+    append(flag ? "true" : "false");
+    return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::null() {
+    separate();
+    append("null");
+    return *this;
+}
+
+bool JsonStreamWriter::flush() {
+    if (m_ok && !m_buffer.empty()) {
+        m_ok = m_sink(m_buffer.data(), m_buffer.length());
+    }
+    m_buffer.clear();
+    return m_ok;
+}
+
+void JsonStreamWriter::separate() {
+    // A value directly after its key, or the first item in a container, needs no comma
+    if (m_afterKey) {
+        m_afterKey = false;
+        return;
+    }
+    if (!m_first.empty()) {
+        if (!m_first.back()) {
+            append(",");
+        }
+        m_first.back() = false;
+    }
+}
+
+void JsonStreamWriter::appendString(std::string_view text) {
+    append("\"");
+    
+    // Copy unescaped runs in one piece; only quotes, backslashes and control characters need work
+    size_t start = 0;
+    for (size_t i = 0; i < text.length(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        
+        append(text.substr(start, i - start));
+        switch (c) {
+            case '"':  append("\\\""); break;
+            case '\\': append("\\\\"); break;
+            case '\n': append("\\n"); break;
+            case '\r': append("\\r"); break;
+            case '\t': append("\\t"); break;
+            default: {
+                char hex[8];
+                snprintf(hex, sizeof(hex), "\\u%04x", c);
+                append(hex);
+            }
+        }
+        start = i + 1;
+    }
+    append(text.substr(start));
+    
+    append("\"");
+}
+
+void JsonStreamWriter::append(std::string_view text) {
+    if (!m_ok) {
+        return;
+    }
+    
+    if (m_buffer.length() + text.length() > m_bufferSize) {
+        flush();
+        if (text.length() > m_bufferSize) {
+            // Too big to buffer at all, pass it straight through
+            m_ok = m_ok && m_sink(text.data(), text.length());
+            return;
+        }
+    }
+    m_buffer.append(text.data(), text.length());
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "network/MetricsWriter.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+const char* const MetricsWriter::CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+
+namespace {
+
+// Shortest of %.15g and %.17g that reads back as the same value; floating-point
+// std::to_chars would do this but needs GCC 11
+size_t formatDouble(char* out, size_t size, double value) {
+    int length = std::snprintf(out, size, "%.15g", value);
+    if (std::strtod(out, nullptr) != value) {
+        length = std::snprintf(out, size, "%.17g", value);
+    }
+    return static_cast<size_t>(length);
+}
+
+}
+
+MetricsWriter& MetricsWriter::family(std::string_view name, std::string_view type, std::string_view help) {
+    m_output.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    m_output.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+    return *this;
+}
+
+MetricsWriter& MetricsWriter::sample(std::string_view name, std::string_view labels, uint64_t value) {
+    appendName(name, {}, labels);
+    appendNumber(value);
+    m_output += '\n';
+    return *this;
+}
+
+MetricsWriter& MetricsWriter::sample(std::string_view name, std::string_view labels, double value) {
+    appendName(name, {}, labels);
+    appendNumber(value);
+    m_output += '\n';
+    return *this;
+}
+
+MetricsWriter& MetricsWriter::counter(std::string_view name, std::string_view help, uint64_t value) {
+    return family(name, "counter", help).sample(name, value);
+}
+
+MetricsWriter& MetricsWriter::gauge(std::string_view name, std::string_view help, uint64_t value) {
+    return family(name, "gauge", help).sample(name, value);
+}
+
+MetricsWriter& MetricsWriter::gauge(std::string_view name, std::string_view help, double value) {
+    return family(name, "gauge", help).sample(name, value);
+}
+
+MetricsWriter& MetricsWriter::histogram(std::string_view name, std::string_view help,
+                                        const LatencyHistogram::Snapshot& snapshot) {
+    family(name, "histogram", help);
+    
+    char bound[32];
+    for (size_t i = 0; i < snapshot.bucketCount; ++i) {
+        std::string_view le(bound, formatDouble(bound, sizeof(bound), snapshot.bounds[i]));
+        
+        m_output.append(name).append("_bucket{le=\"").append(le).append("\"} ");
+        appendNumber(snapshot.cumulative[i]);
+        m_output += '\n';
+    }
+    
+    m_output.append(name).append("_bucket{le=\"+Inf\"} ");
+    appendNumber(snapshot.count);
+    m_output += '\n';
+    
+    appendName(name, "_sum", {});
+    appendNumber(snapshot.sum);
+    m_output += '\n';
+    appendName(name, "_count", {});
+    appendNumber(snapshot.count);
+    m_output += '\n';
+    return *this;
+}
+
+void MetricsWriter::appendLabel(std::string& labels, std::string_view name, std::string_view value) {
+    if (!labels.empty()) {
+        labels += ',';
+    }
+    labels.append(name).append("=\"");
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            labels += '\\';
+            labels += c;
+        } else if (c == '\n') {
+            labels.append("\\n");
+        } else {
+            labels += c;
+        }
+    }
+    labels += '"';
+}
+
+void MetricsWriter::appendName(std::string_view name, std::string_view suffix, std::string_view labels) {
+    m_output.append(name).append(suffix);
+    if (!labels.empty()) {
+        m_output.append("{").append(labels).append("}");
+    }
+    m_output += ' ';
+}
+
+void MetricsWriter::appendNumber(uint64_t value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    m_output.append(digits, result.ptr - digits);
+}
+
+void MetricsWriter::appendNumber(double value) {
+    if (std::isnan(value)) {
+        m_output.append("NaN");
+        return;
+    }
+    if (std::isinf(value)) {
+        m_output.append(value > 0 ? "+Inf" : "-Inf");
+        return;
+    }
+    
+    char digits[32];
+    m_output.append(digits, formatDouble(digits, sizeof(digits), value));
+}
\ No newline at end of file
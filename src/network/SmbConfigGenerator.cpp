@@ -0,0 +1,276 @@
+#include "network/SmbConfigGenerator.hpp"
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/sysinfo.h>
+#include <sys/sysmacros.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <limits.h>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+const uint64_t SmbConfigGenerator::WRITE_CACHE_REMOVED_VERSION = 412;
+
+namespace {
+const long MSDOS_MAGIC = 0x4d44;
+const long EXFAT_MAGIC = 0x2011BAB0;
+
+std::string readSysfsValue(const std::string& path) {
+    std::ifstream file(path);
+    std::string value;
+    std::getline(file, value);
+    return value;
+}
+}
+
+SmbConfigGenerator::Environment SmbConfigGenerator::detectEnvironment(const std::string& sharePath) {
+    Environment environment;
+    
+    struct stat st;
+    if (stat(sharePath.c_str(), &st) == 0) {
+        environment.driveType = detectDriveType(st.st_dev);
+    }
+    
+    struct statfs fs;
+    if (statfs(sharePath.c_str(), &fs) == 0) {
+        environment.fatFilesystem = fs.f_type == MSDOS_MAGIC || fs.f_type == EXFAT_MAGIC;
+    }
+    
+    struct sysinfo info;
+    if (sysinfo(&info) == 0) {
+        environment.memoryBytes = static_cast<uint64_t>(info.totalram) * info.mem_unit;
+    }
+    
+    detectSambaVersion(environment);
+    return environment;
+}
+
+SmbConfigGenerator::DriveType SmbConfigGenerator::detectDriveType(dev_t device) {
+    // /sys/dev/block/<major>:<minor> leads to the partition; the queue attributes belong to its disk
+    std::string link = "/sys/dev/block/" + std::to_string(major(device)) + ":" + std::to_string(minor(device));
+    char resolved[PATH_MAX];
+    if (!realpath(link.c_str(), resolved)) {
+        return DriveType::FLASH;
+    }
+    
+    std::string disk = resolved;
+    if (access((disk + "/queue").c_str(), F_OK) != 0) {
+        disk = disk.substr(0, disk.rfind('/'));
+    }
+    
+    if (readSysfsValue(disk + "/queue/rotational") == "1") {
+        return DriveType::ROTATIONAL;
+    }
+    
+    // SD cards and sticks; USB SSDs report themselves as fixed disks
+    std::string name = disk.substr(disk.rfind('/') + 1);
+    if (name.compare(0, 6, "mmcblk") == 0 || readSysfsValue(disk + "/removable") == "1") {
+        return DriveType::FLASH;
+    }
+    return DriveType::SOLID_STATE;
+}
+
+void SmbConfigGenerator::detectSambaVersion(Environment& environment) {
+    FILE* pipe = popen("smbd --version 2>/dev/null", "r");
+    if (!pipe) {
+        return;
+    }
+    
+    // "Version 4.17.12-Debian"
+    char line[128] = {};
+    if (fgets(line, sizeof(line), pipe)) {
+        int major = 0;
+        int minor = 0;
+        if (sscanf(line, "Version %d.%d", &major, &minor) == 2) {
+            environment.sambaMajor = major;
+            environment.sambaMinor = minor;
+        }
+    }
+    pclose(pipe);
+}
+
+SmbConfigGenerator::Profile SmbConfigGenerator::selectProfile(const Environment& environment) {
+    const uint64_t MB = 1024 * 1024;
+    
+    // Every in-flight request can hold a buffer of the negotiated I/O size, so small
+    // boards cap it; the thread pool grows with memory as well
+    unsigned memoryTier = environment.memoryBytes < 768 * MB ? 0 : environment.memoryBytes < 3072 * MB ? 1 : 2;
+    static const char* const MEMORY_NAMES[] = {"512m", "1g", "4g"};
+    static const uint64_t MAX_IO_SIZES[] = {1 * MB, 4 * MB, 8 * MB};
+    static const unsigned AIO_THREADS[] = {4, 8, 16};
+    static const uint64_t WRITE_CACHE_SIZES[] = {256 * 1024, 512 * 1024, 1 * MB};
+    
+    Profile profile;
+    profile.aioReadSize = 1;    // Everything goes through the thread pool, smbd never blocks on the drive
+    profile.aioWriteSize = 1;
+    profile.aioMaxThreads = AIO_THREADS[memoryTier];
+    profile.useSendfile = true;
+    // Fixed SO_SNDBUF/SO_RCVBUF would switch off the kernel's buffer autotuning
+    profile.socketOptions = "TCP_NODELAY IPTOS_LOWDELAY SO_KEEPALIVE";
+    profile.oplocks = true;
+    profile.leases = true;
+    profile.strictSync = false;
+    profile.strictAllocate = false;
+    profile.minReceivefileSize = 16 * 1024;
+    profile.maxIoSize = MAX_IO_SIZES[memoryTier];
+    profile.writeCacheSize = WRITE_CACHE_SIZES[memoryTier];
+    
+    switch (environment.driveType) {
+        case DriveType::ROTATIONAL:
+            // Parallel requests only make one head seek between them; allocating whole
+            // files up front keeps them contiguous, except on FAT where it means zero-filling
+            profile.name = "hdd";
+            profile.aioMaxThreads = std::min(profile.aioMaxThreads, 4u);
+            profile.strictAllocate = !environment.fatFilesystem;
+            break;
+        
+        case DriveType::SOLID_STATE:
+            profile.name = "ssd";
+            break;
+        
+        case DriveType::FLASH:
+            // Cheap controllers serialise anyway, a deeper queue only adds latency; small
+            // writes are worth coalescing before they reach the stick
+            profile.name = "flash";
+            profile.aioMaxThreads = 2;
+            profile.writeCacheSize *= 2;
+            break;
+    }
+    
+    profile.name += "-";
+    profile.name += MEMORY_NAMES[memoryTier];
+    return profile;
+}
+
+std::string SmbConfigGenerator::render(const ShareSettings& share, const Environment& environment,
+                                       const Profile& profile) {
+    auto yesNo = [](bool value) { return value ? "yes" : "no"; };
+    
+    std::ostringstream config;
+    config << "# Generated by USB Bridge, changes are overwritten when the share is started\n";
+    config << "# Profile " << profile.name << ": " << getDriveTypeName(environment.driveType) << " drive, "
+           << environment.memoryBytes / (1024 * 1024) << " MB RAM"
+           << (environment.fatFilesystem ? ", FAT" : "");
+    if (environment.sambaMajor > 0) {
+        config << ", Samba " << environment.sambaMajor << "." << environment.sambaMinor;
+    }
+    config << "\n\n";
+    
+    config << "[global]\n";
+    config << "   workgroup = " << share.workgroup << "\n";
+    config << "   server string = USB Bridge\n";
+    config << "   server role = standalone server\n";
+    config << "   server min protocol = SMB2_02\n";
+    if (share.guestAccess) {
+        config << "   map to guest = Bad User\n";
+    }
+    config << "   log file = /var/log/samba/log.%m\n";
+    config << "   max log size = 1000\n";
+    config << "   load printers = no\n";
+    config << "   printing = bsd\n";
+    config << "   printcap name = /dev/null\n";
+    config << "   disable spoolss = yes\n";
+    config << "\n";
+    config << "   # Throughput\n";
+    config << "   socket options = " << profile.socketOptions << "\n";
+    config << "   aio max threads = " << profile.aioMaxThreads << "\n";
+    config << "   min receivefile size = " << profile.minReceivefileSize << "\n";
+    config << "   smb2 max read = " << profile.maxIoSize << "\n";
+    config << "   smb2 max write = " << profile.maxIoSize << "\n";
+    config << "   smb2 max trans = " << profile.maxIoSize << "\n";
+    config << "   smb2 leases = " << yesNo(profile.leases) << "\n";
+    config << "   getwd cache = yes\n";
+    config << "   deadtime = 15\n";
+    config << "\n";
+    
+    config << "[" << share.name << "]\n";
+    config << "   comment = " << share.description << "\n";
+    config << "   path = " << share.path << "\n";
+    config << "   browseable = yes\n";
+    config << "   read only = " << yesNo(share.readOnly) << "\n";
+    config << "   guest ok = " << yesNo(share.guestAccess) << "\n";
+    config << "   create mask = 0664\n";
+    config << "   directory mask = 0775\n";
+    config << "   use sendfile = " << yesNo(profile.useSendfile) << "\n";
+    config << "   aio read size = " << profile.aioReadSize << "\n";
+    config << "   aio write size = " << profile.aioWriteSize << "\n";
+    config << "   oplocks = " << yesNo(profile.oplocks) << "\n";
+    config << "   level2 oplocks = " << yesNo(profile.oplocks) << "\n";
+    config << "   strict sync = " << yesNo(profile.strictSync) << "\n";
+    config << "   sync always = no\n";
+    config << "   strict allocate = " << yesNo(profile.strictAllocate) << "\n";
+    
+    // Unknown versions get the modern parameter set
+    if (environment.sambaMajor > 0 &&
+        static_cast<uint64_t>(environment.sambaMajor * 100 + environment.sambaMinor) < WRITE_CACHE_REMOVED_VERSION) {
+        config << "   write cache size = " << profile.writeCacheSize << "\n";
+    }
+    
+    if (environment.fatFilesystem) {
+        // FAT can't hold extended attributes or Unix modes, and keeps 2 s timestamps
+        config << "   ea support = no\n";
+        config << "   store dos attributes = no\n";
+        config << "   map archive = no\n";
+        config << "   map hidden = no\n";
+        config << "   map system = no\n";
+        config << "   dos filetime resolution = yes\n";
+    }
+    
+    return config.str();
+}
+
+bool SmbConfigGenerator::validate(const std::string& configPath, std::string& errors) {
+    errors.clear();
+    if (system("command -v testparm >/dev/null 2>&1") != 0) {
+        return true;
+    }
+    
+    std::string command = "testparm -s --suppress-prompt '" + configPath + "' 2>&1 >/dev/null";
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) {
+        return true;
+    }
+    
+    // The dump goes to stdout, diagnostics to stderr; unknown parameters don't fail the exit code
+    char line[512];
+    while (fgets(line, sizeof(line), pipe)) {
+        std::string text = line;
+        if (text.find("Unknown parameter") != std::string::npos ||
+            text.find("Ignoring unknown") != std::string::npos ||
+            text.find("ERROR") != std::string::npos ||
+            text.find("Error") != std::string::npos) {
+            errors += text;
+        }
+    }
+    
+    int status = pclose(pipe);
+    if (status != 0 && errors.empty()) {
+        errors = "testparm exited with status " + std::to_string(WEXITSTATUS(status));
+    }
+    return errors.empty();
+}
+
+bool SmbConfigGenerator::parseDriveType(const std::string& name, DriveType& type) {
+    if (name == "hdd") {
+        type = DriveType::ROTATIONAL;
+    } else if (name == "ssd") {
+        type = DriveType::SOLID_STATE;
+    } else if (name == "flash") {
+        type = DriveType::FLASH;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* SmbConfigGenerator::getDriveTypeName(DriveType type) {
+    switch (type) {
+        case DriveType::ROTATIONAL:  return "rotational";
+        case DriveType::SOLID_STATE: return "solid state";
+        case DriveType::FLASH:       return "flash";
+    }
+    return "unknown";
+}
\ No newline at end of file
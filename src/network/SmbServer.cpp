@@ -0,0 +1,188 @@
+#include "network/SmbServer.hpp"
+#include "network/SmbConfigGenerator.hpp"
+#include "network/SmbWriteStager.hpp"
+#include "core/UsbBridge.hpp"
+#include "utils/Logger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+const std::string SmbServer::SMB_CONFIG_PATH = "/etc/samba/smb.conf";
+
+SmbServer::SmbServer()
+    : m_shareName("USBShare")
+    , m_workgroup("WORKGROUP")
+    , m_running(false)
+    , m_readOnly(false)
+    , m_guestAccess(true)
+    , m_profile("auto")
+{
+}
+
+SmbServer::~SmbServer() {
+    stop();
+}
+
+bool SmbServer::initialize(const std::string& sharePath, const std::string& shareName) {
+    m_sharePath = sharePath;
+    m_shareName = shareName;
+    
+    LOG_INFO("SMB share " + m_shareName + " configured for " + m_sharePath, "SMB");
+    return true;
+}
+
+bool SmbServer::start() {
+    if (m_running) {
+        return true;
+    }
+    if (m_sharePath.empty()) {
+        LOG_ERROR("SMB share path not set", "SMB");
+        return false;
+    }
+    
+    if (m_bufferOperations && m_bridge) {
+        std::string stagingPath = m_bridge->getOperationQueue().getLocalBufferPath() + "/smb";
+        m_stager = std::make_unique<SmbWriteStager>(m_bridge, m_sharePath, stagingPath);
+        if (!m_stager->start()) {
+            // Kernel FAT and exFAT drives can't be overlaid
+            LOG_WARNING("SMB write buffering unavailable, clients write to the drive directly", "SMB");
+            m_stager.reset();
+        }
+    }
+    
+    // A config that doesn't validate is not installed; smbd then keeps the previous one
+    generateSmbConfig();
+    
+    if (!startSambaServices()) {
+        LOG_ERROR("Failed to start Samba", "SMB");
+        if (m_stager) {
+            m_stager->stop();
+            m_stager.reset();
+        }
+        return false;
+    }
+    
+    m_running = true;
+    m_statsCollector.start();
+    LOG_INFO("SMB server started", "SMB");
+    return true;
+}
+
+bool SmbServer::stop() {
+    if (!m_running) {
+        return true;
+    }
+    
+    m_statsCollector.stop();
+    bool stopped = stopSambaServices();
+    
+    // After smbd, so no client is still writing to the staging layer
+    bool flushed = true;
+    if (m_stager) {
+        flushed = m_stager->stop();
+        if (!flushed) {
+            LOG_WARNING("Staged SMB writes not all on the drive yet, kept for the next start", "SMB");
+        }
+        m_stager.reset();
+    }
+    m_running = false;
+    LOG_INFO("SMB server stopped", "SMB");
+    return stopped && flushed;
+}
+
+bool SmbServer::addUser(const std::string& username, const std::string& password) {
+    bool validName = !username.empty() && std::all_of(username.begin(), username.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '_' || c == '-';
+    });
+    if (!validName || password.find('\n') != std::string::npos) {
+        LOG_WARNING("Rejected SMB user name or password", "SMB");
+        return false;
+    }
+    
+    // The password goes through the pipe, never onto a command line
+    FILE* pipe = popen(("smbpasswd -s -a " + username + " >/dev/null").c_str(), "w");
+    if (!pipe) {
+        return false;
+    }
+    fprintf(pipe, "%s\n%s\n", password.c_str(), password.c_str());
+    
+    bool added = pclose(pipe) == 0;
+    if (added) {
+        LOG_INFO("Added SMB user " + username, "SMB");
+    } else {
+        LOG_ERROR("Failed to add SMB user " + username, "SMB");
+    }
+    return added;
+}
+
+void SmbServer::removeUser(const std::string& username) {
+    bool validName = !username.empty() && std::all_of(username.begin(), username.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '_' || c == '-';
+    });
+    if (validName && system(("smbpasswd -x " + username + " >/dev/null 2>&1").c_str()) == 0) {
+        LOG_INFO("Removed SMB user " + username, "SMB");
+    }
+}
+
+int SmbServer::getConnectedClients() const {
+    return static_cast<int>(m_statsCollector.getSnapshot().sessions.size());
+}
+
+uint64_t SmbServer::getBytesTransferred() const {
+    auto stats = m_statsCollector.getSnapshot();
+    return stats.totalBytesRead + stats.totalBytesWritten;
+}
+
+bool SmbServer::generateSmbConfig() {
+    SmbConfigGenerator::ShareSettings share;
+    share.path = m_stager ? m_stager->getSharePath() : m_sharePath;
+    share.name = m_shareName;
+    share.workgroup = m_workgroup;
+    share.readOnly = m_readOnly;
+    share.guestAccess = m_guestAccess;
+    
+    SmbConfigGenerator::Environment environment = SmbConfigGenerator::detectEnvironment(m_sharePath);
+    if (m_profile != "auto" && !SmbConfigGenerator::parseDriveType(m_profile, environment.driveType)) {
+        LOG_WARNING("Unknown SMB profile '" + m_profile + "', detecting the drive type", "SMB");
+    }
+    
+    SmbConfigGenerator::Profile profile = SmbConfigGenerator::selectProfile(environment);
+    m_profileName = profile.name;
+    
+    // Written next to the live config and checked before it replaces it
+    std::string pendingPath = SMB_CONFIG_PATH + ".new";
+    {
+        std::ofstream file(pendingPath, std::ios::trunc);
+        file << SmbConfigGenerator::render(share, environment, profile);
+        if (!file) {
+            LOG_ERROR("Failed to write " + pendingPath, "SMB");
+            return false;
+        }
+    }
+    
+    std::string errors;
+    if (!SmbConfigGenerator::validate(pendingPath, errors)) {
+        LOG_ERROR("Generated SMB configuration rejected by testparm: " + errors, "SMB");
+        std::remove(pendingPath.c_str());
+        return false;
+    }
+    
+    if (std::rename(pendingPath.c_str(), SMB_CONFIG_PATH.c_str()) != 0) {
+        LOG_ERROR("Failed to install " + SMB_CONFIG_PATH, "SMB");
+        return false;
+    }
+    
+    LOG_INFO("SMB configuration written with profile " + profile.name, "SMB");
+    return true;
+}
+
+bool SmbServer::startSambaServices() {
+    // Restarted rather than started, so a running smbd picks up the new configuration
+    return system("systemctl restart smbd >/dev/null 2>&1") == 0;
+}
+
+bool SmbServer::stopSambaServices() {
+    return system("systemctl stop smbd >/dev/null 2>&1") == 0;
+}
\ No newline at end of file
@@ -0,0 +1,337 @@
+#include "network/SmbStatsCollector.hpp"
+#include "utils/Logger.hpp"
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <cctype>
+#include <cstdio>
+
+// smbstatus walks Samba's databases; every few seconds is plenty for a display
+const std::chrono::seconds SmbStatsCollector::COLLECT_INTERVAL(5);
+const uint64_t SmbStatsCollector::ACTIVE_TRANSFER = 1024;
+
+namespace {
+
+std::string serverPid(const nlohmann::json& entry) {
+    auto serverId = entry.find("server_id");
+    if (serverId == entry.end() || !serverId->is_object()) {
+        return "";
+    }
+    auto pid = serverId->find("pid");
+    if (pid == serverId->end()) {
+        return "";
+    }
+    return pid->is_string() ? pid->get<std::string>() : pid->dump();
+}
+
+std::string stringField(const nlohmann::json& entry, const char* name) {
+    auto field = entry.find(name);
+    return field != entry.end() && field->is_string() ? field->get<std::string>() : "";
+}
+
+} // namespace
+
+SmbStatsCollector::SmbStatsCollector()
+    : m_running(false)
+    , m_jsonSupported(true)
+{
+}
+
+SmbStatsCollector::~SmbStatsCollector() {
+    stop();
+}
+
+void SmbStatsCollector::start() {
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    m_collectThread = std::thread(&SmbStatsCollector::collectLoop, this);
+}
+
+void SmbStatsCollector::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_waitMutex);
+        if (!m_running) {
+            return;
+        }
+        m_running = false;
+    }
+    m_wakeup.notify_all();
+    if (m_collectThread.joinable()) {
+        m_collectThread.join();
+    }
+    
+    // Sessions end with smbd; the totals stay
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_snapshot.sessions.clear();
+    m_lastSessionIo.clear();
+}
+
+SmbStatsCollector::Snapshot SmbStatsCollector::getSnapshot() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_snapshot;
+}
+
+void SmbStatsCollector::collectLoop() {
+    while (m_running) {
+        collect();
+        
+        std::unique_lock<std::mutex> lock(m_waitMutex);
+        m_wakeup.wait_for(lock, COLLECT_INTERVAL, [this] { return !m_running; });
+    }
+}
+
+void SmbStatsCollector::collect() {
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = m_lastCollect == std::chrono::steady_clock::time_point() ? 0 :
+                     std::chrono::duration<double>(now - m_lastCollect).count();
+    m_lastCollect = now;
+    
+    std::vector<Session> sessions;
+    readSessions(sessions);
+    
+    uint64_t addedRead = 0;
+    uint64_t addedWritten = 0;
+    std::map<std::string, std::pair<uint64_t, uint64_t>> sessionIo;
+    std::map<std::string, uint64_t> sessionTransfer;
+    
+    for (auto& session : sessions) {
+        uint64_t transferred = 0;
+        if (!readProcessIo(session.pid, session.bytesRead, session.bytesWritten, transferred)) {
+            continue;
+        }
+        sessionIo[session.pid] = {session.bytesRead, session.bytesWritten};
+        sessionTransfer[session.pid] = transferred;
+        
+        auto lastTransfer = m_lastSessionTransfer.find(session.pid);
+        uint64_t previous = lastTransfer != m_lastSessionTransfer.end() ? lastTransfer->second : 0;
+        session.active = transferred >= previous && transferred - previous >= ACTIVE_TRANSFER;
+        
+        // A session seen for the first time counts from its smbd's start
+        auto last = m_lastSessionIo.find(session.pid);
+        uint64_t lastRead = last != m_lastSessionIo.end() ? last->second.first : 0;
+        uint64_t lastWritten = last != m_lastSessionIo.end() ? last->second.second : 0;
+        uint64_t deltaRead = session.bytesRead >= lastRead ? session.bytesRead - lastRead : 0;
+        uint64_t deltaWritten = session.bytesWritten >= lastWritten ? session.bytesWritten - lastWritten : 0;
+        
+        addedRead += deltaRead;
+        addedWritten += deltaWritten;
+        if (elapsed > 0 && last != m_lastSessionIo.end()) {
+            session.readRate = deltaRead / elapsed;
+            session.writeRate = deltaWritten / elapsed;
+        }
+    }
+    m_lastSessionIo = std::move(sessionIo);
+    m_lastSessionTransfer = std::move(sessionTransfer);
+    
+    std::vector<Interface> interfaces;
+    readInterfaces(interfaces);
+    for (auto& interface : interfaces) {
+        auto last = m_lastInterfaceBytes.find(interface.name);
+        if (elapsed > 0 && last != m_lastInterfaceBytes.end()) {
+            // Counters restart when a driver is reloaded
+            if (interface.bytesReceived >= last->second.first) {
+                interface.receiveRate = (interface.bytesReceived - last->second.first) / elapsed;
+            }
+            if (interface.bytesSent >= last->second.second) {
+                interface.sendRate = (interface.bytesSent - last->second.second) / elapsed;
+            }
+        }
+        m_lastInterfaceBytes[interface.name] = {interface.bytesReceived, interface.bytesSent};
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_snapshot.sessions = std::move(sessions);
+    m_snapshot.interfaces = std::move(interfaces);
+    m_snapshot.totalBytesRead += addedRead;
+    m_snapshot.totalBytesWritten += addedWritten;
+}
+
+bool SmbStatsCollector::readSessions(std::vector<Session>& sessions) {
+    std::string output;
+    if (m_jsonSupported && runCommand("smbstatus --json --byterange 2>/dev/null", output) &&
+        parseStatusJson(output, sessions)) {
+        return true;
+    }
+    
+    std::string processes;
+    std::string openFiles;
+    if (!runCommand("smbstatus --processes 2>/dev/null", processes)) {
+        return false;
+    }
+    if (m_jsonSupported) {
+        // smbstatus works, only without JSON: Samba before 4.16
+        m_jsonSupported = false;
+        LOG_INFO("smbstatus has no JSON output, SMB lock counts unavailable", "SMB");
+    }
+    runCommand("smbstatus --locks 2>/dev/null", openFiles);
+    parseStatusText(processes, openFiles, sessions);
+    return true;
+}
+
+bool SmbStatsCollector::parseStatusJson(const std::string& text, std::vector<Session>& sessions) {
+    nlohmann::json status = nlohmann::json::parse(text, nullptr, false);
+    if (status.is_discarded() || !status.is_object()) {
+        return false;
+    }
+    
+    std::map<std::string, Session> byPid;
+    auto sessionList = status.find("sessions");
+    if (sessionList != status.end() && sessionList->is_object()) {
+        for (const auto& entry : *sessionList) {
+            std::string pid = serverPid(entry);
+            if (pid.empty()) {
+                continue;
+            }
+            Session& session = byPid[pid];
+            session.pid = pid;
+            session.username = stringField(entry, "username");
+            session.machine = stringField(entry, "remote_machine");
+            session.protocol = stringField(entry, "session_dialect");
+        }
+    }
+    
+    // Each open of a file is listed under the file, keyed by the smbd holding it
+    auto openFiles = status.find("open_files");
+    if (openFiles != status.end() && openFiles->is_object()) {
+        for (const auto& file : *openFiles) {
+            auto opens = file.find("opens");
+            if (opens == file.end() || !opens->is_object()) {
+                continue;
+            }
+            for (const auto& open : *opens) {
+                auto session = byPid.find(serverPid(open));
+                if (session != byPid.end()) {
+                    session->second.openFiles++;
+                }
+            }
+        }
+    }
+    
+    auto lockedFiles = status.find("byte_range_locks");
+    if (lockedFiles != status.end() && lockedFiles->is_object()) {
+        for (const auto& file : *lockedFiles) {
+            auto locks = file.find("locks");
+            if (locks == file.end() || !locks->is_array()) {
+                continue;
+            }
+            for (const auto& lock : *locks) {
+                auto session = byPid.find(serverPid(lock));
+                if (session != byPid.end()) {
+                    session->second.locks++;
+                }
+            }
+        }
+    }
+    
+    sessions.clear();
+    for (auto& [pid, session] : byPid) {
+        sessions.push_back(std::move(session));
+    }
+    return true;
+}
+
+void SmbStatsCollector::parseStatusText(const std::string& processes, const std::string& openFiles,
+                                        std::vector<Session>& sessions) {
+    // PID  Username  Group  Machine (ipv4:address:port)  Protocol Version  Encryption  Signing
+    std::map<std::string, Session> byPid;
+    std::istringstream processLines(processes);
+    std::string line;
+    while (std::getline(processLines, line)) {
+        if (line.empty() || !std::isdigit(static_cast<unsigned char>(line[0]))) {
+            continue;
+        }
+        std::istringstream fields(line);
+        Session session;
+        std::string group;
+        fields >> session.pid >> session.username >> group >> session.machine;
+        
+        // The machine is followed by its address in parentheses
+        std::string field;
+        while (fields >> field) {
+            if (field.back() == ')') {
+                fields >> session.protocol;
+                break;
+            }
+        }
+        byPid[session.pid] = session;
+    }
+    
+    // Pid  User(ID)  DenyMode  Access  R/W  Oplock  SharePath  Name  Time
+    std::istringstream fileLines(openFiles);
+    while (std::getline(fileLines, line)) {
+        if (line.empty() || !std::isdigit(static_cast<unsigned char>(line[0]))) {
+            continue;
+        }
+        auto session = byPid.find(line.substr(0, line.find_first_of(" \t")));
+        if (session != byPid.end()) {
+            session->second.openFiles++;
+        }
+    }
+    
+    sessions.clear();
+    for (auto& [pid, session] : byPid) {
+        sessions.push_back(std::move(session));
+    }
+}
+
+void SmbStatsCollector::readInterfaces(std::vector<Interface>& interfaces) {
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/class/net", ec)) {
+        Interface interface;
+        interface.name = entry.path().filename().string();
+        if (interface.name == "lo") {
+            continue;
+        }
+        
+        std::ifstream received(entry.path() / "statistics" / "rx_bytes");
+        std::ifstream sent(entry.path() / "statistics" / "tx_bytes");
+        if (received >> interface.bytesReceived && sent >> interface.bytesSent) {
+            interfaces.push_back(interface);
+        }
+    }
+}
+
+bool SmbStatsCollector::readProcessIo(const std::string& pid, uint64_t& bytesRead, uint64_t& bytesWritten,
+                                      uint64_t& bytesTransferred) {
+    // read_bytes and write_bytes count what reached the storage layer, rchar and wchar every
+    // read() and write() of the process
+    std::ifstream io("/proc/" + pid + "/io");
+    if (!io) {
+        return false;
+    }
+    
+    std::string key;
+    uint64_t value;
+    int found = 0;
+    while (io >> key >> value) {
+        if (key == "read_bytes:") {
+            bytesRead = value;
+            found++;
+        } else if (key == "write_bytes:") {
+            bytesWritten = value;
+            found++;
+        } else if (key == "rchar:" || key == "wchar:") {
+            bytesTransferred += value;
+            found++;
+        }
+    }
+    return found == 4;
+}
+
+bool SmbStatsCollector::runCommand(const std::string& command, std::string& output) {
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) {
+        return false;
+    }
+    
+    output.clear();
+    char buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, length);
+    }
+    return pclose(pipe) == 0;
+}
\ No newline at end of file
@@ -0,0 +1,587 @@
+#include "network/SmbWriteStager.hpp"
+#include "core/UsbBridge.hpp"
+#include "utils/Logger.hpp"
+#include <filesystem>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <linux/fs.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+const std::string SmbWriteStager::CLIENT_ID = "smb";
+const std::chrono::seconds SmbWriteStager::RECLAIM_IDLE(60);
+const std::chrono::seconds SmbWriteStager::FLUSH_TIMEOUT(120);
+const std::chrono::seconds SmbWriteStager::USAGE_INTERVAL(5);
+
+namespace {
+
+// A hard link where the layer and the buffer share a filesystem, then a reflink (btrfs, XFS),
+// a copy only as the last resort. A link shares the layer's inode, which is safe because the
+// overlay stays down, so nothing writes to the file, until the queue has written it all;
+// clearing the layer afterwards only drops the layer's name for it.
+bool snapshotFile(const std::string& from, const std::string& to) {
+    if (link(from.c_str(), to.c_str()) == 0) {
+        return true;
+    }
+    
+    int source = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (source < 0) {
+        return false;
+    }
+    int target = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (target < 0) {
+        close(source);
+        return false;
+    }
+    bool cloned = ioctl(target, FICLONE, source) == 0;
+    close(source);
+    close(target);
+    if (cloned) {
+        return true;
+    }
+    
+    std::error_code ec;
+    return fs::copy_file(from, to, fs::copy_options::overwrite_existing, ec);
+}
+
+}
+
+SmbWriteStager::SmbWriteStager(usb_bridge::UsbBridge* bridge, const std::string& drivePath, const std::string& stagingPath)
+    : m_bridge(bridge)
+    , m_drivePath(drivePath)
+    , m_upperPath(stagingPath + "/upper")
+    , m_workPath(stagingPath + "/work")
+    , m_mergedPath(stagingPath + "/share")
+    , m_running(false)
+    , m_mounted(false)
+    , m_inotifyFd(-1)
+    , m_tracker(std::make_shared<CommitTracker>())
+{
+}
+
+SmbWriteStager::~SmbWriteStager() {
+    stop();
+}
+
+bool SmbWriteStager::start() {
+    if (m_running) {
+        return true;
+    }
+    
+    std::error_code ec;
+    for (const auto& path : {m_upperPath, m_workPath, m_mergedPath}) {
+        fs::create_directories(path, ec);
+        if (ec) {
+            LOG_ERROR("Failed to create " + path + ": " + ec.message(), "SMB");
+            return false;
+        }
+    }
+    // Guests connecting while the overlay is down for a commit can't write to the bare mount point
+    chmod(m_mergedPath.c_str(), 0555);
+    
+    m_tracker = std::make_shared<CommitTracker>();
+    if (!recover()) {
+        return false;
+    }
+    
+    if (!mountOverlay()) {
+        return false;
+    }
+    if (!resetWatches()) {
+        unmountOverlay();
+        return false;
+    }
+    
+    updateLayerUsage();
+    m_lastActivity = std::chrono::steady_clock::now();
+    m_running = true;
+    m_watchThread = std::thread(&SmbWriteStager::watchLoop, this);
+    
+    LOG_INFO("SMB writes staged in " + m_upperPath, "SMB");
+    return true;
+}
+
+bool SmbWriteStager::stop() {
+    if (!m_running) {
+        return true;
+    }
+    
+    m_running = false;
+    if (m_watchThread.joinable()) {
+        m_watchThread.join();
+    }
+    
+    close(m_inotifyFd);
+    m_inotifyFd = -1;
+    m_watches.clear();
+    
+    // Unmounted already when stop() interrupted a reclaim, whose commits are then in the queue
+    if (m_mounted) {
+        if (unmountOverlay()) {
+            commitLayer();
+        } else {
+            LOG_WARNING("SMB staging overlay still in use, its changes are committed on the next start", "SMB");
+        }
+    }
+    
+    // Anything not yet on the drive keeps the layer; the next start commits it again
+    bool flushed = !m_mounted && waitForCommits(FLUSH_TIMEOUT) && takeFailures() == 0 && m_dirty.empty();
+    if (flushed) {
+        clearUpperLayer();
+        m_committed.clear();
+    }
+    updateLayerUsage();
+    
+    LOG_INFO("SMB write staging stopped", "SMB");
+    return flushed;
+}
+
+SmbWriteStager::Statistics SmbWriteStager::getStatistics() const {
+    Statistics stats;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stats = m_stats;
+        stats.pendingPaths = m_dirty.size();
+    }
+    
+    std::lock_guard<std::mutex> lock(m_tracker->mutex);
+    stats.outstandingWrites = m_tracker->outstanding;
+    stats.failedWrites = m_tracker->failed;
+    return stats;
+}
+
+void SmbWriteStager::watchLoop() {
+    alignas(inotify_event) char buffer[16 * 1024];
+    
+    while (m_running) {
+        if (!m_mounted) {
+            // Reclaiming: the overlay stays down until the queue has written the whole layer
+            if (waitForCommits(std::chrono::milliseconds(500)) && !remount()) {
+                std::this_thread::sleep_for(std::chrono::seconds(5));
+            }
+            continue;
+        }
+        
+        pollfd pfd = {m_inotifyFd, POLLIN, 0};
+        int result = poll(&pfd, 1, 500);
+        if (result < 0 && errno != EINTR) {
+            LOG_ERROR("Failed to wait for SMB write events: " + std::string(strerror(errno)), "SMB");
+            break;
+        }
+        
+        if (result > 0) {
+            ssize_t length = read(m_inotifyFd, buffer, sizeof(buffer));
+            if (length > 0) {
+                handleEvents(buffer, static_cast<size_t>(length));
+            }
+        }
+        
+        if (m_lastActivity > m_lastUsageUpdate && std::chrono::steady_clock::now() - m_lastUsageUpdate >= USAGE_INTERVAL) {
+            updateLayerUsage();
+        }
+        
+        bool changed;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            changed = !m_dirty.empty();
+        }
+        if (changed && std::chrono::steady_clock::now() - m_lastActivity >= RECLAIM_IDLE) {
+            reclaim();
+        }
+    }
+}
+
+void SmbWriteStager::handleEvents(const char* buffer, size_t length) {
+    size_t offset = 0;
+    while (offset < length) {
+        const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+        offset += sizeof(inotify_event) + event->len;
+        
+        if (event->mask & IN_Q_OVERFLOW) {
+            // Events were lost; every path in the layer is looked at again
+            LOG_WARNING("SMB write events overflowed, rescanning the staging layer", "SMB");
+            watchTree("");
+            continue;
+        }
+        
+        auto watch = m_watches.find(event->wd);
+        if (watch == m_watches.end()) {
+            continue;
+        }
+        if (event->mask & IN_IGNORED) {
+            m_watches.erase(watch);
+            continue;
+        }
+        if (event->len == 0) {
+            continue;
+        }
+        
+        std::string name(event->name);
+        std::string relativePath = watch->second.empty() ? name : watch->second + "/" + name;
+        
+        if (event->mask & IN_ISDIR) {
+            if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                watchTree(relativePath);
+            } else if (event->mask & IN_MOVED_FROM) {
+                unwatchTree(relativePath);
+            }
+        }
+        markDirty(relativePath);
+        m_lastActivity = std::chrono::steady_clock::now();
+    }
+}
+
+void SmbWriteStager::watchTree(const std::string& relativePath) {
+    std::string path = upperPath(relativePath);
+    int wd = inotify_add_watch(m_inotifyFd, path.c_str(),
+        IN_CREATE | IN_CLOSE_WRITE | IN_MODIFY | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR);
+    if (wd < 0) {
+        LOG_WARNING("Failed to watch " + path + ": " + std::string(strerror(errno)), "SMB");
+        return;
+    }
+    m_watches[wd] = relativePath;
+    
+    // Whatever was created before the watch existed
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(path, ec)) {
+        std::string child = relativePath.empty() ? entry.path().filename().string()
+                                                 : relativePath + "/" + entry.path().filename().string();
+        if (entry.is_directory(ec) && !entry.is_symlink(ec)) {
+            watchTree(child);
+        }
+        markDirty(child);
+    }
+}
+
+void SmbWriteStager::unwatchTree(const std::string& relativePath) {
+    for (auto it = m_watches.begin(); it != m_watches.end();) {
+        const std::string& path = it->second;
+        if (path == relativePath || path.compare(0, relativePath.length() + 1, relativePath + "/") == 0) {
+            inotify_rm_watch(m_inotifyFd, it->first);
+            it = m_watches.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SmbWriteStager::markDirty(const std::string& relativePath) {
+    if (relativePath.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_dirty[relativePath] = std::chrono::steady_clock::now();
+}
+
+void SmbWriteStager::commit() {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<std::string> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& entry : m_dirty) {
+            ready.push_back(entry.first);
+        }
+    }
+    if (ready.empty()) {
+        return;
+    }
+    
+    // A delete queued behind an earlier write to the same path would run first:
+    // deletes go straight to the operation queue, writes wait in the write queue
+    bool writesOutstanding;
+    {
+        std::lock_guard<std::mutex> lock(m_tracker->mutex);
+        writesOutstanding = m_tracker->outstanding > 0;
+    }
+    
+    auto& queue = m_bridge->getOperationQueue();
+    std::vector<usb_bridge::WriteBatchItem> items;
+    std::vector<std::string> deletes;
+    std::vector<std::string> retry;
+    std::vector<std::string> done;
+    uint64_t bytes = 0;
+    uint64_t directories = 0;
+    
+    for (const auto& relativePath : ready) {
+        std::string upper = upperPath(relativePath);
+        std::string drive = drivePath(relativePath);
+        std::error_code ec;
+        struct stat st;
+        
+        bool deleted = lstat(upper.c_str(), &st) != 0;
+        bool whiteout = !deleted && S_ISCHR(st.st_mode) && st.st_rdev == 0;
+        
+        if (deleted || whiteout) {
+            // A whiteout hides a drive entry; a path missing from the layer only needs
+            // deleting if it was created here and committed before
+            bool onDrive = fs::exists(fs::symlink_status(drive, ec));
+            if (onDrive && (whiteout || m_committed.count(relativePath))) {
+                if (writesOutstanding) {
+                    retry.push_back(relativePath);
+                    continue;
+                }
+                deletes.push_back(drive);
+            }
+            m_committed.erase(relativePath);
+        } else if (S_ISDIR(st.st_mode)) {
+            // An opaque directory replaced a deleted one of the same name
+            char opaque = 0;
+            bool replaced = getxattr(upper.c_str(), "trusted.overlay.opaque", &opaque, 1) == 1 && opaque == 'y' &&
+                            fs::exists(fs::symlink_status(drive, ec));
+            if (replaced) {
+                if (writesOutstanding) {
+                    retry.push_back(relativePath);
+                    continue;
+                }
+                deletes.push_back(drive);
+            }
+            if (replaced || !fs::is_directory(drive, ec)) {
+                usb_bridge::WriteBatchItem item;
+                item.drivePath = drive;
+                item.isDirectory = true;
+                items.push_back(std::move(item));
+                m_committed.insert(relativePath);
+                directories++;
+            }
+        } else if (S_ISREG(st.st_mode)) {
+            uint64_t size = static_cast<uint64_t>(st.st_size);
+            std::string bufferPath = queue.allocateLocalBuffer(CLIENT_ID, size);
+            if (bufferPath.empty()) {
+                retry.push_back(relativePath);
+                continue;
+            }
+            
+            if (!snapshotFile(upper, bufferPath)) {
+                LOG_ERROR("Failed to stage " + relativePath + ": " + std::string(strerror(errno)), "SMB");
+                queue.releaseLocalBuffer(bufferPath, size);
+                retry.push_back(relativePath);
+                continue;
+            }
+            
+            usb_bridge::WriteBatchItem item;
+            item.localPath = bufferPath;
+            item.drivePath = drive;
+            item.fileSize = size;
+            items.push_back(std::move(item));
+            m_committed.insert(relativePath);
+            bytes += size;
+        }
+        // Symlinks, devices and FIFOs have no place on the drive
+        done.push_back(relativePath);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& path : done) {
+            m_dirty.erase(path);
+        }
+        // Tried again when the share is next idle
+        for (const auto& path : retry) {
+            m_dirty[path] = now;
+        }
+        m_stats.filesCommitted += items.size() - directories;
+        m_stats.bytesCommitted += bytes;
+        m_stats.directoriesCommitted += directories;
+        m_stats.deletesCommitted += deletes.size();
+    }
+    
+    if (items.empty() && deletes.empty()) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_tracker->mutex);
+        m_tracker->outstanding += items.size() + deletes.size();
+    }
+    std::shared_ptr<CommitTracker> tracker = m_tracker;
+    auto completed = [tracker](const usb_bridge::FileOperation& op) {
+        std::lock_guard<std::mutex> lock(tracker->mutex);
+        tracker->outstanding--;
+        if (op.status == usb_bridge::OperationStatus::FAILED) {
+            tracker->failed++;
+            LOG_ERROR("SMB change to " + (op.destPath.empty() ? op.sourcePath : op.destPath) +
+                      " failed, kept in the staging layer", "SMB");
+        }
+        if (tracker->outstanding == 0) {
+            tracker->settled.notify_all();
+        }
+    };
+    
+    for (const auto& path : deletes) {
+        m_bridge->clientDeleteFile(CLIENT_ID, usb_bridge::ClientType::NETWORK_SMB, path, completed);
+    }
+    if (!items.empty()) {
+        m_bridge->clientWriteBatch(CLIENT_ID, usb_bridge::ClientType::NETWORK_SMB, std::move(items), completed);
+    }
+}
+
+bool SmbWriteStager::reclaim() {
+    // Fails while a client is connected, smbd then has its working directory in the share
+    m_lastActivity = std::chrono::steady_clock::now();
+    if (!unmountOverlay()) {
+        return false;
+    }
+    
+    // The watch loop mounts the overlay again once the queue has written all of it
+    commitLayer();
+    return true;
+}
+
+bool SmbWriteStager::remount() {
+    if (takeFailures() == 0 && m_dirty.empty()) {
+        clearUpperLayer();
+        m_committed.clear();
+        LOG_INFO("SMB staging layer committed and emptied", "SMB");
+    } else {
+        // Marked again by the new watches, and retried the next time the share is idle
+        LOG_WARNING("Some SMB changes didn't reach the drive, kept in the staging layer", "SMB");
+    }
+    updateLayerUsage();
+    
+    if (!mountOverlay()) {
+        return false;
+    }
+    if (!resetWatches()) {
+        LOG_ERROR("Failed to watch the SMB staging layer, changes are committed on stop", "SMB");
+    }
+    return true;
+}
+
+size_t SmbWriteStager::commitLayer() {
+    // Only called with the overlay unmounted, so neither layer changes underneath; events
+    // may have been lost, the layer itself is what gets committed
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(m_upperPath, ec); !ec && it != fs::recursive_directory_iterator();
+         it.increment(ec)) {
+        markDirty(fs::relative(it->path(), m_upperPath, ec).string());
+    }
+    
+    size_t paths;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        paths = m_dirty.size();
+    }
+    // The files are counted again as the commit allocates their snapshots
+    m_bridge->getOperationQueue().setExternalBufferUsage(0);
+    commit();
+    return paths;
+}
+    
+bool SmbWriteStager::waitForCommits(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(m_tracker->mutex);
+    return m_tracker->settled.wait_for(lock, timeout, [this] { return m_tracker->outstanding == 0; });
+}
+
+uint64_t SmbWriteStager::takeFailures() {
+    std::lock_guard<std::mutex> lock(m_tracker->mutex);
+    uint64_t failed = m_tracker->failed;
+    m_tracker->failed = 0;
+    return failed;
+}
+
+bool SmbWriteStager::recover() {
+    std::error_code ec;
+    if (fs::is_empty(m_upperPath, ec)) {
+        return true;
+    }
+    
+    // Left by a crash or a stop with writes still outstanding; everything in it is committed
+    // again, which at worst rewrites files that already reached the drive. The overlay can
+    // only go up once the drive has stopped changing.
+    size_t staged = commitLayer();
+    if (!waitForCommits(FLUSH_TIMEOUT)) {
+        LOG_ERROR("Staged SMB changes still being written, not mounting the overlay", "SMB");
+        return false;
+    }
+    
+    if (takeFailures() == 0 && m_dirty.empty()) {
+        clearUpperLayer();
+        m_committed.clear();
+    }
+    LOG_INFO("Recovered " + std::to_string(staged) + " staged SMB changes", "SMB");
+    return true;
+}
+
+bool SmbWriteStager::mountOverlay() {
+    // Metadata-only copy-ups would leave files in the upper layer without their data
+    std::string options = "lowerdir=" + m_drivePath + ",upperdir=" + m_upperPath + ",workdir=" + m_workPath +
+                          ",redirect_dir=off,index=off,metacopy=off";
+    if (mount("overlay", m_mergedPath.c_str(), "overlay", 0, options.c_str()) != 0) {
+        LOG_ERROR("Failed to mount the SMB staging overlay over " + m_drivePath + ": " +
+                  std::string(strerror(errno)), "SMB");
+        return false;
+    }
+    m_mounted = true;
+    return true;
+}
+
+bool SmbWriteStager::unmountOverlay() {
+    if (!m_mounted) {
+        return true;
+    }
+    if (umount2(m_mergedPath.c_str(), 0) != 0) {
+        if (errno != EBUSY) {
+            LOG_WARNING("Failed to unmount " + m_mergedPath + ": " + std::string(strerror(errno)), "SMB");
+        }
+        return false;
+    }
+    m_mounted = false;
+    return true;
+}
+
+void SmbWriteStager::clearUpperLayer() {
+    std::error_code ec;
+    for (const auto& root : {m_upperPath, m_workPath}) {
+        for (const auto& entry : fs::directory_iterator(root, ec)) {
+            fs::remove_all(entry.path(), ec);
+        }
+    }
+}
+
+void SmbWriteStager::updateLayerUsage() {
+    // Allocated blocks rather than sizes: a client may write a sparse file
+    uint64_t bytes = 0;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(m_upperPath, ec); !ec && it != fs::recursive_directory_iterator();
+         it.increment(ec)) {
+        struct stat st;
+        if (lstat(it->path().c_str(), &st) == 0) {
+            bytes += static_cast<uint64_t>(st.st_blocks) * 512;
+        }
+    }
+    
+    m_bridge->getOperationQueue().setExternalBufferUsage(bytes);
+    m_lastUsageUpdate = std::chrono::steady_clock::now();
+}
+
+bool SmbWriteStager::resetWatches() {
+    if (m_inotifyFd >= 0) {
+        close(m_inotifyFd);
+    }
+    m_watches.clear();
+    
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0) {
+        LOG_ERROR("Failed to initialize inotify for SMB staging", "SMB");
+        return false;
+    }
+    
+    watchTree("");
+    return !m_watches.empty();
+}
+
+std::string SmbWriteStager::upperPath(const std::string& relativePath) const {
+    return relativePath.empty() ? m_upperPath : m_upperPath + "/" + relativePath;
+}
+
+std::string SmbWriteStager::drivePath(const std::string& relativePath) const {
+    return m_drivePath + "/" + relativePath;
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "network/StaticAssetCache.hpp"
+#include "utils/Logger.hpp"
+#include "utils/FileUtils.hpp"
+#include <zlib.h>
+#ifdef HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+
+#ifdef EMBED_WEB_ASSETS
+extern const EmbeddedAsset g_embeddedWebAssets[];
+extern const size_t g_embeddedWebAssetCount;
+#endif
+
+// Below this the compressed variant is rarely worth the extra header
+const size_t StaticAssetCache::MIN_COMPRESS_SIZE = 256;
+
+size_t StaticAssetCache::loadDirectory(const std::string& root) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(root, ec)) {
+        LOG_WARNING("Web interface directory not found: " + root, "HTTP");
+        return 0;
+    }
+    
+    size_t loaded = 0;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(root, ec)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        
+        std::ifstream file(entry.path(), std::ios::binary);
+        std::ostringstream content;
+        content << file.rdbuf();
+        if (!file) {
+            LOG_WARNING("Failed to read web asset: " + entry.path().string(), "HTTP");
+            continue;
+        }
+        
+        std::string relativePath = "/" + std::filesystem::relative(entry.path(), root).generic_string();
+        addAsset(relativePath, content.str());
+        loaded++;
+    }
+    
+    return loaded;
+}
+
+size_t StaticAssetCache::loadEmbedded() {
+#ifdef EMBED_WEB_ASSETS
+    for (size_t i = 0; i < g_embeddedWebAssetCount; ++i) {
+        const EmbeddedAsset& embedded = g_embeddedWebAssets[i];
+        addAsset(embedded.path, std::string(reinterpret_cast<const char*>(embedded.data), embedded.size));
+    }
+    return g_embeddedWebAssetCount;
+#else
+    return 0;
+#endif
+}
+
+const StaticAssetCache::Asset* StaticAssetCache::find(const std::string& path) const {
+    auto it = m_assets.find(path);
+    return it != m_assets.end() ? &it->second : nullptr;
+}
+
+uint64_t StaticAssetCache::getMemoryUsage() const {
+    uint64_t total = 0;
+    for (const auto& pair : m_assets) {
+        const Asset& asset = pair.second;
+        total += asset.identity->size();
+        total += asset.gzip ? asset.gzip->size() : 0;
+        total += asset.brotli ? asset.brotli->size() : 0;
+    }
+    return total;
+}
+
+void StaticAssetCache::addAsset(const std::string& path, std::string content) {
+    Asset asset;
+    asset.contentType = FileUtils::getMimeType(path);
+    asset.etag = computeETag(content);
+    asset.cacheControl = getCacheControl(path);
+    
+    // Variants are only kept when they are actually smaller
+    if (content.size() >= MIN_COMPRESS_SIZE) {
+        std::string gzipped = gzipCompress(content);
+        if (!gzipped.empty() && gzipped.size() < content.size()) {
+            asset.gzip = std::make_shared<const std::string>(std::move(gzipped));
+        }
+        
+        std::string brotli = brotliCompress(content);
+        if (!brotli.empty() && brotli.size() < content.size()) {
+            asset.brotli = std::make_shared<const std::string>(std::move(brotli));
+        }
+    }
+    
+    asset.identity = std::make_shared<const std::string>(std::move(content));
+    m_assets[path] = std::move(asset);
+}
+
+std::string StaticAssetCache::computeETag(const std::string& content) {
+    // FNV-1a over the content: stable across restarts and builds, unlike mtime-based tags
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : content) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    
+    char text[32];
+    snprintf(text, sizeof(text), "%016llx-%zx", static_cast<unsigned long long>(hash), content.size());
+    return text;
+}
+
+std::string StaticAssetCache::gzipCompress(const std::string& content) {
+    z_stream stream = {};
+    
+    // windowBits 15 + 16 selects the gzip wrapper
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return "";
+    }
+    
+    std::string compressed(deflateBound(&stream, content.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(content.data()));
+    stream.avail_in = static_cast<uInt>(content.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+    stream.avail_out = static_cast<uInt>(compressed.size());
+    
+    int result = deflate(&stream, Z_FINISH);
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+    
+    return result == Z_STREAM_END ? compressed : "";
+}
+
+std::string StaticAssetCache::brotliCompress(const std::string& content) {
+#ifdef HAVE_BROTLI
+    size_t encodedSize = BrotliEncoderMaxCompressedSize(content.size());
+    if (encodedSize == 0) {
+        return "";
+    }
+    
+    std::string compressed(encodedSize, '\0');
+    if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                               content.size(), reinterpret_cast<const uint8_t*>(content.data()),
+                               &encodedSize, reinterpret_cast<uint8_t*>(&compressed[0]))) {
+        return "";
+    }
+    compressed.resize(encodedSize);
+    return compressed;
+#else
+    (void)content;
+    return "";
+#endif
+}
+
+std::string StaticAssetCache::getCacheControl(const std::string& path) {
+    // The page itself is always revalidated so a firmware update shows up immediately;
+    // scripts and styles may be reused for a while and are cheap to revalidate after that
+    if (path.size() >= 5 && path.compare(path.size() - 5, 5, ".html") == 0) {
+        return "no-cache";
+    }
+    return "public, max-age=300";
+}
\ No newline at end of file
@@ -0,0 +1,284 @@
+#include "network/TarStreamReader.hpp"
+#include <cstring>
+#include <algorithm>
+
+// pax and GNU long-name entries only ever carry a path or two
+const size_t TarStreamReader::MAX_METADATA_SIZE = 64 * 1024;
+
+TarStreamReader::TarStreamReader(EntryHandler onEntry, DataHandler onData, EndHandler onEnd)
+    : m_onEntry(std::move(onEntry))
+    , m_onData(std::move(onData))
+    , m_onEnd(std::move(onEnd))
+{
+}
+
+bool TarStreamReader::feed(std::string_view data) {
+    if (!m_error.empty()) {
+        return false;
+    }
+    
+    while (!data.empty()) {
+        switch (m_state) {
+            case State::HEADER: {
+                size_t take = std::min(sizeof(m_header) - m_headerFill, data.length());
+                memcpy(m_header + m_headerFill, data.data(), take);
+                m_headerFill += take;
+                data.remove_prefix(take);
+                
+                if (m_headerFill == sizeof(m_header)) {
+                    m_headerFill = 0;
+                    if (!processHeader()) {
+                        return false;
+                    }
+                }
+                break;
+            }
+            
+            case State::DATA:
+            case State::METADATA:
+            case State::SKIP: {
+                size_t take = static_cast<size_t>(std::min<uint64_t>(m_remaining, data.length()));
+                if (m_state == State::DATA) {
+                    if (!m_onData(data.substr(0, take))) {
+                        return fail("Failed to store archive entry");
+                    }
+                } else if (m_state == State::METADATA) {
+                    m_metadata.append(data.data(), take);
+                }
+                m_remaining -= take;
+                data.remove_prefix(take);
+                
+                if (m_remaining == 0 && !finishEntryData()) {
+                    return false;
+                }
+                break;
+            }
+            
+            case State::PADDING: {
+                size_t take = static_cast<size_t>(std::min<uint64_t>(m_remaining, data.length()));
+                m_remaining -= take;
+                data.remove_prefix(take);
+                if (m_remaining == 0) {
+                    m_state = State::HEADER;
+                }
+                break;
+            }
+            
+            case State::END:
+                // Writers pad the archive to a whole record; whatever follows the marker is ignored
+                return true;
+        }
+    }
+    
+    return true;
+}
+
+bool TarStreamReader::isComplete() const {
+    return m_error.empty() && (m_state == State::END || (m_state == State::HEADER && m_headerFill == 0));
+}
+
+bool TarStreamReader::processHeader() {
+    if (std::all_of(m_header, m_header + sizeof(m_header), [](char c) { return c == 0; })) {
+        m_state = State::END;
+        return true;
+    }
+    
+    if (!verifyChecksum(m_header)) {
+        return fail("Invalid tar header checksum");
+    }
+    
+    uint64_t size;
+    if (!parseNumber(m_header + 124, 12, size)) {
+        return fail("Invalid tar entry size");
+    }
+    
+    char type = m_header[156];
+    bool isFile = type == '0' || type == '\0' || type == '7';
+    bool isDirectory = type == '5';
+    
+    std::string path;
+    if (isFile || isDirectory) {
+        // pax and GNU headers in front of an entry override its own fields
+        if (m_hasNextSize) {
+            size = m_nextSize;
+        }
+        if (!m_nextPath.empty()) {
+            path = m_nextPath;
+        } else {
+            path.assign(m_header, strnlen(m_header, 100));
+            if (memcmp(m_header + 257, "ustar", 5) == 0 && m_header[345] != '\0') {
+                path = std::string(m_header + 345, strnlen(m_header + 345, 155)) + "/" + path;
+            }
+        }
+        m_nextPath.clear();
+        m_hasNextSize = false;
+    }
+    
+    m_remaining = size;
+    m_padding = (512 - size % 512) % 512;
+    
+    if (type == 'x' || type == 'L') {
+        if (size > MAX_METADATA_SIZE) {
+            return fail("Tar metadata entry too large");
+        }
+        m_metadataType = type;
+        m_metadata.clear();
+        m_state = State::METADATA;
+    } else if (isFile || isDirectory) {
+        Entry entry;
+        if (!normalizePath(path, entry.path)) {
+            return fail("Unsafe path in archive: " + path);
+        }
+        entry.size = isDirectory ? 0 : size;
+        entry.isDirectory = isDirectory;
+        
+        // "./" itself names the extraction directory, which already exists
+        if (entry.path.empty()) {
+            m_state = State::SKIP;
+        } else {
+            if (!m_onEntry(entry)) {
+                return fail("Failed to store archive entry");
+            }
+            m_state = isDirectory ? State::SKIP : State::DATA;
+        }
+    } else {
+        // Links, devices, FIFOs, global pax headers and vendor extensions
+        m_state = State::SKIP;
+    }
+    
+    if (m_remaining == 0) {
+        return finishEntryData();
+    }
+    return true;
+}
+
+bool TarStreamReader::finishEntryData() {
+    if (m_state == State::DATA && !m_onEnd()) {
+        return fail("Failed to store archive entry");
+    }
+    
+    if (m_state == State::METADATA) {
+        if (m_metadataType == 'x') {
+            parsePaxRecords(m_metadata);
+        } else {
+            m_nextPath.assign(m_metadata.c_str(), strnlen(m_metadata.c_str(), m_metadata.length()));
+        }
+        m_metadata.clear();
+    }
+    
+    m_remaining = m_padding;
+    m_state = m_padding > 0 ? State::PADDING : State::HEADER;
+    return true;
+}
+
+bool TarStreamReader::fail(const std::string& error) {
+    m_error = error;
+    return false;
+}
+
+void TarStreamReader::parsePaxRecords(const std::string& records) {
+    // Each record is "<length> <key>=<value>\n", the length covering the whole record
+    size_t pos = 0;
+    while (pos < records.length()) {
+        size_t space = records.find(' ', pos);
+        if (space == std::string::npos) {
+            return;
+        }
+        
+        uint64_t length = 0;
+        for (size_t i = pos; i < space; ++i) {
+            if (records[i] < '0' || records[i] > '9' || length > records.length()) {
+                return;
+            }
+            length = length * 10 + (records[i] - '0');
+        }
+        if (length <= space - pos + 1 || pos + length > records.length() || records[pos + length - 1] != '\n') {
+            return;
+        }
+        
+        std::string record = records.substr(space + 1, pos + length - space - 2);
+        size_t equals = record.find('=');
+        if (equals != std::string::npos) {
+            std::string key = record.substr(0, equals);
+            std::string value = record.substr(equals + 1);
+            
+            if (key == "path") {
+                m_nextPath = value;
+            } else if (key == "size" && !value.empty() &&
+                       value.find_first_not_of("0123456789") == std::string::npos && value.length() < 20) {
+                m_nextSize = std::stoull(value);
+                m_hasNextSize = true;
+            }
+        }
+        pos += length;
+    }
+}
+
+bool TarStreamReader::parseNumber(const char* field, size_t length, uint64_t& value) {
+    value = 0;
+    
+    // GNU base-256 for values that don't fit the octal field
+    if (static_cast<unsigned char>(field[0]) & 0x80) {
+        for (size_t i = 1; i < length; ++i) {
+            if (value >> 56) {
+                return false;
+            }
+            value = (value << 8) | static_cast<unsigned char>(field[i]);
+        }
+        return true;
+    }
+    
+    size_t i = 0;
+    while (i < length && (field[i] == ' ' || field[i] == '\0')) {
+        i++;
+    }
+    for (; i < length && field[i] != ' ' && field[i] != '\0'; ++i) {
+        if (field[i] < '0' || field[i] > '7' || (value >> 61)) {
+            return false;
+        }
+        value = (value << 3) | static_cast<uint64_t>(field[i] - '0');
+    }
+    return true;
+}
+
+bool TarStreamReader::verifyChecksum(const char* header) {
+    uint64_t stored;
+    if (!parseNumber(header + 148, 8, stored)) {
+        return false;
+    }
+    
+    // The checksum field itself counts as spaces; old writers summed signed chars
+    uint64_t unsignedSum = 0;
+    int64_t signedSum = 0;
+    for (int i = 0; i < 512; ++i) {
+        char c = (i >= 148 && i < 156) ? ' ' : header[i];
+        unsignedSum += static_cast<unsigned char>(c);
+        signedSum += static_cast<signed char>(c);
+    }
+    return stored == unsignedSum || static_cast<int64_t>(stored) == signedSum;
+}
+
+bool TarStreamReader::normalizePath(const std::string& path, std::string& normalized) {
+    normalized.clear();
+    
+    size_t pos = 0;
+    while (pos <= path.length()) {
+        size_t end = path.find('/', pos);
+        if (end == std::string::npos) {
+            end = path.length();
+        }
+        
+        std::string component = path.substr(pos, end - pos);
+        if (component == "..") {
+            return false;
+        }
+        if (!component.empty() && component != ".") {
+            if (!normalized.empty()) {
+                normalized += '/';
+            }
+            normalized += component;
+        }
+        pos = end + 1;
+    }
+    return true;
+}
\ No newline at end of file
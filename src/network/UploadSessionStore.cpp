@@ -0,0 +1,238 @@
+#include "network/UploadSessionStore.hpp"
+#include "utils/Logger.hpp"
+#include <sys/stat.h>
+#include <sys/random.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+
+const std::chrono::hours UploadSessionStore::EXPIRY(24);
+
+size_t UploadSessionStore::load(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_directory = directory;
+    
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        return 0;
+    }
+    
+    size_t loaded = 0;
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.length() <= 7 || name.compare(name.length() - 7, 7, ".upload") != 0) {
+            continue;
+        }
+        
+        Session session;
+        session.id = name.substr(0, name.length() - 7);
+        
+        // One "key=value" per line, written by writeSessionFile()
+        std::ifstream file(directory + "/" + name);
+        std::string line;
+        while (std::getline(file, line)) {
+            size_t equals = line.find('=');
+            if (equals == std::string::npos) {
+                continue;
+            }
+            std::string key = line.substr(0, equals);
+            std::string value = line.substr(equals + 1);
+            
+            if (key == "client") {
+                session.clientId = value;
+            } else if (key == "buffer") {
+                session.bufferPath = value;
+            } else if (key == "dest") {
+                session.destPath = value;
+            } else if (key == "length") {
+                session.length = std::strtoull(value.c_str(), nullptr, 10);
+            }
+        }
+        
+        // The buffer file is all that was received; the space it takes was counted when
+        // the buffer directory was scanned at startup, the rest is reserved as data arrives
+        struct stat st;
+        if (session.bufferPath.empty() || session.destPath.empty() ||
+            stat(session.bufferPath.c_str(), &st) != 0 || static_cast<uint64_t>(st.st_size) > session.length) {
+            LOG_WARNING("Discarding broken upload session " + session.id, "HTTP");
+            unlink((directory + "/" + name).c_str());
+            continue;
+        }
+        session.offset = st.st_size;
+        session.reserved = st.st_size;
+        
+        Entry& stored = m_sessions[session.id];
+        stored.session = session;
+        stored.lastActivity = std::chrono::steady_clock::now();
+        loaded++;
+    }
+    closedir(dir);
+    
+    return loaded;
+}
+
+bool UploadSessionStore::create(Session& session) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    do {
+        session.id = generateId();
+        if (session.id.empty()) {
+            LOG_ERROR("No randomness available for an upload ID", "HTTP");
+            return false;
+        }
+    } while (m_sessions.count(session.id));
+    
+    if (!writeSessionFile(session)) {
+        return false;
+    }
+    
+    Entry& stored = m_sessions[session.id];
+    stored.session = session;
+    stored.lastActivity = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool UploadSessionStore::get(const std::string& id, Session& session) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    auto it = m_sessions.find(id);
+    if (it == m_sessions.end()) {
+        return false;
+    }
+    session = it->second.session;
+    return true;
+}
+
+UploadSessionStore::Claim UploadSessionStore::claim(const std::string& id, Session& session) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    auto it = m_sessions.find(id);
+    if (it == m_sessions.end()) {
+        return Claim::NOT_FOUND;
+    }
+    if (it->second.busy) {
+        return Claim::BUSY;
+    }
+    
+    it->second.busy = true;
+    session = it->second.session;
+    return Claim::CLAIMED;
+}
+
+void UploadSessionStore::release(const Session& session) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    auto it = m_sessions.find(session.id);
+    if (it != m_sessions.end()) {
+        it->second.session = session;
+        it->second.busy = false;
+        it->second.lastActivity = std::chrono::steady_clock::now();
+    }
+}
+
+void UploadSessionStore::remove(const std::string& id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    m_sessions.erase(id);
+    unlink(sessionFilePath(id).c_str());
+}
+
+std::vector<UploadSessionStore::Session> UploadSessionStore::takeExpired() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    std::vector<Session> expired;
+    auto now = std::chrono::steady_clock::now();
+    
+    for (auto it = m_sessions.begin(); it != m_sessions.end();) {
+        if (!it->second.busy && now - it->second.lastActivity > EXPIRY) {
+            expired.push_back(it->second.session);
+            unlink(sessionFilePath(it->first).c_str());
+            it = m_sessions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return expired;
+}
+
+std::string UploadSessionStore::sessionFilePath(const std::string& id) const {
+    return m_directory + "/" + id + ".upload";
+}
+
+bool UploadSessionStore::writeSessionFile(const Session& session) const {
+    if (m_directory.empty()) {
+        return false;
+    }
+    
+    // Written aside and renamed into place, so a crash never leaves half a session file
+    std::string path = sessionFilePath(session.id);
+    std::string temporary = path + ".new";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        file << "client=" << session.clientId << "\n"
+             << "buffer=" << session.bufferPath << "\n"
+             << "dest=" << session.destPath << "\n"
+             << "length=" << session.length << "\n";
+        if (!file.flush()) {
+            unlink(temporary.c_str());
+            return false;
+        }
+    }
+    
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string UploadSessionStore::generateId() {
+    static const char hex[] = "0123456789abcdef";
+    
+    // 128 bits straight from the kernel; the ID is all a client needs to write to an upload
+    unsigned char bytes[16];
+    size_t filled = 0;
+    while (filled < sizeof(bytes)) {
+        ssize_t got = getrandom(bytes + filled, sizeof(bytes) - filled, 0);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        filled += got;
+    }
+    
+    if (filled < sizeof(bytes)) {
+        // Kernels before 3.17 have no getrandom()
+        int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return "";
+        }
+        filled = 0;
+        while (filled < sizeof(bytes)) {
+            ssize_t got = read(fd, bytes + filled, sizeof(bytes) - filled);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                break;
+            }
+            filled += got;
+        }
+        close(fd);
+        if (filled < sizeof(bytes)) {
+            return "";
+        }
+    }
+    
+    std::string id;
+    for (unsigned char byte : bytes) {
+        id += hex[byte >> 4];
+        id += hex[byte & 0xF];
+    }
+    return id;
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Just enough of a unit test framework for the tests/ executables, which have to build
+ * without anything beyond the compiler. Each TEST registers itself; a failed CHECK is
+ * reported with its location and the test carries on, so one run shows every mismatch.
+ *
+ * Usage: <test executable> [name filter]
+ */
+
+namespace test {
+
+struct Case {
+    const char* name;
+    std::function<void()> body;
+};
+
+inline std::vector<Case>& registry() {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+inline int& failureCount() {
+    static int count = 0;
+    return count;
+}
+
+struct Registrar {
+    Registrar(const char* name, std::function<void()> body) {
+        registry().push_back({name, std::move(body)});
+    }
+};
+
+inline void fail(const char* file, int line, const std::string& message) {
+    std::fprintf(stderr, "%s:%d: %s\n", file, line, message.c_str());
+    failureCount()++;
+}
+
+// Runs every test, or those whose name contains the filter; 0 when all passed
+inline int runAll(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int run = 0;
+    int failed = 0;
+    
+    for (const auto& testCase : registry()) {
+        if (filter && !std::strstr(testCase.name, filter)) {
+            continue;
+        }
+        
+        int before = failureCount();
+        testCase.body();
+        run++;
+        
+        bool passed = failureCount() == before;
+        if (!passed) {
+            failed++;
+        }
+        std::printf("%s %s\n", passed ? "PASS" : "FAIL", testCase.name);
+    }
+    
+    std::printf("%d of %d tests passed\n", run - failed, run);
+    return failed == 0 && run > 0 ? 0 : 1;
+}
+
+}
+
+#define TEST_CONCAT_(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_(a, b)
+
+#define TEST(name) \
+    static void name(); \
+    static test::Registrar TEST_CONCAT(name, Registrar)(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            test::fail(__FILE__, __LINE__, "CHECK(" #condition ") failed"); \
+        } \
+    } while (0)
+
+// Both sides must be printable with operator<<
+#define CHECK_EQ(actual, expected) \
+    do { \
+        const auto& actualValue = (actual); \
+        const auto& expectedValue = (expected); \
+        if (!(actualValue == expectedValue)) { \
+            std::ostringstream message; \
+            message << #actual " == " #expected " failed: got " << actualValue << ", expected " << expectedValue; \
+            test::fail(__FILE__, __LINE__, message.str()); \
+        } \
+    } while (0)
+
+#define TEST_MAIN() \
+    int main(int argc, char** argv) { \
+        return test::runAll(argc, argv); \
+    }
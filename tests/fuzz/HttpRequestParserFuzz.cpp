@@ -0,0 +1,87 @@
+#include "network/HttpRequestParser.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+/**
+ * Fuzz target for HttpRequestParser and ChunkedDecoder
+ *
+ * The first byte picks the sizes the input arrives in, so the same request is also
+ * tried split across many reads, the way it comes off a slow socket. The parser sees
+ * a growing prefix of the input, as in HttpServer::readRequestHead; whatever follows
+ * a complete head is decoded as a chunked body in pieces of the same size.
+ */
+
+namespace {
+
+void require(bool condition) {
+    if (!condition) {
+        std::abort();
+    }
+}
+
+bool within(std::string_view part, std::string_view whole) {
+    return part.empty() || (part.data() >= whole.data() &&
+                            part.data() + part.size() <= whole.data() + whole.size());
+}
+
+void decodeBody(std::string_view body, size_t step) {
+    ChunkedDecoder decoder;
+    size_t pos = 0;
+    
+    while (pos < body.size() && !decoder.done() && !decoder.failed()) {
+        std::string_view input = body.substr(pos, step);
+        std::string_view payload;
+        size_t consumed = decoder.decode(input, payload);
+        
+        require(consumed <= input.size());
+        require(within(payload, input));
+        // Every call either makes progress or ends the body
+        require(consumed > 0 || decoder.done() || decoder.failed());
+        pos += consumed;
+    }
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    size_t step = 1 + data[0] % 64;
+    std::string_view input(reinterpret_cast<const char*>(data) + 1, size - 1);
+    
+    HttpRequestParser parser(1024);
+    HttpRequestParser::Status status = HttpRequestParser::Status::INCOMPLETE;
+    size_t received = 0;
+    
+    while (status == HttpRequestParser::Status::INCOMPLETE && received < input.size()) {
+        received = std::min(input.size(), received + step);
+        status = parser.parse(input.substr(0, received));
+    }
+    
+    if (status == HttpRequestParser::Status::ERROR) {
+        int error = parser.errorStatus();
+        require(error == 400 || error == 414 || error == 431 || error == 501);
+        return 0;
+    }
+    if (status != HttpRequestParser::Status::COMPLETE) {
+        return 0;
+    }
+    
+    std::string_view head = input.substr(0, received);
+    require(parser.headLength() > 0 && parser.headLength() <= head.size());
+    require(within(parser.method(), head) && within(parser.target(), head));
+    require(within(parser.path(), head) && within(parser.query(), head));
+    require(within(parser.version(), head));
+    require(parser.headerCount() <= HttpRequestParser::MAX_HEADERS);
+    for (size_t i = 0; i < parser.headerCount(); ++i) {
+        require(within(parser.headerAt(i).name, head) && within(parser.headerAt(i).value, head));
+    }
+    
+    if (parser.isChunked()) {
+        decodeBody(input.substr(parser.headLength()), step);
+    }
+    return 0;
+}
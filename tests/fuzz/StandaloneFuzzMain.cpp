@@ -0,0 +1,89 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Driver for fuzz targets built without libFuzzer (GCC)
+ *
+ * Runs every file given, or every file in a directory given, through the target, then
+ * -runs=N inputs made by mutating them with a fixed seed. Not coverage-guided, but it
+ * catches the crashes and invariant violations the corpus leads to.
+ */
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace {
+
+void runInput(const std::string& input) {
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+}
+
+void addFile(const std::filesystem::path& path, std::vector<std::string>& corpus) {
+    std::ifstream file(path, std::ios::binary);
+    corpus.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    unsigned long runs = 10000;
+    std::vector<std::string> corpus;
+    
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "-runs=", 6) == 0) {
+            runs = std::strtoul(argv[i] + 6, nullptr, 10);
+        } else if (std::filesystem::is_directory(argv[i])) {
+            for (const auto& entry : std::filesystem::directory_iterator(argv[i])) {
+                addFile(entry.path(), corpus);
+            }
+        } else {
+            addFile(argv[i], corpus);
+        }
+    }
+    if (corpus.empty()) {
+        corpus.emplace_back();
+    }
+    
+    for (const auto& input : corpus) {
+        runInput(input);
+    }
+    
+    std::mt19937 random(1);
+    for (unsigned long run = 0; run < runs; ++run) {
+        std::string input = corpus[random() % corpus.size()];
+        size_t mutations = 1 + random() % 8;
+        for (size_t i = 0; i < mutations; ++i) {
+            size_t pos = input.empty() ? 0 : random() % input.size();
+            switch (random() % 4) {
+                case 0:
+                    if (!input.empty()) {
+                        input[pos] = static_cast<char>(random());
+                    }
+                    break;
+                case 1:
+                    input.insert(pos, 1, static_cast<char>(random()));
+                    break;
+                case 2:
+                    if (!input.empty()) {
+                        input.erase(pos, 1 + random() % 16);
+                    }
+                    break;
+                default:
+                    // Repeating a slice makes long lines, many headers and big chunk sizes
+                    input.insert(pos, input.substr(pos, 1 + random() % 32));
+                    break;
+            }
+        }
+        runInput(input);
+    }
+    
+    std::printf("%zu corpus inputs and %lu mutations passed\n", corpus.size(), runs);
+    return 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "core/FileOperationQueue.hpp"
+#include "core/WriteQueueManager.hpp"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Stands in for core/UsbBridge.hpp in the HTTP server tests, ahead of it on their include
+ * path. Client operations go straight to a real FileOperationQueue working on a directory
+ * the test owns, so a test can pause the queue to keep operations waiting.
+ */
+namespace usb_bridge {
+
+class UsbBridge {
+public:
+    using Callback = std::function<void(const FileOperation&)>;
+    
+    explicit UsbBridge(const std::string& bufferPath) : m_queue(bufferPath, 64 * 1024 * 1024) {
+        m_queue.start();
+    }
+    
+    ~UsbBridge() {
+        m_queue.stop();
+    }
+    
+    FileOperationQueue& getOperationQueue() { return m_queue; }
+    
+    uint64_t clientWriteFile(const std::string& clientId, ClientType, const std::string& localPath,
+                             const std::string& drivePath, uint64_t size, Callback callback = nullptr) {
+        return m_queue.queueWrite(clientId, localPath, drivePath, size, callback);
+    }
+    
+    uint64_t clientDeleteFile(const std::string& clientId, ClientType, const std::string& drivePath,
+                              Callback callback = nullptr) {
+        return m_queue.queueDelete(clientId, drivePath, callback);
+    }
+    
+    uint64_t clientCreateDirectory(const std::string& clientId, ClientType, const std::string& drivePath,
+                                   Callback callback = nullptr) {
+        return m_queue.queueMkdir(clientId, drivePath, callback);
+    }
+    
+    uint64_t clientMoveFile(const std::string& clientId, ClientType, const std::string& sourcePath,
+                            const std::string& destPath, Callback callback = nullptr) {
+        return m_queue.queueMove(clientId, sourcePath, destPath, callback);
+    }
+    
+    // The write queue's ordering doesn't matter here, so a batch is queued item by item
+    std::vector<uint64_t> clientWriteBatch(const std::string& clientId, ClientType, std::vector<WriteBatchItem> items,
+                                           Callback callback = nullptr) {
+        std::vector<uint64_t> ids;
+        for (const auto& item : items) {
+            ids.push_back(item.isDirectory
+                ? m_queue.queueMkdir(clientId, item.drivePath, callback)
+                : m_queue.queueWrite(clientId, item.localPath, item.drivePath, item.fileSize, callback));
+        }
+        return ids;
+    }
+    
+    bool renewDirectAccess(const std::string&) { return false; }
+
+private:
+    FileOperationQueue m_queue;
+};
+
+}
@@ -0,0 +1,27 @@
+#include "utils/FileUtils.hpp"
+#include <sys/stat.h>
+
+/**
+ * The few FileUtils functions the network code calls, for tests that link it without the
+ * rest of the utilities. Only what a test response could depend on is filled in.
+ */
+namespace FileUtils {
+
+std::string getMimeType(const std::string&) {
+    return "application/octet-stream";
+}
+
+std::string formatFileSize(uint64_t bytes) {
+    return std::to_string(bytes) + " B";
+}
+
+std::string formatTime(std::time_t time) {
+    return std::to_string(time);
+}
+
+std::time_t getLastModifiedTime(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_mtime : 0;
+}
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+/**
+ * Stands in for utils/Logger.hpp in the tests, ahead of it on the include path. The core
+ * classes log through static calls that the board build gets from the logging backend;
+ * here they compile to nothing, so test output is only what the tests report.
+ */
+class Logger {
+public:
+    static void debug(const std::string&) {}
+    static void info(const std::string&) {}
+    static void warn(const std::string&) {}
+    static void error(const std::string&) {}
+};
+
+#define LOG_DEBUG(msg, cat) ((void)0)
+#define LOG_INFO(msg, cat) ((void)0)
+#define LOG_WARNING(msg, cat) ((void)0)
+#define LOG_ERROR(msg, cat) ((void)0)
+#define LOG_FATAL(msg, cat) ((void)0)
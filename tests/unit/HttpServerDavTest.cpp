@@ -0,0 +1,224 @@
+#include "network/HttpServer.hpp"
+#include "core/UsbBridge.hpp"
+#include "TestHarness.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+/**
+ * WebDAV requests against a running HttpServer whose bridge hands every operation to a real
+ * FileOperationQueue on a scratch directory. Pausing that queue keeps operations waiting
+ * past the server's (shortened) wait, which is how the 202 paths are reached.
+ */
+
+namespace {
+
+const std::chrono::seconds SETTLE_TIMEOUT(5);
+
+std::string makeScratchDirectory() {
+    char pattern[] = "/tmp/http_dav_test.XXXXXX";
+    const char* created = mkdtemp(pattern);
+    return created ? created : "";
+}
+
+int findFreePort() {
+    int probe = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    bind(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    getsockname(probe, reinterpret_cast<sockaddr*>(&address), &length);
+    close(probe);
+    return ntohs(address.sin_port);
+}
+
+int connectTo(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void writeFile(const std::string& path, const std::string& content) {
+    std::ofstream(path, std::ios::binary) << content;
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream input(path, std::ios::binary);
+    std::ostringstream content;
+    content << input.rdbuf();
+    return content.str();
+}
+
+template <typename Predicate>
+bool eventually(Predicate predicate) {
+    auto deadline = std::chrono::steady_clock::now() + SETTLE_TIMEOUT;
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+class DavServer {
+public:
+    DavServer() : m_directory(makeScratchDirectory()), m_bridge(m_directory + "/buffer") {
+        std::filesystem::create_directories(drive());
+        m_server.setBridge(&m_bridge);
+        m_server.setDocumentRoot(drive());
+        m_server.setDavOperationTimeout(1);
+        
+        m_port = findFreePort();
+        m_server.initialize(m_port);
+        m_server.start();
+        eventually([this] {
+            int fd = connectTo(m_port);
+            if (fd >= 0) {
+                close(fd);
+            }
+            return fd >= 0;
+        });
+    }
+    
+    ~DavServer() {
+        m_bridge.getOperationQueue().resume();
+        m_server.stop();
+        m_bridge.getOperationQueue().stop();
+        std::filesystem::remove_all(m_directory);
+    }
+    
+    std::string drive() const { return m_directory + "/drive"; }
+    usb_bridge::FileOperationQueue& queue() { return m_bridge.getOperationQueue(); }
+    
+    // Status code of the response, 0 when there was none
+    int send(const std::string& method, const std::string& path, const std::string& headers = "") {
+        int fd = connectTo(m_port);
+        if (fd < 0) {
+            return 0;
+        }
+        
+        std::string request = method + " " + path + " HTTP/1.1\r\nHost: test\r\n" + headers +
+                              "Content-Length: 0\r\nConnection: close\r\n\r\n";
+        send(fd, request);
+        
+        std::string response;
+        char buffer[4096];
+        ssize_t received;
+        while ((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            response.append(buffer, static_cast<size_t>(received));
+        }
+        close(fd);
+        
+        return response.compare(0, 9, "HTTP/1.1 ") == 0 ? std::atoi(response.c_str() + 9) : 0;
+    }
+
+private:
+    static void send(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.length()) {
+            ssize_t written = ::send(fd, data.data() + sent, data.length() - sent, MSG_NOSIGNAL);
+            if (written <= 0) {
+                return;
+            }
+            sent += static_cast<size_t>(written);
+        }
+    }
+    
+    std::string m_directory;
+    usb_bridge::UsbBridge m_bridge;
+    HttpServer m_server;
+    int m_port = 0;
+};
+
+}
+
+TEST(copyOverwriteReplacesTheDestination) {
+    DavServer server;
+    writeFile(server.drive() + "/source.txt", "new");
+    writeFile(server.drive() + "/dest.txt", "old");
+    
+    CHECK_EQ(server.send("COPY", "/dav/source.txt", "Destination: /dav/dest.txt\r\n"), 204);
+    CHECK_EQ(readFile(server.drive() + "/dest.txt"), "new");
+    CHECK_EQ(server.queue().getUsedBufferSpace(), 0u);
+}
+
+TEST(copyOverwriteFollowsADeleteStillQueued) {
+    DavServer server;
+    writeFile(server.drive() + "/source.txt", "new");
+    writeFile(server.drive() + "/dest.txt", "old");
+    
+    // The delete is still waiting when the server gives up and answers
+    server.queue().pause();
+    CHECK_EQ(server.send("COPY", "/dav/source.txt", "Destination: /dav/dest.txt\r\n"), 202);
+    CHECK_EQ(readFile(server.drive() + "/dest.txt"), "old");
+    CHECK_EQ(server.queue().getUsedBufferSpace(), 3u);
+    
+    // Once it runs, the buffered copy takes the destination's place
+    server.queue().resume();
+    CHECK(eventually([&] { return readFile(server.drive() + "/dest.txt") == "new"; }));
+    CHECK(eventually([&] { return server.queue().getUsedBufferSpace() == 0; }));
+    CHECK_EQ(readFile(server.drive() + "/source.txt"), "new");
+}
+
+TEST(collectionCopyOverwriteFollowsADeleteStillQueued) {
+    DavServer server;
+    std::filesystem::create_directories(server.drive() + "/source/sub");
+    writeFile(server.drive() + "/source/a.txt", "a");
+    writeFile(server.drive() + "/source/sub/b.txt", "bb");
+    std::filesystem::create_directories(server.drive() + "/dest");
+    writeFile(server.drive() + "/dest/stale.txt", "stale");
+    
+    server.queue().pause();
+    CHECK_EQ(server.send("COPY", "/dav/source/", "Destination: /dav/dest/\r\n"), 202);
+    CHECK(std::filesystem::exists(server.drive() + "/dest/stale.txt"));
+    
+    server.queue().resume();
+    CHECK(eventually([&] {
+        return readFile(server.drive() + "/dest/a.txt") == "a" && readFile(server.drive() + "/dest/sub/b.txt") == "bb";
+    }));
+    CHECK(!std::filesystem::exists(server.drive() + "/dest/stale.txt"));
+    CHECK(eventually([&] { return server.queue().getUsedBufferSpace() == 0; }));
+}
+
+TEST(moveOverwriteFollowsADeleteStillQueued) {
+    DavServer server;
+    writeFile(server.drive() + "/source.txt", "new");
+    writeFile(server.drive() + "/dest.txt", "old");
+    
+    server.queue().pause();
+    CHECK_EQ(server.send("MOVE", "/dav/source.txt", "Destination: /dav/dest.txt\r\n"), 202);
+    CHECK_EQ(readFile(server.drive() + "/dest.txt"), "old");
+    
+    server.queue().resume();
+    CHECK(eventually([&] { return !std::filesystem::exists(server.drive() + "/source.txt"); }));
+    CHECK_EQ(readFile(server.drive() + "/dest.txt"), "new");
+}
+
+TEST(copyWithoutOverwriteKeepsTheDestination) {
+    DavServer server;
+    writeFile(server.drive() + "/source.txt", "new");
+    writeFile(server.drive() + "/dest.txt", "old");
+    
+    CHECK_EQ(server.send("COPY", "/dav/source.txt", "Destination: /dav/dest.txt\r\nOverwrite: F\r\n"), 412);
+    CHECK_EQ(readFile(server.drive() + "/dest.txt"), "old");
+    CHECK_EQ(server.queue().getUsedBufferSpace(), 0u);
+}
+
+TEST_MAIN()
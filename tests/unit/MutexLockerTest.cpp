@@ -0,0 +1,296 @@
+#include "core/MutexLocker.hpp"
+#include "TestHarness.hpp"
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Leases, time slices and board windows run on MutexLocker's replaceable clock, so each
+ * test drives a simulated clock and calls releaseExpiredGrants() the way the bridge's
+ * maintenance tick does. Requests that have to queue block in real time, so they run on
+ * their own thread; the test waits until they are queued before going on.
+ */
+
+using namespace usb_bridge;
+
+namespace {
+
+const std::chrono::seconds WAIT_TIMEOUT(10);
+
+class SimulatedClock {
+public:
+    explicit SimulatedClock(MutexLocker& locker) : m_start(std::chrono::system_clock::now()), m_elapsed(0) {
+        locker.setClock([this] { return now(); });
+    }
+    
+    std::chrono::system_clock::time_point now() const { return m_start + std::chrono::seconds(m_elapsed.load()); }
+    void advance(std::chrono::seconds seconds) { m_elapsed += seconds.count(); }
+
+private:
+    std::chrono::system_clock::time_point m_start;
+    std::atomic<int64_t> m_elapsed;
+};
+
+// Leases that don't run out on their own, so only slices and windows end grants
+void configure(MutexLocker& locker, std::chrono::seconds timeSlice, std::chrono::seconds boardWindow) {
+    locker.setLeaseLimits(std::chrono::hours(1), std::chrono::hours(2));
+    locker.setTimeSlicing(timeSlice, boardWindow);
+}
+
+std::future<bool> requestInBackground(MutexLocker& locker, const std::string& clientId, ClientType type,
+                                      bool readOnly = false) {
+    auto request = std::async(std::launch::async, [&locker, clientId, type, readOnly] {
+        return readOnly ? locker.requestSharedAccess(clientId, type, 0, WAIT_TIMEOUT)
+                        : locker.requestDirectAccess(clientId, type, 0, WAIT_TIMEOUT);
+    });
+    
+    // Queued, or already through if nothing was in the way
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (locker.getQueuePosition(clientId) == 0 && !locker.hasDirectAccess(clientId) &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return request;
+}
+
+bool grantedSoon(std::future<bool>& request) {
+    return request.wait_for(std::chrono::seconds(2)) == std::future_status::ready && request.get();
+}
+
+std::string join(const std::vector<std::string>& values) {
+    std::string joined;
+    for (const auto& value : values) {
+        joined += (joined.empty() ? "" : ",") + value;
+    }
+    return joined;
+}
+
+}
+
+TEST(sliceIsScaledByClientWeight) {
+    MutexLocker locker;
+    SimulatedClock clock(locker);
+    configure(locker, std::chrono::seconds(10), std::chrono::seconds(0));
+    
+    // Hosts weigh 2 by default, so the host keeps the drive for 20 s while others wait
+    CHECK(locker.requestDirectAccess("host", ClientType::USB_HOST_1, 1));
+    auto http = requestInBackground(locker, "http", ClientType::NETWORK_HTTP);
+    CHECK_EQ(locker.getQueuePosition("http"), 1u);
+    
+    clock.advance(std::chrono::seconds(19));
+    CHECK_EQ(join(locker.releaseExpiredGrants()), "");
+    CHECK(locker.hasDirectAccess("host"));
+    
+    clock.advance(std::chrono::seconds(1));
+    CHECK_EQ(join(locker.releaseExpiredGrants()), "host");
+    CHECK(grantedSoon(http));
+    CHECK_EQ(locker.getCurrentAccessHolder(), "http");
+    CHECK_EQ(locker.getStatistics().preemptedGrants, 1u);
+    
+    locker.releaseDirectAccess("http");
+}
+
+TEST(sliceWeightCanBeChanged) {
+    MutexLocker locker;
+    SimulatedClock clock(locker);
+    configure(locker, std::chrono::seconds(10), std::chrono::seconds(0));
+    locker.setSliceWeight(ClientType::NETWORK_SMB, 3);
+    
+    CHECK(locker.requestDirectAccess("smb", ClientType::NETWORK_SMB, 1));
+    auto host = requestInBackground(locker, "host", ClientType::USB_HOST_2);
+    
+    clock.advance(std::chrono::seconds(29));
+    CHECK_EQ(join(locker.releaseExpiredGrants()), "");
+    clock.advance(std::chrono::seconds(1));
+    CHECK_EQ(join(locker.releaseExpiredGrants()), "smb");
+    CHECK(grantedSoon(host));
+    
+    locker.releaseDirectAccess("host");
+}
+
+TEST(sliceOnlyEndsWhileOthersWait) {
+    MutexLocker locker;
+    SimulatedClock clock(locker);
+    configure(locker, std::chrono::seconds(10), std::chrono::seconds(0));
+    
+    CHECK(locker.requestDirectAccess("http", ClientType::NETWORK_HTTP, 1));
+    clock.advance(std::chrono::seconds(60));
+    CHECK_EQ(join(locker.releaseExpiredGrants()), "");
+    CHECK(locker.hasDirectAccess("http"));
+    
+    // Long past its slice, the holder goes at the next tick once someone waits
+    auto smb = requestInBackground(locker, "smb", ClientType::NETWORK_SMB);
+    CHECK_EQ(join(locker.releaseExpiredGrants()), "http");
+    CHECK(grantedSoon(smb));
+    
+    locker.releaseDirectAccess("smb");
+}
+
+TEST(idleLeaseExpiresUnlessRenewed) {
+    MutexLocker locker;
+    SimulatedClock clock(locker);
+    locker.setLeaseLimits(std::chrono::seconds(30), std::chrono::seconds(100));
+    
+    CHECK(locker.requestDirectAccess("host", ClientType::USB_HOST_1, 1));
+    clock.advance(std::chrono::seconds(25));
+    CHECK(locker.renewAccess("host"));
+    clock.advance(std::chrono::seconds(25));
+    CHECK_EQ(join(locker.releaseExpiredGrants()), "");
+    
+    // Renewals never reach past the maximum duration
+    CHECK(locker.renewAccess("host", std::chrono::seconds(600)));
+    clock.advance(std::chrono::seconds(49));
+    CHECK_EQ(join(locker.releaseExpiredGrants()), "");
+    clock.advance(std::chrono::seconds(1));
+    CHECK_EQ(join(locker.releaseExpiredGrants()), "host");
+    CHECK(locker.isBoardManaged());
+    CHECK_EQ(locker.getStatistics().expiredGrants, 1u);
+    CHECK(!locker.renewAccess("host"));
+}
+
+TEST(boardWindowHoldsBackTheNextGrant) {
+    MutexLocker locker;
+    SimulatedClock clock(locker);
+    configure(locker, std::chrono::seconds(10), std::chrono::seconds(5));
+    locker.setBoardWorkCheck([] { return true; });
+    
+    CHECK(locker.requestDirectAccess("host", ClientType::USB_HOST_1, 1));
+    auto http = requestInBackground(locker, "http", ClientType::NETWORK_HTTP);
+    
+    locker.releaseDirectAccess("host");
+    CHECK(locker.isBoardManaged());
+    CHECK_EQ(locker.getQueuePosition("http"), 1u);
+    CHECK_EQ(locker.getStatistics().boardWindows, 1u);
+    
+    clock.advance(std::chrono::seconds(4));
+    locker.releaseExpiredGrants();
+    CHECK_EQ(locker.getQueuePosition("http"), 1u);
+    
+    clock.advance(std::chrono::seconds(1));
+    locker.releaseExpiredGrants();
+    CHECK(grantedSoon(http));
+    CHECK_EQ(locker.getCurrentAccessHolder(), "http");
+    
+    locker.releaseDirectAccess("http");
+}
+
+TEST(boardWindowAlsoFollowsPreemption) {
+    MutexLocker locker;
+    SimulatedClock clock(locker);
+    configure(locker, std::chrono::seconds(10), std::chrono::seconds(5));
+    locker.setBoardWorkCheck([] { return true; });
+    
+    CHECK(locker.requestDirectAccess("smb", ClientType::NETWORK_SMB, 1));
+    auto http = requestInBackground(locker, "http", ClientType::NETWORK_HTTP);
+    
+    clock.advance(std::chrono::seconds(10));
+    CHECK_EQ(join(locker.releaseExpiredGrants()), "smb");
+    CHECK(locker.isBoardManaged());
+    
+    clock.advance(std::chrono::seconds(5));
+    locker.releaseExpiredGrants();
+    CHECK(grantedSoon(http));
+    
+    locker.releaseDirectAccess("http");
+}
+
+TEST(boardWindowSkippedWithoutBoardWork) {
+    MutexLocker locker;
+    SimulatedClock clock(locker);
+    configure(locker, std::chrono::seconds(10), std::chrono::seconds(5));
+    locker.setBoardWorkCheck([] { return false; });
+    
+    CHECK(locker.requestDirectAccess("host", ClientType::USB_HOST_1, 1));
+    auto http = requestInBackground(locker, "http", ClientType::NETWORK_HTTP);
+    
+    // Nothing queued for the board, so the waiting client is handed the drive straight away
+    locker.releaseDirectAccess("host");
+    CHECK(grantedSoon(http));
+    CHECK_EQ(locker.getStatistics().boardWindows, 0u);
+    
+    locker.releaseDirectAccess("http");
+}
+
+TEST(noBoardWindowWithoutWaiters) {
+    MutexLocker locker;
+    SimulatedClock clock(locker);
+    configure(locker, std::chrono::seconds(10), std::chrono::seconds(5));
+    locker.setBoardWorkCheck([] { return true; });
+    
+    CHECK(locker.requestDirectAccess("host", ClientType::USB_HOST_1, 1));
+    locker.releaseDirectAccess("host");
+    CHECK_EQ(locker.getStatistics().boardWindows, 0u);
+    
+    // The next request is granted at once
+    CHECK(locker.requestDirectAccess("http", ClientType::NETWORK_HTTP, 2));
+    locker.releaseDirectAccess("http");
+}
+
+TEST(readersShareAndWritersWaitForThem) {
+    MutexLocker locker;
+    
+    CHECK(locker.requestSharedAccess("reader1", ClientType::NETWORK_HTTP, 1));
+    CHECK(locker.requestSharedAccess("reader2", ClientType::USB_HOST_1, 2));
+    CHECK(locker.getCurrentAccessMode() == AccessMode::DIRECT_USB);
+    
+    auto writer = requestInBackground(locker, "writer", ClientType::NETWORK_SMB);
+    CHECK_EQ(locker.getQueuePosition("writer"), 1u);
+    
+    locker.releaseDirectAccess("reader1");
+    CHECK_EQ(locker.getQueuePosition("writer"), 1u);
+    
+    // Granted once the last reader is gone
+    locker.releaseDirectAccess("reader2");
+    CHECK(grantedSoon(writer));
+    CHECK(locker.getCurrentAccessMode() == AccessMode::DIRECT_NETWORK);
+    
+    locker.releaseDirectAccess("writer");
+    CHECK(locker.isBoardManaged());
+}
+
+TEST(readersDontOvertakeAWaitingWriter) {
+    MutexLocker locker;
+    
+    CHECK(locker.requestSharedAccess("reader1", ClientType::NETWORK_HTTP, 1));
+    auto writer = requestInBackground(locker, "writer", ClientType::NETWORK_SMB);
+    auto reader2 = requestInBackground(locker, "reader2", ClientType::NETWORK_HTTP, true);
+    auto reader3 = requestInBackground(locker, "reader3", ClientType::USB_HOST_1, true);
+    
+    // The drive is shared with reader1, but the writer is first in line
+    CHECK_EQ(join(locker.getWaitingClients()), "writer,reader2,reader3");
+    
+    locker.releaseDirectAccess("reader1");
+    CHECK(grantedSoon(writer));
+    CHECK_EQ(join(locker.getWaitingClients()), "reader2,reader3");
+    
+    // Every reader up to the next writer gets in together
+    locker.releaseDirectAccess("writer");
+    CHECK(grantedSoon(reader2));
+    CHECK(grantedSoon(reader3));
+    CHECK(locker.hasDirectAccess("reader2"));
+    CHECK(locker.hasDirectAccess("reader3"));
+    
+    locker.releaseDirectAccess("reader2");
+    locker.releaseDirectAccess("reader3");
+    CHECK(locker.isBoardManaged());
+}
+
+TEST(blockingCancelsWaiters) {
+    MutexLocker locker;
+    
+    CHECK(locker.requestDirectAccess("host", ClientType::USB_HOST_1, 1));
+    auto http = requestInBackground(locker, "http", ClientType::NETWORK_HTTP);
+    
+    locker.blockAccess("test");
+    CHECK(http.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+    CHECK(!http.get());
+    CHECK(!locker.requestDirectAccess("smb", ClientType::NETWORK_SMB, 2));
+    
+    locker.unblockAccess();
+    locker.releaseDirectAccess("host");
+}
+
+TEST_MAIN()
@@ -0,0 +1,175 @@
+#include "network/SmbConfigGenerator.hpp"
+#include "TestHarness.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+/**
+ * selectProfile() and render() depend on nothing but the Environment, so each profile is
+ * checked against a golden smb.conf under tests/golden/smb. After an intended change to the
+ * output, rerun with UPDATE_GOLDEN=1 to rewrite the files and review the diff.
+ */
+
+namespace {
+
+const uint64_t MB = 1024 * 1024;
+
+SmbConfigGenerator::Environment makeEnvironment(SmbConfigGenerator::DriveType driveType, uint64_t memoryMb,
+                                                bool fat = false, int sambaMajor = 4, int sambaMinor = 17) {
+    SmbConfigGenerator::Environment environment;
+    environment.driveType = driveType;
+    environment.memoryBytes = memoryMb * MB;
+    environment.fatFilesystem = fat;
+    environment.sambaMajor = sambaMajor;
+    environment.sambaMinor = sambaMinor;
+    return environment;
+}
+
+std::string renderConfig(const SmbConfigGenerator::Environment& environment) {
+    SmbConfigGenerator::ShareSettings share;
+    share.path = "/mnt/usb_bridge";
+    return SmbConfigGenerator::render(share, environment, SmbConfigGenerator::selectProfile(environment));
+}
+
+void checkGolden(const char* file, int line, const std::string& name, const std::string& actual) {
+    std::string path = std::string(GOLDEN_DIR) + "/smb/" + name + ".conf";
+    
+    if (std::getenv("UPDATE_GOLDEN")) {
+        std::ofstream(path, std::ios::binary) << actual;
+        return;
+    }
+    
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        test::fail(file, line, "missing golden file " + path);
+        return;
+    }
+    std::ostringstream expected;
+    expected << input.rdbuf();
+    if (actual == expected.str()) {
+        return;
+    }
+    
+    // Point at the first line that differs rather than dumping both files
+    std::istringstream actualLines(actual);
+    std::istringstream expectedLines(expected.str());
+    std::string actualLine;
+    std::string expectedLine;
+    for (int number = 1;; ++number) {
+        bool moreActual = static_cast<bool>(std::getline(actualLines, actualLine));
+        bool moreExpected = static_cast<bool>(std::getline(expectedLines, expectedLine));
+        if (!moreActual && !moreExpected) {
+            break;
+        }
+        if (!moreActual || !moreExpected || actualLine != expectedLine) {
+            test::fail(file, line, name + ".conf line " + std::to_string(number) + ": got \"" +
+                       (moreActual ? actualLine : "<end>") + "\", expected \"" +
+                       (moreExpected ? expectedLine : "<end>") + "\"");
+            return;
+        }
+    }
+    test::fail(file, line, name + ".conf differs in its line endings");
+}
+
+#define CHECK_GOLDEN(name, actual) checkGolden(__FILE__, __LINE__, name, actual)
+
+bool hasLine(const std::string& config, const std::string& line) {
+    return config.find("\n   " + line + "\n") != std::string::npos;
+}
+
+}
+
+TEST(hddProfileRendersGolden) {
+    CHECK_GOLDEN("hdd-1g", renderConfig(makeEnvironment(SmbConfigGenerator::DriveType::ROTATIONAL, 1024)));
+}
+
+TEST(ssdProfileRendersGolden) {
+    CHECK_GOLDEN("ssd-4g", renderConfig(makeEnvironment(SmbConfigGenerator::DriveType::SOLID_STATE, 4096)));
+}
+
+TEST(flashProfileRendersGolden) {
+    CHECK_GOLDEN("flash-512m", renderConfig(makeEnvironment(SmbConfigGenerator::DriveType::FLASH, 512)));
+}
+
+TEST(fatFilesystemRendersGolden) {
+    CHECK_GOLDEN("hdd-1g-fat", renderConfig(makeEnvironment(SmbConfigGenerator::DriveType::ROTATIONAL, 1024, true)));
+}
+
+TEST(oldSambaRendersGolden) {
+    CHECK_GOLDEN("flash-1g-samba-4.11",
+                 renderConfig(makeEnvironment(SmbConfigGenerator::DriveType::FLASH, 1024, false, 4, 11)));
+}
+
+TEST(memoryTiersSwitchAtTheirBoundaries) {
+    auto profileFor = [](uint64_t memoryMb) {
+        return SmbConfigGenerator::selectProfile(makeEnvironment(SmbConfigGenerator::DriveType::SOLID_STATE, memoryMb));
+    };
+    
+    CHECK_EQ(profileFor(512).name, "ssd-512m");
+    CHECK_EQ(profileFor(767).name, "ssd-512m");
+    CHECK_EQ(profileFor(768).name, "ssd-1g");
+    CHECK_EQ(profileFor(3071).name, "ssd-1g");
+    CHECK_EQ(profileFor(3072).name, "ssd-4g");
+    CHECK_EQ(profileFor(8192).name, "ssd-4g");
+    
+    CHECK_EQ(profileFor(512).maxIoSize, 1 * MB);
+    CHECK_EQ(profileFor(1024).maxIoSize, 4 * MB);
+    CHECK_EQ(profileFor(4096).maxIoSize, 8 * MB);
+    CHECK_EQ(profileFor(512).aioMaxThreads, 4u);
+    CHECK_EQ(profileFor(1024).aioMaxThreads, 8u);
+    CHECK_EQ(profileFor(4096).aioMaxThreads, 16u);
+    
+    // Unknown memory is treated as the smallest board
+    CHECK_EQ(profileFor(0).name, "ssd-512m");
+}
+
+TEST(driveTypesCapTheThreadPool) {
+    auto threadsFor = [](SmbConfigGenerator::DriveType driveType) {
+        return SmbConfigGenerator::selectProfile(makeEnvironment(driveType, 4096)).aioMaxThreads;
+    };
+    
+    CHECK_EQ(threadsFor(SmbConfigGenerator::DriveType::ROTATIONAL), 4u);
+    CHECK_EQ(threadsFor(SmbConfigGenerator::DriveType::SOLID_STATE), 16u);
+    CHECK_EQ(threadsFor(SmbConfigGenerator::DriveType::FLASH), 2u);
+}
+
+TEST(fatDisablesStrictAllocateOnHardDisks) {
+    auto hdd = SmbConfigGenerator::selectProfile(makeEnvironment(SmbConfigGenerator::DriveType::ROTATIONAL, 1024));
+    auto hddFat = SmbConfigGenerator::selectProfile(makeEnvironment(SmbConfigGenerator::DriveType::ROTATIONAL, 1024, true));
+    CHECK(hdd.strictAllocate);
+    CHECK(!hddFat.strictAllocate);
+    
+    std::string config = renderConfig(makeEnvironment(SmbConfigGenerator::DriveType::SOLID_STATE, 1024, true));
+    CHECK(hasLine(config, "ea support = no"));
+    CHECK(hasLine(config, "dos filetime resolution = yes"));
+    CHECK(!hasLine(renderConfig(makeEnvironment(SmbConfigGenerator::DriveType::SOLID_STATE, 1024)), "ea support = no"));
+}
+
+TEST(writeCacheSizeOnlyBeforeSamba412) {
+    auto configFor = [](int major, int minor) {
+        return renderConfig(makeEnvironment(SmbConfigGenerator::DriveType::FLASH, 1024, false, major, minor));
+    };
+    
+    // Flash doubles the tier's 512 KiB
+    CHECK(hasLine(configFor(4, 11), "write cache size = 1048576"));
+    CHECK(hasLine(configFor(3, 6), "write cache size = 1048576"));
+    CHECK(configFor(4, 12).find("write cache size") == std::string::npos);
+    CHECK(configFor(4, 19).find("write cache size") == std::string::npos);
+    CHECK(configFor(5, 0).find("write cache size") == std::string::npos);
+    
+    // An smbd that couldn't be asked gets the modern parameter set
+    CHECK(configFor(0, 0).find("write cache size") == std::string::npos);
+}
+
+TEST(driveTypeNamesRoundTrip) {
+    for (const char* name : {"hdd", "ssd", "flash"}) {
+        SmbConfigGenerator::DriveType type;
+        CHECK(SmbConfigGenerator::parseDriveType(name, type));
+    }
+    SmbConfigGenerator::DriveType type = SmbConfigGenerator::DriveType::SOLID_STATE;
+    CHECK(!SmbConfigGenerator::parseDriveType("nvme", type));
+    CHECK(type == SmbConfigGenerator::DriveType::SOLID_STATE);
+}
+
+TEST_MAIN()
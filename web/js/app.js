@@ -2,6 +2,14 @@ class USBBridgeWebUI {
     constructor() {
         this.currentPath = '/';
         this.refreshInterval = null;
+        this.uptimeInterval = null;
+        this.eventSource = null;
+        this.status = {};
+        this.activityEvents = [];
+        this.transfers = new Map();
+        this.files = [];
+        this.fileCursor = null;
+        this.fileTotal = 0;
         this.init();
     }
 
@@ -11,12 +19,94 @@ class USBBridgeWebUI {
         this.refreshFiles();
         this.refreshActivity();
         
-        // Auto-refresh every 30 seconds
+        // Live updates arrive over /api/events; polling is only the fallback
+        this.connectEvents();
+        
+        // Uptime is derived from the start time, so ticking it needs no requests
+        this.uptimeInterval = setInterval(() => this.updateUptime(), 1000);
+    }
+    
+    connectEvents() {
+        if (typeof EventSource === 'undefined') {
+            this.startPolling();
+            return;
+        }
+        
+        this.eventSource = new EventSource('/api/events');
+        
+        this.eventSource.addEventListener('open', () => {
+            // Anything that happened while disconnected is only visible in the log
+            this.stopPolling();
+            this.refreshActivity();
+        });
+        
+        this.eventSource.addEventListener('error', () => {
+            // EventSource reconnects by itself; poll until it succeeds
+            this.startPolling();
+        });
+        
+        this.eventSource.addEventListener('status', (e) => {
+            this.status = this.mergePatch(this.status, JSON.parse(e.data));
+            this.updateStatusDisplay(this.status);
+        });
+        
+        this.eventSource.addEventListener('progress', (e) => {
+            const operation = JSON.parse(e.data);
+            if (operation.status === 'queued' || operation.status === 'in_progress') {
+                this.transfers.set(operation.id, operation);
+            } else {
+                this.transfers.delete(operation.id);
+            }
+            this.updateActivityDisplay(this.activityEvents);
+        });
+        
+        this.eventSource.addEventListener('file', (e) => {
+            this.activityEvents.unshift(JSON.parse(e.data));
+            this.activityEvents.length = Math.min(this.activityEvents.length, 100);
+            this.updateActivityDisplay(this.activityEvents);
+        });
+        
+        this.eventSource.addEventListener('resync', () => {
+            // The server dropped events for us; start over from the full lists
+            this.refreshActivity();
+            this.refreshFiles();
+        });
+    }
+    
+    startPolling() {
+        if (this.refreshInterval) {
+            return;
+        }
+        
         this.refreshInterval = setInterval(() => {
             this.refreshStatus();
             this.refreshActivity();
         }, 30000);
     }
+    
+    stopPolling() {
+        if (this.refreshInterval) {
+            clearInterval(this.refreshInterval);
+            this.refreshInterval = null;
+        }
+    }
+    
+    mergePatch(target, patch) {
+        // JSON merge patch (RFC 7386): null removes a field, objects merge recursively
+        if (patch === null || typeof patch !== 'object' || Array.isArray(patch)) {
+            return patch;
+        }
+        
+        const result = (target && typeof target === 'object' && !Array.isArray(target)) ? { ...target } : {};
+        for (const [key, value] of Object.entries(patch)) {
+            if (value === null) {
+                delete result[key];
+            } else {
+                result[key] = this.mergePatch(result[key], value);
+            }
+        }
+        return result;
+    }
 
     setupEventListeners() {
         // Handle modal close on background click
@@ -58,8 +148,8 @@ class USBBridgeWebUI {
 
     async refreshStatus() {
         try {
-            const status = await this.apiCall('status');
-            this.updateStatusDisplay(status);
+            this.status = await this.apiCall('status');
+            this.updateStatusDisplay(this.status);
         } catch (error) {
             console.error('Failed to refresh status:', error);
             this.showError('Failed to connect to USB Bridge system');
@@ -91,22 +181,56 @@ class USBBridgeWebUI {
             status.network?.connected ? 'Connected' : 'Offline';
         document.getElementById('storageCapacity').textContent = 
             this.formatBytes(status.storage?.freeSpace || 0);
-        document.getElementById('systemUptime').textContent = 
-            this.formatUptime(status.system?.uptime || 0);
+        this.updateUptime();
+    }
+    
+    updateUptime() {
+        const startTime = this.status.system?.startTime;
+        const uptime = startTime ? Math.max(0, Math.floor(Date.now() / 1000) - startTime) : 0;
+        document.getElementById('systemUptime').textContent = this.formatUptime(uptime);
     }
 
     async refreshFiles() {
         try {
-            const response = await this.apiCall('files', {
-                headers: { 'X-Path': this.currentPath }
-            });
+            const response = await this.apiCall(this.filesEndpoint(null));
             
-            this.updateFileDisplay(response.files || []);
+            this.files = response.files || [];
+            this.fileCursor = response.next_cursor;
+            this.fileTotal = response.total || 0;
+            this.updateFileDisplay(this.files);
         } catch (error) {
             console.error('Failed to refresh files:', error);
+            this.files = [];
+            this.fileCursor = null;
             this.updateFileDisplay([]);
         }
     }
+    
+    async loadMoreFiles() {
+        if (!this.fileCursor) {
+            return;
+        }
+        
+        try {
+            const response = await this.apiCall(this.filesEndpoint(this.fileCursor));
+            
+            this.files = this.files.concat(response.files || []);
+            this.fileCursor = response.next_cursor;
+            this.fileTotal = response.total || 0;
+            this.updateFileDisplay(this.files);
+        } catch (error) {
+            console.error('Failed to load more files:', error);
+        }
+    }
+    
+    filesEndpoint(cursor) {
+        // The server returns directories first, then names in order, one page at a time
+        let endpoint = `files?path=${encodeURIComponent(this.currentPath)}&limit=200`;
+        if (cursor) {
+            endpoint += `&cursor=${encodeURIComponent(cursor)}`;
+        }
+        return endpoint;
+    }
 
     updateFileDisplay(files) {
         const fileList = document.getElementById('fileList');
@@ -121,14 +245,6 @@ class USBBridgeWebUI {
             return;
         }
 
-        // Sort files: directories first, then by name
-        files.sort((a, b) => {
-            if (a.is_directory !== b.is_directory) {
-                return a.is_directory ? -1 : 1;
-            }
-            return a.name.localeCompare(b.name);
-        });
-
         const fileItems = files.map(file => {
             const icon = file.is_directory ? 
                 `<svg class="file-icon" viewBox="0 0 24 24" fill="currentColor">
@@ -153,7 +269,16 @@ class USBBridgeWebUI {
             `;
         }).join('');
 
-        fileList.innerHTML = fileItems;
+        const moreItem = this.fileCursor ? `
+                <div class="file-item" onclick="window.usbBridgeUI.loadMoreFiles()">
+                    <div class="file-info">
+                        <div class="file-name">Load more</div>
+                        <div class="file-details">${this.fileTotal - files.length} more entries</div>
+                    </div>
+                </div>
+            ` : '';
+        
+        fileList.innerHTML = fileItems + moreItem;
     }
 
     handleFileClick(filename, isDirectory) {
@@ -184,23 +309,47 @@ class USBBridgeWebUI {
         window.open(`/files${filePath}`, '_blank');
     }
 
+    downloadFolder() {
+        // The archive is generated while it downloads, so there is no wait before it starts
+        window.open(`/api/archive?path=${encodeURIComponent(this.currentPath)}&format=zip`, '_blank');
+    }
+    
     async refreshActivity() {
         try {
             const response = await this.apiCall('activity');
-            this.updateActivityDisplay(response.events || []);
+            this.activityEvents = response.events || [];
+            this.updateActivityDisplay(this.activityEvents);
         } catch (error) {
             console.error('Failed to refresh activity:', error);
-            this.updateActivityDisplay([]);
+            this.updateActivityDisplay(this.activityEvents);
         }
     }
 
     updateActivityDisplay(events) {
         const activityList = document.getElementById('activityList');
 
-        if (events.length === 0) {
+        if (events.length === 0 && this.transfers.size === 0) {
             activityList.innerHTML = '<div class="loading">No recent activity</div>';
             return;
         }
+        
+        // Transfers still running are listed above the finished events
+        const transferItems = Array.from(this.transfers.values()).map(operation => {
+            const icon = this.getActivityIcon(operation.type === 'read' ? 'moved' : 'modified');
+            const percent = operation.fileSize > 0 ?
+                Math.floor(operation.bytesProcessed * 100 / operation.fileSize) : 0;
+            
+            return `
+                <div class="activity-item">
+                    ${icon}
+                    <div class="activity-content">
+                        <div class="activity-action">${operation.type === 'read' ? 'Reading' : 'Writing'} ${percent}%</div>
+                        <div class="activity-file">${this.escapeHtml(operation.path)}</div>
+                    </div>
+                    <div class="activity-time">${this.formatBytes(operation.bytesProcessed)}</div>
+                </div>
+            `;
+        }).join('');
 
         const activityItems = events.slice(0, 10).map(event => {
             const icon = this.getActivityIcon(event.type);
@@ -219,7 +368,7 @@ class USBBridgeWebUI {
             `;
         }).join('');
 
-        activityList.innerHTML = activityItems;
+        activityList.innerHTML = transferItems + activityItems;
     }
 
     getActivityIcon(type) {
@@ -415,6 +564,7 @@ class USBBridgeWebUI {
 window.refreshStatus = () => window.usbBridgeUI.refreshStatus();
 window.refreshFiles = () => window.usbBridgeUI.refreshFiles();
 window.navigateUp = () => window.usbBridgeUI.navigateUp();
+window.downloadFolder = () => window.usbBridgeUI.downloadFolder();
 window.filterActivity = () => window.usbBridgeUI.filterActivity();
 window.showSettings = () => window.usbBridgeUI.showSettings();
 window.showLogs = () => window.usbBridgeUI.showLogs();